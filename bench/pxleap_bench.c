@@ -0,0 +1,1287 @@
+//
+// pxleap_bench
+//
+// Headless benchmark for the px.ultraleap output paths. Links the objects against the
+// stand-ins in stubs/, feeds them synthetic or recorded frames and measures every bang that produces output.
+//
+// usage: pxleap_bench [-o ultraleap|dict|all] [-n bangs] [-r rate] [-h hands] [-p recording] [-w recording]
+//                     [-i seconds] [-m objects] [-d devices] [-q depth] [-u port] [-s] [-b ms] [-a vectors]
+//                     [-l log] [-z zones] [-c templates] [-g name] [-k] [-t] [-- object arguments]
+//
+// -i measures the worker thread instead: its CPU use over that many seconds connected, with no bangs
+// (add -r 0 for a device that sends no frames), then how long stop takes to return.
+// -m connects that many objects at once, which all share one connection, and -d sets how many
+// trackers the stand-in reports. -q keeps a history of that many frames and times -n history
+// queries against it.
+// -u streams OSC to that port on 127.0.0.1 and receives -n bundles there, checking each one.
+// -s prints each object's stats report after its bangs. -b turns on @drain and bangs every that many ms,
+// reporting how many frames each bang drained and checking none went missing.
+// -a runs px.ultraleap~ for that many 64 sample vectors at 48 kHz in real time, timing the perform
+// routine and measuring how far its first signal moves from one sample to the next.
+// -l logs -n synthetic 120 Hz frames to a session log next to a raw recording of them, then checks
+// the log replays within its quantization, seeks, and still reads with its end cut off.
+// -z tests -n synthetic frames against that many trigger zones, checking every event against a
+// brute force pass, then runs each object with those zones and no bangs for 2 seconds.
+// -c classifies -n synthetic frames against a library of that many pose templates, checking the
+// index against comparing every template, then runs each object reading that library for 2 seconds.
+// -g shares each object's frames under that name while a forked process reads -n of them through
+// the C reader API, timing each one from publish to read, and a second object attached to them is banged.
+// -k packs -n synthetic frames and checks what px.ultraleap.unpack takes out of them against the hands,
+// then runs px.ultraleap with @output list and with @output packed for -n bangs each.
+// -t sends -n bangs from the main thread with Overdrive off, where isr() is false even in scheduler
+// callbacks, checking each one outputs on the next scheduler pass, once, and not before.
+//
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <math.h>
+#include <float.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "ext.h"
+#include "z_dsp.h"
+#include "leapstub.h"
+#include "pxleap_core.h"
+#include "pxleap_record.h"
+#include "pxleap_log.h"
+#include "pxleap_zones.h"
+#include "pxleap_poses.h"
+#include "pxleap_shm.h"
+#include "pxleap_features.h"
+#include "pxleap_packed.h"
+
+// entry points of the objects under test, main() is renamed at compile time. both objects
+// take every shared message through pxleap_core
+int px_ultraleap_main(void);
+void *ultraleap_new(t_symbol *s, long argc, t_atom *argv);
+int px_dict_ultraleap_main(void);
+void *px_dict_ultraleap_new(t_symbol *s, long argc, t_atom *argv);
+
+int px_ultraleap_tilde_main(void);
+void *ultraleap_tilde_new(t_symbol *s, long argc, t_atom *argv);
+void ultraleap_tilde_connect(void *x);
+
+int px_ultraleap_unpack_main(void);
+void *ultraleap_unpack_new(t_symbol *s, long argc, t_atom *argv);
+void ultraleap_unpack_list(void *x, t_symbol *s, long argc, t_atom *argv);
+
+typedef struct _bench_target
+{
+    const char *name;
+    int (*setup)(void);
+    void *(*create)(t_symbol *s, long argc, t_atom *argv);
+} t_bench_target;
+
+static const t_bench_target bench_targets[] = {
+    { "px.ultraleap", px_ultraleap_main, ultraleap_new },
+    { "px.dict.ultraleap", px_dict_ultraleap_main, px_dict_ultraleap_new },
+};
+
+#define PXLEAP_BENCH_SIGNALS 48
+
+typedef struct _bench_sample
+{
+    double latency_us;
+    t_stub_counters cost;
+} t_bench_sample;
+
+static double bench_now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e6 + (double)ts.tv_nsec / 1e3;
+}
+
+static int bench_cmp_double(const void *a, const void *b)
+{
+    double da = *(const double *)a, db = *(const double *)b;
+    return (da > db) - (da < db);
+}
+
+static double bench_percentile(const double *sorted, long n, double p)
+{
+    long i = (long)(p * (double)(n - 1) + 0.5);
+    return sorted[i < n ? i : n - 1];
+}
+
+// synthetic frame i of a 120 Hz stream, timestamps start from 0
+static void bench_synthetic(t_pxleap_frame *frame, long i, uint32_t hands)
+{
+    double t = (double)i / 120.;
+    frame->frame_id = frame->tracking_frame_id = i + 1;
+    frame->timestamp = (int64_t)(t * 1e6);
+    frame->framerate = 120.f;
+    frame->nHands = hands;
+    for (uint32_t h = 0; h < hands; h++) stub_leap_fill_hand(&frame->hands[h], h, t);
+}
+
+// the worker would drop a frame the recorder has no room for, here wait for its writer instead
+static void bench_record(t_pxleap_recorder *rec, const t_pxleap_frame *frame)
+{
+    while (!pxleap_recorder_write(rec, frame) && !atomic_load(&rec->failed)) {
+        atomic_fetch_sub(&rec->dropped, 1);
+        usleep(1000);
+    }
+}
+
+// writes synthetic 120 Hz frames to a recording as fast as the recorder takes them
+static int bench_write_recording(const char *path, long frames, uint32_t hands)
+{
+    t_pxleap_recorder *rec = pxleap_recorder_open(path);
+    t_pxleap_frame frame;
+    if (!rec) {
+        fprintf(stderr, "could not create %s\n", path);
+        return 1;
+    }
+    memset(&frame, 0, sizeof(frame));
+    for (long i = 0; i < frames; i++) {
+        bench_synthetic(&frame, i, hands);
+        bench_record(rec, &frame);
+    }
+    if (!pxleap_recorder_close(rec)) {
+        fprintf(stderr, "could not write %s\n", path);
+        return 1;
+    }
+    printf("wrote %ld frames to %s\n", frames, path);
+    return 0;
+}
+
+// the log against the raw recording of the same frames, and seeks into it
+static void bench_log(const char *path, long frames, uint32_t hands)
+{
+    char rawpath[1024], cutpath[1024];
+    double *cost = (double *)calloc((size_t)frames, sizeof(double));
+    t_pxleap_log *log = pxleap_log_open(path);
+    t_pxleap_recorder *rec;
+    t_pxleap_replay *replay, *raw;
+    t_pxleap_frame frame, check;
+    double t0, elapsed, maxjoint = 0., maxquat = 0., seekmax = 0., seektotal = 0.;
+    long stalls = 0, compared = 0, mismatched = 0, badseeks = 0, cutframes = 0;
+    uint64_t bytes, rawbytes;
+    FILE *file;
+
+    snprintf(rawpath, sizeof(rawpath), "%s.pxr", path);
+    snprintf(cutpath, sizeof(cutpath), "%s.cut", path);
+    rec = pxleap_recorder_open(rawpath);
+    if (!log || !rec) {
+        fprintf(stderr, "could not create %s or %s\n", path, rawpath);
+        return;
+    }
+    memset(&frame, 0, sizeof(frame));
+    t0 = bench_now_us();
+    for (long i = 0; i < frames; i++) {
+        double t1;
+        bench_synthetic(&frame, i, hands);
+        bench_record(rec, &frame);
+        t1 = bench_now_us();
+        // the worker would drop the frame, here wait for the writer so every frame gets compared
+        while (!pxleap_log_write(log, &frame)) {
+            stalls++;
+            atomic_fetch_sub(&log->dropped, 1);
+            usleep(1000);
+            t1 = bench_now_us();
+        }
+        cost[i] = bench_now_us() - t1;
+    }
+    bytes = pxleap_log_close(log);
+    elapsed = (bench_now_us() - t0) / 1e6;
+    rawbytes = pxleap_recorder_close(rec);
+    qsort(cost, (size_t)frames, sizeof(double), bench_cmp_double);
+    printf("%ld frames, %u hands, logged in %.2f s (%.0f frames/s), %ld waits on a full queue\n", frames, hands, elapsed, frames / elapsed, stalls);
+    printf("  log write us      p50 %8.3f  p99 %8.3f  max %8.2f\n", bench_percentile(cost, frames, 0.5), bench_percentile(cost, frames, 0.99), cost[frames - 1]);
+    printf("  bytes per frame   log %8.1f  raw %8.1f  ratio %6.1fx  MB per hour at 120 Hz %8.1f\n",
+           (double)bytes / frames, (double)rawbytes / frames, (double)rawbytes / (double)bytes, (double)bytes / frames * 120. * 3600. / 1e6);
+    free(cost);
+
+    replay = pxleap_replay_open(path);
+    raw = pxleap_replay_open(rawpath);
+    if (!replay || !raw) {
+        fprintf(stderr, "could not replay %s\n", replay ? rawpath : path);
+        return;
+    }
+    while (pxleap_replay_next(raw, &frame)) {
+        if (!pxleap_replay_next(replay, &check) || check.timestamp != frame.timestamp || check.nHands != frame.nHands
+            || check.tracking_frame_id != frame.tracking_frame_id) {
+            mismatched++;
+            break;
+        }
+        for (uint32_t h = 0; h < frame.nHands; h++) {
+            float a[PXLEAP_JOINT_COUNT * 3], b[PXLEAP_JOINT_COUNT * 3];
+            pxleap_hand_joints(&frame.hands[h], a);
+            pxleap_hand_joints(&check.hands[h], b);
+            if (frame.hands[h].id != check.hands[h].id || frame.hands[h].type != check.hands[h].type) mismatched++;
+            for (int j = 0; j < PXLEAP_JOINT_COUNT * 3; j++) if (fabs(a[j] - b[j]) > maxjoint) maxjoint = fabs(a[j] - b[j]);
+            for (int j = 0; j < 4; j++) {
+                double d = fabs(frame.hands[h].palm.orientation.v[j] - check.hands[h].palm.orientation.v[j]);
+                if (d > maxquat) maxquat = d;
+            }
+        }
+        compared++;
+    }
+    if (pxleap_replay_next(replay, &check)) mismatched++;
+    printf("  replayed          %ld frames, %ld mismatched, max joint error %.4f mm, max orientation error %.6f\n", compared, mismatched, maxjoint, maxquat);
+
+    for (long i = 0; i < 200; i++) {
+        int64_t offset = (int64_t)(rand() % (int)(frames / 120. * 1e6));
+        double t1 = bench_now_us(), us;
+        int found = pxleap_replay_seek(replay, offset);
+        us = bench_now_us() - t1;
+        seektotal += us;
+        if (us > seekmax) seekmax = us;
+        // the first frame at or after the offset, frames are 1/120 s apart from 0
+        if (!found || !pxleap_replay_next(replay, &check) || check.timestamp < offset || check.timestamp - offset >= 8334) badseeks++;
+    }
+    printf("  seek us           mean %8.2f  max %8.2f  wrong %ld of 200\n", seektotal / 200., seekmax, badseeks);
+    pxleap_replay_close(replay);
+    pxleap_replay_close(raw);
+
+    // a log that was never closed: no index, and half of its last chunk
+    file = fopen(path, "rb");
+    if (file) {
+        size_t size, cut;
+        unsigned char *data;
+        fseek(file, 0, SEEK_END);
+        size = (size_t)ftell(file);
+        rewind(file);
+        data = (unsigned char *)malloc(size);
+        if (fread(data, 1, size, file) == size) {
+            t_pxleap_log_trailer trailer;
+            FILE *out = fopen(cutpath, "wb");
+            memcpy(&trailer, data + size - sizeof(trailer), sizeof(trailer));
+            cut = (size_t)trailer.offset - 200;
+            if (out) {
+                fwrite(data, 1, cut, out);
+                fclose(out);
+            }
+            if ((replay = pxleap_replay_open(cutpath))) {
+                while (pxleap_replay_next(replay, &check)) cutframes++;
+                pxleap_replay_close(replay);
+            }
+            printf("  cut short         %ld frames read back of %ld, from %llu chunks\n", cutframes, frames,
+                   (unsigned long long)(trailer.count > 0 ? trailer.count - 1 : 0));
+        }
+        free(data);
+        fclose(file);
+    }
+}
+
+// prints the stats messages an object sends, the rest of its output is ignored
+static void bench_printstats(t_symbol *s, short ac, t_atom *av)
+{
+    if (strcmp(s->s_name, "stats")) return;
+    printf("  stats");
+    for (short i = 0; i < ac; i++) {
+        if (av[i].a_type == A_SYM) printf(" %s", av[i].a_w.w_sym->s_name);
+        else if (av[i].a_type == A_FLOAT) printf(" %.3f", av[i].a_w.w_float);
+        else printf(" %lld", (long long)av[i].a_w.w_long);
+    }
+    printf("\n");
+}
+
+static long bench_overflow;
+
+static void bench_drainhook(t_symbol *s, short ac, t_atom *av)
+{
+    if (!strcmp(s->s_name, "overflow")) bench_overflow += (long)av[0].a_w.w_long;
+    else bench_printstats(s, ac, av);
+}
+
+// @drain with a slow bang: every frame received should come out, in order, or be reported as overflow
+static void bench_drain(const t_bench_target *target, double interval, long bangs, long argc, t_atom *argv)
+{
+    double *latency = (double *)calloc((size_t)bangs, sizeof(double));
+    uint64_t calls = 0;
+    void *x;
+
+    target->setup();
+    x = target->create(gensym(target->name), argc, argv);
+    object_attr_setlong(x, gensym("drain"), 1);
+    pxleap_core_connect(x);
+    bench_overflow = 0;
+    // start from an empty window
+    pxleap_core_stats(x);
+    stub_set_anything_hook(bench_drainhook);
+    printf("%s: %ld bangs every %.0f ms with @drain 1\n", target->name, bangs, interval);
+    for (long i = 0; i < bangs; i++) {
+        t_stub_counters before;
+        double t0;
+        usleep((useconds_t)(interval * 1000.));
+        before = stub_counters;
+        t0 = bench_now_us();
+        pxleap_core_bang(x);
+        latency[i] = bench_now_us() - t0;
+        calls += stub_counters.outlet_calls - before.outlet_calls;
+    }
+    pxleap_core_stop(x);
+    pxleap_core_bang(x);
+    pxleap_core_stats(x);
+    stub_set_anything_hook(NULL);
+    object_free(x);
+    qsort(latency, (size_t)bangs, sizeof(double), bench_cmp_double);
+    printf("  bang latency us   p50 %8.2f  p90 %8.2f  max %8.2f  outlet calls per bang %8.1f\n",
+           bench_percentile(latency, bangs, 0.5), bench_percentile(latency, bangs, 0.9), latency[bangs - 1], (double)calls / bangs);
+    printf("  overflow reported %ld\n", bench_overflow);
+    free(latency);
+}
+
+// bangs from the main thread go to the scheduler, and come out of its next pass exactly once
+static void bench_mainthread(const t_bench_target *target, long bangs, long argc, t_atom *argv)
+{
+    long early = 0, outputs = 0, missed = 0, repeated = 0;
+    void *x;
+
+    target->setup();
+    x = target->create(gensym(target->name), argc, argv);
+    pxleap_core_connect(x);
+    stub_set_isr(0);
+    for (long i = 0; i < bangs; i++) {
+        uint64_t calls, frames = stub_leap_frame_count();
+        // a new frame for every bang, so each one has something to output
+        while (stub_leap_frame_count() == frames) usleep(100);
+        calls = stub_counters.outlet_calls;
+        pxleap_core_bang(x);
+        if (stub_counters.outlet_calls != calls) early++;
+        stub_run_scheduler();
+        if (stub_counters.outlet_calls == calls) missed++;
+        else outputs++;
+        calls = stub_counters.outlet_calls;
+        stub_run_scheduler();
+        if (stub_counters.outlet_calls != calls) repeated++;
+    }
+    stub_set_isr(1);
+    pxleap_core_stop(x);
+    object_free(x);
+    printf("%s: %ld bangs from the main thread\n", target->name, bangs);
+    printf("  output on the next pass %ld, before it %ld, never %ld, again after it %ld\n", outputs, early, missed, repeated);
+}
+
+// px.ultraleap~ on a dsp chain paced like an audio driver, 48 kHz and 64 sample vectors
+static void bench_signal(long vectors, long argc, t_atom *argv)
+{
+    static double buffers[PXLEAP_BENCH_SIGNALS][64];
+    double *outs[PXLEAP_BENCH_SIGNALS];
+    double *latency = (double *)calloc((size_t)vectors, sizeof(double));
+    double period = 64. / 48000. * 1e6;
+    double last = 0., maxstep = 0., totalstep = 0., next;
+    long numouts = 0;
+    uint64_t start;
+    t_object *dsp64;
+    void *x;
+
+    for (int c = 0; c < PXLEAP_BENCH_SIGNALS; c++) outs[c] = buffers[c];
+    px_ultraleap_tilde_main();
+    x = ultraleap_tilde_new(gensym("px.ultraleap~"), argc, argv);
+    for (long i = 0; i < attr_args_offset((short)argc, argv) / 2; i++) numouts += 3;
+    if (!numouts) numouts = 6;
+    dsp64 = stub_dsp64_new();
+    stub_dsp64_compile(dsp64, x, 48000., 64);
+    start = stub_leap_frame_count();
+    ultraleap_tilde_connect(x);
+    while (stub_leap_frame_count() - start < 5) usleep(1000);
+
+    next = bench_now_us();
+    for (long v = 0; v < vectors; v++) {
+        double t0, now;
+        next += period;
+        while ((now = bench_now_us()) < next) usleep((useconds_t)(next - now > 200. ? 100 : 10));
+        t0 = bench_now_us();
+        stub_dsp64_perform(dsp64, outs, numouts, 64);
+        latency[v] = bench_now_us() - t0;
+        for (int i = 0; i < 64; i++) {
+            double step = fabs(outs[0][i] - last);
+            if (v || i) {
+                totalstep += step;
+                if (step > maxstep) maxstep = step;
+            }
+            last = outs[0][i];
+        }
+    }
+    object_free(x);
+    object_free(dsp64);
+    qsort(latency, (size_t)vectors, sizeof(double), bench_cmp_double);
+    printf("px.ultraleap~: %ld signals, %ld vectors of 64 samples at 48 kHz\n", numouts, vectors);
+    printf("  perform us        p50 %8.2f  p99 %8.2f  max %8.2f  ns per sample and signal %6.2f\n",
+           bench_percentile(latency, vectors, 0.5), bench_percentile(latency, vectors, 0.99), latency[vectors - 1],
+           bench_percentile(latency, vectors, 0.5) * 1e3 / (64. * (double)numouts));
+    printf("  first signal mm   mean step %8.5f  max step %8.5f\n", totalstep / (vectors * 64. - 1.), maxstep);
+    free(latency);
+}
+
+static void bench_run(const t_bench_target *target, long bangs, const char *replay, int stats, long argc, t_atom *argv)
+{
+    t_bench_sample *samples = (t_bench_sample *)calloc((size_t)bangs, sizeof(t_bench_sample));
+    double *latency = (double *)calloc((size_t)bangs, sizeof(double));
+    t_stub_counters total;
+    long measured = 0, idle = 0;
+    double start, elapsed;
+    void *x;
+
+    target->setup();
+    x = target->create(gensym(target->name), argc, argv);
+    if (replay) {
+        object_attr_setfloat(x, gensym("speed"), 0.); // as fast as possible
+        object_attr_setlong(x, gensym("loop"), 1);
+        pxleap_core_replay(x, gensym(replay));
+    }
+    else pxleap_core_connect(x);
+
+    start = bench_now_us();
+    while (measured < bangs && bench_now_us() - start < 60e6) {
+        t_stub_counters before = stub_counters;
+        double t0, t1;
+        // push mode outputs from the scheduler, so time it together with the bang
+        t0 = bench_now_us();
+        stub_run_scheduler();
+        pxleap_core_bang(x);
+        t1 = bench_now_us();
+        if (stub_counters.outlet_calls == before.outlet_calls) {
+            // nothing new since the last bang
+            idle++;
+            usleep(20);
+            continue;
+        }
+        samples[measured].latency_us = t1 - t0;
+        samples[measured].cost.allocs = stub_counters.allocs - before.allocs;
+        samples[measured].cost.gensyms = stub_counters.gensyms - before.gensyms;
+        samples[measured].cost.outlet_calls = stub_counters.outlet_calls - before.outlet_calls;
+        samples[measured].cost.atoms_out = stub_counters.atoms_out - before.atoms_out;
+        measured++;
+    }
+    elapsed = bench_now_us() - start;
+    if (stats) {
+        stub_set_anything_hook(bench_printstats);
+        pxleap_core_stats(x);
+        stub_set_anything_hook(NULL);
+    }
+    object_free(x);
+
+    memset(&total, 0, sizeof(total));
+    for (long i = 0; i < measured; i++) {
+        latency[i] = samples[i].latency_us;
+        total.allocs += samples[i].cost.allocs;
+        total.gensyms += samples[i].cost.gensyms;
+        total.outlet_calls += samples[i].cost.outlet_calls;
+        total.atoms_out += samples[i].cost.atoms_out;
+    }
+    qsort(latency, (size_t)measured, sizeof(double), bench_cmp_double);
+
+    printf("%s: %ld output bangs, %ld idle bangs, %.0f frames/s output\n", target->name, measured, idle, measured / (elapsed / 1e6));
+    if (measured) {
+        double n = (double)measured;
+        printf("  bang latency us   p50 %8.2f  p90 %8.2f  p99 %8.2f  max %8.2f\n",
+               bench_percentile(latency, measured, 0.5), bench_percentile(latency, measured, 0.9),
+               bench_percentile(latency, measured, 0.99), latency[measured - 1]);
+        printf("  per frame         allocs %6.1f  gensyms %6.1f  outlet calls %6.1f  atoms %6.1f\n",
+               total.allocs / n, total.gensyms / n, total.outlet_calls / n, total.atoms_out / n);
+    }
+    free(samples);
+    free(latency);
+}
+
+static double bench_cpu_us(void)
+{
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return (double)(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1e6 + (double)(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec);
+}
+
+// worker CPU while nobody bangs, the main thread only sleeps so the process total is the worker's
+static void bench_idle(const t_bench_target *target, double seconds, long objects, const char *replay, long argc, t_atom *argv)
+{
+    const long cycles = 50;
+    double stops[50];
+    double cpu, wall, polls, worst = 0., sum = 0.;
+    void *others[63];
+    void *x;
+
+    target->setup();
+    x = target->create(gensym(target->name), argc, argv);
+    if (replay) pxleap_core_replay(x, gensym(replay));
+    else pxleap_core_connect(x);
+    for (long i = 0; i < objects - 1; i++) {
+        others[i] = target->create(gensym(target->name), argc, argv);
+        if (replay) pxleap_core_replay(others[i], gensym(replay));
+        else pxleap_core_connect(others[i]);
+    }
+    usleep(100000); // let it settle
+    polls = (double)stub_leap_poll_count();
+    cpu = bench_cpu_us();
+    wall = bench_now_us();
+    usleep((useconds_t)(seconds * 1e6));
+    cpu = bench_cpu_us() - cpu;
+    wall = bench_now_us() - wall;
+    polls = (double)stub_leap_poll_count() - polls;
+    printf("%s: worker cpu %.3f%% of a core, %.0f polls/s over %.1f s, %ld objects\n", target->name, 100. * cpu / wall, polls / (wall / 1e6), wall / 1e6, objects);
+
+    // stop right after a (re)start and at random points while running
+    for (long i = 0; i < cycles; i++) {
+        double t0;
+        usleep((useconds_t)(rand() % 20000));
+        t0 = bench_now_us();
+        pxleap_core_stop(x);
+        stops[i] = bench_now_us() - t0;
+        sum += stops[i];
+        if (stops[i] > worst) worst = stops[i];
+        if (replay) pxleap_core_replay(x, gensym(replay));
+        else pxleap_core_connect(x);
+    }
+    qsort(stops, (size_t)cycles, sizeof(double), bench_cmp_double);
+    printf("  stop latency us   p50 %8.1f  mean %8.1f  max %8.1f\n", bench_percentile(stops, cycles, 0.5), sum / cycles, worst);
+    object_free(x);
+    for (long i = 0; i < objects - 1; i++) object_free(others[i]);
+}
+
+// history queries against a full ring while the worker keeps pushing
+static void bench_history(const t_bench_target *target, long depth, long queries, long argc, t_atom *argv)
+{
+    double *latency = (double *)calloc((size_t)queries, sizeof(double));
+    t_stub_counters before;
+    double calls, allocs;
+    uint64_t start;
+    void *x;
+
+    target->setup();
+    x = target->create(gensym(target->name), argc, argv);
+    object_attr_setlong(x, gensym("depth"), depth);
+    start = stub_leap_frame_count();
+    pxleap_core_connect(x);
+    while ((long)(stub_leap_frame_count() - start) < depth + 10) usleep(1000);
+    before = stub_counters;
+    for (long i = 0; i < queries; i++) {
+        double t0 = bench_now_us();
+        if (i & 1) pxleap_core_since(x, 100.);
+        else pxleap_core_history(x, depth);
+        latency[i] = bench_now_us() - t0;
+    }
+    calls = (double)(stub_counters.outlet_calls - before.outlet_calls);
+    allocs = (double)(stub_counters.allocs - before.allocs);
+    object_free(x);
+    qsort(latency, (size_t)queries, sizeof(double), bench_cmp_double);
+    printf("%s: %ld queries of a %ld frame history, alternating history %ld and since 100\n", target->name, queries, depth, depth);
+    printf("  query latency us  p50 %8.2f  p90 %8.2f  p99 %8.2f  max %8.2f\n",
+           bench_percentile(latency, queries, 0.5), bench_percentile(latency, queries, 0.9),
+           bench_percentile(latency, queries, 0.99), latency[queries - 1]);
+    printf("  per query         allocs %6.1f  outlet calls %8.1f\n", allocs / queries, calls / queries);
+    free(latency);
+}
+
+// receives the OSC the worker sends over loopback, checking each bundle starts with the frame message
+static void bench_osc(const t_bench_target *target, int port, long bundles, long argc, t_atom *argv)
+{
+    struct sockaddr_in addr;
+    struct timeval timeout = { 1, 0 };
+    unsigned char packet[65536];
+    t_atom dest[2];
+    long received = 0, bad = 0;
+    double bytes = 0., t0, elapsed;
+    uint64_t frames;
+    void *x;
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (sock < 0 || bind(sock, (struct sockaddr *)&addr, sizeof(addr))) {
+        fprintf(stderr, "could not listen on port %d\n", port);
+        if (sock >= 0) close(sock);
+        return;
+    }
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    target->setup();
+    x = target->create(gensym(target->name), argc, argv);
+    atom_setsym(dest, gensym("127.0.0.1"));
+    atom_setlong(dest + 1, port);
+    pxleap_core_osc(x, gensym("osc"), 2, dest);
+    pxleap_core_connect(x);
+    frames = stub_leap_frame_count();
+    t0 = bench_now_us();
+    while (received < bundles) {
+        ssize_t n = recv(sock, packet, sizeof(packet), 0);
+        if (n <= 0) break;
+        if (n < 32 || memcmp(packet, "#bundle", 8) || memcmp(packet + 20, "/leap/frame", 12)) bad++;
+        received++;
+        bytes += (double)n;
+    }
+    elapsed = (bench_now_us() - t0) / 1e6;
+    frames = stub_leap_frame_count() - frames;
+    object_free(x);
+    close(sock);
+    printf("%s: %ld bundles in %.2f s for %llu frames, %ld malformed\n", target->name, received, elapsed, (unsigned long long)frames, bad);
+    printf("  bundles/s %8.1f  bytes per bundle %8.1f\n", received / elapsed, received ? bytes / received : 0.);
+}
+
+// the zones a -z run tests against, scattered through the space the synthetic hands move in
+static void bench_makezones(long count, t_atom *argv, long *argc)
+{
+    srand(1);
+    for (long i = 0; i < count; i++) {
+        t_atom *a = argv + i * 8;
+        char name[16];
+        float cx = (float)(rand() % 300 - 150), cy = (float)(rand() % 140 + 150), cz = (float)(rand() % 100 - 50);
+        float size = (float)(rand() % 50 + 10);
+        snprintf(name, sizeof(name), "z%ld", i);
+        atom_setsym(a, gensym(name));
+        if (i % 8 == 7) {
+            // a plane through the point, facing somewhere along x
+            atom_setsym(a + 1, gensym("plane"));
+            atom_setfloat(a + 2, cx);
+            atom_setfloat(a + 3, cy);
+            atom_setfloat(a + 4, cz);
+            atom_setfloat(a + 5, i % 16 == 7 ? 1. : -1.);
+            atom_setfloat(a + 6, 0.2);
+            atom_setfloat(a + 7, 0.);
+            argc[i] = 8;
+        }
+        else if (i % 2) {
+            atom_setsym(a + 1, gensym("sphere"));
+            atom_setfloat(a + 2, cx);
+            atom_setfloat(a + 3, cy);
+            atom_setfloat(a + 4, cz);
+            atom_setfloat(a + 5, size);
+            argc[i] = 6;
+        }
+        else {
+            atom_setsym(a + 1, gensym("box"));
+            atom_setfloat(a + 2, cx - size);
+            atom_setfloat(a + 3, cy - size);
+            atom_setfloat(a + 4, cz - size);
+            atom_setfloat(a + 5, cx + size);
+            atom_setfloat(a + 6, cy + size * 0.5);
+            atom_setfloat(a + 7, cz + size);
+            argc[i] = 8;
+        }
+    }
+}
+
+// every zone against every joint, the answer the grid has to match
+static int bench_zonecontains(const t_atom *a, const float *p)
+{
+    const char *shape = atom_getsym(a + 1)->s_name;
+    float v[6];
+    for (int k = 0; k < 6; k++) v[k] = (float)atom_getfloat(a + 2 + k);
+    if (!strcmp(shape, "box")) return p[0] >= v[0] && p[0] <= v[3] && p[1] >= v[1] && p[1] <= v[4] && p[2] >= v[2] && p[2] <= v[5];
+    if (!strcmp(shape, "sphere"))
+        return (p[0] - v[0]) * (p[0] - v[0]) + (p[1] - v[1]) * (p[1] - v[1]) + (p[2] - v[2]) * (p[2] - v[2]) <= v[3] * v[3];
+    return ((p[0] - v[0]) * v[3] + (p[1] - v[1]) * v[4] + (p[2] - v[2]) * v[5]) / sqrtf(v[3] * v[3] + v[4] * v[4] + v[5] * v[5]) >= 0.f;
+}
+
+// pxleap_zones on its own: cost per frame, and every event checked against a brute force pass
+static void bench_zones(long count, long frames, uint32_t hands)
+{
+    t_pxleap_zones *z = (t_pxleap_zones *)malloc(sizeof(t_pxleap_zones));
+    t_atom *zoneargv = (t_atom *)calloc((size_t)count * 8, sizeof(t_atom));
+    long *zoneargc = (long *)calloc((size_t)count, sizeof(long));
+    double *cost = (double *)calloc((size_t)frames, sizeof(double));
+    static unsigned char inside[2][PXLEAP_ZONES_PROBES][PXLEAP_ZONES_MAX];
+    static int64_t entered[2][PXLEAP_ZONES_PROBES][PXLEAP_ZONES_MAX];
+    static unsigned char dwelt[2][PXLEAP_ZONES_PROBES][PXLEAP_ZONES_MAX];
+    long events[3] = { 0, 0, 0 }, wrong = 0;
+    int64_t dwell = 250000;
+    t_pxleap_frame frame;
+
+    memset(inside, 0, sizeof(inside));
+    memset(dwelt, 0, sizeof(dwelt));
+    pxleap_zones_init(z);
+    pxleap_zones_setdwell(z, dwell / 1000.);
+    bench_makezones(count, zoneargv, zoneargc);
+    for (long i = 0; i < count; i++) {
+        const char *error = pxleap_zones_add(z, zoneargc[i], zoneargv + i * 8);
+        if (error) fprintf(stderr, "zone %ld: %s\n", i, error);
+    }
+    memset(&frame, 0, sizeof(frame));
+    for (long i = 0; i < frames; i++) {
+        t_pxleap_zone_event e;
+        t_symbol *name;
+        double t0;
+        // hands drop out now and then, which leaves every zone they were in
+        bench_synthetic(&frame, i, (i / 240) % 5 == 4 ? hands - 1 : hands);
+        t0 = bench_now_us();
+        pxleap_zones_apply(z, &frame);
+        cost[i] = bench_now_us() - t0;
+
+        for (int t = 0; t < 2; t++) {
+            for (int p = 0; p < PXLEAP_ZONES_PROBES; p++) {
+                unsigned char now[PXLEAP_ZONES_MAX];
+                memset(now, 0, sizeof(now));
+                for (uint32_t h = 0; h < frame.nHands; h++) {
+                    const LEAP_HAND *hand = &frame.hands[h];
+                    if ((hand->type == eLeapHandType_Left ? 0 : 1) != t) continue;
+                    for (long zi = 0; zi < count; zi++)
+                        now[zi] |= bench_zonecontains(zoneargv + zi * 8, p ? hand->digits[p - 1].bones[3].next_joint.v : hand->palm.position.v);
+                }
+                // the order pxleap_zones_apply queues them in: exits, enters, then dwells, by zone
+                for (int pass = 0; pass < 3; pass++) {
+                    for (long zi = 0; zi < count; zi++) {
+                        int type = -1;
+                        if (pass == 0 && inside[t][p][zi] && !now[zi]) type = PXLEAP_ZONE_EXIT;
+                        if (pass == 1 && !inside[t][p][zi] && now[zi]) type = PXLEAP_ZONE_ENTER;
+                        if (pass == 2 && now[zi] && !dwelt[t][p][zi] && frame.timestamp - entered[t][p][zi] >= dwell) type = PXLEAP_ZONE_DWELL;
+                        if (type < 0) continue;
+                        if (!pxleap_zones_pop(z, &e, &name) || e.type != type || e.zone != zi || e.hand != t || e.probe != p
+                            || strcmp(name->s_name, atom_getsym(zoneargv + zi * 8)->s_name))
+                            wrong++;
+                        events[type]++;
+                        if (type == PXLEAP_ZONE_ENTER) entered[t][p][zi] = frame.timestamp;
+                        if (type == PXLEAP_ZONE_DWELL) dwelt[t][p][zi] = 1;
+                    }
+                    if (pass == 1) {
+                        for (long zi = 0; zi < count; zi++) {
+                            if (!now[zi]) dwelt[t][p][zi] = 0;
+                            inside[t][p][zi] = now[zi];
+                        }
+                    }
+                }
+            }
+        }
+        // nothing left over that the brute force pass didn't expect
+        while (pxleap_zones_pop(z, &e, &name)) wrong++;
+    }
+    qsort(cost, (size_t)frames, sizeof(double), bench_cmp_double);
+    printf("%ld zones, %ld frames, %u hands, dwell %.0f ms\n", count, frames, hands, dwell / 1000.);
+    printf("  apply us          p50 %8.3f  p99 %8.3f  max %8.2f\n", bench_percentile(cost, frames, 0.5), bench_percentile(cost, frames, 0.99), cost[frames - 1]);
+    printf("  events            enter %ld  exit %ld  dwell %ld  (%.3f per frame), %ld wrong, %llu dropped\n", events[PXLEAP_ZONE_ENTER], events[PXLEAP_ZONE_EXIT],
+           events[PXLEAP_ZONE_DWELL], (double)(events[0] + events[1] + events[2]) / frames, wrong, (unsigned long long)atomic_load(&z->dropped));
+    free(z);
+    free(zoneargv);
+    free(zoneargc);
+    free(cost);
+}
+
+static long bench_zonemessages;
+
+static void bench_zonehook(t_symbol *s, short ac, t_atom *av)
+{
+    if (!strcmp(s->s_name, "zone")) bench_zonemessages++;
+}
+
+// an object with zones and no bangs: what reaches the patch while the hands move through them
+static void bench_zoneobject(const t_bench_target *target, long count, double seconds, long argc, t_atom *argv)
+{
+    t_atom *zoneargv = (t_atom *)calloc((size_t)count * 8, sizeof(t_atom));
+    long *zoneargc = (long *)calloc((size_t)count, sizeof(long));
+    void (*zone)(void *x, t_symbol *s, long argc, t_atom *argv);
+    uint64_t frames, calls;
+    double t0;
+    void *x;
+
+    target->setup();
+    x = target->create(gensym(target->name), argc, argv);
+    zone = (void (*)(void *, t_symbol *, long, t_atom *))stub_getmethod(x, "zone");
+    bench_makezones(count, zoneargv, zoneargc);
+    for (long i = 0; i < count; i++) {
+        t_atom add[9];
+        atom_setsym(add, gensym("add"));
+        memcpy(add + 1, zoneargv + i * 8, sizeof(t_atom) * (size_t)zoneargc[i]);
+        zone(x, gensym("zone"), zoneargc[i] + 1, add);
+    }
+    bench_zonemessages = 0;
+    stub_set_anything_hook(bench_zonehook);
+    pxleap_core_connect(x);
+    frames = stub_leap_frame_count();
+    calls = stub_counters.outlet_calls;
+    t0 = bench_now_us();
+    while (bench_now_us() - t0 < seconds * 1e6) {
+        stub_run_scheduler();
+        usleep(1000);
+    }
+    pxleap_core_stop(x);
+    stub_run_scheduler();
+    frames = stub_leap_frame_count() - frames;
+    calls = stub_counters.outlet_calls - calls;
+    stub_set_anything_hook(NULL);
+    object_free(x);
+    printf("%s: %llu frames through %ld zones in %.1f s with no bangs\n", target->name, (unsigned long long)frames, count, seconds);
+    printf("  zone messages     %ld  (%.3f per frame)  outlet calls per frame %.3f\n", bench_zonemessages,
+           frames ? (double)bench_zonemessages / frames : 0., frames ? (double)calls / frames : 0.);
+    free(zoneargv);
+    free(zoneargc);
+}
+
+// a library of count templates from the synthetic hands at random times, each jittered a little and
+// labelled by how far the hand is curled, written the way pxleap_poses_write lays a library out
+static int bench_makeposes(const char *path, long count)
+{
+    t_pxleap_poses_header header;
+    t_pxleap_poses_record record;
+    FILE *file = fopen(path, "wb");
+    if (!file) return 0;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, PXLEAP_POSES_MAGIC, 8);
+    header.version = PXLEAP_POSES_VERSION;
+    header.points = PXLEAP_POSES_POINTS;
+    header.count = (uint32_t)count;
+    fwrite(&header, sizeof(header), 1, file);
+    srand(2);
+    for (long i = 0; i < count; i++) {
+        LEAP_HAND hand;
+        float v[PXLEAP_POSES_DIMS];
+        double t = 30. * rand() / RAND_MAX;
+        uint32_t index = (uint32_t)(rand() % 2);
+        float curl = 0.5f + 0.5f * (float)sin(t * 2.1 + index);
+        stub_leap_fill_hand(&hand, index, t);
+        pxleap_poses_vector(&hand, v);
+        memset(&record, 0, sizeof(record));
+        snprintf(record.label, sizeof(record.label), "curl%d", curl < 1.f ? (int)(curl * 8.f) : 7);
+        for (int k = 0; k < PXLEAP_POSES_POINTS * 3; k++) record.v[k] = v[k] + 0.06f * ((float)rand() / RAND_MAX - 0.5f);
+        fwrite(&record, sizeof(record), 1, file);
+    }
+    return !fclose(file);
+}
+
+// pxleap_poses on its own: cost per frame, and the index checked against comparing every template
+static void bench_poses(const char *path, long count, long frames, uint32_t hands)
+{
+    t_pxleap_poses *p = (t_pxleap_poses *)malloc(sizeof(t_pxleap_poses));
+    double *cost = (double *)calloc((size_t)frames, sizeof(double));
+    long queries = 0, wrong = 0, budgeted = 0, bucketed = 0, events = 0, seen = 0;
+    uint64_t compared;
+    t_pxleap_frame frame;
+    long read;
+
+    pxleap_poses_init(p);
+    read = pxleap_poses_read(p, path);
+    if (read != count) {
+        fprintf(stderr, "read %ld of %ld pose templates from %s\n", read, count, path);
+        free(p);
+        free(cost);
+        return;
+    }
+    memset(&frame, 0, sizeof(frame));
+    for (long i = 0; i < frames; i++) {
+        t_pxleap_pose_event e;
+        double t0;
+        bench_synthetic(&frame, i, (i / 240) % 5 == 4 ? hands - 1 : hands);
+        t0 = bench_now_us();
+        pxleap_poses_apply(p, &frame);
+        cost[i] = bench_now_us() - t0;
+        seen += frame.nHands;
+        while (pxleap_poses_pop(p, &e)) events++;
+
+        // a tenth of the frames again, without the budget and against every template
+        if (i % 10) continue;
+        for (uint32_t h = 0; h < frame.nHands; h++) {
+            float v[PXLEAP_POSES_DIMS];
+            t_pxleap_pose_match m, exact;
+            float best = FLT_MAX, other = FLT_MAX;
+            t_symbol *label = NULL;
+            double curl = 0.5 + 0.5 * sin((double)i / 120. * 2.1 + h);
+            char bucket[16];
+            pxleap_poses_vector(&frame.hands[h], v);
+            pxleap_poses_classify(p->libs[p->front], v, PXLEAP_POSES_BUDGET, &m);
+            pxleap_poses_classify(p->libs[p->front], v, UINT32_MAX, &exact);
+            for (uint32_t k = 0; k < p->count; k++) {
+                float d = 0.f;
+                for (int c = 0; c < PXLEAP_POSES_DIMS; c++) d += (v[c] - p->vectors[k][c]) * (v[c] - p->vectors[k][c]);
+                if (d < best) {
+                    if (p->labels[k] != label) other = best;
+                    best = d;
+                    label = p->labels[k];
+                }
+                else if (d < other && p->labels[k] != label) other = d;
+            }
+            // ties between labels can go either way, the distances can't
+            if (fabsf(exact.distance - best) > 1e-4f * (1.f + best) || (other < FLT_MAX && fabsf(exact.other - other) > 1e-4f * (1.f + other)))
+                wrong++;
+            if (m.label != exact.label) budgeted++;
+            snprintf(bucket, sizeof(bucket), "curl%d", curl < 1. ? (int)(curl * 8.) : 7);
+            if (exact.label == gensym(bucket)) bucketed++;
+            queries++;
+        }
+    }
+    compared = atomic_load(&p->compared);
+    qsort(cost, (size_t)frames, sizeof(double), bench_cmp_double);
+    printf("%ld templates (%u clusters), %ld frames, %u hands\n", count, p->libs[p->front] ? p->libs[p->front]->nclusters : 0, frames, hands);
+    printf("  apply us          p50 %8.3f  p99 %8.3f  max %8.2f\n", bench_percentile(cost, frames, 0.5), bench_percentile(cost, frames, 0.99), cost[frames - 1]);
+    printf("  per hand          %.1f compared, %llu over budget\n", seen ? (double)compared / seen : 0., (unsigned long long)atomic_load(&p->truncated));
+    printf("  checked           %ld hands, %ld wrong, %ld changed by the budget, %.1f%% in their curl bucket, %.3f pose changes per frame\n", queries, wrong, budgeted,
+           queries ? 100. * bucketed / queries : 0., (double)events / frames);
+    pxleap_poses_free(p);
+    free(p);
+    free(cost);
+}
+
+static long bench_posemessages;
+
+static void bench_posehook(t_symbol *s, short ac, t_atom *av)
+{
+    if (!strcmp(s->s_name, "pose")) bench_posemessages++;
+}
+
+// an object reading the library and classifying with no bangs: what reaches the patch
+static void bench_poseobject(const t_bench_target *target, const char *path, double seconds, long argc, t_atom *argv)
+{
+    void (*pose)(void *x, t_symbol *s, long argc, t_atom *argv);
+    uint64_t frames;
+    t_atom read[2];
+    double t0;
+    void *x;
+
+    target->setup();
+    x = target->create(gensym(target->name), argc, argv);
+    pose = (void (*)(void *, t_symbol *, long, t_atom *))stub_getmethod(x, "pose");
+    atom_setsym(read, gensym("read"));
+    atom_setsym(read + 1, gensym(path));
+    pose(x, gensym("pose"), 2, read);
+    bench_posemessages = 0;
+    stub_set_anything_hook(bench_posehook);
+    pxleap_core_connect(x);
+    frames = stub_leap_frame_count();
+    t0 = bench_now_us();
+    while (bench_now_us() - t0 < seconds * 1e6) {
+        stub_run_scheduler();
+        usleep(1000);
+    }
+    pxleap_core_stop(x);
+    stub_run_scheduler();
+    frames = stub_leap_frame_count() - frames;
+    stub_set_anything_hook(NULL);
+    object_free(x);
+    printf("%s: %llu frames classified in %.1f s with no bangs\n", target->name, (unsigned long long)frames, seconds);
+    printf("  pose messages     %ld  (%.3f per frame)\n", bench_posemessages, frames ? (double)bench_posemessages / frames : 0.);
+}
+
+// a forked process reading frames through the C reader API, the way a program outside Max would
+static void bench_shmreader(const char *name, long frames)
+{
+    t_pxleap_shmreader *r = pxleap_shmreader_open(name);
+    double *latency = (double *)calloc((size_t)frames, sizeof(double));
+    long read = 0, gaps = 0;
+    int64_t last = 0;
+    double t0 = bench_now_us();
+    t_pxleap_frame frame;
+    while (r && read < frames && bench_now_us() - t0 < 20e6) {
+        if (!pxleap_shmreader_next(r, &frame)) {
+            usleep(100);
+            continue;
+        }
+        // published is CLOCK_MONOTONIC in ns, the same clock in every process
+        latency[read++] = (double)(pxleap_now_ns() - frame.published) / 1000.;
+        if (last && frame.frame_id != last + 1) gaps++;
+        last = frame.frame_id;
+    }
+    qsort(latency, (size_t)read, sizeof(double), bench_cmp_double);
+    printf("  other process     %ld frames read, %ld gaps in frame ids, %llu missed\n", read, gaps, r ? (unsigned long long)r->missed : 0ULL);
+    if (read)
+        printf("  writer to reader  p50 %8.1f us  p99 %8.1f us  max %8.1f us (polling every 100 us)\n", bench_percentile(latency, read, 0.5),
+               bench_percentile(latency, read, 0.99), latency[read - 1]);
+    fflush(stdout);
+    pxleap_shmreader_close(r);
+    free(latency);
+}
+
+// an object sharing its frames, read by another process and by a second object attached to them
+static void bench_shm(const t_bench_target *target, const char *name, long frames, long argc, t_atom *argv)
+{
+    void (*share)(void *x, t_symbol *s);
+    void (*attach)(void *x, t_symbol *s);
+    long output = 0, idle = 0;
+    uint64_t sent;
+    int status;
+    pid_t pid;
+    void *x, *y;
+
+    printf("%s: sharing as %s\n", target->name, name);
+    fflush(stdout);
+    pid = fork();
+    if (pid == 0) {
+        bench_shmreader(name, frames);
+        _exit(0);
+    }
+    target->setup();
+    x = target->create(gensym(target->name), argc, argv);
+    y = target->create(gensym(target->name), argc, argv);
+    share = (void (*)(void *, t_symbol *))stub_getmethod(x, "share");
+    attach = (void (*)(void *, t_symbol *))stub_getmethod(y, "attach");
+    share(x, gensym(name));
+    attach(y, gensym(name));
+    pxleap_core_connect(x);
+    sent = stub_leap_frame_count();
+    while (pid > 0 && waitpid(pid, &status, WNOHANG) == 0) {
+        uint64_t before = stub_counters.outlet_calls;
+        pxleap_core_bang(y);
+        if (stub_counters.outlet_calls != before) output++;
+        else idle++;
+        usleep(500);
+    }
+    sent = stub_leap_frame_count() - sent;
+    pxleap_core_stop(x);
+    object_free(y);
+    object_free(x);
+    printf("  attached object   %ld output bangs, %ld idle bangs, %llu frames from the device\n", output, idle, (unsigned long long)sent);
+}
+
+// the lists px.ultraleap.unpack sent for one frame, in the order it sent them
+#define PXLEAP_BENCH_UNPACKED 8
+static t_atom bench_unpacked[PXLEAP_BENCH_UNPACKED][PXLEAP_PACKED_STRIDE_MAX];
+static long bench_unpackedcount[PXLEAP_BENCH_UNPACKED];
+static long bench_unpackedlists;
+
+static void bench_unpackhook(short ac, t_atom *av)
+{
+    if (bench_unpackedlists < PXLEAP_BENCH_UNPACKED && ac <= PXLEAP_PACKED_STRIDE_MAX) {
+        memcpy(bench_unpacked[bench_unpackedlists], av, sizeof(t_atom) * (size_t)ac);
+        bench_unpackedcount[bench_unpackedlists] = ac;
+    }
+    bench_unpackedlists++;
+}
+
+// whether list n out of the unpack object holds exactly these values
+static int bench_unpackmatch(long n, const float *v, long count)
+{
+    if (n >= bench_unpackedlists || n >= PXLEAP_BENCH_UNPACKED || bench_unpackedcount[n] != count) return 0;
+    for (long i = 0; i < count; i++) {
+        if (atom_getfloat(&bench_unpacked[n][i]) != (double)v[i]) return 0;
+    }
+    return 1;
+}
+
+// a finger as the packed list holds it, the plan's joints from base to tip
+static long bench_finger(float *dst, const t_pxleap_plan *plan, const LEAP_HAND *hand, int d)
+{
+    for (long j = 0; j < plan->njoints; j++) memcpy(dst + j * 3, hand->digits[d].bones[plan->firstjoint + j].next_joint.v, 3 * sizeof(float));
+    return plan->njoints * 3;
+}
+
+// packs synthetic two hand frames, every other one with only palms and tips and no features so the unpack
+// object has to lay the list out again, and compares what it sends with the hands the frames were made from
+static void bench_packed(long frames)
+{
+    t_pxleap_plan plans[2];
+    t_pxleap_packed_layout layouts[2];
+    uint32_t groups[2] = { PXLEAP_FEATURE_VELOCITY | PXLEAP_FEATURE_GRIP | PXLEAP_FEATURE_CURL, 0 };
+    t_atom packed[PXLEAP_PACKED_MAX], args[10];
+    const char *parts[10] = { "frame", "left", "palm", "thumb", "curl", "right", "palm", "pinky", "grip", "hands" };
+    double *packcost = (double *)calloc((size_t)frames, sizeof(double));
+    double *unpackcost = (double *)calloc((size_t)frames, sizeof(double));
+    t_pxleap_frame frame;
+    long mismatches = 0, length = 0;
+    void *x;
+
+    pxleap_plan_compile(&plans[0], PXLEAP_FIELD_ALL);
+    pxleap_plan_compile(&plans[1], PXLEAP_FIELD_PALM | PXLEAP_FIELD_TIPS);
+    for (int k = 0; k < 2; k++) pxleap_packed_layout(&layouts[k], plans[k].fields, groups[k]);
+    px_ultraleap_unpack_main();
+    for (int i = 0; i < 10; i++) atom_setsym(args + i, gensym(parts[i]));
+    x = ultraleap_unpack_new(gensym("px.ultraleap.unpack"), 10, args);
+    memset(&frame, 0, sizeof(frame));
+    stub_set_list_hook(bench_unpackhook);
+    for (long i = 0; i < frames; i++) {
+        int k = (int)(i & 1);
+        const t_pxleap_plan *plan = &plans[k];
+        const LEAP_HAND *left, *right;
+        float v[PXLEAP_PACKED_STRIDE_MAX];
+        long n = 0, count;
+        double t0, t1, t2;
+        bench_synthetic(&frame, i, 2);
+        left = &frame.hands[0];
+        right = &frame.hands[1];
+        frame.featuregroups = groups[k];
+        for (int h = 0; h < 2; h++) {
+            t_pxleap_features *f = &frame.features[h];
+            for (int c = 0; c < 3; c++) f->palm_velocity[c] = (float)(i + h + c);
+            f->pinch_distance = (float)i * 0.5f;
+            f->pinch_strength = frame.hands[h].pinch_strength;
+            f->grab_strength = frame.hands[h].grab_strength;
+            f->grab_angle = frame.hands[h].grab_angle;
+            for (int d = 0; d < 5; d++) f->curl[d] = (float)(i % 180) + (float)d + (float)h * 0.25f;
+        }
+        bench_unpackedlists = 0;
+        t0 = bench_now_us();
+        length = pxleap_packed_write(packed, &layouts[k], plan, &frame);
+        t1 = bench_now_us();
+        ultraleap_unpack_list(x, gensym("list"), length, packed);
+        t2 = bench_now_us();
+        packcost[i] = t1 - t0;
+        unpackcost[i] = t2 - t1;
+        // right to left: right grip, pinky and palm, then left curl, thumb and palm
+        if (groups[k] & PXLEAP_FEATURE_GRIP) {
+            const t_pxleap_features *f = &frame.features[1];
+            float grip[4] = { f->pinch_distance, f->pinch_strength, f->grab_strength, f->grab_angle };
+            if (!bench_unpackmatch(n++, grip, 4)) mismatches++;
+        }
+        count = bench_finger(v, plan, right, 4);
+        if (!bench_unpackmatch(n++, v, count)) mismatches++;
+        if (!bench_unpackmatch(n++, right->palm.position.v, 3)) mismatches++;
+        if ((groups[k] & PXLEAP_FEATURE_CURL) && !bench_unpackmatch(n++, frame.features[0].curl, 5)) mismatches++;
+        count = bench_finger(v, plan, left, 0);
+        if (!bench_unpackmatch(n++, v, count)) mismatches++;
+        if (!bench_unpackmatch(n++, left->palm.position.v, 3)) mismatches++;
+        if (bench_unpackedlists != n) mismatches++;
+    }
+    stub_set_list_hook(NULL);
+    object_free(x);
+    qsort(packcost, (size_t)frames, sizeof(double), bench_cmp_double);
+    qsort(unpackcost, (size_t)frames, sizeof(double), bench_cmp_double);
+    printf("packed: %ld frames, %ld and %ld atoms, %ld mismatches unpacking\n", frames,
+           PXLEAP_PACKED_HEADER + PXLEAP_MAX_HANDS * layouts[0].stride, PXLEAP_PACKED_HEADER + PXLEAP_MAX_HANDS * layouts[1].stride, mismatches);
+    printf("  pack us           p50 %8.3f  p99 %8.3f\n", bench_percentile(packcost, frames, 0.5), bench_percentile(packcost, frames, 0.99));
+    printf("  unpack us         p50 %8.3f  p99 %8.3f  (6 outlets)\n", bench_percentile(unpackcost, frames, 0.5), bench_percentile(unpackcost, frames, 0.99));
+    free(packcost);
+    free(unpackcost);
+}
+
+static void bench_parse_atoms(int argc, char **argv, long *ac, t_atom *av)
+{
+    for (int i = 0; i < argc; i++) {
+        char *end;
+        double v = strtod(argv[i], &end);
+        if (*end || !*argv[i]) atom_setsym(av + i, gensym(argv[i]));
+        else if (strchr(argv[i], '.')) atom_setfloat(av + i, v);
+        else atom_setlong(av + i, (t_atom_long)v);
+    }
+    *ac = argc;
+}
+
+int main(int argc, char **argv)
+{
+    const char *object = "all";
+    const char *replay = NULL;
+    const char *write = NULL;
+    const char *logpath = NULL;
+    const char *shared = NULL;
+    double idle = 0.;
+    long bangs = 2000;
+    double rate = 1000.;
+    long hands = 2;
+    long objects = 1;
+    long devices = 1;
+    long depth = 0;
+    int port = 0;
+    int stats = 0;
+    double drain = 0.;
+    long vectors = 0;
+    long zones = 0;
+    long templates = 0;
+    int packed = 0;
+    int mainthread = 0;
+    long objargc = 0;
+    t_atom objargv[64];
+    int opt;
+
+    while ((opt = getopt(argc, argv, "o:n:r:h:p:w:i:m:d:q:u:sb:a:l:z:c:g:kt")) != -1) {
+        switch (opt) {
+            case 'o': object = optarg; break;
+            case 'n': bangs = atol(optarg); break;
+            case 'r': rate = atof(optarg); break;
+            case 'h': hands = atol(optarg); break;
+            case 'p': replay = optarg; break;
+            case 'w': write = optarg; break;
+            case 'i': idle = atof(optarg); break;
+            case 'm': objects = atol(optarg); break;
+            case 'd': devices = atol(optarg); break;
+            case 'q': depth = atol(optarg); break;
+            case 'u': port = atoi(optarg); break;
+            case 's': stats = 1; break;
+            case 'b': drain = atof(optarg); break;
+            case 'a': vectors = atol(optarg); break;
+            case 'l': logpath = optarg; break;
+            case 'z': zones = atol(optarg); break;
+            case 'c': templates = atol(optarg); break;
+            case 'g': shared = optarg; break;
+            case 'k': packed = 1; break;
+            case 't': mainthread = 1; break;
+            default:
+                fprintf(stderr, "usage: %s [-o ultraleap|dict|all] [-n bangs] [-r rate] [-h hands] [-p recording] [-w recording] [-i seconds] [-m objects] [-d devices] [-q depth] [-u port] [-s] [-b ms] [-a vectors] [-l log] [-z zones] [-c templates] [-g name] [-k] [-t] [-- object arguments]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (argc - optind > 64) return 1;
+    bench_parse_atoms(argc - optind, argv + optind, &objargc, objargv);
+    if (hands < 0 || hands > 2) hands = 2;
+    if (bangs < 1) bangs = 1;
+    if (objects < 1 || objects > 64) objects = 1;
+    if (devices < 1) devices = 1;
+
+    if (write) return bench_write_recording(write, bangs, (uint32_t)hands);
+    if (logpath) {
+        bench_log(logpath, bangs, (uint32_t)hands);
+        return 0;
+    }
+
+    stub_set_quiet(1);
+    stub_leap_configure(rate, (uint32_t)hands);
+    stub_leap_set_devices((uint32_t)devices);
+    if (depth > 0) {
+        if (!strcmp(object, "ultraleap") || !strcmp(object, "all")) bench_history(&bench_targets[0], depth, bangs, objargc, objargv);
+        if (!strcmp(object, "dict") || !strcmp(object, "all")) bench_history(&bench_targets[1], depth, bangs, objargc, objargv);
+        return 0;
+    }
+    if (zones > 0) {
+        if (zones > PXLEAP_ZONES_MAX) zones = PXLEAP_ZONES_MAX;
+        bench_zones(zones, bangs, (uint32_t)hands);
+        if (!strcmp(object, "ultraleap") || !strcmp(object, "all")) bench_zoneobject(&bench_targets[0], zones, 2., objargc, objargv);
+        if (!strcmp(object, "dict") || !strcmp(object, "all")) bench_zoneobject(&bench_targets[1], zones, 2., objargc, objargv);
+        return 0;
+    }
+    if (shared) {
+        printf("%.0f frames/s, %ld hands, %ld frames read\n", rate, hands, bangs);
+        if (!strcmp(object, "ultraleap") || !strcmp(object, "all")) bench_shm(&bench_targets[0], shared, bangs, objargc, objargv);
+        if (!strcmp(object, "dict") || !strcmp(object, "all")) bench_shm(&bench_targets[1], shared, bangs, objargc, objargv);
+        return 0;
+    }
+    if (packed) {
+        t_atom outputargv[66];
+        bench_packed(bangs);
+        printf("%.0f frames/s, %ld hands\n", rate, hands);
+        memcpy(outputargv, objargv, sizeof(t_atom) * (size_t)objargc);
+        atom_setsym(outputargv + objargc, gensym("@output"));
+        atom_setsym(outputargv + objargc + 1, gensym("list"));
+        bench_run(&bench_targets[0], bangs, replay, 0, objargc + 2, outputargv);
+        atom_setsym(outputargv + objargc + 1, gensym("packed"));
+        bench_run(&bench_targets[0], bangs, replay, 0, objargc + 2, outputargv);
+        return 0;
+    }
+    if (templates > 0) {
+        char path[64];
+        if (templates > PXLEAP_POSES_MAX) templates = PXLEAP_POSES_MAX;
+        snprintf(path, sizeof(path), "/tmp/pxleap_bench_poses_%d", (int)getpid());
+        if (!bench_makeposes(path, templates)) return 1;
+        bench_poses(path, templates, bangs, (uint32_t)hands);
+        if (!strcmp(object, "ultraleap") || !strcmp(object, "all")) bench_poseobject(&bench_targets[0], path, 2., objargc, objargv);
+        if (!strcmp(object, "dict") || !strcmp(object, "all")) bench_poseobject(&bench_targets[1], path, 2., objargc, objargv);
+        remove(path);
+        return 0;
+    }
+    if (vectors > 0) {
+        printf("%.0f frames/s, %ld hands\n", rate, hands);
+        bench_signal(vectors, objargc, objargv);
+        return 0;
+    }
+    if (mainthread) {
+        printf("%.0f frames/s, %ld hands\n", rate, hands);
+        if (!strcmp(object, "ultraleap") || !strcmp(object, "all")) bench_mainthread(&bench_targets[0], bangs, objargc, objargv);
+        if (!strcmp(object, "dict") || !strcmp(object, "all")) bench_mainthread(&bench_targets[1], bangs, objargc, objargv);
+        return 0;
+    }
+    if (drain > 0.) {
+        printf("%.0f frames/s, %ld hands\n", rate, hands);
+        if (!strcmp(object, "ultraleap") || !strcmp(object, "all")) bench_drain(&bench_targets[0], drain, bangs, objargc, objargv);
+        if (!strcmp(object, "dict") || !strcmp(object, "all")) bench_drain(&bench_targets[1], drain, bangs, objargc, objargv);
+        return 0;
+    }
+    if (port > 0) {
+        printf("OSC to 127.0.0.1:%d, %.0f frames/s, %ld hands\n", port, rate, hands);
+        if (!strcmp(object, "ultraleap") || !strcmp(object, "all")) bench_osc(&bench_targets[0], port, bangs, objargc, objargv);
+        if (!strcmp(object, "dict") || !strcmp(object, "all")) bench_osc(&bench_targets[1], port, bangs, objargc, objargv);
+        return 0;
+    }
+    if (idle > 0.) {
+        printf("%s, %.0f frames/s, idle for %.1f s per object\n", replay ? replay : "synthetic", rate, idle);
+        if (!strcmp(object, "ultraleap") || !strcmp(object, "all")) bench_idle(&bench_targets[0], idle, objects, replay, objargc, objargv);
+        if (!strcmp(object, "dict") || !strcmp(object, "all")) bench_idle(&bench_targets[1], idle, objects, replay, objargc, objargv);
+        return 0;
+    }
+    printf("%s frames, %ld hands, %ld measured bangs per object\n", replay ? replay : "synthetic", hands, bangs);
+    if (!strcmp(object, "ultraleap") || !strcmp(object, "all")) bench_run(&bench_targets[0], bangs, replay, stats, objargc, objargv);
+    if (!strcmp(object, "dict") || !strcmp(object, "all")) bench_run(&bench_targets[1], bangs, replay, stats, objargc, objargv);
+    return 0;
+}
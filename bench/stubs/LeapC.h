@@ -0,0 +1,164 @@
+// stand-in for the parts of LeapC.h used by the externals
+#ifndef PXLEAP_STUB_LEAPC_H
+#define PXLEAP_STUB_LEAPC_H
+#include <stdint.h>
+#include <stddef.h>
+
+typedef enum _eLeapRS {
+    eLeapRS_Success = 0,
+    eLeapRS_UnknownError = 0xE2010000,
+    eLeapRS_InvalidArgument = 0xE2010001,
+    eLeapRS_InsufficientResources = 0xE2010002,
+    eLeapRS_InsufficientBuffer = 0xE2010003,
+    eLeapRS_Timeout = 0xE2010004,
+    eLeapRS_NotConnected = 0xE2010005,
+    eLeapRS_NotAvailable = 0xE2010006,
+} eLeapRS;
+
+typedef enum _eLeapEventType {
+    eLeapEventType_None = 0,
+    eLeapEventType_Connection,
+    eLeapEventType_ConnectionLost,
+    eLeapEventType_Device,
+    eLeapEventType_DeviceFailure,
+    eLeapEventType_Policy,
+    eLeapEventType_Tracking = 0x100,
+    eLeapEventType_DeviceLost = 0x104,
+} eLeapEventType;
+
+typedef enum _eLeapHandType {
+    eLeapHandType_Left,
+    eLeapHandType_Right
+} eLeapHandType;
+
+typedef enum _eLeapConnectionConfig {
+    eLeapConnectionConfig_MultiDeviceAware = 0x00000001
+} eLeapConnectionConfig;
+
+typedef struct _LEAP_CONNECTION *LEAP_CONNECTION;
+typedef struct _LEAP_DEVICE *LEAP_DEVICE;
+typedef struct _LEAP_CLOCK_REBASER *LEAP_CLOCK_REBASER;
+
+typedef struct _LEAP_DEVICE_REF {
+    void *handle;
+    uint32_t id;
+} LEAP_DEVICE_REF;
+
+typedef struct _LEAP_CONNECTION_CONFIG {
+    uint32_t size;
+    uint32_t flags;
+    const char *server_namespace;
+    uint32_t tracking_origin;
+} LEAP_CONNECTION_CONFIG;
+
+typedef struct _LEAP_VECTOR {
+    union {
+        float v[3];
+        struct { float x; float y; float z; };
+    };
+} LEAP_VECTOR;
+
+typedef struct _LEAP_QUATERNION {
+    union {
+        float v[4];
+        struct { float x; float y; float z; float w; };
+    };
+} LEAP_QUATERNION;
+
+typedef struct _LEAP_BONE {
+    LEAP_VECTOR prev_joint;
+    LEAP_VECTOR next_joint;
+    float width;
+    LEAP_QUATERNION rotation;
+} LEAP_BONE;
+
+typedef struct _LEAP_DIGIT {
+    int32_t finger_id;
+    union {
+        LEAP_BONE bones[4];
+        struct { LEAP_BONE metacarpal; LEAP_BONE proximal; LEAP_BONE intermediate; LEAP_BONE distal; };
+    };
+    uint32_t is_extended;
+} LEAP_DIGIT;
+
+typedef struct _LEAP_PALM {
+    LEAP_VECTOR position;
+    LEAP_VECTOR stabilized_position;
+    LEAP_VECTOR velocity;
+    LEAP_VECTOR normal;
+    float width;
+    LEAP_VECTOR direction;
+    LEAP_QUATERNION orientation;
+} LEAP_PALM;
+
+typedef struct _LEAP_HAND {
+    uint32_t id;
+    uint32_t flags;
+    eLeapHandType type;
+    float confidence;
+    uint64_t visible_time;
+    float pinch_distance;
+    float grab_angle;
+    float pinch_strength;
+    float grab_strength;
+    LEAP_PALM palm;
+    union {
+        struct { LEAP_DIGIT thumb; LEAP_DIGIT index; LEAP_DIGIT middle; LEAP_DIGIT ring; LEAP_DIGIT pinky; };
+        LEAP_DIGIT digits[5];
+    };
+    LEAP_BONE arm;
+} LEAP_HAND;
+
+typedef struct _LEAP_FRAME_HEADER {
+    void *reserved;
+    int64_t frame_id;
+    int64_t timestamp;
+} LEAP_FRAME_HEADER;
+
+typedef struct _LEAP_TRACKING_EVENT {
+    LEAP_FRAME_HEADER info;
+    int64_t tracking_frame_id;
+    uint32_t nHands;
+    LEAP_HAND *pHands;
+    float framerate;
+} LEAP_TRACKING_EVENT;
+
+typedef struct _LEAP_DEVICE_EVENT {
+    uint32_t flags;
+    LEAP_DEVICE_REF device;
+    uint32_t status;
+} LEAP_DEVICE_EVENT;
+
+typedef struct _LEAP_CONNECTION_INFO {
+    uint32_t size;
+    uint32_t status;
+} LEAP_CONNECTION_INFO;
+
+typedef struct _LEAP_CONNECTION_MESSAGE {
+    uint32_t size;
+    eLeapEventType type;
+    union {
+        const void *pointer;
+        const LEAP_TRACKING_EVENT *tracking_event;
+        const LEAP_DEVICE_EVENT *device_event;
+    };
+    uint32_t device_id;
+} LEAP_CONNECTION_MESSAGE;
+
+eLeapRS LeapCreateConnection(const LEAP_CONNECTION_CONFIG *pConfig, LEAP_CONNECTION *phConnection);
+eLeapRS LeapOpenConnection(LEAP_CONNECTION hConnection);
+eLeapRS LeapPollConnection(LEAP_CONNECTION hConnection, uint32_t timeout, LEAP_CONNECTION_MESSAGE *evt);
+void LeapCloseConnection(LEAP_CONNECTION hConnection);
+void LeapDestroyConnection(LEAP_CONNECTION hConnection);
+int64_t LeapGetNow(void);
+eLeapRS LeapCreateClockRebaser(LEAP_CLOCK_REBASER *phClockRebaser);
+eLeapRS LeapUpdateRebase(LEAP_CLOCK_REBASER hClockRebaser, int64_t userClock, int64_t leapClock);
+eLeapRS LeapRebaseClock(LEAP_CLOCK_REBASER hClockRebaser, int64_t userClock, int64_t *pLeapClock);
+void LeapDestroyClockRebaser(LEAP_CLOCK_REBASER hClockRebaser);
+eLeapRS LeapGetDeviceList(LEAP_CONNECTION hConnection, LEAP_DEVICE_REF *pArray, uint32_t *pnArray);
+eLeapRS LeapOpenDevice(LEAP_DEVICE_REF rDevice, LEAP_DEVICE *phDevice);
+void LeapCloseDevice(LEAP_DEVICE hDevice);
+eLeapRS LeapSubscribeEvents(LEAP_CONNECTION hConnection, LEAP_DEVICE hDevice);
+eLeapRS LeapUnsubscribeEvents(LEAP_CONNECTION hConnection, LEAP_DEVICE hDevice);
+
+#endif
@@ -0,0 +1 @@
+#include "maxstub.h"
@@ -0,0 +1,20 @@
+#ifndef PXLEAP_STUB_DICTOBJ_H
+#define PXLEAP_STUB_DICTOBJ_H
+#include "maxstub.h"
+t_dictionary *dictionary_new(void);
+t_max_err dictionary_clear(t_dictionary *d);
+t_max_err dictionary_appendlong(t_dictionary *d, t_symbol *key, t_atom_long value);
+t_max_err dictionary_appendfloat(t_dictionary *d, t_symbol *key, double value);
+t_max_err dictionary_appendsym(t_dictionary *d, t_symbol *key, t_symbol *value);
+t_max_err dictionary_appendatoms(t_dictionary *d, t_symbol *key, long argc, t_atom *argv);
+t_max_err dictionary_appenddictionary(t_dictionary *d, t_symbol *key, t_object *value);
+t_max_err dictionary_getatoms(const t_dictionary *d, t_symbol *key, long *argc, t_atom **argv);
+t_max_err dictionary_getdictionary(const t_dictionary *d, t_symbol *key, t_object **value);
+t_max_err dictionary_deleteentry(t_dictionary *d, t_symbol *key);
+t_max_err dictionary_chuckentry(t_dictionary *d, t_symbol *key);
+long dictionary_hasentry(const t_dictionary *d, t_symbol *key);
+t_atom_long dictionary_getentrycount(const t_dictionary *d);
+t_dictionary *dictionary_sprintf(const char *fmt, ...);
+t_dictionary *dictobj_register(t_dictionary *d, t_symbol **name);
+t_max_err dictobj_unregister(t_dictionary *d);
+#endif
@@ -0,0 +1,21 @@
+#ifndef PXLEAP_STUB_SYSTHREAD_H
+#define PXLEAP_STUB_SYSTHREAD_H
+#include "maxstub.h"
+typedef void *t_systhread;
+typedef void *t_systhread_mutex;
+typedef void *t_systhread_cond;
+long systhread_create(method entryproc, void *arg, long stacksize, long priority, long flags, t_systhread *thread);
+long systhread_join(t_systhread thread, unsigned int *retval);
+void systhread_exit(long status);
+void systhread_sleep(long milliseconds);
+long systhread_mutex_new(t_systhread_mutex *pmutex, long flags);
+long systhread_mutex_free(t_systhread_mutex pmutex);
+long systhread_mutex_lock(t_systhread_mutex pmutex);
+long systhread_mutex_unlock(t_systhread_mutex pmutex);
+long systhread_cond_new(t_systhread_cond *pcond, long flags);
+long systhread_cond_free(t_systhread_cond pcond);
+long systhread_cond_wait(t_systhread_cond pcond, t_systhread_mutex m);
+long systhread_cond_signal(t_systhread_cond pcond);
+long systhread_cond_broadcast(t_systhread_cond pcond);
+short systhread_ismainthread(void);
+#endif
@@ -0,0 +1,35 @@
+// stand-in for the parts of the Jitter API used by the externals
+#ifndef PXLEAP_STUB_JIT_COMMON_H
+#define PXLEAP_STUB_JIT_COMMON_H
+#include "maxstub.h"
+
+#define JIT_MATRIX_MAX_DIMCOUNT 32
+#define JIT_MATRIX_MAX_PLANECOUNT 32
+
+typedef struct _jit_matrix_info
+{
+    long size;
+    t_symbol *type;
+    long flags;
+    long dimcount;
+    long dim[JIT_MATRIX_MAX_DIMCOUNT];
+    long dimstride[JIT_MATRIX_MAX_DIMCOUNT];
+    long planecount;
+} t_jit_matrix_info;
+
+extern t_symbol *_jit_sym_jit_matrix;
+extern t_symbol *_jit_sym_float32;
+extern t_symbol *_jit_sym_char;
+extern t_symbol *_jit_sym_long;
+extern t_symbol *_jit_sym_register;
+extern t_symbol *_jit_sym_getdata;
+extern t_symbol *_jit_sym_getinfo;
+extern t_symbol *_jit_sym_lock;
+
+t_max_err jit_matrix_info_default(t_jit_matrix_info *info);
+void *jit_object_new(t_symbol *classname, ...);
+void *jit_object_method(void *x, t_symbol *s, ...);
+t_max_err jit_object_free(void *x);
+t_symbol *jit_symbol_unique(void);
+
+#endif
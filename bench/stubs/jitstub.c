@@ -0,0 +1,108 @@
+//
+// jitstub
+//
+// Just enough of a jit_matrix for the matrix output path: float32 data, info, lock and register
+//
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include "jit.common.h"
+
+t_symbol *_jit_sym_jit_matrix;
+t_symbol *_jit_sym_float32;
+t_symbol *_jit_sym_char;
+t_symbol *_jit_sym_long;
+t_symbol *_jit_sym_register;
+t_symbol *_jit_sym_getdata;
+t_symbol *_jit_sym_getinfo;
+t_symbol *_jit_sym_lock;
+
+typedef struct _stub_jit_matrix
+{
+    t_object ob;
+    t_jit_matrix_info info;
+    char *data;
+    long lock;
+} t_stub_jit_matrix;
+
+static t_class *stub_jit_matrix_class;
+
+static void stub_jit_matrix_free(t_stub_jit_matrix *m)
+{
+    stub_free(m->data);
+}
+
+__attribute__((constructor)) static void stub_jit_init(void)
+{
+    _jit_sym_jit_matrix = gensym("jit_matrix");
+    _jit_sym_float32 = gensym("float32");
+    _jit_sym_char = gensym("char");
+    _jit_sym_long = gensym("long");
+    _jit_sym_register = gensym("register");
+    _jit_sym_getdata = gensym("getdata");
+    _jit_sym_getinfo = gensym("getinfo");
+    _jit_sym_lock = gensym("lock");
+    stub_jit_matrix_class = class_new("jit_matrix", NULL, (method)stub_jit_matrix_free, sizeof(t_stub_jit_matrix), NULL, 0);
+}
+
+t_max_err jit_matrix_info_default(t_jit_matrix_info *info)
+{
+    memset(info, 0, sizeof(*info));
+    info->size = sizeof(*info);
+    info->type = _jit_sym_char;
+    info->dimcount = 2;
+    info->dim[0] = info->dim[1] = 1;
+    info->planecount = 4;
+    return MAX_ERR_NONE;
+}
+
+void *jit_object_new(t_symbol *classname, ...)
+{
+    t_stub_jit_matrix *m;
+    const t_jit_matrix_info *info;
+    long cellsize, bytes;
+    va_list ap;
+    if (classname != _jit_sym_jit_matrix) return NULL;
+    va_start(ap, classname);
+    info = va_arg(ap, const t_jit_matrix_info *);
+    va_end(ap);
+    m = (t_stub_jit_matrix *)object_alloc(stub_jit_matrix_class);
+    m->info = *info;
+    cellsize = (info->type == _jit_sym_char ? 1 : 4) * info->planecount;
+    bytes = cellsize;
+    for (long d = 0; d < info->dimcount; d++) {
+        m->info.dimstride[d] = bytes;
+        bytes *= info->dim[d];
+    }
+    m->data = (char *)stub_alloc((size_t)bytes);
+    return m;
+}
+
+void *jit_object_method(void *x, t_symbol *s, ...)
+{
+    t_stub_jit_matrix *m = (t_stub_jit_matrix *)x;
+    void *arg;
+    va_list ap;
+    va_start(ap, s);
+    arg = va_arg(ap, void *);
+    va_end(ap);
+    if (s == _jit_sym_getdata) *(char **)arg = m->data;
+    else if (s == _jit_sym_getinfo) *(t_jit_matrix_info *)arg = m->info;
+    else if (s == _jit_sym_lock) {
+        long prev = m->lock;
+        m->lock = (long)(intptr_t)arg;
+        return (void *)(intptr_t)prev;
+    }
+    return x; // register hands back the same object
+}
+
+t_max_err jit_object_free(void *x)
+{
+    return object_free(x);
+}
+
+t_symbol *jit_symbol_unique(void)
+{
+    return symbol_unique();
+}
@@ -0,0 +1,237 @@
+//
+// leapstub
+//
+// Stand-in for LeapC that generates synthetic two-hand tracking frames at a fixed rate,
+// so the objects can be driven without the tracking service
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+#include "LeapC.h"
+#include "leapstub.h"
+
+struct _LEAP_CONNECTION
+{
+    int open;
+    int64_t next_due;                       // leap clock time of the next synthetic frame
+    int64_t frame_id;
+    uint32_t announced;                     // device events sent so far
+    LEAP_DEVICE_EVENT device_event;
+    LEAP_HAND hands[2];
+    LEAP_TRACKING_EVENT event;
+};
+
+struct _LEAP_CLOCK_REBASER
+{
+    int64_t offset;
+};
+
+static double stub_leap_rate = 120.;
+static uint32_t stub_leap_hands = 2;
+static uint32_t stub_leap_devices = 1;
+static atomic_ullong stub_leap_frames;
+static atomic_ullong stub_leap_polls;
+
+void stub_leap_configure(double rate, uint32_t hands)
+{
+    stub_leap_rate = rate > 0. ? rate : 0.;
+    stub_leap_hands = hands > 2 ? 2 : hands;
+}
+
+void stub_leap_set_devices(uint32_t devices)
+{
+    stub_leap_devices = devices ? devices : 1;
+}
+
+uint64_t stub_leap_frame_count(void)
+{
+    return atomic_load(&stub_leap_frames);
+}
+
+uint64_t stub_leap_poll_count(void)
+{
+    return atomic_load(&stub_leap_polls);
+}
+
+static void stub_leap_setvec(LEAP_VECTOR *v, float x, float y, float z)
+{
+    v->x = x;
+    v->y = y;
+    v->z = z;
+}
+
+void stub_leap_fill_hand(LEAP_HAND *hand, uint32_t index, double t)
+{
+    float side = index ? 1.f : -1.f;
+    float px = side * 80.f + 60.f * (float)sin(t * 1.3 + index);
+    float py = 220.f + 50.f * (float)cos(t * 0.7 + index);
+    float pz = 30.f * (float)sin(t * 0.5);
+    float curl = 0.5f + 0.5f * (float)sin(t * 2.1 + index);
+    memset(hand, 0, sizeof(*hand));
+    hand->id = index + 1;
+    hand->type = index ? eLeapHandType_Right : eLeapHandType_Left;
+    hand->confidence = 1.f;
+    hand->visible_time = (uint64_t)(t * 1e6);
+    hand->pinch_distance = 40.f * (1.f - curl);
+    hand->pinch_strength = curl;
+    hand->grab_strength = curl;
+    hand->grab_angle = curl * 3.14159f;
+    stub_leap_setvec(&hand->palm.position, px, py, pz);
+    hand->palm.stabilized_position = hand->palm.position;
+    stub_leap_setvec(&hand->palm.normal, 0.f, -1.f, 0.f);
+    stub_leap_setvec(&hand->palm.direction, 0.f, 0.f, -1.f);
+    hand->palm.orientation.w = 1.f;
+    hand->palm.width = 85.f;
+    for (int f = 0; f < 5; f++) {
+        LEAP_DIGIT *digit = &hand->digits[f];
+        LEAP_VECTOR joint;
+        static const float lengths[4] = { 45.f, 40.f, 25.f, 20.f };
+        stub_leap_setvec(&joint, px + side * (f - 2) * 20.f, py, pz + 20.f);
+        digit->finger_id = (int32_t)(hand->id * 10 + f);
+        digit->is_extended = curl < 0.5f;
+        for (int b = 0; b < 4; b++) {
+            LEAP_BONE *bone = &digit->bones[b];
+            bone->prev_joint = joint;
+            joint.y -= b ? lengths[b] * curl * 0.6f : 0.f;
+            joint.z -= lengths[b] * (1.f - (b ? curl * 0.4f : 0.f));
+            bone->next_joint = joint;
+            bone->width = 18.f - b;
+            bone->rotation.w = 1.f;
+        }
+    }
+    stub_leap_setvec(&hand->arm.prev_joint, px, py - 40.f, pz + 260.f);
+    stub_leap_setvec(&hand->arm.next_joint, px, py, pz + 50.f);
+    hand->arm.width = 60.f;
+    hand->arm.rotation.w = 1.f;
+}
+
+int64_t LeapGetNow(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+eLeapRS LeapCreateConnection(const LEAP_CONNECTION_CONFIG *pConfig, LEAP_CONNECTION *phConnection)
+{
+    *phConnection = (LEAP_CONNECTION)calloc(1, sizeof(struct _LEAP_CONNECTION));
+    return eLeapRS_Success;
+}
+
+eLeapRS LeapOpenConnection(LEAP_CONNECTION hConnection)
+{
+    if (!hConnection) return eLeapRS_InvalidArgument;
+    hConnection->open = 1;
+    hConnection->next_due = LeapGetNow();
+    return eLeapRS_Success;
+}
+
+eLeapRS LeapPollConnection(LEAP_CONNECTION hConnection, uint32_t timeout, LEAP_CONNECTION_MESSAGE *evt)
+{
+    int64_t now = LeapGetNow();
+    int64_t deadline = now + (int64_t)timeout * 1000;
+    atomic_fetch_add(&stub_leap_polls, 1);
+    if (!hConnection || !hConnection->open) return eLeapRS_NotConnected;
+    // a newly opened connection first hears about every attached device
+    if (hConnection->announced < stub_leap_devices) {
+        memset(evt, 0, sizeof(*evt));
+        hConnection->announced++;
+        hConnection->device_event.device.id = hConnection->announced;
+        hConnection->device_event.status = 0;
+        evt->size = sizeof(LEAP_DEVICE_EVENT);
+        evt->type = eLeapEventType_Device;
+        evt->device_event = &hConnection->device_event;
+        evt->device_id = hConnection->announced;
+        return eLeapRS_Success;
+    }
+    if (stub_leap_rate <= 0. || hConnection->next_due > deadline) {
+        usleep((useconds_t)(deadline - now));
+        return eLeapRS_Timeout;
+    }
+    if (hConnection->next_due > now) usleep((useconds_t)(hConnection->next_due - now));
+    now = LeapGetNow();
+    for (uint32_t h = 0; h < stub_leap_hands; h++) stub_leap_fill_hand(&hConnection->hands[h], h, (double)now / 1e6);
+    hConnection->frame_id++;
+    hConnection->event.info.frame_id = hConnection->frame_id;
+    hConnection->event.info.timestamp = now;
+    hConnection->event.tracking_frame_id = hConnection->frame_id;
+    hConnection->event.nHands = stub_leap_hands;
+    hConnection->event.pHands = hConnection->hands;
+    hConnection->event.framerate = (float)stub_leap_rate;
+    hConnection->next_due += (int64_t)(1e6 / stub_leap_rate);
+    if (hConnection->next_due < now) hConnection->next_due = now; // don't try to catch up after a stall
+    memset(evt, 0, sizeof(*evt));
+    evt->size = sizeof(LEAP_TRACKING_EVENT);
+    evt->type = eLeapEventType_Tracking;
+    evt->tracking_event = &hConnection->event;
+    evt->device_id = (uint32_t)(hConnection->frame_id % stub_leap_devices) + 1; // devices take turns
+    atomic_fetch_add(&stub_leap_frames, 1);
+    return eLeapRS_Success;
+}
+
+void LeapCloseConnection(LEAP_CONNECTION hConnection)
+{
+    if (hConnection) hConnection->open = 0;
+}
+
+void LeapDestroyConnection(LEAP_CONNECTION hConnection)
+{
+    free(hConnection);
+}
+
+eLeapRS LeapCreateClockRebaser(LEAP_CLOCK_REBASER *phClockRebaser)
+{
+    *phClockRebaser = (LEAP_CLOCK_REBASER)calloc(1, sizeof(struct _LEAP_CLOCK_REBASER));
+    return eLeapRS_Success;
+}
+
+eLeapRS LeapUpdateRebase(LEAP_CLOCK_REBASER hClockRebaser, int64_t userClock, int64_t leapClock)
+{
+    hClockRebaser->offset = leapClock - userClock;
+    return eLeapRS_Success;
+}
+
+eLeapRS LeapRebaseClock(LEAP_CLOCK_REBASER hClockRebaser, int64_t userClock, int64_t *pLeapClock)
+{
+    *pLeapClock = userClock + hClockRebaser->offset;
+    return eLeapRS_Success;
+}
+
+void LeapDestroyClockRebaser(LEAP_CLOCK_REBASER hClockRebaser)
+{
+    free(hClockRebaser);
+}
+
+eLeapRS LeapGetDeviceList(LEAP_CONNECTION hConnection, LEAP_DEVICE_REF *pArray, uint32_t *pnArray)
+{
+    if (pArray && *pnArray) {
+        pArray[0].handle = NULL;
+        pArray[0].id = 1;
+    }
+    *pnArray = 1;
+    return eLeapRS_Success;
+}
+
+eLeapRS LeapOpenDevice(LEAP_DEVICE_REF rDevice, LEAP_DEVICE *phDevice)
+{
+    *phDevice = (LEAP_DEVICE)(uintptr_t)rDevice.id;
+    return eLeapRS_Success;
+}
+
+void LeapCloseDevice(LEAP_DEVICE hDevice)
+{
+}
+
+eLeapRS LeapSubscribeEvents(LEAP_CONNECTION hConnection, LEAP_DEVICE hDevice)
+{
+    return eLeapRS_Success;
+}
+
+eLeapRS LeapUnsubscribeEvents(LEAP_CONNECTION hConnection, LEAP_DEVICE hDevice)
+{
+    return eLeapRS_Success;
+}
@@ -0,0 +1,17 @@
+// bench hooks for the LeapC stand-in
+#ifndef PXLEAP_LEAPSTUB_H
+#define PXLEAP_LEAPSTUB_H
+#include <stdint.h>
+#include "LeapC.h"
+
+// frame rate and hand count of the synthetic frames, a rate of 0 is a connected device that sends nothing
+void stub_leap_configure(double rate, uint32_t hands);
+// devices announced to each new connection, frames come from each of them in turn
+void stub_leap_set_devices(uint32_t devices);
+// synthetic frames delivered through LeapPollConnection so far, across all connections
+uint64_t stub_leap_frame_count(void);
+uint64_t stub_leap_poll_count(void);
+// fills a moving synthetic hand, t in seconds
+void stub_leap_fill_hand(LEAP_HAND *hand, uint32_t index, double t);
+
+#endif
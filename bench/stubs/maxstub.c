@@ -0,0 +1,968 @@
+//
+// maxstub
+//
+// Just enough of the Max runtime to load the px.ultraleap objects outside of Max:
+// symbols, atoms, counting outlets, attributes, dictionaries, qelems, clocks and systhreads
+//
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include "ext.h"
+#include "ext_systhread.h"
+#include "ext_dictobj.h"
+
+_Thread_local t_stub_counters stub_counters;
+static int stub_quiet = 0;
+
+void stub_set_quiet(int quiet)
+{
+    stub_quiet = quiet;
+}
+
+void *stub_alloc(size_t size)
+{
+    stub_counters.allocs++;
+    return calloc(1, size ? size : 1);
+}
+
+void stub_free(void *ptr)
+{
+    free(ptr);
+}
+
+//////////////////////// console
+
+static void stub_vpost(const char *prefix, const char *fmt, va_list ap)
+{
+    if (stub_quiet) return;
+    fputs(prefix, stderr);
+    vfprintf(stderr, fmt, ap);
+    fputc('\n', stderr);
+}
+
+void post(const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    stub_vpost("", fmt, ap);
+    va_end(ap);
+}
+
+void object_post(t_object *x, const char *s, ...)
+{
+    va_list ap;
+    va_start(ap, s);
+    stub_vpost("", s, ap);
+    va_end(ap);
+}
+
+void object_warn(t_object *x, const char *s, ...)
+{
+    va_list ap;
+    va_start(ap, s);
+    stub_vpost("warning: ", s, ap);
+    va_end(ap);
+}
+
+void object_error(t_object *x, const char *s, ...)
+{
+    va_list ap;
+    va_start(ap, s);
+    stub_vpost("error: ", s, ap);
+    va_end(ap);
+}
+
+//////////////////////// symbols
+
+#define STUB_SYMTAB_SIZE 4096
+
+typedef struct _stub_symentry
+{
+    t_symbol sym;
+    struct _stub_symentry *next;
+} t_stub_symentry;
+
+static t_stub_symentry *stub_symtab[STUB_SYMTAB_SIZE];
+static pthread_mutex_t stub_symlock = PTHREAD_MUTEX_INITIALIZER;
+
+t_symbol *gensym(const char *s)
+{
+    unsigned long hash = 5381;
+    const char *c;
+    t_stub_symentry *e;
+    stub_counters.gensyms++;
+    for (c = s; *c; c++) hash = hash * 33 + (unsigned char)*c;
+    hash %= STUB_SYMTAB_SIZE;
+    pthread_mutex_lock(&stub_symlock);
+    for (e = stub_symtab[hash]; e; e = e->next) {
+        if (!strcmp(e->sym.s_name, s)) break;
+    }
+    if (!e) {
+        e = (t_stub_symentry *)calloc(1, sizeof(t_stub_symentry));
+        e->sym.s_name = strdup(s);
+        e->next = stub_symtab[hash];
+        stub_symtab[hash] = e;
+    }
+    pthread_mutex_unlock(&stub_symlock);
+    return &e->sym;
+}
+
+t_symbol *symbol_unique(void)
+{
+    static atomic_long counter;
+    char name[32];
+    snprintf(name, sizeof(name), "u%06ld", atomic_fetch_add(&counter, 1));
+    return gensym(name);
+}
+
+//////////////////////// atoms
+
+t_max_err atom_setlong(t_atom *a, t_atom_long b)
+{
+    a->a_type = A_LONG;
+    a->a_w.w_long = b;
+    return MAX_ERR_NONE;
+}
+
+t_max_err atom_setfloat(t_atom *a, double b)
+{
+    a->a_type = A_FLOAT;
+    a->a_w.w_float = b;
+    return MAX_ERR_NONE;
+}
+
+t_max_err atom_setsym(t_atom *a, t_symbol *b)
+{
+    a->a_type = A_SYM;
+    a->a_w.w_sym = b;
+    return MAX_ERR_NONE;
+}
+
+t_max_err atom_setobj(t_atom *a, void *b)
+{
+    a->a_type = A_OBJ;
+    a->a_w.w_obj = (t_object *)b;
+    return MAX_ERR_NONE;
+}
+
+t_atom_long atom_getlong(const t_atom *a)
+{
+    if (a->a_type == A_LONG) return a->a_w.w_long;
+    if (a->a_type == A_FLOAT) return (t_atom_long)a->a_w.w_float;
+    return 0;
+}
+
+t_atom_float atom_getfloat(const t_atom *a)
+{
+    if (a->a_type == A_FLOAT) return a->a_w.w_float;
+    if (a->a_type == A_LONG) return (t_atom_float)a->a_w.w_long;
+    return 0.;
+}
+
+t_symbol *atom_getsym(const t_atom *a)
+{
+    if (a->a_type == A_SYM) return a->a_w.w_sym;
+    return gensym("");
+}
+
+long atom_gettype(const t_atom *a)
+{
+    return a->a_type;
+}
+
+//////////////////////// classes, objects and attributes
+
+#define STUB_MAX_METHODS 64
+#define STUB_MAX_ATTRS 64
+
+typedef struct _stub_attr
+{
+    t_symbol *name;
+    char type;
+    long offset;
+    long size;
+    long count;
+    method get;
+    method set;
+    double min;
+    double max;
+} t_stub_attr;
+
+struct maxclass
+{
+    char name[128];
+    method mnew;
+    method mfree;
+    long size;
+    t_symbol *methodnames[STUB_MAX_METHODS];
+    method methods[STUB_MAX_METHODS];
+    int nmethods;
+    t_stub_attr attrs[STUB_MAX_ATTRS];
+    int nattrs;
+};
+
+t_class *class_new(const char *name, method mnew, method mfree, long size, method mmenu, short type, ...)
+{
+    t_class *c = (t_class *)calloc(1, sizeof(t_class));
+    strncpy(c->name, name, sizeof(c->name) - 1);
+    c->mnew = mnew;
+    c->mfree = mfree;
+    c->size = size;
+    return c;
+}
+
+t_max_err class_addmethod(t_class *c, method m, const char *name, ...)
+{
+    if (c->nmethods >= STUB_MAX_METHODS) return MAX_ERR_GENERIC;
+    c->methodnames[c->nmethods] = gensym(name);
+    c->methods[c->nmethods] = m;
+    c->nmethods++;
+    return MAX_ERR_NONE;
+}
+
+t_max_err class_register(t_symbol *name_space, t_class *c)
+{
+    return MAX_ERR_NONE;
+}
+
+static t_stub_attr *stub_findattr(t_class *c, t_symbol *name)
+{
+    for (int i = 0; i < c->nattrs; i++) {
+        if (c->attrs[i].name == name) return &c->attrs[i];
+    }
+    return NULL;
+}
+
+t_max_err class_addattr(t_class *c, t_symbol *name, char type, long offset, long size, long count, method get, method set)
+{
+    t_stub_attr *a;
+    if (c->nattrs >= STUB_MAX_ATTRS) return MAX_ERR_GENERIC;
+    a = &c->attrs[c->nattrs++];
+    a->name = name;
+    a->type = type;
+    a->offset = offset;
+    a->size = size;
+    a->count = count;
+    a->get = get;
+    a->set = set;
+    a->min = -1e300;
+    a->max = 1e300;
+    return MAX_ERR_NONE;
+}
+
+t_max_err class_attr_accessors(t_class *c, const char *name, method get, method set)
+{
+    t_stub_attr *a = stub_findattr(c, gensym(name));
+    if (!a) return MAX_ERR_GENERIC;
+    a->get = get;
+    a->set = set;
+    return MAX_ERR_NONE;
+}
+
+t_max_err class_attr_filter_clip(t_class *c, const char *name, double min, double max)
+{
+    t_stub_attr *a = stub_findattr(c, gensym(name));
+    if (!a) return MAX_ERR_GENERIC;
+    a->min = min;
+    a->max = max;
+    return MAX_ERR_NONE;
+}
+
+void *object_alloc(t_class *c)
+{
+    t_object *x = (t_object *)calloc(1, (size_t)c->size);
+    x->o_messlist = c;
+    return x;
+}
+
+t_max_err object_free(void *x)
+{
+    t_class *c;
+    if (!x) return MAX_ERR_NONE;
+    c = (t_class *)((t_object *)x)->o_messlist;
+    if (c && c->mfree) c->mfree(x);
+    free(x);
+    return MAX_ERR_NONE;
+}
+
+method stub_getmethod(void *x, const char *name)
+{
+    t_class *c = (t_class *)((t_object *)x)->o_messlist;
+    t_symbol *s = gensym(name);
+    for (int i = 0; i < c->nmethods; i++) {
+        if (c->methodnames[i] == s) return c->methods[i];
+    }
+    return NULL;
+}
+
+void freeobject(t_object *op)
+{
+    object_free(op);
+}
+
+void *object_method(void *x, t_symbol *s, ...)
+{
+    t_class *c = (t_class *)((t_object *)x)->o_messlist;
+    void *args[4];
+    va_list ap;
+    va_start(ap, s);
+    for (int i = 0; i < 4; i++) args[i] = va_arg(ap, void *);
+    va_end(ap);
+    for (int i = 0; i < c->nmethods; i++) {
+        if (c->methodnames[i] == s) return c->methods[i](x, args[0], args[1], args[2], args[3]);
+    }
+    return NULL;
+}
+
+t_max_err object_attr_setvalueof(void *x, t_symbol *s, long argc, t_atom *argv)
+{
+    t_class *c = (t_class *)((t_object *)x)->o_messlist;
+    t_stub_attr *a = stub_findattr(c, s);
+    char *field;
+    if (!a) {
+        object_error(x, "%s: no attribute %s", c->name, s->s_name);
+        return MAX_ERR_GENERIC;
+    }
+    if (a->set) {
+        a->set(x, a, argc, argv);
+        return MAX_ERR_NONE;
+    }
+    field = (char *)x + a->offset;
+    for (long i = 0; i < argc && i < a->count; i++) {
+        double v = atom_getfloat(argv + i);
+        if (a->type != 's' && a->type != 'S') v = v < a->min ? a->min : (v > a->max ? a->max : v);
+        switch (a->type) {
+            case 'l': ((t_atom_long *)field)[i] = (t_atom_long)v; break;
+            case 'c': ((unsigned char *)field)[i] = (unsigned char)v; break;
+            case 'f': ((float *)field)[i] = (float)v; break;
+            case 'd': ((double *)field)[i] = v; break;
+            case 's':
+            case 'S': ((t_symbol **)field)[i] = atom_getsym(argv + i); break;
+        }
+    }
+    return MAX_ERR_NONE;
+}
+
+t_max_err object_attr_setsym(void *x, t_symbol *s, t_symbol *c)
+{
+    t_atom a;
+    atom_setsym(&a, c);
+    return object_attr_setvalueof(x, s, 1, &a);
+}
+
+t_max_err object_attr_setlong(void *x, t_symbol *s, t_atom_long c)
+{
+    t_atom a;
+    atom_setlong(&a, c);
+    return object_attr_setvalueof(x, s, 1, &a);
+}
+
+t_max_err object_attr_setfloat(void *x, t_symbol *s, double c)
+{
+    t_atom a;
+    atom_setfloat(&a, c);
+    return object_attr_setvalueof(x, s, 1, &a);
+}
+
+static int stub_isattrname(const t_atom *a)
+{
+    return a->a_type == A_SYM && a->a_w.w_sym->s_name[0] == '@';
+}
+
+long attr_args_offset(short ac, t_atom *av)
+{
+    for (short i = 0; i < ac; i++) {
+        if (stub_isattrname(av + i)) return i;
+    }
+    return ac;
+}
+
+void attr_args_process(void *x, short ac, t_atom *av)
+{
+    short i = (short)attr_args_offset(ac, av);
+    while (i < ac) {
+        t_symbol *name = gensym(atom_getsym(av + i)->s_name + 1);
+        short start = ++i;
+        while (i < ac && !stub_isattrname(av + i)) i++;
+        object_attr_setvalueof(x, name, i - start, av + start);
+    }
+}
+
+//////////////////////// outlets
+
+typedef struct _stub_outlet
+{
+    void *owner;
+    const char *type;
+    uint64_t calls;
+} t_stub_outlet;
+
+void *outlet_new(void *x, const char *s)
+{
+    t_stub_outlet *o = (t_stub_outlet *)calloc(1, sizeof(t_stub_outlet));
+    o->owner = x;
+    o->type = s;
+    return o;
+}
+
+static void stub_outlet_count(void *o, long ac)
+{
+    ((t_stub_outlet *)o)->calls++;
+    stub_counters.outlet_calls++;
+    stub_counters.atoms_out += (uint64_t)ac;
+}
+
+void *outlet_bang(void *o)
+{
+    stub_outlet_count(o, 0);
+    return NULL;
+}
+
+void *outlet_int(void *o, t_atom_long n)
+{
+    stub_outlet_count(o, 1);
+    return NULL;
+}
+
+void *outlet_float(void *o, double f)
+{
+    stub_outlet_count(o, 1);
+    return NULL;
+}
+
+static void (*stub_list_hook)(short ac, t_atom *av) = NULL;
+
+void stub_set_list_hook(void (*hook)(short ac, t_atom *av))
+{
+    stub_list_hook = hook;
+}
+
+void *outlet_list(void *o, t_symbol *s, short ac, t_atom *av)
+{
+    stub_outlet_count(o, ac);
+    if (stub_list_hook) stub_list_hook(ac, av);
+    return NULL;
+}
+
+static void (*stub_anything_hook)(t_symbol *s, short ac, t_atom *av) = NULL;
+
+void stub_set_anything_hook(void (*hook)(t_symbol *s, short ac, t_atom *av))
+{
+    stub_anything_hook = hook;
+}
+
+void *outlet_anything(void *o, t_symbol *s, short ac, t_atom *av)
+{
+    stub_outlet_count(o, ac);
+    if (stub_anything_hook) stub_anything_hook(s, ac, av);
+    return NULL;
+}
+
+//////////////////////// memory
+
+void *sysmem_newptr(t_ptr_size size)
+{
+    return stub_alloc(size);
+}
+
+void *sysmem_newptrclear(t_ptr_size size)
+{
+    return stub_alloc(size);
+}
+
+void sysmem_freeptr(void *ptr)
+{
+    stub_free(ptr);
+}
+
+void sysmem_copyptr(const void *src, void *dst, t_ptr_size bytes)
+{
+    memmove(dst, src, bytes);
+}
+
+//////////////////////// scheduler
+
+#define STUB_MAX_TASKS 256
+
+typedef struct _stub_task
+{
+    t_object ob;
+    void *owner;
+    method fn;
+    atomic_int pending;
+    _Atomic double due;                     // clocks only, in ms. set from any thread
+} t_stub_task;
+
+static t_stub_task *stub_tasks[STUB_MAX_TASKS];
+static pthread_mutex_t stub_tasklock = PTHREAD_MUTEX_INITIALIZER;
+
+static void stub_task_free(t_stub_task *t)
+{
+    pthread_mutex_lock(&stub_tasklock);
+    for (int i = 0; i < STUB_MAX_TASKS; i++) {
+        if (stub_tasks[i] == t) stub_tasks[i] = NULL;
+    }
+    pthread_mutex_unlock(&stub_tasklock);
+}
+
+static t_class stub_task_class = { "task", NULL, (method)stub_task_free, sizeof(t_stub_task) };
+
+static t_stub_task *stub_task_new(void *obj, method fn)
+{
+    t_stub_task *t = (t_stub_task *)object_alloc(&stub_task_class);
+    t->owner = obj;
+    t->fn = fn;
+    pthread_mutex_lock(&stub_tasklock);
+    for (int i = 0; i < STUB_MAX_TASKS; i++) {
+        if (!stub_tasks[i]) {
+            stub_tasks[i] = t;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&stub_tasklock);
+    return t;
+}
+
+t_qelem *qelem_new(void *obj, method fn)
+{
+    return stub_task_new(obj, fn);
+}
+
+void qelem_set(t_qelem *q)
+{
+    atomic_store(&((t_stub_task *)q)->pending, 1);
+}
+
+void qelem_unset(t_qelem *q)
+{
+    atomic_store(&((t_stub_task *)q)->pending, 0);
+}
+
+void qelem_free(t_qelem *q)
+{
+    object_free(q);
+}
+
+t_clock *clock_new(void *obj, method fn)
+{
+    return stub_task_new(obj, fn);
+}
+
+void clock_fdelay(t_clock *c, double time)
+{
+    ((t_stub_task *)c)->due = systimer_gettime() + time;
+    atomic_store(&((t_stub_task *)c)->pending, 1);
+}
+
+void clock_delay(t_clock *c, long time)
+{
+    clock_fdelay(c, (double)time);
+}
+
+void clock_unset(t_clock *c)
+{
+    atomic_store(&((t_stub_task *)c)->pending, 0);
+}
+
+double systimer_gettime(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000. + (double)ts.tv_nsec / 1e6;
+}
+
+#define STUB_MAX_SCHEDULED 64
+#define STUB_MAX_SCHEDULED_ATOMS 8
+
+// a schedule_delay call waiting for the next scheduler pass, its atoms copied as Max does
+typedef struct _stub_scheduled
+{
+    void *ob;
+    method fun;
+    t_symbol *sym;
+    short argc;
+    t_atom argv[STUB_MAX_SCHEDULED_ATOMS];
+} t_stub_scheduled;
+
+static t_stub_scheduled stub_scheduled[STUB_MAX_SCHEDULED];
+static int stub_nscheduled = 0;
+static int stub_isr = 1;
+
+// delays aren't kept, every call runs on the next pass
+void schedule_delay(void *ob, method fun, long delay, t_symbol *sym, short argc, t_atom *argv)
+{
+    t_stub_scheduled *call;
+    pthread_mutex_lock(&stub_tasklock);
+    if (stub_nscheduled < STUB_MAX_SCHEDULED) {
+        call = &stub_scheduled[stub_nscheduled++];
+        call->ob = ob;
+        call->fun = fun;
+        call->sym = sym;
+        call->argc = argc < STUB_MAX_SCHEDULED_ATOMS ? argc : STUB_MAX_SCHEDULED_ATOMS;
+        if (call->argc > 0) memcpy(call->argv, argv, sizeof(t_atom) * (size_t)call->argc);
+    }
+    else fprintf(stderr, "maxstub: more than %d calls scheduled at once\n", STUB_MAX_SCHEDULED);
+    pthread_mutex_unlock(&stub_tasklock);
+}
+
+void stub_set_isr(int isr)
+{
+    stub_isr = isr;
+}
+
+// the bench's own thread plays Max's scheduler unless stub_set_isr(0) makes it the main thread
+// with Overdrive off, where even scheduler callbacks see isr() false
+short isr(void)
+{
+    return (short)stub_isr;
+}
+
+void stub_run_scheduler(void)
+{
+    double now = systimer_gettime();
+    t_stub_scheduled calls[STUB_MAX_SCHEDULED];
+    int ncalls;
+    // only what was scheduled before this pass, anything these schedule waits for the next one
+    pthread_mutex_lock(&stub_tasklock);
+    ncalls = stub_nscheduled;
+    memcpy(calls, stub_scheduled, sizeof(t_stub_scheduled) * (size_t)ncalls);
+    stub_nscheduled = 0;
+    pthread_mutex_unlock(&stub_tasklock);
+    for (int i = 0; i < ncalls; i++) calls[i].fun(calls[i].ob, calls[i].sym, calls[i].argc, calls[i].argv);
+    for (int i = 0; i < STUB_MAX_TASKS; i++) {
+        t_stub_task *t = stub_tasks[i];
+        if (!t || !atomic_load(&t->pending)) continue;
+        if (t->due > now) continue;
+        if (atomic_exchange(&t->pending, 0)) t->fn(t->owner);
+    }
+}
+
+//////////////////////// files
+
+short locatefile_extended(char *name, short *outvol, t_uint32 *outtype, const t_uint32 *filetypelist, short numtypes)
+{
+    return 1; // not in the search path, callers fall back to the name as given
+}
+
+short path_toabsolutesystempath(const short in_path, const char *in_filename, char *out_filepath)
+{
+    strcpy(out_filepath, in_filename);
+    return 0;
+}
+
+short path_topathname(short path, const char *file, char *name)
+{
+    strcpy(name, file);
+    return 0;
+}
+
+short path_getdefault(void)
+{
+    return 0;
+}
+
+char *strncpy_zero(char *dst, const char *src, long size)
+{
+    strncpy(dst, src, (size_t)size - 1);
+    dst[size - 1] = 0;
+    return dst;
+}
+
+//////////////////////// systhread
+
+long systhread_create(method entryproc, void *arg, long stacksize, long priority, long flags, t_systhread *thread)
+{
+    pthread_t *t = (pthread_t *)calloc(1, sizeof(pthread_t));
+    if (pthread_create(t, NULL, (void *(*)(void *))entryproc, arg)) {
+        free(t);
+        return -1;
+    }
+    *thread = t;
+    return 0;
+}
+
+long systhread_join(t_systhread thread, unsigned int *retval)
+{
+    void *ret = NULL;
+    long err = pthread_join(*(pthread_t *)thread, &ret);
+    if (retval) *retval = (unsigned int)(uintptr_t)ret;
+    free(thread);
+    return err;
+}
+
+void systhread_exit(long status)
+{
+    pthread_exit((void *)(intptr_t)status);
+}
+
+void systhread_sleep(long milliseconds)
+{
+    usleep((useconds_t)milliseconds * 1000);
+}
+
+short systhread_ismainthread(void)
+{
+    return 1;
+}
+
+long systhread_mutex_new(t_systhread_mutex *pmutex, long flags)
+{
+    pthread_mutex_t *m = (pthread_mutex_t *)calloc(1, sizeof(pthread_mutex_t));
+    pthread_mutex_init(m, NULL);
+    *pmutex = m;
+    return 0;
+}
+
+long systhread_mutex_free(t_systhread_mutex pmutex)
+{
+    pthread_mutex_destroy((pthread_mutex_t *)pmutex);
+    free(pmutex);
+    return 0;
+}
+
+long systhread_mutex_lock(t_systhread_mutex pmutex)
+{
+    return pthread_mutex_lock((pthread_mutex_t *)pmutex);
+}
+
+long systhread_mutex_unlock(t_systhread_mutex pmutex)
+{
+    return pthread_mutex_unlock((pthread_mutex_t *)pmutex);
+}
+
+long systhread_cond_new(t_systhread_cond *pcond, long flags)
+{
+    pthread_cond_t *c = (pthread_cond_t *)calloc(1, sizeof(pthread_cond_t));
+    pthread_cond_init(c, NULL);
+    *pcond = c;
+    return 0;
+}
+
+long systhread_cond_free(t_systhread_cond pcond)
+{
+    pthread_cond_destroy((pthread_cond_t *)pcond);
+    free(pcond);
+    return 0;
+}
+
+long systhread_cond_wait(t_systhread_cond pcond, t_systhread_mutex m)
+{
+    return pthread_cond_wait((pthread_cond_t *)pcond, (pthread_mutex_t *)m);
+}
+
+long systhread_cond_signal(t_systhread_cond pcond)
+{
+    return pthread_cond_signal((pthread_cond_t *)pcond);
+}
+
+long systhread_cond_broadcast(t_systhread_cond pcond)
+{
+    return pthread_cond_broadcast((pthread_cond_t *)pcond);
+}
+
+//////////////////////// dictionaries
+
+typedef struct _stub_dictentry
+{
+    t_symbol *key;
+    long argc;
+    t_atom *argv;
+    t_object *dict;                         // set instead of atoms for sub-dictionaries
+} t_stub_dictentry;
+
+struct _dictionary
+{
+    t_object ob;
+    t_stub_dictentry *entries;
+    long count;
+    long capacity;
+};
+
+static void stub_dictentry_clear(t_stub_dictentry *e)
+{
+    stub_free(e->argv);
+    if (e->dict) object_free(e->dict);
+    e->argv = NULL;
+    e->argc = 0;
+    e->dict = NULL;
+}
+
+static void stub_dictionary_free(t_dictionary *d)
+{
+    dictionary_clear(d);
+    stub_free(d->entries);
+}
+
+static t_class stub_dictionary_class = { "dictionary", NULL, (method)stub_dictionary_free, sizeof(struct _dictionary) };
+
+t_dictionary *dictionary_new(void)
+{
+    stub_counters.allocs++;
+    return (t_dictionary *)object_alloc(&stub_dictionary_class);
+}
+
+t_max_err dictionary_clear(t_dictionary *d)
+{
+    for (long i = 0; i < d->count; i++) stub_dictentry_clear(&d->entries[i]);
+    d->count = 0;
+    return MAX_ERR_NONE;
+}
+
+static t_stub_dictentry *stub_dictionary_find(const t_dictionary *d, t_symbol *key)
+{
+    for (long i = 0; i < d->count; i++) {
+        if (d->entries[i].key == key) return &d->entries[i];
+    }
+    return NULL;
+}
+
+// appending to an existing key replaces its value, like Max does
+static t_stub_dictentry *stub_dictionary_slot(t_dictionary *d, t_symbol *key)
+{
+    t_stub_dictentry *e = stub_dictionary_find(d, key);
+    if (e) {
+        stub_dictentry_clear(e);
+        return e;
+    }
+    if (d->count == d->capacity) {
+        long capacity = d->capacity ? d->capacity * 2 : 8;
+        t_stub_dictentry *entries = (t_stub_dictentry *)stub_alloc(sizeof(t_stub_dictentry) * (size_t)capacity);
+        if (d->count) memcpy(entries, d->entries, sizeof(t_stub_dictentry) * (size_t)d->count);
+        stub_free(d->entries);
+        d->entries = entries;
+        d->capacity = capacity;
+    }
+    e = &d->entries[d->count++];
+    e->key = key;
+    return e;
+}
+
+t_max_err dictionary_appendatoms(t_dictionary *d, t_symbol *key, long argc, t_atom *argv)
+{
+    t_stub_dictentry *e = stub_dictionary_slot(d, key);
+    e->argv = (t_atom *)stub_alloc(sizeof(t_atom) * (size_t)argc);
+    memcpy(e->argv, argv, sizeof(t_atom) * (size_t)argc);
+    e->argc = argc;
+    return MAX_ERR_NONE;
+}
+
+t_max_err dictionary_appendlong(t_dictionary *d, t_symbol *key, t_atom_long value)
+{
+    t_atom a;
+    atom_setlong(&a, value);
+    return dictionary_appendatoms(d, key, 1, &a);
+}
+
+t_max_err dictionary_appendfloat(t_dictionary *d, t_symbol *key, double value)
+{
+    t_atom a;
+    atom_setfloat(&a, value);
+    return dictionary_appendatoms(d, key, 1, &a);
+}
+
+t_max_err dictionary_appendsym(t_dictionary *d, t_symbol *key, t_symbol *value)
+{
+    t_atom a;
+    atom_setsym(&a, value);
+    return dictionary_appendatoms(d, key, 1, &a);
+}
+
+t_max_err dictionary_appenddictionary(t_dictionary *d, t_symbol *key, t_object *value)
+{
+    t_stub_dictentry *e = stub_dictionary_slot(d, key);
+    e->dict = value;
+    return MAX_ERR_NONE;
+}
+
+t_max_err dictionary_getatoms(const t_dictionary *d, t_symbol *key, long *argc, t_atom **argv)
+{
+    t_stub_dictentry *e = stub_dictionary_find(d, key);
+    if (!e || e->dict) return MAX_ERR_GENERIC;
+    *argc = e->argc;
+    *argv = e->argv;
+    return MAX_ERR_NONE;
+}
+
+t_max_err dictionary_getdictionary(const t_dictionary *d, t_symbol *key, t_object **value)
+{
+    t_stub_dictentry *e = stub_dictionary_find(d, key);
+    if (!e || !e->dict) return MAX_ERR_GENERIC;
+    *value = e->dict;
+    return MAX_ERR_NONE;
+}
+
+t_max_err dictionary_chuckentry(t_dictionary *d, t_symbol *key)
+{
+    t_stub_dictentry *e = stub_dictionary_find(d, key);
+    if (!e) return MAX_ERR_GENERIC;
+    stub_free(e->argv); // a chucked sub-dictionary now belongs to the caller
+    *e = d->entries[--d->count];
+    return MAX_ERR_NONE;
+}
+
+t_max_err dictionary_deleteentry(t_dictionary *d, t_symbol *key)
+{
+    t_stub_dictentry *e = stub_dictionary_find(d, key);
+    if (!e) return MAX_ERR_GENERIC;
+    stub_dictentry_clear(e);
+    *e = d->entries[--d->count];
+    return MAX_ERR_NONE;
+}
+
+long dictionary_hasentry(const t_dictionary *d, t_symbol *key)
+{
+    return stub_dictionary_find(d, key) != NULL;
+}
+
+t_atom_long dictionary_getentrycount(const t_dictionary *d)
+{
+    return d->count;
+}
+
+// parses the "@key value value @key value" form used with dictionary_sprintf
+t_dictionary *dictionary_sprintf(const char *fmt, ...)
+{
+    char buf[4096];
+    char *tok, *save = NULL;
+    t_symbol *key = NULL;
+    t_atom values[64];
+    long count = 0;
+    t_dictionary *d = dictionary_new();
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    for (tok = strtok_r(buf, " ", &save); ; tok = strtok_r(NULL, " ", &save)) {
+        if (!tok || tok[0] == '@') {
+            if (key) dictionary_appendatoms(d, key, count, values);
+            if (!tok) break;
+            key = gensym(tok + 1);
+            count = 0;
+        }
+        else if (count < 64) {
+            char *end;
+            double v = strtod(tok, &end);
+            if (*end) atom_setsym(values + count, gensym(tok));
+            else if (strchr(tok, '.')) atom_setfloat(values + count, v);
+            else atom_setlong(values + count, (t_atom_long)v);
+            count++;
+        }
+    }
+    return d;
+}
+
+t_dictionary *dictobj_register(t_dictionary *d, t_symbol **name)
+{
+    if (!*name) *name = symbol_unique();
+    return d;
+}
+
+t_max_err dictobj_unregister(t_dictionary *d)
+{
+    return MAX_ERR_NONE;
+}
@@ -0,0 +1,154 @@
+// lightweight stand-ins for the Max API used by the externals
+#ifndef PXLEAP_MAXSTUB_H
+#define PXLEAP_MAXSTUB_H
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+typedef void *(*method)(void *, ...);
+typedef long t_atom_long;
+typedef double t_atom_float;
+typedef intptr_t t_int;
+typedef uintptr_t t_uint;
+typedef int64_t t_int64;
+typedef uint64_t t_uint64;
+typedef int32_t t_int32;
+typedef uint32_t t_uint32;
+typedef size_t t_ptr_size;
+typedef long t_max_err;
+typedef char *t_ptr;
+typedef uint32_t t_fourcc;
+#define MAX_PATH_CHARS 2048
+
+enum { MAX_ERR_NONE = 0, MAX_ERR_GENERIC = -1 };
+enum { A_NOTHING = 0, A_LONG, A_FLOAT, A_SYM, A_OBJ, A_DEFLONG, A_DEFFLOAT, A_DEFSYM, A_GIMME, A_CANT };
+enum { ASSIST_INLET = 1, ASSIST_OUTLET = 2 };
+
+typedef struct symbol { char *s_name; struct object *s_thing; } t_symbol;
+typedef struct object { void *o_messlist; void *o_magic; void *o_inlet; void *o_outlet; } t_object;
+typedef union word { t_atom_long w_long; t_atom_float w_float; t_symbol *w_sym; t_object *w_obj; } t_word;
+typedef struct atom { short a_type; union word a_w; } t_atom;
+typedef struct maxclass t_class;
+typedef void t_qelem;
+typedef void t_clock;
+typedef struct _dictionary t_dictionary;
+
+#define CLASS_BOX gensym("box")
+#define calcoffset(x, y) ((long)offsetof(x, y))
+
+void post(const char *fmt, ...);
+void object_post(t_object *x, const char *s, ...);
+void object_error(t_object *x, const char *s, ...);
+void object_warn(t_object *x, const char *s, ...);
+t_symbol *gensym(const char *s);
+t_symbol *symbol_unique(void);
+
+t_max_err atom_setlong(t_atom *a, t_atom_long b);
+t_max_err atom_setfloat(t_atom *a, double b);
+t_max_err atom_setsym(t_atom *a, t_symbol *b);
+t_max_err atom_setobj(t_atom *a, void *b);
+t_atom_long atom_getlong(const t_atom *a);
+t_atom_float atom_getfloat(const t_atom *a);
+t_symbol *atom_getsym(const t_atom *a);
+long atom_gettype(const t_atom *a);
+
+void *outlet_new(void *x, const char *s);
+void *outlet_bang(void *o);
+void *outlet_int(void *o, t_atom_long n);
+void *outlet_float(void *o, double f);
+void *outlet_list(void *o, t_symbol *s, short ac, t_atom *av);
+void *outlet_anything(void *o, t_symbol *s, short ac, t_atom *av);
+
+t_class *class_new(const char *name, method mnew, method mfree, long size, method mmenu, short type, ...);
+t_max_err class_addmethod(t_class *c, method m, const char *name, ...);
+t_max_err class_register(t_symbol *name_space, t_class *c);
+t_max_err class_addattr(t_class *c, t_symbol *name, char type, long offset, long size, long count, method get, method set);
+t_max_err class_attr_accessors(t_class *c, const char *name, method get, method set);
+t_max_err class_attr_filter_clip(t_class *c, const char *name, double min, double max);
+void *object_alloc(t_class *c);
+t_max_err object_free(void *x);
+void freeobject(t_object *op);
+void *object_method(void *x, t_symbol *s, ...);
+t_max_err object_attr_setsym(void *x, t_symbol *s, t_symbol *c);
+t_max_err object_attr_setlong(void *x, t_symbol *s, t_atom_long c);
+t_max_err object_attr_setfloat(void *x, t_symbol *s, double c);
+t_max_err object_attr_setvalueof(void *x, t_symbol *s, long argc, t_atom *argv);
+long attr_args_offset(short ac, t_atom *av);
+void attr_args_process(void *x, short ac, t_atom *av);
+
+#define CLASS_ATTR_LONG(c, name, flags, structname, field) \
+    class_addattr((c), gensym(name), 'l', calcoffset(structname, field), sizeof(((structname *)0)->field), 1, NULL, NULL)
+#define CLASS_ATTR_FLOAT(c, name, flags, structname, field) \
+    class_addattr((c), gensym(name), 'f', calcoffset(structname, field), sizeof(((structname *)0)->field), 1, NULL, NULL)
+#define CLASS_ATTR_FLOAT_ARRAY(c, name, flags, structname, field, size) \
+    class_addattr((c), gensym(name), 'f', calcoffset(structname, field), sizeof(float), (size), NULL, NULL)
+#define CLASS_ATTR_DOUBLE(c, name, flags, structname, field) \
+    class_addattr((c), gensym(name), 'd', calcoffset(structname, field), sizeof(((structname *)0)->field), 1, NULL, NULL)
+#define CLASS_ATTR_SYM(c, name, flags, structname, field) \
+    class_addattr((c), gensym(name), 's', calcoffset(structname, field), sizeof(((structname *)0)->field), 1, NULL, NULL)
+#define CLASS_ATTR_CHAR(c, name, flags, structname, field) \
+    class_addattr((c), gensym(name), 'c', calcoffset(structname, field), sizeof(((structname *)0)->field), 1, NULL, NULL)
+#define CLASS_ATTR_SYM_VARSIZE(c, name, flags, structname, field, countfield, maxcount) \
+    class_addattr((c), gensym(name), 'S', calcoffset(structname, field), sizeof(t_symbol *), (maxcount), NULL, NULL)
+#define CLASS_ATTR_ACCESSORS(c, name, get, set) class_attr_accessors((c), (name), (method)(get), (method)(set))
+#define CLASS_ATTR_FILTER_CLIP(c, name, min, max) class_attr_filter_clip((c), (name), (min), (max))
+#define CLASS_ATTR_FILTER_MIN(c, name, min) class_attr_filter_clip((c), (name), (min), 1e300)
+#define CLASS_ATTR_CATEGORY(c, name, flags, str)
+#define CLASS_ATTR_LABEL(c, name, flags, str)
+#define CLASS_ATTR_BASIC(c, name, flags)
+#define CLASS_ATTR_STYLE(c, name, flags, str)
+#define CLASS_ATTR_STYLE_LABEL(c, name, flags, style, label)
+#define CLASS_ATTR_ENUM(c, name, flags, str)
+#define CLASS_ATTR_ENUMINDEX(c, name, flags, str)
+#define CLASS_ATTR_SAVE(c, name, flags)
+
+void *sysmem_newptr(t_ptr_size size);
+void *sysmem_newptrclear(t_ptr_size size);
+void sysmem_freeptr(void *ptr);
+void sysmem_copyptr(const void *src, void *dst, t_ptr_size bytes);
+
+t_qelem *qelem_new(void *obj, method fn);
+void qelem_set(t_qelem *q);
+void qelem_unset(t_qelem *q);
+void qelem_free(t_qelem *q);
+t_clock *clock_new(void *obj, method fn);
+void clock_fdelay(t_clock *c, double time);
+void clock_delay(t_clock *c, long time);
+void clock_unset(t_clock *c);
+double systimer_gettime(void);
+void schedule_delay(void *ob, method fun, long delay, t_symbol *sym, short argc, t_atom *argv);
+short isr(void);
+
+short path_topathname(short path, const char *file, char *name);
+short locatefile_extended(char *name, short *outvol, t_uint32 *outtype, const t_uint32 *filetypelist, short numtypes);
+short path_toabsolutesystempath(const short in_path, const char *in_filename, char *out_filepath);
+short path_getdefault(void);
+char *strncpy_zero(char *dst, const char *src, long size);
+
+
+// bench hooks, not part of the Max API
+// counters are per thread so the bench sees only what the Max thread did around a bang
+typedef struct _stub_counters
+{
+    uint64_t allocs;                        // sysmem and dictionary heap allocations
+    uint64_t gensyms;                       // symbol table lookups
+    uint64_t outlet_calls;
+    uint64_t atoms_out;                     // atoms passed through outlets
+} t_stub_counters;
+
+extern _Thread_local t_stub_counters stub_counters;
+void stub_set_quiet(int quiet);
+// what isr() returns, 0 to send messages as the main thread with Overdrive off
+void stub_set_isr(int isr);
+// the method a class registered under name, for messages with arguments object_method can't pass
+method stub_getmethod(void *x, const char *name);
+// called with every message sent through outlet_anything, NULL to stop
+void stub_set_anything_hook(void (*hook)(t_symbol *s, short ac, t_atom *av));
+// the same for outlet_list
+void stub_set_list_hook(void (*hook)(short ac, t_atom *av));
+void *stub_alloc(size_t size);
+void stub_free(void *ptr);
+// runs pending qelems and due clocks on the calling thread, like the Max scheduler would
+void stub_run_scheduler(void);
+#endif
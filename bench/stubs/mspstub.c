@@ -0,0 +1,60 @@
+//
+// mspstub
+//
+// Stand-ins for the MSP calls px.ultraleap~ makes, and a dsp64 chain the bench can run vectors through
+//
+
+#include <stdlib.h>
+#include "z_dsp.h"
+
+typedef struct _stub_dsp64
+{
+    t_object ob;
+    void *x;
+    t_perfroutine64 perform;
+    void *userparam;
+} t_stub_dsp64;
+
+static t_class *stub_dsp64_class;
+
+void z_dsp_setup(t_pxobject *x, long nsignals)
+{
+    x->z_in = nsignals;
+}
+
+void z_dsp_free(t_pxobject *x)
+{
+}
+
+void class_dspinit(t_class *c)
+{
+}
+
+static void stub_dsp64_add(t_stub_dsp64 *d, void *x, t_perfroutine64 perform, long flags, void *userparam)
+{
+    d->x = x;
+    d->perform = perform;
+    d->userparam = userparam;
+}
+
+t_object *stub_dsp64_new(void)
+{
+    if (!stub_dsp64_class) {
+        stub_dsp64_class = class_new("dsp64", NULL, NULL, sizeof(t_stub_dsp64), NULL, 0, 0);
+        class_addmethod(stub_dsp64_class, (method)stub_dsp64_add, "dsp_add64", A_CANT, 0);
+    }
+    return (t_object *)object_alloc(stub_dsp64_class);
+}
+
+void stub_dsp64_compile(t_object *dsp64, void *x, double samplerate, long maxvectorsize)
+{
+    void (*dsp)(void *, t_object *, short *, double, long, long) = (void (*)(void *, t_object *, short *, double, long, long))stub_getmethod(x, "dsp64");
+    short count[1] = { 0 };
+    if (dsp) dsp(x, dsp64, count, samplerate, maxvectorsize, 0);
+}
+
+void stub_dsp64_perform(t_object *dsp64, double **outs, long numouts, long n)
+{
+    t_stub_dsp64 *d = (t_stub_dsp64 *)dsp64;
+    if (d->perform) d->perform((t_object *)d->x, dsp64, NULL, 0, outs, numouts, n, 0, d->userparam);
+}
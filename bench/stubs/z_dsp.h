@@ -0,0 +1,31 @@
+// just enough of MSP for px.ultraleap~: t_pxobject, dsp setup and a dsp64 chain that keeps the perform routine
+#ifndef PXLEAP_MSPSTUB_H
+#define PXLEAP_MSPSTUB_H
+#include "ext.h"
+
+typedef struct t_pxobject
+{
+    t_object z_ob;
+    long z_in;
+    void *z_proxy;
+    long z_disabled;
+    short z_count;
+    short z_misc;
+} t_pxobject;
+
+typedef void (*t_perfroutine64)(t_object *x, t_object *dsp64, double **ins, long numins, double **outs, long numouts, long sampleframes, long flags, void *userparam);
+
+void z_dsp_setup(t_pxobject *x, long nsignals);
+void z_dsp_free(t_pxobject *x);
+void class_dspinit(t_class *c);
+#define dsp_setup z_dsp_setup
+#define dsp_free z_dsp_free
+
+// bench hooks, not part of the MSP API
+// a dsp64 chain holding the perform routine one object adds to it
+t_object *stub_dsp64_new(void);
+// sends x its dsp64 message, like turning audio on
+void stub_dsp64_compile(t_object *dsp64, void *x, double samplerate, long maxvectorsize);
+// runs the perform routine for one vector
+void stub_dsp64_perform(t_object *dsp64, double **outs, long numouts, long n);
+#endif
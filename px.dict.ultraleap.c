@@ -15,13 +15,14 @@
 #include "ext_systhread.h"
 #include "ext_strings.h"
 #include "ext_dictobj.h"
-
 #define _USE_MATH_DEFINES // To get definition of M_PI
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <time.h>
+#include <string.h>
 #include "LeapC.h"
+#include "pxleap_core.h"
 
 // a macro to mark exported symbols in the code without requiring an external file to define them
 #ifdef WIN_VERSION
@@ -33,22 +34,31 @@
 #endif
 
 ////////////////////////// object struct
+//one frame's hand trees, held outside the frame dictionary until they're swapped into it
+typedef struct _px_dict_ultraleap_trees
+{
+    t_dictionary *hands[2];                                 // left and right
+    bool present[2];                                        // hands in the frame these trees were filled from
+    t_atom_long id;
+    t_atom_long numhands;
+} t_px_dict_ultraleap_trees;
+
+//trees[3] is written by the Max thread for frames it outputs itself, the rest are handed over by the worker
+#define PX_DICT_ULTRALEAP_OWNTREES 3
+
 typedef struct _px_dict_ultraleap
 {
-	t_object ob;
+    t_pxleap_core core;                                     // frames, the worker and every shared message, see pxleap_core.h
     void *outlet_frame;
     void *outlet_start;
     t_symbol        *name;            // symbol mapped to the dictionary
     t_dictionary    *dictionary;    // the actual dictionary
-    bool isrunning;
-    t_int64 lastframeid;
-    LEAP_CONNECTION connection;
-    LEAP_CLOCK_REBASER clockSynchronizer;
-    LEAP_TRACKING_EVENT *frame;
-    t_systhread        x_systhread;                        // thread reference
-    t_systhread_mutex    x_mutex;                            // mutual exclusion lock for threadsafety
-    int                x_systhread_cancel;                    // thread cancel flag
-    void                *x_qelem;
+    t_px_dict_ultraleap_trees trees[4];                     // hand trees, filled ahead of output so bang only swaps pointers
+    _Atomic uint32_t treesmiddle;                           // latest trees the worker filled | PXLEAP_TRIPLEBUF_FRESH, as in t_pxleap_triplebuf
+    uint32_t treesback;                                     // owned by the worker
+    uint32_t treesfront;                                    // owned by the Max thread
+    t_px_dict_ultraleap_trees *shown;                       // trees in the frame dictionary, NULL for none
+    t_dictionary *installed[2];                             // the hand trees of those put in it
     t_int frame_id_save;
 } t_px_dict_ultraleap;
 
@@ -57,18 +67,44 @@ typedef struct _px_dict_ultraleap
 void *px_dict_ultraleap_new(t_symbol *s, long argc, t_atom *argv);
 void px_dict_ultraleap_free(t_px_dict_ultraleap *x);
 void px_dict_ultraleap_assist(t_px_dict_ultraleap *x, void *b, long m, long a, char *s);
-void px_dict_ultraleap_bang(t_px_dict_ultraleap *x);
-void px_dict_ultraleap_connect(t_px_dict_ultraleap *x);
-void px_dict_ultraleap_stop(t_px_dict_ultraleap *x);
-void px_dict_ultraleap_systhread_start(t_px_dict_ultraleap *x);
-void *px_dict_ultraleap_service(t_px_dict_ultraleap *x);
-void * px_dict_ultraleap_tick(t_px_dict_ultraleap *x);
+void px_dict_ultraleap_outputframe(t_px_dict_ultraleap *x, const t_pxleap_frame *frame);
 void px_dict_ultraleap_setname(t_px_dict_ultraleap *x, void *attr, long argc, t_atom *argv);
+void px_dict_ultraleap_setname_now(t_px_dict_ultraleap *x, t_symbol *name);
+void px_dict_ultraleap_renamed(t_px_dict_ultraleap *x, t_symbol *s, short argc, t_atom *argv);
+t_dictionary *px_dict_ultraleap_newhand(const t_pxleap_plan *plan);
+void px_dict_ultraleap_filltrees(const t_pxleap_plan *plan, t_px_dict_ultraleap_trees *trees, const t_pxleap_frame *frame);
+void px_dict_ultraleap_publishtrees(t_px_dict_ultraleap *x, const t_pxleap_frame *frame);
+void px_dict_ultraleap_install(t_px_dict_ultraleap *x, t_px_dict_ultraleap_trees *trees);
+void px_dict_ultraleap_uninstall(t_px_dict_ultraleap *x);
+void px_dict_ultraleap_showtrees(t_px_dict_ultraleap *x, t_px_dict_ultraleap_trees *trees);
+bool px_dict_ultraleap_outputtrees(t_px_dict_ultraleap *x);
+void px_dict_ultraleap_restart(t_px_dict_ultraleap *x);
+void px_dict_ultraleap_resethands(t_px_dict_ultraleap *x);
+void px_dict_ultraleap_setfloats(t_dictionary *d, t_symbol *key, long n, const float *v);
+void px_dict_ultraleap_setlong(t_dictionary *d, t_symbol *key, t_atom_long v);
 
 // class statics/globals
 t_symbol *ps_name;
 static t_symbol *ps_modified;
 static t_symbol *ps_dictionary;
+static t_symbol *ps_id;
+static t_symbol *ps_numhands;
+static t_symbol *ps_handtypes[2];
+static t_symbol *ps_fingers[5];
+static t_symbol *ps_joints[4];
+static t_symbol *ps_velocity;
+static t_symbol *ps_pinch;
+static t_symbol *ps_grab;
+static t_symbol *ps_curl;
+
+//the worker fills hand trees for each frame as it publishes it, so bang only swaps them in
+static const t_pxleap_core_hooks px_dict_ultraleap_hooks = {
+    (void (*)(t_pxleap_core *, const t_pxleap_frame *))px_dict_ultraleap_outputframe,
+    (bool (*)(t_pxleap_core *))px_dict_ultraleap_outputtrees,
+    (void (*)(t_pxleap_core *, const t_pxleap_frame *))px_dict_ultraleap_publishtrees,
+    (void (*)(t_pxleap_core *))px_dict_ultraleap_restart,
+    (void (*)(t_pxleap_core *))px_dict_ultraleap_resethands
+};
 
 //global class pointer variable
 void *px_dict_ultraleap_class;
@@ -80,9 +116,8 @@ int T_EXPORT main(void)
 	
 	c = class_new("px.dict.ultraleap", (method)px_dict_ultraleap_new, (method)px_dict_ultraleap_free, (long)sizeof(t_px_dict_ultraleap), 0L /* leave NULL!! */, A_GIMME, 0);
 	
-    class_addmethod(c, (method)px_dict_ultraleap_bang, "bang", 0);
-    class_addmethod(c, (method)px_dict_ultraleap_connect, "connect", 0);
-    class_addmethod(c, (method)px_dict_ultraleap_stop, "stop", 0);
+    //bang, connect, replay and the rest of the messages and attributes both objects share
+    pxleap_core_classinit(c);
     class_addmethod(c, (method)px_dict_ultraleap_assist, "assist", A_CANT, 0);
     
     CLASS_ATTR_SYM(c,            "name",            0, t_px_dict_ultraleap, name);
@@ -90,13 +125,33 @@ int T_EXPORT main(void)
     CLASS_ATTR_CATEGORY(c,        "name",            0, "Dictionary");
     CLASS_ATTR_LABEL(c,            "name",            0, "Name");
     CLASS_ATTR_BASIC(c,            "name",            0);
-	
+
+    CLASS_ATTR_CATEGORY(c,        "fields",          0, "Dictionary");
+
 	class_register(CLASS_BOX, c);
 	px_dict_ultraleap_class = c;
     
     ps_name = gensym("name");
     ps_modified = gensym("modified");
     ps_dictionary = gensym("dictionary");
+    ps_id = gensym("id");
+    ps_numhands = gensym("numhands");
+    ps_handtypes[0] = gensym("left");
+    ps_handtypes[1] = gensym("right");
+    ps_fingers[0] = gensym("thumb");
+    ps_fingers[1] = gensym("index");
+    ps_fingers[2] = gensym("middle");
+    ps_fingers[3] = gensym("ring");
+    ps_fingers[4] = gensym("pinky");
+    ps_joints[0] = gensym("base");
+    ps_joints[1] = gensym("joint1");
+    ps_joints[2] = gensym("joint2");
+    ps_joints[3] = gensym("tip");
+    ps_velocity = gensym("velocity");
+    ps_pinch = gensym("pinch");
+    ps_grab = gensym("grab");
+    ps_curl = gensym("curl");
+    pxleap_core_setup();
     
 	return 0;
 }
@@ -119,183 +174,230 @@ void px_dict_ultraleap_assist(t_px_dict_ultraleap *x, void *b, long m, long a, c
 	}
 }
 
-// Initializes the connection to Leap and starts the message service thread
-void px_dict_ultraleap_connect(t_px_dict_ultraleap *x){
-    post("trying to connect");
-    if(x->isrunning){
-        post("already connected!");
-      return &x->connection;
-    }
-    eLeapRS result;
-    if(x->connection || LeapCreateConnection(NULL, &x->connection) == eLeapRS_Success){
-        result = LeapOpenConnection(x->connection);
-        if(result == eLeapRS_Success){
-            x->isrunning = true;
-            px_dict_ultraleap_systhread_start(x);
-            post("Leap Connected");
-        }
-        else post("Leap connection not opened");
+void px_dict_ultraleap_free(t_px_dict_ultraleap *x)
+{
+    pxleap_core_free(&x->core); // stops the worker, which fills the hand trees
+    px_dict_ultraleap_uninstall(x); // the hand trees belong to their slots, not the dictionary
+    object_free((t_object *)x->dictionary); // will call object_unregister
+    for(long s = 0; s < 4; s++){
+        for(long t = 0; t < 2; t++) object_free((t_object *)x->trees[s].hands[t]);
     }
-    else post("problem with creating connection");
-    return &x->connection;
 }
 
-void px_dict_ultraleap_free(t_px_dict_ultraleap *x)
+//build a hand tree with every key already holding an atom array of the right size,
+//so that frames only ever overwrite atoms in place
+t_dictionary *px_dict_ultraleap_newhand(const t_pxleap_plan *plan)
 {
-    px_dict_ultraleap_stop(x); // stop the service thread
-    LeapCloseConnection(x->connection); // close the leap connection
-    LeapDestroyConnection(x->connection); // destroy the leap connection
-    // free our mutex
-    if (x->x_mutex)
-        systhread_mutex_free(x->x_mutex);
-    object_free((t_object *)x->dictionary); // will call object_unregister
+    float zeros[4] = {0.f, 0.f, 0.f, 0.f};
+    t_dictionary *hand = dictionary_new();
+    for(long i = 0; i < plan->nsteps; i++)
+        px_dict_ultraleap_setfloats(hand, plan->steps[i].name, plan->steps[i].count, zeros);
+    for(long f = 0; f < 5 && plan->njoints; f++){
+        t_dictionary *finger = dictionary_new();
+        for(long j = plan->firstjoint; j < 4; j++) px_dict_ultraleap_setfloats(finger, ps_joints[j], 3, zeros);
+        dictionary_appenddictionary(hand, ps_fingers[f], (t_object *)finger);
+    }
+    return hand;
 }
 
-//worker thread function that polls the Leap service and stores tracking frames
-void * px_dict_ultraleap_tick(t_px_dict_ultraleap *x){
-    while(1){
-        if (x->x_systhread_cancel)
-            return NULL;
-        eLeapRS result;
-        LEAP_CONNECTION_MESSAGE msg;
-        LEAP_CONNECTION_INFO *cInfo;
-        if(x->isrunning){
-            //post("running");
-            unsigned int timeout = 10;
-            result = LeapPollConnection(x->connection, timeout, &msg);
-            if(result == eLeapRS_Success){
-                if (msg.type == eLeapEventType_Tracking){
-                    LEAP_TRACKING_EVENT *frame = (LEAP_TRACKING_EVENT *)msg.tracking_event;
-                    //use mutex lock to prevent issues between threads
-                    systhread_mutex_lock(x->x_mutex);
-                    if(!x->frame) x->frame = (LEAP_TRACKING_EVENT *)sysmem_newptr((t_ptr_size)(sizeof(*frame)));
-                        *x->frame = *frame; // store frame of data in object struct
-                        systhread_mutex_unlock(x->x_mutex);
-                }
-            }
-            //else post("not able to poll");
+//throw away every hand tree, the next frames rebuild them with only the keys they write.
+//only call on the scheduler thread, while the worker isn't filling trees
+void px_dict_ultraleap_resethands(t_px_dict_ultraleap *x)
+{
+    px_dict_ultraleap_uninstall(x);
+    for(long s = 0; s < 4; s++){
+        for(long t = 0; t < 2; t++){
+            if(x->trees[s].hands[t]) object_free((t_object *)x->trees[s].hands[t]);
+            x->trees[s].hands[t] = px_dict_ultraleap_newhand(&x->core.plan);
+            x->trees[s].present[t] = false;
         }
-        //systhread_sleep(1);
     }
-    x->x_systhread_cancel = false;
-    systhread_exit(0);
-    return NULL;
+    //whatever the worker filled before is gone, so bang has nothing new until its next frame
+    atomic_fetch_and_explicit(&x->treesmiddle, PXLEAP_TRIPLEBUF_INDEX, memory_order_relaxed);
 }
 
-//start the worker thread
-void px_dict_ultraleap_systhread_start(t_px_dict_ultraleap *x){
-    unsigned int ret;
-    if (x->x_systhread) {
-        x->x_systhread_cancel = true;                        // tell the thread to stop
-        systhread_join(x->x_systhread, &ret);                    // wait for the thread to stop
-        x->x_systhread = NULL;
+//overwrite the atoms stored under key, only appending a new array if the key is missing or the wrong size
+void px_dict_ultraleap_setfloats(t_dictionary *d, t_symbol *key, long n, const float *v)
+{
+    long argc = 0;
+    t_atom *argv = NULL;
+    if(dictionary_getatoms(d, key, &argc, &argv) == MAX_ERR_NONE && argc == n){
+        for(long i = 0; i < n; i++) atom_setfloat(argv+i, v[i]);
     }
-    if (x->x_systhread == NULL) {
-        systhread_create((method) px_dict_ultraleap_tick, x, 0, 0, 0, &x->x_systhread);
+    else {
+        t_atom values[4];
+        for(long i = 0; i < n; i++) atom_setfloat(values+i, v[i]);
+        dictionary_appendatoms(d, key, n, values);
     }
 }
 
-void px_dict_ultraleap_stop(t_px_dict_ultraleap *x)
+void px_dict_ultraleap_setlong(t_dictionary *d, t_symbol *key, t_atom_long v)
 {
-    unsigned int ret;
+    long argc = 0;
+    t_atom *argv = NULL;
+    if(dictionary_getatoms(d, key, &argc, &argv) == MAX_ERR_NONE && argc == 1) atom_setlong(argv, v);
+    else dictionary_appendlong(d, key, v);
+}
 
-    if (x->x_systhread) {
-        post("stopping leap service");
-        x->x_systhread_cancel = true;                        // tell the thread to stop
-        systhread_join(x->x_systhread, &ret);                    // wait for the thread to stop
-        x->x_systhread = NULL;
+//write one frame into a set of hand trees that isn't in the frame dictionary. the worker fills
+//them for bang, and the Max thread its own ones for every other output
+void px_dict_ultraleap_filltrees(const t_pxleap_plan *plan, t_px_dict_ultraleap_trees *trees, const t_pxleap_frame *frame)
+{
+    bool fingers = plan->njoints || (frame->featuregroups & (PXLEAP_FEATURE_VELOCITY | PXLEAP_FEATURE_CURL));
+    trees->id = frame->tracking_frame_id;
+    trees->numhands = frame->nHands;
+    trees->present[0] = trees->present[1] = false;
+    for(uint32_t h = 0; h < frame->nHands; h++){
+        const LEAP_HAND* hand = &frame->hands[h];
+        long type = (hand->type == eLeapHandType_Left) ? 0 : 1;
+        t_dictionary *hand_dict = trees->hands[type];
+        trees->present[type] = true;
+        for(long i = 0; i < plan->nsteps; i++)
+            px_dict_ultraleap_setfloats(hand_dict, plan->steps[i].name, plan->steps[i].count, pxleap_plan_read(&plan->steps[i], hand));
+        //finger trees are only needed for joints or per-finger features
+        for(t_int f = 0; f < 5 && fingers; f++){
+            const LEAP_DIGIT* finger = &hand->digits[f];
+            t_object *finger_dict = NULL;
+            if(dictionary_getdictionary(hand_dict, ps_fingers[f], &finger_dict) != MAX_ERR_NONE){
+                finger_dict = (t_object *)dictionary_new();
+                dictionary_appenddictionary(hand_dict, ps_fingers[f], finger_dict);
+            }
+            for(t_int j = plan->firstjoint; j < plan->firstjoint + plan->njoints; j++)
+                px_dict_ultraleap_setfloats((t_dictionary *)finger_dict, ps_joints[j], 3, finger->bones[j].next_joint.v);
+            if(frame->featuregroups & PXLEAP_FEATURE_VELOCITY)
+                px_dict_ultraleap_setfloats((t_dictionary *)finger_dict, ps_velocity, 3, frame->features[h].tip_velocity[f]);
+            if(frame->featuregroups & PXLEAP_FEATURE_CURL)
+                px_dict_ultraleap_setfloats((t_dictionary *)finger_dict, ps_curl, 1, &frame->features[h].curl[f]);
+        }
+        if(frame->featuregroups){
+            const t_pxleap_features *features = &frame->features[h];
+            if(frame->featuregroups & PXLEAP_FEATURE_VELOCITY)
+                px_dict_ultraleap_setfloats(hand_dict, ps_velocity, 3, features->palm_velocity);
+            if(frame->featuregroups & PXLEAP_FEATURE_GRIP){
+                float pinch[2] = {features->pinch_distance, features->pinch_strength};
+                float grab[2] = {features->grab_strength, features->grab_angle};
+                px_dict_ultraleap_setfloats(hand_dict, ps_pinch, 2, pinch);
+                px_dict_ultraleap_setfloats(hand_dict, ps_grab, 2, grab);
+            }
+        }
     }
 }
 
-//read from the most recent frame of data received from Leap
-void px_dict_ultraleap_bang(t_px_dict_ultraleap *x)
+//worker thread: fill the back trees and hand them over the same way frames are
+void px_dict_ultraleap_publishtrees(t_px_dict_ultraleap *x, const t_pxleap_frame *frame)
 {
-    if(x->isrunning){
-        LEAP_TRACKING_EVENT *frame;
-        systhread_mutex_lock(x->x_mutex);
-        frame = x->frame;
-        systhread_mutex_unlock(x->x_mutex);
-        if (frame){
-            int64_t frameID = frame->tracking_frame_id;
-            if(frameID != x->lastframeid){
-                dictionary_clear(x->dictionary);
-                dictionary_appendlong(x->dictionary,gensym("id"),frameID);
-                t_atom frame_data[5];
-                atom_setsym(frame_data, gensym("id"));
-                atom_setlong(frame_data+1, frameID);
-                t_int numhands = (t_int) frame->nHands;
-                dictionary_appendlong(x->dictionary,gensym("numhands"), numhands);
-                t_dictionary *hand_dict[2];
-                outlet_bang(x->outlet_start);
-                for(uint32_t h = 0; h < numhands; h++){
-                    LEAP_HAND* hand = &frame->pHands[h];
-                    t_atom hand_data[11];
-                    // palmPosition
-                    t_symbol *hand_type = (hand->type == eLeapHandType_Left) ? gensym("left") : gensym("right");
-                    hand_dict[h] = dictionary_new();
-                    atom_setsym(hand_data, hand_type);
-                    //set palm position values
-                    atom_setfloat(hand_data+1, hand->palm.position.x);
-                    atom_setfloat(hand_data+2, hand->palm.position.y);
-                    atom_setfloat(hand_data+3, hand->palm.position.z);
-                    dictionary_appendatoms(hand_dict[h],gensym("position"),3, hand_data+1);
-                    //outlet_list(x->outlet_hands, NULL, 4, hand_data);
-                    //set orientation values
-                    atom_setfloat(hand_data+1, hand->palm.orientation.v[0]);
-                    atom_setfloat(hand_data+2, hand->palm.orientation.v[1]);
-                    atom_setfloat(hand_data+3, hand->palm.orientation.v[2]);
-                    atom_setfloat(hand_data+4, hand->palm.orientation.v[3]);
-                    dictionary_appendatoms(hand_dict[h],gensym("orientation"),4, hand_data+1);
-                    //set normal values
-                    atom_setfloat(hand_data+1, hand->palm.normal.x);
-                    atom_setfloat(hand_data+2, hand->palm.normal.y);
-                    atom_setfloat(hand_data+3, hand->palm.normal.z);
-                    dictionary_appendatoms(hand_dict[h],gensym("normal"),3, hand_data+1);
-                    //set direction values
-                    atom_setfloat(hand_data+1, hand->palm.direction.x);
-                    atom_setfloat(hand_data+2, hand->palm.direction.y);
-                    atom_setfloat(hand_data+3, hand->palm.direction.z);
-                    dictionary_appendatoms(hand_dict[h],gensym("direction"),3, hand_data+1);
-                    t_dictionary *this_finger[5];
-                    char *fingernames[5] = {"thumb","index","middle","ring","pinky"};
-                    for(t_int f = 0; f < 5; f++){
-                        LEAP_DIGIT* finger = &hand->digits[f];
-                        t_atom finger_data[4];
-                        atom_setlong(finger_data,f);
-                        atom_setfloat(finger_data+1, finger->bones[3].next_joint.x);
-                        atom_setfloat(finger_data+2, finger->bones[3].next_joint.y);
-                        atom_setfloat(finger_data+3, finger->bones[3].next_joint.z);
-                        //outlet_list(x->outlet_fingers, NULL, 4, finger_data);
-                        this_finger[f] = dictionary_sprintf("@base %2f %2f %2f @joint1 %2f %2f %2f @joint2 %2f %2f %2f @tip %2f %2f %2f",  finger->bones[0].next_joint.x, finger->bones[0].next_joint.y, finger->bones[0].next_joint.z,  finger->bones[1].next_joint.x, finger->bones[1].next_joint.y, finger->bones[1].next_joint.z, finger->bones[2].next_joint.x, finger->bones[2].next_joint.y, finger->bones[2].next_joint.z, finger->bones[3].next_joint.x, finger->bones[3].next_joint.y, finger->bones[3].next_joint.z);
-                        dictionary_appenddictionary(hand_dict[h], gensym(fingernames[f]), (t_object *)this_finger[f]);
-                    }
-                    dictionary_appenddictionary(x->dictionary, hand_type, (t_object *)hand_dict[h]);
-                }
-                if (x->name) {
-                    t_atom    a[1];
-                    atom_setsym(a, x->name);
-                    outlet_anything(x->outlet_frame, ps_dictionary, 1, a);
-                }
-            }
-            x->lastframeid = frameID;
+    uint32_t prev;
+    px_dict_ultraleap_filltrees(&x->core.plan, &x->trees[x->treesback], frame);
+    prev = atomic_exchange_explicit(&x->treesmiddle, x->treesback | PXLEAP_TRIPLEBUF_FRESH, memory_order_acq_rel);
+    x->treesback = prev & PXLEAP_TRIPLEBUF_INDEX;
+}
+
+//put a set of trees into the frame dictionary, one pointer per hand however many keys it holds
+void px_dict_ultraleap_install(t_px_dict_ultraleap *x, t_px_dict_ultraleap_trees *trees)
+{
+    if(!x->dictionary) return;
+    px_dict_ultraleap_setlong(x->dictionary, ps_id, trees->id);
+    px_dict_ultraleap_setlong(x->dictionary, ps_numhands, trees->numhands);
+    for(long t = 0; t < 2; t++){
+        if(!trees->present[t]) continue;
+        dictionary_appenddictionary(x->dictionary, ps_handtypes[t], (t_object *)trees->hands[t]);
+        x->installed[t] = trees->hands[t];
+    }
+    x->shown = trees;
+}
+
+//take the shown trees back out of the frame dictionary without freeing them
+void px_dict_ultraleap_uninstall(t_px_dict_ultraleap *x)
+{
+    for(long t = 0; t < 2; t++){
+        t_object *hand = NULL;
+        if(!x->installed[t]) continue;
+        //the patch can edit the dictionary too, and a tree it deleted or replaced is already freed
+        if(dictionary_getdictionary(x->dictionary, ps_handtypes[t], &hand) == MAX_ERR_NONE && hand == (t_object *)x->installed[t])
+            dictionary_chuckentry(x->dictionary, ps_handtypes[t]);
+        else {
+            x->shown->hands[t] = px_dict_ultraleap_newhand(&x->core.plan);
+            x->shown->present[t] = false;
         }
+        x->installed[t] = NULL;
     }
+    x->shown = NULL;
 }
 
-void px_dict_ultraleap_setname(t_px_dict_ultraleap *x, void *attr, long argc, t_atom *argv)
+void px_dict_ultraleap_showtrees(t_px_dict_ultraleap *x, t_px_dict_ultraleap_trees *trees)
 {
-    t_symbol        *name = atom_getsym(argv);
+    px_dict_ultraleap_install(x, trees);
+    outlet_bang(x->outlet_start);
+    if (x->name) {
+        t_atom    a[1];
+        atom_setsym(a, x->name);
+        outlet_anything(x->outlet_frame, ps_dictionary, 1, a);
+    }
+}
+
+//bang: swap in the trees the worker filled for its newest frame, if there are any it hasn't shown
+bool px_dict_ultraleap_outputtrees(t_px_dict_ultraleap *x)
+{
+    uint32_t prev;
+    if(!(atomic_load_explicit(&x->treesmiddle, memory_order_relaxed) & PXLEAP_TRIPLEBUF_FRESH)) return false;
+    //the front trees go back to the worker, so they have to leave the frame dictionary first
+    px_dict_ultraleap_uninstall(x);
+    prev = atomic_exchange_explicit(&x->treesmiddle, x->treesfront, memory_order_acq_rel);
+    x->treesfront = prev & PXLEAP_TRIPLEBUF_INDEX;
+    px_dict_ultraleap_showtrees(x, &x->trees[x->treesfront]);
+    return true;
+}
+
+//write one frame into the Max thread's own trees and output it
+void px_dict_ultraleap_outputframe(t_px_dict_ultraleap *x, const t_pxleap_frame *frame)
+{
+    t_px_dict_ultraleap_trees *trees = &x->trees[PX_DICT_ULTRALEAP_OWNTREES];
+    px_dict_ultraleap_uninstall(x);
+    px_dict_ultraleap_filltrees(&x->core.plan, trees, frame);
+    px_dict_ultraleap_showtrees(x, trees);
+}
 
+//a new source is starting, so the trees the worker filled for the last one are never shown
+void px_dict_ultraleap_restart(t_px_dict_ultraleap *x)
+{
+    atomic_fetch_and_explicit(&x->treesmiddle, PXLEAP_TRIPLEBUF_INDEX, memory_order_relaxed);
+}
+
+//swap in the dictionary for a new name. bang writes the frame into the dictionary on the scheduler
+//thread, so it's only swapped there
+void px_dict_ultraleap_setname_now(t_px_dict_ultraleap *x, t_symbol *name)
+{
     if (!x->name || !name || x->name!=name) {
+        px_dict_ultraleap_uninstall(x); // keep the hand trees, the new dictionary gets them on the next output
         object_free(x->dictionary); // will call object_unregister
         x->dictionary = dictionary_new();
         x->dictionary = dictobj_register(x->dictionary, &name);
         x->name = name;
+        if (x->dictionary) {
+            px_dict_ultraleap_setlong(x->dictionary, ps_id, 0);
+            px_dict_ultraleap_setlong(x->dictionary, ps_numhands, 0);
+        }
     }
     if (!x->dictionary)
         object_error((t_object *)x, "could not create dictionary named %s", name->s_name);
 }
 
+void px_dict_ultraleap_renamed(t_px_dict_ultraleap *x, t_symbol *s, short argc, t_atom *argv)
+{
+    px_dict_ultraleap_setname_now(x, s);
+}
+
+void px_dict_ultraleap_setname(t_px_dict_ultraleap *x, void *attr, long argc, t_atom *argv)
+{
+    t_symbol        *name = atom_getsym(argv);
+
+    // the first name comes from new, before anything can bang
+    if (!x->name || isr())
+        px_dict_ultraleap_setname_now(x, name);
+    else
+        schedule_delay(x, (method)px_dict_ultraleap_renamed, 0, name, 0, NULL);
+}
+
 void *px_dict_ultraleap_new(t_symbol *s, long argc, t_atom *argv)
 {
 	t_px_dict_ultraleap *x = NULL;
@@ -309,6 +411,20 @@ void *px_dict_ultraleap_new(t_symbol *s, long argc, t_atom *argv)
         x->outlet_start = outlet_new(x, NULL);
         x->outlet_frame = outlet_new(x, NULL);
         x->dictionary = dictionary_new();
+        pxleap_core_init(&x->core, x->outlet_frame, &px_dict_ultraleap_hooks);
+        x->core.fields[0] = gensym("palm");
+        x->core.fields[1] = gensym("orientation");
+        x->core.fields[2] = gensym("normal");
+        x->core.fields[3] = gensym("direction");
+        x->core.fields[4] = gensym("joints");
+        x->core.fieldcount = 5;
+        pxleap_plan_compile(&x->core.plan, PXLEAP_FIELD_PALM | PXLEAP_FIELD_ORIENTATION | PXLEAP_FIELD_NORMAL | PXLEAP_FIELD_DIRECTION | PXLEAP_FIELD_JOINTS);
+        x->treesback = 0;
+        atomic_init(&x->treesmiddle, 1);
+        x->treesfront = 2;
+        x->shown = NULL;
+        x->installed[0] = x->installed[1] = NULL;
+        px_dict_ultraleap_resethands(x);
         attr_args_process(x, argc, argv);
         if (!x->name) {
             if (name)
@@ -316,9 +432,6 @@ void *px_dict_ultraleap_new(t_symbol *s, long argc, t_atom *argv)
             else
                 object_attr_setsym(x, ps_name, symbol_unique());
         }
-        LeapCreateClockRebaser(&x->clockSynchronizer);
-        x->x_systhread = NULL;
-        systhread_mutex_new(&x->x_mutex,0);
 	}
 	return (x);
 }
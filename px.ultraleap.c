@@ -13,13 +13,17 @@
 #include "ext_obex.h"						// required for new style Max object
 #include "ext_proto.h"
 #include "ext_systhread.h"
+#include "jit.common.h"
 
 #define _USE_MATH_DEFINES // To get definition of M_PI
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <time.h>
+#include <string.h>
 #include "LeapC.h"
+#include "pxleap_core.h"
+#include "pxleap_packed.h"
 
 // a macro to mark exported symbols in the code without requiring an external file to define them
 #ifdef WIN_VERSION
@@ -33,21 +37,18 @@
 ////////////////////////// object struct
 typedef struct _ultraleap
 {
-	t_object ob;
+    t_pxleap_core core;                                     // frames, the worker and every shared message, see pxleap_core.h
 	void *outlet_end;
     void *outlet_fingers;
     void *outlet_hands;
     void *outlet_frame;
     void *outlet_start;
-    bool isrunning;
-    t_int64 lastframeid;
-    LEAP_CONNECTION connection;
-    LEAP_CLOCK_REBASER clockSynchronizer;
-    LEAP_TRACKING_EVENT *frame;
-    t_systhread        x_systhread;                        // thread reference
-    t_systhread_mutex    x_mutex;                            // mutual exclusion lock for threadsafety
-    int                x_systhread_cancel;                    // thread cancel flag
-    void                *x_qelem;
+    t_symbol *output;                                       // list, matrix or packed
+    void *matrix;                                           // float32 skeleton matrix, one row per hand and one cell per joint
+    t_symbol *matrix_name;
+    long matrix_rowstride;                                  // bytes between hand rows
+    t_atom packed[PXLEAP_PACKED_MAX];                       // packed output, laid out again when fields or features change
+    t_pxleap_packed_layout packedlayout;
     t_int frame_id_save;
 } t_ultraleap;
 
@@ -56,16 +57,30 @@ typedef struct _ultraleap
 void *ultraleap_new(t_symbol *s, long argc, t_atom *argv);
 void ultraleap_free(t_ultraleap *x);
 void ultraleap_assist(t_ultraleap *x, void *b, long m, long a, char *s);
-void ultraleap_bang(t_ultraleap *x);
-void ultraleap_connect(t_ultraleap *x);
-void ultraleap_stop(t_ultraleap *x);
-void ultraleap_systhread_start(t_ultraleap *x);
-void *ultraleap_service(t_ultraleap *x);
-void * ultraleap_tick(t_ultraleap *x);
+t_max_err ultraleap_setoutput(t_ultraleap *x, void *attr, long argc, t_atom *argv);
+void ultraleap_outputframe(t_ultraleap *x, const t_pxleap_frame *frame);
+void ultraleap_outputmatrix(t_ultraleap *x, const t_pxleap_frame *frame);
+void ultraleap_outputfeatures(t_ultraleap *x, const t_pxleap_frame *frame);
+void ultraleap_outputpacked(t_ultraleap *x, const t_pxleap_frame *frame);
 
 //////////////////////// global class pointer variable
 void *ultraleap_class;
 
+// class statics
+static t_symbol *ps_handtypes[2];
+static t_symbol *ps_velocity;
+static t_symbol *ps_grip;
+static t_symbol *ps_curl;
+static t_symbol *ps_list;
+static t_symbol *ps_matrix;
+static t_symbol *ps_packed;
+static t_symbol *ps_joints;
+
+//every frame goes out as lists, a matrix or a packed list from the Max thread, nothing is prepared ahead
+static const t_pxleap_core_hooks ultraleap_hooks = {
+    (void (*)(t_pxleap_core *, const t_pxleap_frame *))ultraleap_outputframe, NULL, NULL, NULL, NULL
+};
+
 //////////////////////// Max functions
 int T_EXPORT main(void)
 {
@@ -73,16 +88,33 @@ int T_EXPORT main(void)
 	
 	c = class_new("px.ultraleap", (method)ultraleap_new, (method)ultraleap_free, (long)sizeof(t_ultraleap), 0L /* leave NULL!! */, A_GIMME, 0);
 	
-    class_addmethod(c, (method)ultraleap_bang, "bang", 0);
-    class_addmethod(c, (method)ultraleap_connect, "connect", 0);
-    class_addmethod(c, (method)ultraleap_stop, "stop", 0);
-    //class_addmethod(c, (method)ultraleap_systhread_start, "start", 0);
+    //bang, connect, replay and the rest of the messages and attributes both objects share
+    pxleap_core_classinit(c);
     
 	/* you CAN'T call this from the patcher */
     class_addmethod(c, (method)ultraleap_assist, "assist", A_CANT, 0);
 	
+    CLASS_ATTR_SYM(c,            "output",          0, t_ultraleap, output);
+    CLASS_ATTR_ACCESSORS(c,       "output",          NULL, ultraleap_setoutput);
+    CLASS_ATTR_ENUM(c,            "output",          0, "list matrix packed");
+    CLASS_ATTR_LABEL(c,           "output",          0, "Output Format");
+    CLASS_ATTR_BASIC(c,           "output",          0);
+
+    CLASS_ATTR_BASIC(c,           "fields",          0);
+
 	class_register(CLASS_BOX, c);
 	ultraleap_class = c;
+
+    ps_handtypes[0] = gensym("left");
+    ps_handtypes[1] = gensym("right");
+    ps_velocity = gensym("velocity");
+    ps_grip = gensym("grip");
+    ps_curl = gensym("curl");
+    ps_list = gensym("list");
+    ps_matrix = gensym("matrix");
+    ps_packed = gensym("packed");
+    ps_joints = gensym("joints");
+    pxleap_core_setup();
     
 	return 0;
 }
@@ -104,151 +136,166 @@ void ultraleap_assist(t_ultraleap *x, void *b, long m, long a, char *s)
 				sprintf(s, "Hands");
 				break;
             case 3:
-				sprintf(s, "Begin Frame");
+				sprintf(s, "Frame (matrix, packed and feature output)");
 				break;
             case 4:
-                sprintf(s, "Frame");
+                sprintf(s, "Begin Frame");
+                break;
 			default:
 				break;
 		}
 	}
 }
 
-// Initializes the connection to Leap and starts the message service thread
-void ultraleap_connect(t_ultraleap *x){
-    post("trying to connect");
-    if(x->isrunning){
-        post("already connected!");
-      return &x->connection;
-    }
-    eLeapRS result;
-    if(x->connection || LeapCreateConnection(NULL, &x->connection) == eLeapRS_Success){
-        result = LeapOpenConnection(x->connection);
-        if(result == eLeapRS_Success){
-            x->isrunning = true;
-            ultraleap_systhread_start(x);
-            post("Leap Connected");
-        }
-        else post("Leap connection not opened");
-    }
-    else post("problem with creating connection");
-    return &x->connection;
+void ultraleap_free(t_ultraleap *x)
+{
+    pxleap_core_free(&x->core); // stops the worker and closes everything it wrote to
+    if (x->matrix)
+        jit_object_free(x->matrix);
 }
 
-void ultraleap_free(t_ultraleap *x)
+void simplethread_cancel(t_ultraleap *x)
 {
-    ultraleap_stop(x); // stop the service thread
-    LeapCloseConnection(x->connection); // close the leap connection
-    LeapDestroyConnection(x->connection); // destroy the leap connection
-    // free our mutex
-    if (x->x_mutex)
-        systhread_mutex_free(x->x_mutex);
+    pxleap_core_stop(&x->core);                            // kill thread if, any
 }
 
-//worker thread function that polls the Leap service and stores tracking frames
-void * ultraleap_tick(t_ultraleap *x){
-    while(1){
-        if (x->x_systhread_cancel)
-            return NULL;
-        eLeapRS result;
-        LEAP_CONNECTION_MESSAGE msg;
-        LEAP_CONNECTION_INFO *cInfo;
-        if(x->isrunning){
-            //post("running");
-            unsigned int timeout = 10;
-            result = LeapPollConnection(x->connection, timeout, &msg);
-            if(result == eLeapRS_Success){
-                if (msg.type == eLeapEventType_Tracking){
-                    LEAP_TRACKING_EVENT *frame = (LEAP_TRACKING_EVENT *)msg.tracking_event;
-                    //use mutex lock to prevent issues between threads
-                    systhread_mutex_lock(x->x_mutex);
-                    if(!x->frame) x->frame = (LEAP_TRACKING_EVENT *)sysmem_newptr((t_ptr_size)(sizeof(*frame)));
-                    *x->frame = *frame; // store frame of data in object struct
-                    systhread_mutex_unlock(x->x_mutex);
-                }
-            }
-            //else post("not able to poll");
+t_max_err ultraleap_setoutput(t_ultraleap *x, void *attr, long argc, t_atom *argv){
+    t_symbol *output = argc ? atom_getsym(argv) : ps_list;
+    if(output != ps_list && output != ps_matrix && output != ps_packed){
+        object_error((t_object *)x, "output must be list, matrix or packed");
+        return MAX_ERR_GENERIC;
+    }
+    //the matrix is only allocated once, the first time it's needed
+    if(output == ps_matrix && !x->matrix){
+        t_jit_matrix_info info;
+        jit_matrix_info_default(&info);
+        info.type = _jit_sym_float32;
+        info.planecount = 3;
+        info.dimcount = 2;
+        info.dim[0] = PXLEAP_JOINT_COUNT;
+        info.dim[1] = PXLEAP_MAX_HANDS;
+        x->matrix_name = jit_symbol_unique();
+        x->matrix = jit_object_new(_jit_sym_jit_matrix, &info);
+        if(!x->matrix){
+            object_error((t_object *)x, "could not create the output matrix");
+            return MAX_ERR_GENERIC;
         }
-        //systhread_sleep(1);
+        x->matrix = jit_object_method(x->matrix, _jit_sym_register, x->matrix_name);
+        jit_object_method(x->matrix, _jit_sym_getinfo, &info);
+        x->matrix_rowstride = info.dimstride[1];
     }
-    x->x_systhread_cancel = false;
-    systhread_exit(0);
-    return NULL;
+    x->output = output;
+    return MAX_ERR_NONE;
 }
 
-//start the worker thread
-void ultraleap_systhread_start(t_ultraleap *x){
-    unsigned int ret;
-    if (x->x_systhread) {
-        x->x_systhread_cancel = true;                        // tell the thread to stop
-        systhread_join(x->x_systhread, &ret);                    // wait for the thread to stop
-        x->x_systhread = NULL;
-    }
-    if (x->x_systhread == NULL) {
-        systhread_create((method) ultraleap_tick, x, 0, 0, 0, &x->x_systhread);
+//write every joint of the frame into the matrix, row 0 is the left hand and row 1 the right,
+//rows of hands that aren't tracked are zeroed
+void ultraleap_outputmatrix(t_ultraleap *x, const t_pxleap_frame *frame){
+    char *data = NULL;
+    bool present[PXLEAP_MAX_HANDS] = {false, false};
+    t_atom a;
+    long savelock = (long)jit_object_method(x->matrix, _jit_sym_lock, 1);
+    jit_object_method(x->matrix, _jit_sym_getdata, &data);
+    if(data){
+        for(uint32_t h = 0; h < frame->nHands; h++){
+            long row = (frame->hands[h].type == eLeapHandType_Left) ? 0 : 1;
+            pxleap_hand_joints(&frame->hands[h], (float *)(data + row * x->matrix_rowstride));
+            present[row] = true;
+        }
+        for(long row = 0; row < PXLEAP_MAX_HANDS; row++){
+            if(!present[row]) memset(data + row * x->matrix_rowstride, 0, PXLEAP_JOINT_COUNT * 3 * sizeof(float));
+        }
     }
+    jit_object_method(x->matrix, _jit_sym_lock, savelock);
+    atom_setsym(&a, x->matrix_name);
+    outlet_anything(x->outlet_frame, _jit_sym_jit_matrix, 1, &a);
 }
 
-void ultraleap_stop(t_ultraleap *x)
+//output one frame in the current output format
+void ultraleap_outputframe(t_ultraleap *x, const t_pxleap_frame *frame)
 {
-    unsigned int ret;
-
-    if (x->x_systhread) {
-        post("stopping leap service");
-        x->x_systhread_cancel = true;                        // tell the thread to stop
-        systhread_join(x->x_systhread, &ret);                    // wait for the thread to stop
-        x->x_systhread = NULL;
+    if(x->output == ps_matrix){
+        ultraleap_outputmatrix(x, frame);
+        ultraleap_outputfeatures(x, frame);
+        return;
     }
+    if(x->output == ps_packed){
+        ultraleap_outputpacked(x, frame);
+        return;
+    }
+    const t_pxleap_plan *plan = &x->core.plan;
+    t_int numhands = (t_int) frame->nHands;
+    if(numhands>0) outlet_bang(x->outlet_start);
+    for(uint32_t h = 0; h < numhands; h++){
+        const LEAP_HAND* hand = &frame->hands[h];
+        t_atom hand_data[5];
+        atom_setsym(hand_data, ps_handtypes[hand->type == eLeapHandType_Left ? 0 : 1]);
+        for(long i = 0; i < plan->nsteps; i++){
+            const t_pxleap_plan_step *step = &plan->steps[i];
+            const float *v = pxleap_plan_read(step, hand);
+            for(long c = 0; c < step->count; c++) atom_setfloat(hand_data+1+c, v[c]);
+            //palm positions keep going out as plain lists, everything else is prefixed with its name
+            if(step->field == PXLEAP_FIELD_PALM) outlet_list(x->outlet_hands, NULL, 4, hand_data);
+            else outlet_anything(x->outlet_hands, step->name, step->count+1, hand_data);
+        }
+        if(plan->njoints){
+            for(t_int f = 0; f < 5; f++){
+                const LEAP_DIGIT* finger = &hand->digits[f];
+                t_atom finger_data[13];
+                atom_setlong(finger_data,f);
+                for(long j = 0; j < plan->njoints; j++){
+                    const LEAP_VECTOR *joint = &finger->bones[plan->firstjoint + j].next_joint;
+                    atom_setfloat(finger_data+1+j*3, joint->x);
+                    atom_setfloat(finger_data+2+j*3, joint->y);
+                    atom_setfloat(finger_data+3+j*3, joint->z);
+                }
+                if(plan->njoints == 1) outlet_list(x->outlet_fingers, NULL, 4, finger_data);
+                else outlet_anything(x->outlet_fingers, ps_joints, 13, finger_data);
+            }
+        }
+    }
+    ultraleap_outputfeatures(x, frame);
+    if (numhands>0) outlet_bang(x->outlet_end);
 }
 
-void simplethread_cancel(t_ultraleap *x)
+//the whole frame as one list out of the frame outlet, see pxleap_packed.h. px.ultraleap.unpack takes it apart.
+void ultraleap_outputpacked(t_ultraleap *x, const t_pxleap_frame *frame)
 {
-    ultraleap_stop(x);                                    // kill thread if, any
+    t_pxleap_packed_layout *l = &x->packedlayout;
+    if(l->fields != x->core.plan.fields || l->groups != frame->featuregroups || !l->stride) pxleap_packed_layout(l, x->core.plan.fields, frame->featuregroups);
+    outlet_list(x->outlet_frame, NULL, (short)pxleap_packed_write(x->packed, l, &x->core.plan, frame), x->packed);
 }
 
-//read from the most recent frame of data received from Leap
-void ultraleap_bang(t_ultraleap *x)
+//derived values go out of the frame outlet, one message per group and hand:
+//velocity <hand> <palm xyz> <thumb to pinky tip xyz>, grip <hand> <pinch distance> <pinch> <grab> <grab angle>,
+//curl <hand> <thumb to pinky degrees>
+void ultraleap_outputfeatures(t_ultraleap *x, const t_pxleap_frame *frame)
 {
-    if(x->isrunning){
-        LEAP_TRACKING_EVENT *frame;
-        systhread_mutex_lock(x->x_mutex);
-        frame = x->frame;
-        systhread_mutex_unlock(x->x_mutex);
-        if (frame){
-            int64_t frameID = frame->tracking_frame_id;
-            if(frameID != x->lastframeid){
-                t_atom frame_data[5];
-                atom_setsym(frame_data, gensym("id"));
-                atom_setlong(frame_data+1, frameID);
-                t_int numhands = (t_int) frame->nHands;
-                if(numhands>0) outlet_bang(x->outlet_start);
-                for(uint32_t h = 0; h < numhands; h++){
-                    LEAP_HAND* hand = &frame->pHands[h];
-                    t_atom hand_data[11];
-                    // palmPosition
-                    t_symbol *hand_type = (hand->type == eLeapHandType_Left) ? gensym("left") : gensym("right");
-                    atom_setsym(hand_data, hand_type);
-                    atom_setfloat(hand_data+1, hand->palm.position.x);
-                    atom_setfloat(hand_data+2, hand->palm.position.y);
-                    atom_setfloat(hand_data+3, hand->palm.position.z);
-                    outlet_list(x->outlet_hands, NULL, 4, hand_data);
-                    for(t_int f = 0; f < 5; f++){
-                        LEAP_DIGIT* finger = &hand->digits[f];
-                        t_atom finger_data[4];
-                        atom_setlong(finger_data,f);
-                        atom_setfloat(finger_data+1, finger->bones[3].next_joint.x);
-                        atom_setfloat(finger_data+2, finger->bones[3].next_joint.y);
-                        atom_setfloat(finger_data+3, finger->bones[3].next_joint.z);
-                        outlet_list(x->outlet_fingers, NULL, 4, finger_data);
-                    }
-                }
-                if (numhands>0) outlet_bang(x->outlet_end);
+    t_atom data[19];
+    uint32_t groups = frame->featuregroups;
+    if(!groups) return;
+    for(uint32_t h = 0; h < frame->nHands; h++){
+        const t_pxleap_features *f = &frame->features[h];
+        atom_setsym(data, ps_handtypes[(frame->hands[h].type == eLeapHandType_Left) ? 0 : 1]);
+        if(groups & PXLEAP_FEATURE_VELOCITY){
+            for(int i = 0; i < 3; i++) atom_setfloat(data+1+i, f->palm_velocity[i]);
+            for(int d = 0; d < 5; d++){
+                for(int i = 0; i < 3; i++) atom_setfloat(data+4+d*3+i, f->tip_velocity[d][i]);
             }
-            x->lastframeid = frameID;
+            outlet_anything(x->outlet_frame, ps_velocity, 19, data);
+        }
+        if(groups & PXLEAP_FEATURE_GRIP){
+            atom_setfloat(data+1, f->pinch_distance);
+            atom_setfloat(data+2, f->pinch_strength);
+            atom_setfloat(data+3, f->grab_strength);
+            atom_setfloat(data+4, f->grab_angle);
+            outlet_anything(x->outlet_frame, ps_grip, 5, data);
+        }
+        if(groups & PXLEAP_FEATURE_CURL){
+            for(int d = 0; d < 5; d++) atom_setfloat(data+1+d, f->curl[d]);
+            outlet_anything(x->outlet_frame, ps_curl, 6, data);
         }
-        //else post("frame failed");
     }
-    //else post("not running");
 }
 
 void *ultraleap_new(t_symbol *s, long argc, t_atom *argv)
@@ -263,10 +310,14 @@ void *ultraleap_new(t_symbol *s, long argc, t_atom *argv)
 		x->outlet_hands = outlet_new(x, NULL);
         x->outlet_fingers = outlet_new(x, NULL);
         x->outlet_end = outlet_new(x, NULL);
-
-        LeapCreateClockRebaser(&x->clockSynchronizer);
-        x->x_systhread = NULL;
-        systhread_mutex_new(&x->x_mutex,0);
+        pxleap_core_init(&x->core, x->outlet_frame, &ultraleap_hooks);
+        x->output = ps_list;
+        x->core.fields[0] = gensym("palm");
+        x->core.fields[1] = gensym("tips");
+        x->core.fieldcount = 2;
+        pxleap_plan_compile(&x->core.plan, PXLEAP_FIELD_PALM | PXLEAP_FIELD_TIPS);
+        x->matrix = NULL;
+        attr_args_process(x, argc, argv);
 	}
 	return (x);
 }
@@ -0,0 +1,174 @@
+//
+// px.ultraleap.unpack
+//
+// Takes apart the frames px.ultraleap sends with @output packed. Arguments name the values to
+// pull out, one outlet each: frame, timestamp and hands from the header, and present, id, palm,
+// orientation, normal, direction, elbow, wrist, thumb, index, middle, ring, pinky, velocity, grip
+// and curl from a hand. left or right picks the hand for the names after it, left to begin with.
+// Each value is read at an index worked out once per layout, so nothing is searched per frame.
+//
+// author: Andrew Benson
+// contact: pixlpa@gmail.com
+//
+
+#include "ext.h"							// standard Max include, always required
+#include "ext_obex.h"						// required for new style Max object
+#include "ext_proto.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pxleap_packed.h"
+
+// a macro to mark exported symbols in the code without requiring an external file to define them
+#ifdef WIN_VERSION
+// note that this is the required syntax on windows regardless of whether the compiler is msvc or gcc
+#define T_EXPORT __declspec(dllexport)
+#else // MAC_VERSION
+// the mac uses the standard gcc syntax, you should also set the -fvisibility=hidden flag to hide the non-marked symbols
+#define T_EXPORT __attribute__((visibility("default")))
+#endif
+
+#define ULTRALEAP_UNPACK_MAX_OUTLETS 32
+
+// one outlet: a header atom when hand is -1, a part of that hand's block otherwise
+typedef struct _ultraleap_unpack_out
+{
+    long hand;
+    long index;                                             // PXLEAP_PACKED_FRAME... or PXLEAP_PACKED_PRESENT...
+    void *outlet;
+} t_ultraleap_unpack_out;
+
+////////////////////////// object struct
+typedef struct _ultraleap_unpack
+{
+	t_object ob;
+    t_ultraleap_unpack_out outs[ULTRALEAP_UNPACK_MAX_OUTLETS];
+    long nouts;
+    t_pxleap_packed_layout layout;                          // of the last list, laid out again when its header changes
+    t_symbol *names[ULTRALEAP_UNPACK_MAX_OUTLETS];          // as typed, for assist
+} t_ultraleap_unpack;
+
+///////////////////////// function prototypes
+//// standard set
+void *ultraleap_unpack_new(t_symbol *s, long argc, t_atom *argv);
+void ultraleap_unpack_free(t_ultraleap_unpack *x);
+void ultraleap_unpack_assist(t_ultraleap_unpack *x, void *b, long m, long a, char *s);
+void ultraleap_unpack_list(t_ultraleap_unpack *x, t_symbol *s, long argc, t_atom *argv);
+
+//////////////////////// global class pointer variable
+void *ultraleap_unpack_class;
+
+static const char *ultraleap_unpack_header[3] = {"frame", "timestamp", "hands"};
+
+//////////////////////// Max functions
+int T_EXPORT main(void)
+{
+	t_class *c;
+
+	c = class_new("px.ultraleap.unpack", (method)ultraleap_unpack_new, (method)ultraleap_unpack_free, (long)sizeof(t_ultraleap_unpack), 0L /* leave NULL!! */, A_GIMME, 0);
+
+    class_addmethod(c, (method)ultraleap_unpack_list, "list", A_GIMME, 0);
+    class_addmethod(c, (method)ultraleap_unpack_assist, "assist", A_CANT, 0);
+
+	class_register(CLASS_BOX, c);
+	ultraleap_unpack_class = c;
+
+	return 0;
+}
+
+void ultraleap_unpack_assist(t_ultraleap_unpack *x, void *b, long m, long a, char *s)
+{
+	if (m == ASSIST_INLET) { //inlet
+		sprintf(s, "packed frames from px.ultraleap @output packed");
+	}
+	else if (a >= 0 && a < x->nouts) {	// outlet
+        const t_ultraleap_unpack_out *out = &x->outs[a];
+        if (out->hand < 0) sprintf(s, "%s", x->names[a]->s_name);
+        else sprintf(s, "%s %s", out->hand ? "right" : "left", x->names[a]->s_name);
+	}
+}
+
+//the index of a header or hand part name, -1 if it's neither
+static long ultraleap_unpack_find(const char *name, long *hand)
+{
+    for (long i = 0; i < 3; i++) {
+        if (!strcmp(name, ultraleap_unpack_header[i])) {
+            *hand = -1;
+            return i;
+        }
+    }
+    for (long i = 0; i < PXLEAP_PACKED_PARTS; i++) {
+        if (!strcmp(name, pxleap_packed_parts[i])) return i;
+    }
+    return -1;
+}
+
+//values come out right to left, like unpack
+void ultraleap_unpack_list(t_ultraleap_unpack *x, t_symbol *s, long argc, t_atom *argv)
+{
+    t_pxleap_packed_layout *l = &x->layout;
+    uint32_t fields, groups;
+    if (argc < PXLEAP_PACKED_HEADER) return;
+    fields = (uint32_t)atom_getlong(argv + PXLEAP_PACKED_FIELDS);
+    groups = (uint32_t)atom_getlong(argv + PXLEAP_PACKED_GROUPS);
+    if (fields != l->fields || groups != l->groups || !l->stride) pxleap_packed_layout(l, fields, groups);
+    if (atom_getlong(argv + PXLEAP_PACKED_STRIDE) != l->stride || argc < PXLEAP_PACKED_HEADER + PXLEAP_MAX_HANDS * l->stride) {
+        object_error((t_object *)x, "not a packed frame from px.ultraleap");
+        return;
+    }
+    for (long i = x->nouts - 1; i >= 0; i--) {
+        const t_ultraleap_unpack_out *out = &x->outs[i];
+        t_atom *block;
+        if (out->hand < 0) {
+            outlet_int(out->outlet, atom_getlong(argv + out->index));
+            continue;
+        }
+        block = argv + PXLEAP_PACKED_HEADER + out->hand * l->stride;
+        if (out->index <= PXLEAP_PACKED_ID) outlet_int(out->outlet, atom_getlong(block + out->index));
+        //nothing for a hand that isn't tracked, or a part the frame was sent without
+        else if (atom_getlong(block + PXLEAP_PACKED_PRESENT) && l->count[out->index]) {
+            outlet_list(out->outlet, NULL, (short)l->count[out->index], block + l->offset[out->index]);
+        }
+    }
+}
+
+void ultraleap_unpack_free(t_ultraleap_unpack *x)
+{
+    ;
+}
+
+void *ultraleap_unpack_new(t_symbol *s, long argc, t_atom *argv)
+{
+	t_ultraleap_unpack *x = NULL;
+    t_symbol *palm = gensym("palm");
+
+	if ((x = (t_ultraleap_unpack *)object_alloc(ultraleap_unpack_class))) {
+        long hand = 0;
+        x->nouts = 0;
+        memset(&x->layout, 0, sizeof(x->layout));
+        for (long i = 0; i < argc && x->nouts < ULTRALEAP_UNPACK_MAX_OUTLETS; i++) {
+            t_symbol *name = atom_getsym(argv + i);
+            long outhand = hand, index;
+            if (name == gensym("left") || name == gensym("right")) {
+                hand = name == gensym("right");
+                continue;
+            }
+            if ((index = ultraleap_unpack_find(name->s_name, &outhand)) < 0) {
+                object_error((t_object *)x, "unknown part %s", atom_gettype(argv + i) == A_SYM ? name->s_name : "(number)");
+                continue;
+            }
+            x->outs[x->nouts].hand = outhand;
+            x->outs[x->nouts].index = index;
+            x->names[x->nouts++] = name;
+        }
+        if (!x->nouts) {
+            x->outs[0].hand = hand;
+            x->outs[0].index = PXLEAP_PACKED_PALM;
+            x->names[x->nouts++] = palm;
+        }
+        //outlets are created right to left
+        for (long i = x->nouts - 1; i >= 0; i--) x->outs[i].outlet = outlet_new(x, NULL);
+	}
+	return (x);
+}
@@ -0,0 +1,210 @@
+//
+// ultraleap~
+//
+// Signal-rate joint positions from Leap Motion skeletal tracking in Max on Apple Silicon Machines.
+// Each selected joint goes out as three signals (x y z in mm), interpolated sample by sample
+// between tracking frames so synthesis parameters glide instead of stepping at the tracking rate.
+// Only compiles for arm64 target
+// Requires having ultraleap software installed
+//
+// author: Andrew Benson
+// contact: pixlpa@gmail.com
+//
+
+#include "ext.h"							// standard Max include, always required
+#include "ext_obex.h"						// required for new style Max object
+#include "ext_proto.h"
+#include "ext_systhread.h"
+#include "z_dsp.h"							// required for MSP objects
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "LeapC.h"
+#include "pxleap_frame.h"
+#include "pxleap_thread.h"
+#include "pxleap_hub.h"
+#include "pxleap_signal.h"
+
+// a macro to mark exported symbols in the code without requiring an external file to define them
+#ifdef WIN_VERSION
+// note that this is the required syntax on windows regardless of whether the compiler is msvc or gcc
+#define T_EXPORT __declspec(dllexport)
+#else // MAC_VERSION
+// the mac uses the standard gcc syntax, you should also set the -fvisibility=hidden flag to hide the non-marked symbols
+#define T_EXPORT __attribute__((visibility("default")))
+#endif
+
+////////////////////////// object struct
+typedef struct _ultraleap_tilde
+{
+	t_pxobject ob;
+    bool isrunning;
+    t_pxleap_hub *hub;                                      // shared Leap connection, held from connect until free
+    t_pxleap_hub_subscriber subscriber;                     // receives the hub's frames while connected
+    long device;                                            // tracker to follow, 0 for the first one attached
+    long interactive;                                       // the polling thread asks for interactive QoS, if this object opens it
+    _Atomic int64_t clockoffset;                            // leap clock minus Max system time in microseconds, kept current by the hub thread
+    t_pxleap_signal signal;                                 // selected joints of the last few frames, written by the hub thread
+    t_symbol *names[PXLEAP_SIGNAL_MAX_JOINTS];              // joint name of each group of outlets, for assist
+    double latency;                                         // ms the signals run behind the tracker, so they land between frames
+    double samplerate;
+} t_ultraleap_tilde;
+
+///////////////////////// function prototypes
+//// standard set
+void *ultraleap_tilde_new(t_symbol *s, long argc, t_atom *argv);
+void ultraleap_tilde_free(t_ultraleap_tilde *x);
+void ultraleap_tilde_assist(t_ultraleap_tilde *x, void *b, long m, long a, char *s);
+void ultraleap_tilde_connect(t_ultraleap_tilde *x);
+void ultraleap_tilde_stop(t_ultraleap_tilde *x);
+t_max_err ultraleap_tilde_setdevice(t_ultraleap_tilde *x, void *attr, long argc, t_atom *argv);
+void ultraleap_tilde_hubframe(t_ultraleap_tilde *x, const t_pxleap_frame *frame, int64_t clockoffset);
+void ultraleap_tilde_dsp64(t_ultraleap_tilde *x, t_object *dsp64, short *count, double samplerate, long maxvectorsize, long flags);
+void ultraleap_tilde_perform64(t_ultraleap_tilde *x, t_object *dsp64, double **ins, long numins, double **outs, long numouts, long sampleframes, long flags, void *userparam);
+
+//////////////////////// global class pointer variable
+void *ultraleap_tilde_class;
+
+static const char *ultraleap_tilde_axes[3] = {"x", "y", "z"};
+
+//////////////////////// Max functions
+int T_EXPORT main(void)
+{
+	t_class *c;
+
+	c = class_new("px.ultraleap~", (method)ultraleap_tilde_new, (method)ultraleap_tilde_free, (long)sizeof(t_ultraleap_tilde), 0L /* leave NULL!! */, A_GIMME, 0);
+
+    class_addmethod(c, (method)ultraleap_tilde_connect, "connect", 0);
+    class_addmethod(c, (method)ultraleap_tilde_stop, "stop", 0);
+    class_addmethod(c, (method)ultraleap_tilde_assist, "assist", A_CANT, 0);
+    class_addmethod(c, (method)ultraleap_tilde_dsp64, "dsp64", A_CANT, 0);
+    class_dspinit(c);
+
+    CLASS_ATTR_LONG(c,           "interactive",     0, t_ultraleap_tilde, interactive);
+    CLASS_ATTR_STYLE_LABEL(c,     "interactive",     0, "onoff", "Interactive Worker Thread Priority");
+
+    CLASS_ATTR_LONG(c,           "device",          0, t_ultraleap_tilde, device);
+    CLASS_ATTR_ACCESSORS(c,       "device",          NULL, ultraleap_tilde_setdevice);
+    CLASS_ATTR_LABEL(c,           "device",          0, "Tracker (0 = first attached)");
+    CLASS_ATTR_FILTER_MIN(c,      "device",          0);
+
+    CLASS_ATTR_DOUBLE(c,         "latency",         0, t_ultraleap_tilde, latency);
+    CLASS_ATTR_LABEL(c,           "latency",         0, "Latency Behind The Tracker (ms)");
+    CLASS_ATTR_FILTER_MIN(c,      "latency",         0);
+
+	class_register(CLASS_BOX, c);
+	ultraleap_tilde_class = c;
+
+	return 0;
+}
+
+void ultraleap_tilde_assist(t_ultraleap_tilde *x, void *b, long m, long a, char *s)
+{
+	if (m == ASSIST_INLET) { //inlet
+		sprintf(s, "connect or stop");
+	}
+	else if (a >= 0 && a < (long)x->signal.njoints * 3) {	// outlet
+        long j = a / 3;
+        sprintf(s, "%s %s %s (signal, mm)", x->signal.hand[j] ? "right" : "left", x->names[j]->s_name, ultraleap_tilde_axes[a % 3]);
+	}
+}
+
+void ultraleap_tilde_connect(t_ultraleap_tilde *x){
+    if(x->isrunning && x->subscriber.subscribed){
+        post("already connected!");
+        return;
+    }
+    if(!x->hub) x->hub = pxleap_hub_acquire((int)x->interactive);
+    if(x->hub){
+        x->isrunning = true;
+        pxleap_hub_subscribe(x->hub, &x->subscriber);
+        post("Leap Connected");
+    }
+    else post("Leap connection not opened");
+}
+
+//the signals hold their last positions until connected again
+void ultraleap_tilde_stop(t_ultraleap_tilde *x)
+{
+    if (x->hub) pxleap_hub_unsubscribe(x->hub, &x->subscriber);
+    x->isrunning = false;
+}
+
+t_max_err ultraleap_tilde_setdevice(t_ultraleap_tilde *x, void *attr, long argc, t_atom *argv){
+    long device = argc ? atom_getlong(argv) : 0;
+    x->device = device < 0 ? 0 : device;
+    pxleap_hub_setdevice(x->hub, &x->subscriber, (uint32_t)x->device);
+    return MAX_ERR_NONE;
+}
+
+//hub thread: only the selected joints are kept, the audio thread does the rest
+void ultraleap_tilde_hubframe(t_ultraleap_tilde *x, const t_pxleap_frame *frame, int64_t clockoffset){
+    atomic_store_explicit(&x->clockoffset, clockoffset, memory_order_relaxed);
+    pxleap_signal_push(&x->signal, frame);
+}
+
+void ultraleap_tilde_dsp64(t_ultraleap_tilde *x, t_object *dsp64, short *count, double samplerate, long maxvectorsize, long flags)
+{
+    x->samplerate = samplerate > 0. ? samplerate : 44100.;
+    object_method(dsp64, gensym("dsp_add64"), x, ultraleap_tilde_perform64, 0, NULL);
+}
+
+//audio thread: the tracker's clock at the start of this vector, less the latency, and one
+//line per frame interval for every channel
+void ultraleap_tilde_perform64(t_ultraleap_tilde *x, t_object *dsp64, double **ins, long numins, double **outs, long numouts, long sampleframes, long flags, void *userparam)
+{
+    double now = systimer_gettime() * 1000. + (double)atomic_load_explicit(&x->clockoffset, memory_order_relaxed) - x->latency * 1000.;
+    pxleap_signal_render(&x->signal, now, 1e6 / x->samplerate, outs, sampleframes);
+}
+
+void ultraleap_tilde_free(t_ultraleap_tilde *x)
+{
+    dsp_free((t_pxobject *)x);
+    ultraleap_tilde_stop(x);
+    pxleap_hub_release(x->hub); // the last object out closes the leap connection
+}
+
+//arguments are hand and joint pairs, one group of x y z outlets each:
+//px.ultraleap~ left palm right index, with left palm right palm if there are none
+void *ultraleap_tilde_new(t_symbol *s, long argc, t_atom *argv)
+{
+	t_ultraleap_tilde *x = NULL;
+    long nargs = attr_args_offset((short)argc, argv);
+
+	if ((x = (t_ultraleap_tilde *)object_alloc((t_class *)ultraleap_tilde_class)))
+	{
+        dsp_setup((t_pxobject *)x, 0);
+        pxleap_signal_init(&x->signal);
+        for(long i = 0; i + 1 < nargs; i += 2){
+            t_symbol *hand = atom_getsym(argv + i);
+            t_symbol *joint = atom_getsym(argv + i + 1);
+            if(pxleap_signal_addjoint(&x->signal, hand->s_name, joint->s_name)) x->names[x->signal.njoints - 1] = joint;
+            else object_error((t_object *)x, "can't add %s %s, use left or right and palm wrist elbow thumb index middle ring or pinky, %d joints at most",
+                             hand->s_name, joint->s_name, PXLEAP_SIGNAL_MAX_JOINTS);
+        }
+        if(nargs & 1) object_error((t_object *)x, "%s needs a joint after it", atom_getsym(argv + nargs - 1)->s_name);
+        if(!x->signal.njoints){
+            pxleap_signal_addjoint(&x->signal, "left", "palm");
+            pxleap_signal_addjoint(&x->signal, "right", "palm");
+            x->names[0] = x->names[1] = gensym("palm");
+        }
+        //the last outlet created is the leftmost, so the first joint's x comes out on the left
+        for(long c = (long)x->signal.njoints * 3 - 1; c >= 0; c--) outlet_new((t_object *)x, "signal");
+        x->isrunning = false;
+        x->hub = NULL;
+        x->subscriber.owner = x;
+        x->subscriber.callback = (t_pxleap_hub_callback)ultraleap_tilde_hubframe;
+        x->subscriber.device = 0;
+        x->subscriber.subscribed = 0;
+        atomic_init(&x->subscriber.busy, 0);
+        x->subscriber.next = NULL;
+        x->device = 0;
+        x->interactive = 0;
+        atomic_init(&x->clockoffset, 0);
+        x->latency = 20.;
+        x->samplerate = 44100.;
+        attr_args_process(x, (short)argc, argv);
+	}
+	return (x);
+}
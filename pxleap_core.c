@@ -0,0 +1,1141 @@
+//
+// pxleap_core
+//
+// The frame pipeline, worker lifecycle and shared messages of px.ultraleap and px.dict.ultraleap.
+// see pxleap_core.h
+//
+// author: Andrew Benson
+// contact: pixlpa@gmail.com
+//
+
+#include <string.h>
+#include "pxleap_core.h"
+
+static t_symbol *ps_bang;
+static t_symbol *ps_push;
+static t_symbol *ps_none;
+static t_symbol *ps_euro;
+static t_symbol *ps_kalman;
+static t_symbol *ps_overflow;
+static t_symbol *ps_empty;
+static t_symbol *ps_pose;
+static t_symbol *ps_predict;
+static t_symbol *ps_history;
+static t_symbol *ps_since;
+static t_symbol *ps_frame;
+static t_symbol *ps_stats;
+static t_symbol *ps_depth;
+static t_symbol *ps_drain;
+static t_symbol *ps_fields;
+static t_symbol *ps_relayout;
+
+static void pxleap_core_hubframe(t_pxleap_core *x, const t_pxleap_frame *src, int64_t clockoffset);
+static void pxleap_core_systhread_start(t_pxleap_core *x);
+static void pxleap_core_resume(t_pxleap_core *x);
+static void pxleap_core_pause(t_pxleap_core *x);
+static bool pxleap_core_toscheduler(t_pxleap_core *x, t_symbol *s, long argc, t_atom *argv);
+static void pxleap_core_bang_now(t_pxleap_core *x);
+static void pxleap_core_pose_now(t_pxleap_core *x, long argc, t_atom *argv);
+static void pxleap_core_predict_now(t_pxleap_core *x, double ms);
+static void pxleap_core_history_now(t_pxleap_core *x, long n);
+static void pxleap_core_since_now(t_pxleap_core *x, double ms);
+static void pxleap_core_frame_now(t_pxleap_core *x, long id);
+static void pxleap_core_setdepth_now(t_pxleap_core *x, long depth);
+static void pxleap_core_setdrain_now(t_pxleap_core *x, long drain);
+static void pxleap_core_setfields_now(t_pxleap_core *x, uint32_t fields);
+static void pxleap_core_relayout_now(t_pxleap_core *x, uint32_t fields);
+static t_max_err pxleap_core_setdepth(t_pxleap_core *x, void *attr, long argc, t_atom *argv);
+static t_max_err pxleap_core_setoscrate(t_pxleap_core *x, void *attr, long argc, t_atom *argv);
+static t_max_err pxleap_core_setoscprefix(t_pxleap_core *x, void *attr, long argc, t_atom *argv);
+static t_max_err pxleap_core_setstatsinterval(t_pxleap_core *x, void *attr, long argc, t_atom *argv);
+static t_max_err pxleap_core_setdrain(t_pxleap_core *x, void *attr, long argc, t_atom *argv);
+static t_max_err pxleap_core_setdwell(t_pxleap_core *x, void *attr, long argc, t_atom *argv);
+static t_max_err pxleap_core_setposethreshold(t_pxleap_core *x, void *attr, long argc, t_atom *argv);
+static t_max_err pxleap_core_setposehold(t_pxleap_core *x, void *attr, long argc, t_atom *argv);
+static t_max_err pxleap_core_setspeed(t_pxleap_core *x, void *attr, long argc, t_atom *argv);
+static t_max_err pxleap_core_setloop(t_pxleap_core *x, void *attr, long argc, t_atom *argv);
+static t_max_err pxleap_core_setinteractive(t_pxleap_core *x, void *attr, long argc, t_atom *argv);
+static t_max_err pxleap_core_setdevice(t_pxleap_core *x, void *attr, long argc, t_atom *argv);
+static t_max_err pxleap_core_setmode(t_pxleap_core *x, void *attr, long argc, t_atom *argv);
+static t_max_err pxleap_core_setfilter(t_pxleap_core *x, void *attr, long argc, t_atom *argv);
+static t_max_err pxleap_core_setcutoff(t_pxleap_core *x, void *attr, long argc, t_atom *argv);
+static t_max_err pxleap_core_setkalman(t_pxleap_core *x, void *attr, long argc, t_atom *argv);
+static t_max_err pxleap_core_setvelocity(t_pxleap_core *x, void *attr, long argc, t_atom *argv);
+static t_max_err pxleap_core_setgrip(t_pxleap_core *x, void *attr, long argc, t_atom *argv);
+static t_max_err pxleap_core_setcurl(t_pxleap_core *x, void *attr, long argc, t_atom *argv);
+static t_max_err pxleap_core_setfields(t_pxleap_core *x, void *attr, long argc, t_atom *argv);
+
+void pxleap_core_setup(void)
+{
+    ps_bang = gensym("bang");
+    ps_push = gensym("push");
+    ps_none = gensym("none");
+    ps_euro = gensym("euro");
+    ps_kalman = gensym("kalman");
+    ps_overflow = gensym("overflow");
+    ps_empty = gensym("");
+    ps_pose = gensym("pose");
+    ps_predict = gensym("predict");
+    ps_history = gensym("history");
+    ps_since = gensym("since");
+    ps_frame = gensym("frame");
+    ps_stats = gensym("stats");
+    ps_depth = gensym("depth");
+    ps_drain = gensym("drain");
+    ps_fields = gensym("fields");
+    ps_relayout = gensym("relayout");
+    pxleap_stats_setup();
+    pxleap_zones_setup();
+    pxleap_poses_setup();
+}
+
+void pxleap_core_classinit(t_class *c)
+{
+    class_addmethod(c, (method)pxleap_core_bang, "bang", 0);
+    class_addmethod(c, (method)pxleap_core_connect, "connect", 0);
+    class_addmethod(c, (method)pxleap_core_stop, "stop", 0);
+    class_addmethod(c, (method)pxleap_core_record, "record", A_DEFSYM, 0);
+    class_addmethod(c, (method)pxleap_core_replay, "replay", A_DEFSYM, 0);
+    class_addmethod(c, (method)pxleap_core_log, "log", A_DEFSYM, 0);
+    class_addmethod(c, (method)pxleap_core_share, "share", A_DEFSYM, 0);
+    class_addmethod(c, (method)pxleap_core_attach, "attach", A_DEFSYM, 0);
+    class_addmethod(c, (method)pxleap_core_seek, "seek", A_FLOAT, 0);
+    class_addmethod(c, (method)pxleap_core_zone, "zone", A_GIMME, 0);
+    class_addmethod(c, (method)pxleap_core_pose, "pose", A_GIMME, 0);
+    class_addmethod(c, (method)pxleap_core_predict, "predict", A_FLOAT, 0);
+    class_addmethod(c, (method)pxleap_core_history, "history", A_LONG, 0);
+    class_addmethod(c, (method)pxleap_core_since, "since", A_FLOAT, 0);
+    class_addmethod(c, (method)pxleap_core_frame, "frame", A_LONG, 0);
+    class_addmethod(c, (method)pxleap_core_osc, "osc", A_GIMME, 0);
+    class_addmethod(c, (method)pxleap_core_stats, "stats", 0);
+
+    CLASS_ATTR_DOUBLE(c,         "speed",           0, t_pxleap_core, speed);
+    CLASS_ATTR_CATEGORY(c,        "speed",           0, "Replay");
+    CLASS_ATTR_LABEL(c,           "speed",           0, "Replay Speed (0 = as fast as possible)");
+    CLASS_ATTR_FILTER_MIN(c,      "speed",           0);
+    CLASS_ATTR_ACCESSORS(c,       "speed",           NULL, pxleap_core_setspeed);
+
+    CLASS_ATTR_LONG(c,           "loop",            0, t_pxleap_core, loop);
+    CLASS_ATTR_STYLE_LABEL(c,     "loop",            0, "onoff", "Loop Replay");
+    CLASS_ATTR_CATEGORY(c,        "loop",            0, "Replay");
+    CLASS_ATTR_ACCESSORS(c,       "loop",            NULL, pxleap_core_setloop);
+
+    CLASS_ATTR_LONG(c,           "interactive",     0, t_pxleap_core, interactive);
+    CLASS_ATTR_ACCESSORS(c,       "interactive",     NULL, pxleap_core_setinteractive);
+    CLASS_ATTR_STYLE_LABEL(c,     "interactive",     0, "onoff", "Interactive Worker Thread Priority");
+
+    CLASS_ATTR_LONG(c,           "device",          0, t_pxleap_core, device);
+    CLASS_ATTR_ACCESSORS(c,       "device",          NULL, pxleap_core_setdevice);
+    CLASS_ATTR_LABEL(c,           "device",          0, "Tracker (0 = first attached)");
+    CLASS_ATTR_FILTER_MIN(c,      "device",          0);
+
+    CLASS_ATTR_LONG(c,           "depth",           0, t_pxleap_core, depth);
+    CLASS_ATTR_ACCESSORS(c,       "depth",           NULL, pxleap_core_setdepth);
+    CLASS_ATTR_LABEL(c,           "depth",           0, "History Depth (frames)");
+    CLASS_ATTR_CATEGORY(c,        "depth",           0, "History");
+
+    CLASS_ATTR_DOUBLE(c,         "oscrate",         0, t_pxleap_core, oscrate);
+    CLASS_ATTR_ACCESSORS(c,       "oscrate",         NULL, pxleap_core_setoscrate);
+    CLASS_ATTR_LABEL(c,           "oscrate",         0, "OSC Bundles Per Second (0 = every frame)");
+    CLASS_ATTR_FILTER_MIN(c,      "oscrate",         0);
+    CLASS_ATTR_CATEGORY(c,        "oscrate",         0, "OSC");
+
+    CLASS_ATTR_SYM(c,            "oscprefix",       0, t_pxleap_core, oscprefix);
+    CLASS_ATTR_ACCESSORS(c,       "oscprefix",       NULL, pxleap_core_setoscprefix);
+    CLASS_ATTR_LABEL(c,           "oscprefix",       0, "OSC Address Prefix");
+    CLASS_ATTR_CATEGORY(c,        "oscprefix",       0, "OSC");
+
+    CLASS_ATTR_DOUBLE(c,         "statsinterval",   0, t_pxleap_core, stats.interval);
+    CLASS_ATTR_ACCESSORS(c,       "statsinterval",   NULL, pxleap_core_setstatsinterval);
+    CLASS_ATTR_LABEL(c,           "statsinterval",   0, "Stats Report Interval in ms (0 = off)");
+    CLASS_ATTR_FILTER_MIN(c,      "statsinterval",   0);
+    CLASS_ATTR_CATEGORY(c,        "statsinterval",   0, "Stats");
+
+    CLASS_ATTR_SYM(c,            "mode",            0, t_pxleap_core, mode);
+    CLASS_ATTR_ACCESSORS(c,       "mode",            NULL, pxleap_core_setmode);
+    CLASS_ATTR_ENUM(c,            "mode",            0, "bang push");
+    CLASS_ATTR_LABEL(c,           "mode",            0, "Output Mode");
+    CLASS_ATTR_BASIC(c,           "mode",            0);
+
+    CLASS_ATTR_LONG(c,           "drain",           0, t_pxleap_core, drain);
+    CLASS_ATTR_ACCESSORS(c,       "drain",           NULL, pxleap_core_setdrain);
+    CLASS_ATTR_STYLE_LABEL(c,     "drain",           0, "onoff", "Output Every Frame Since The Last Bang");
+
+    CLASS_ATTR_DOUBLE(c,         "dwell",           0, t_pxleap_core, zones.dwell);
+    CLASS_ATTR_ACCESSORS(c,       "dwell",           NULL, pxleap_core_setdwell);
+    CLASS_ATTR_LABEL(c,           "dwell",           0, "Zone Dwell Time in ms (0 = off)");
+    CLASS_ATTR_FILTER_MIN(c,      "dwell",           0);
+    CLASS_ATTR_CATEGORY(c,        "dwell",           0, "Zones");
+
+    CLASS_ATTR_DOUBLE(c,         "posethreshold",   0, t_pxleap_core, poses.posethreshold);
+    CLASS_ATTR_ACCESSORS(c,       "posethreshold",   NULL, pxleap_core_setposethreshold);
+    CLASS_ATTR_LABEL(c,           "posethreshold",   0, "Pose Match Distance in Palm Widths");
+    CLASS_ATTR_FILTER_MIN(c,      "posethreshold",   0);
+    CLASS_ATTR_CATEGORY(c,        "posethreshold",   0, "Poses");
+
+    CLASS_ATTR_LONG(c,           "posehold",        0, t_pxleap_core, poses.posehold);
+    CLASS_ATTR_ACCESSORS(c,       "posehold",        NULL, pxleap_core_setposehold);
+    CLASS_ATTR_LABEL(c,           "posehold",        0, "Frames Before A Pose Change Goes Out");
+    CLASS_ATTR_FILTER_MIN(c,      "posehold",        1);
+    CLASS_ATTR_CATEGORY(c,        "posehold",        0, "Poses");
+
+    CLASS_ATTR_SYM_VARSIZE(c,    "fields",          0, t_pxleap_core, fields, fieldcount, PXLEAP_FIELD_MAXNAMES);
+    CLASS_ATTR_ACCESSORS(c,       "fields",          NULL, pxleap_core_setfields);
+    CLASS_ATTR_LABEL(c,           "fields",          0, "Output Fields (palm orientation normal direction arm tips joints all)");
+
+    CLASS_ATTR_LONG(c,           "interp",          0, t_pxleap_core, interp);
+    CLASS_ATTR_STYLE_LABEL(c,     "interp",          0, "onoff", "Interpolate To Output Time");
+    CLASS_ATTR_CATEGORY(c,        "interp",          0, "Timing");
+
+    CLASS_ATTR_DOUBLE(c,         "lookahead",       0, t_pxleap_core, lookahead);
+    CLASS_ATTR_LABEL(c,           "lookahead",       0, "Lookahead (ms)");
+    CLASS_ATTR_CATEGORY(c,        "lookahead",       0, "Timing");
+
+    CLASS_ATTR_SYM(c,            "filter",          0, t_pxleap_core, filtertype);
+    CLASS_ATTR_ACCESSORS(c,       "filter",          NULL, pxleap_core_setfilter);
+    CLASS_ATTR_ENUM(c,            "filter",          0, "none euro kalman");
+    CLASS_ATTR_LABEL(c,           "filter",          0, "Joint Filter");
+    CLASS_ATTR_CATEGORY(c,        "filter",          0, "Filter");
+
+    CLASS_ATTR_FLOAT_ARRAY(c,    "cutoff",          0, t_pxleap_core, cutoff, 3);
+    CLASS_ATTR_ACCESSORS(c,       "cutoff",          NULL, pxleap_core_setcutoff);
+    CLASS_ATTR_LABEL(c,           "cutoff",          0, "One-Euro Min Cutoff, Beta, Speed Cutoff");
+    CLASS_ATTR_CATEGORY(c,        "cutoff",          0, "Filter");
+
+    CLASS_ATTR_FLOAT_ARRAY(c,    "kalman",          0, t_pxleap_core, kalman, 2);
+    CLASS_ATTR_ACCESSORS(c,       "kalman",          NULL, pxleap_core_setkalman);
+    CLASS_ATTR_LABEL(c,           "kalman",          0, "Kalman Noise (mm), Acceleration (mm/s^2)");
+    CLASS_ATTR_CATEGORY(c,        "kalman",          0, "Filter");
+
+    CLASS_ATTR_LONG(c,           "velocity",        0, t_pxleap_core, velocity);
+    CLASS_ATTR_ACCESSORS(c,       "velocity",        NULL, pxleap_core_setvelocity);
+    CLASS_ATTR_STYLE_LABEL(c,     "velocity",        0, "onoff", "Palm And Fingertip Velocities");
+    CLASS_ATTR_CATEGORY(c,        "velocity",        0, "Features");
+
+    CLASS_ATTR_LONG(c,           "grip",            0, t_pxleap_core, grip);
+    CLASS_ATTR_ACCESSORS(c,       "grip",            NULL, pxleap_core_setgrip);
+    CLASS_ATTR_STYLE_LABEL(c,     "grip",            0, "onoff", "Pinch And Grab");
+    CLASS_ATTR_CATEGORY(c,        "grip",            0, "Features");
+
+    CLASS_ATTR_LONG(c,           "curl",            0, t_pxleap_core, curl);
+    CLASS_ATTR_ACCESSORS(c,       "curl",            NULL, pxleap_core_setcurl);
+    CLASS_ATTR_STYLE_LABEL(c,     "curl",            0, "onoff", "Finger Curl");
+    CLASS_ATTR_CATEGORY(c,        "curl",            0, "Features");
+}
+
+//stats for one output, see pxleap_stats_count
+static void pxleap_core_countoutput(t_pxleap_core *x, const t_pxleap_frame *frame, int64_t start, bool fresh)
+{
+    pxleap_stats_count(&x->stats, frame, x->lastframeid, atomic_load_explicit(&x->clockoffset, memory_order_relaxed), start, fresh);
+}
+
+//everything counted since the last report, one message per measure
+static void pxleap_core_stats_now(t_pxleap_core *x)
+{
+    pxleap_stats_send(&x->stats, pxleap_hub_pollfailures(x->hub), x->outlet);
+}
+
+//stats: the counters are kept by the scheduler thread's outputs, so they're read there too
+void pxleap_core_stats(t_pxleap_core *x)
+{
+    if(!pxleap_core_toscheduler(x, ps_stats, 0, NULL)) pxleap_core_stats_now(x);
+}
+
+static void pxleap_core_statstick(t_pxleap_core *x)
+{
+    pxleap_core_stats_now(x);
+    pxleap_stats_schedule(&x->stats);
+}
+
+static t_max_err pxleap_core_setstatsinterval(t_pxleap_core *x, void *attr, long argc, t_atom *argv)
+{
+    pxleap_stats_setinterval(&x->stats, argc ? atom_getfloat(argv) : 0.);
+    return MAX_ERR_NONE;
+}
+
+//zone <name> <enter|exit|dwell> <left|right> <joint>, with the ms spent inside for exit and dwell
+static void pxleap_core_zoneoutput(t_pxleap_core *x)
+{
+    pxleap_zones_output(&x->zones, (t_object *)x, x->outlet);
+}
+
+//pose <left|right> <label|none> <confidence>, only when a hand's pose changes
+static void pxleap_core_poseoutput(t_pxleap_core *x)
+{
+    pxleap_poses_output(&x->poses, (t_object *)x, x->outlet);
+}
+
+//push mode: the worker thread has published at least one new frame since the last output
+static void pxleap_core_pushtick(t_pxleap_core *x)
+{
+    pxleap_core_bang_now(x);
+}
+
+//a message sent from the main thread, carried out from the scheduler. it goes straight to the _now
+//function, since with Overdrive off scheduler callbacks run on the main thread and isr() stays false
+static void pxleap_core_deferred(t_pxleap_core *x, t_symbol *s, short argc, t_atom *argv)
+{
+    if(s == ps_bang) pxleap_core_bang_now(x);
+    else if(s == ps_stats) pxleap_core_stats_now(x);
+    else if(s == ps_predict) pxleap_core_predict_now(x, argc ? atom_getfloat(argv) : 0.);
+    else if(s == ps_history) pxleap_core_history_now(x, argc ? atom_getlong(argv) : 0);
+    else if(s == ps_since) pxleap_core_since_now(x, argc ? atom_getfloat(argv) : 0.);
+    else if(s == ps_frame) pxleap_core_frame_now(x, argc ? atom_getlong(argv) : 0);
+    else if(s == ps_pose) pxleap_core_pose_now(x, argc, argv);
+    else if(s == ps_depth) pxleap_core_setdepth_now(x, argc ? atom_getlong(argv) : 0);
+    else if(s == ps_drain) pxleap_core_setdrain_now(x, argc ? atom_getlong(argv) : 0);
+    else if(s == ps_fields) pxleap_core_setfields_now(x, argc ? (uint32_t)atom_getlong(argv) : 0);
+    else if(s == ps_relayout) pxleap_core_relayout_now(x, x->plan.fields);
+}
+
+//the scheduler thread is the only reader of the triple buffer, the drain queue, the history copy and
+//the predictor, and the only writer of the pose library, the plan and the object's output, so a
+//message that uses them from the main thread is sent on to it. true when it was
+static bool pxleap_core_toscheduler(t_pxleap_core *x, t_symbol *s, long argc, t_atom *argv)
+{
+    if(isr()) return false;
+    schedule_delay(x, (method)pxleap_core_deferred, 0, s, (short)argc, argv);
+    return true;
+}
+
+void pxleap_core_init(t_pxleap_core *x, void *outlet, const t_pxleap_core_hooks *hooks)
+{
+    x->hooks = hooks;
+    x->outlet = outlet;
+    x->isrunning = false;
+    x->lastframeid = 0;
+    x->systhread = NULL;
+    atomic_init(&x->systhread_cancel, 0);
+    pxleap_wake_init(&x->wake);
+    x->interactive = 0;
+    x->hub = NULL;
+    x->subscriber.owner = x;
+    x->subscriber.callback = (t_pxleap_hub_callback)pxleap_core_hubframe;
+    x->subscriber.device = 0;
+    x->subscriber.subscribed = 0;
+    atomic_init(&x->subscriber.busy, 0);
+    x->subscriber.next = NULL;
+    x->device = 0;
+    pxleap_history_init(&x->history);
+    x->depth = 0;
+    x->osc = NULL;
+    x->share = NULL;
+    x->attached = NULL;
+    x->oscrate = 0.;
+    x->oscprefix = gensym("/leap");
+    pxleap_stats_init(&x->stats, x, (method)pxleap_core_statstick);
+    pxleap_queue_init(&x->queue);
+    x->drain = 0;
+    x->overflowseen = 0;
+    pxleap_triplebuf_init(&x->frames);
+    x->recorder = NULL;
+    x->log = NULL;
+    x->replay = NULL;
+    x->speed = 1.;
+    x->loop = 0;
+    x->mode = ps_bang;
+    atomic_init(&x->push, 0);
+    x->pushclock = clock_new(x, (method)pxleap_core_pushtick);
+    atomic_init(&x->clockoffset, 0);
+    x->interp = 0;
+    x->lookahead = 0.;
+    pxleap_filter_init(&x->filter);
+    x->filtertype = ps_none;
+    x->cutoff[0] = atomic_load(&x->filter.mincutoff);
+    x->cutoff[1] = atomic_load(&x->filter.beta);
+    x->cutoff[2] = atomic_load(&x->filter.dcutoff);
+    x->kalman[0] = atomic_load(&x->filter.noise);
+    x->kalman[1] = atomic_load(&x->filter.accel);
+    pxleap_features_init(&x->features);
+    x->velocity = x->grip = x->curl = 0;
+    pxleap_zones_init(&x->zones);
+    pxleap_zones_setdwell(&x->zones, 500.);
+    x->zoneqelem = qelem_new(x, (method)pxleap_core_zoneoutput);
+    pxleap_poses_init(&x->poses);
+    x->poseqelem = qelem_new(x, (method)pxleap_core_poseoutput);
+    x->fieldcount = 0;
+    pxleap_plan_compile(&x->plan, 0);
+}
+
+void pxleap_core_free(t_pxleap_core *x)
+{
+    pxleap_core_pause(x); // stop the service thread
+    pxleap_hub_release(x->hub); // the last object out closes the leap connection
+    object_free(x->pushclock);
+    qelem_free(x->zoneqelem);
+    qelem_free(x->poseqelem);
+    pxleap_wake_free(&x->wake);
+    pxleap_recorder_close(x->recorder);
+    pxleap_log_close(x->log);
+    pxleap_replay_close(x->replay);
+    pxleap_history_free(&x->history);
+    pxleap_poses_free(&x->poses);
+    pxleap_osc_close(x->osc);
+    pxleap_shm_close(x->share);
+    pxleap_shmreader_close(x->attached);
+    pxleap_queue_free(&x->queue);
+    pxleap_stats_free(&x->stats);
+}
+
+//every frame goes through here on the thread it arrived on, whichever source it came from
+static void pxleap_core_processframe(t_pxleap_core *x, t_pxleap_frame *frame, int64_t arrived, int64_t clockoffset)
+{
+    //recordings keep the raw joints, so they can be replayed through other filter settings
+    if(x->recorder) pxleap_recorder_write(x->recorder, frame);
+    //the log only copies the frame into its queue, its own thread compresses and writes it
+    if(x->log) pxleap_log_write(x->log, frame);
+    pxleap_filter_apply(&x->filter, frame);
+    pxleap_features_apply(&x->features, frame);
+    //zones see the filtered joints, and only wake the Max thread when something entered or left
+    if(pxleap_zones_apply(&x->zones, frame)) qelem_set(x->zoneqelem);
+    //poses too, with a bounded number of templates compared per hand
+    if(pxleap_poses_apply(&x->poses, frame)) qelem_set(x->poseqelem);
+    atomic_store_explicit(&x->clockoffset, clockoffset, memory_order_relaxed);
+    pxleap_history_push(&x->history, frame);
+    //the object's side of the frame is written here too, ahead of the frame itself, so bang
+    //only has to show it. drained frames are written by the Max thread instead.
+    if(x->hooks->prepare && !x->drain) x->hooks->prepare(x, frame);
+    frame->published = pxleap_now_ns();
+    pxleap_stats_frame(&x->stats, arrived, frame->published);
+    //a no-op unless @drain is on
+    pxleap_queue_push(&x->queue, frame);
+    pxleap_triplebuf_publish(&x->frames);
+    //output from the scheduler thread, the same one banging from a metro would. a clock that is
+    //already due is only set again, so bursts of frames coalesce into one output
+    if(atomic_load_explicit(&x->push, memory_order_relaxed)) clock_delay(x->pushclock, 0);
+    //the frame was published but the Max thread only reads it, so it can still be sent from here
+    if(x->osc) pxleap_osc_send(x->osc, frame);
+    //other processes copy it out of shared memory themselves, this only copies it in
+    if(x->share) pxleap_shm_publish(x->share, frame);
+}
+
+//hub thread: a frame from the shared connection
+static void pxleap_core_hubframe(t_pxleap_core *x, const t_pxleap_frame *src, int64_t clockoffset)
+{
+    int64_t arrived = pxleap_now_ns();
+    //copy into the back slot, then publish it without waiting on the Max thread
+    t_pxleap_frame *frame = pxleap_triplebuf_back(&x->frames);
+    *frame = *src;
+    pxleap_core_processframe(x, frame, arrived, clockoffset);
+}
+
+//worker thread function that plays back recordings, live frames come from the hub thread instead.
+//it blocks whenever there's nothing to do, and every wait is cut short by x->wake
+static void *pxleap_core_tick(t_pxleap_core *x)
+{
+    if(x->interactive) pxleap_thread_setinteractive();
+    while(!atomic_load_explicit(&x->systhread_cancel, memory_order_acquire)){
+        if(x->replay){
+            //recorded frames stand in for LeapPollConnection while replaying
+            t_pxleap_frame *frame = pxleap_triplebuf_back(&x->frames);
+            if(pxleap_replay_next(x->replay, frame)){
+                int64_t wait, arrived;
+                //a wake-up means stop, or a new speed to pace by
+                while((wait = pxleap_replay_delay(x->replay, frame->timestamp, x->speed)) >= 1000
+                      && !atomic_load_explicit(&x->systhread_cancel, memory_order_acquire))
+                    pxleap_wake_wait(&x->wake, wait);
+                arrived = pxleap_now_ns();
+                //a replay's clock is the recording's timeline, as it is being played now
+                pxleap_core_processframe(x, frame, arrived, frame->timestamp - (int64_t)(systimer_gettime() * 1000.));
+            }
+            else if(x->loop){
+                //timestamps start over, so the history can't run on across the loop
+                pxleap_replay_rewind(x->replay);
+                pxleap_history_clear(&x->history);
+            }
+            //the end of the recording, sleep until stopped or looped
+            else pxleap_wake_wait(&x->wake, -1);
+        }
+        else if(x->attached){
+            //nothing can wake this thread across processes, so it looks for frames every poll interval
+            t_pxleap_frame *frame = pxleap_triplebuf_back(&x->frames);
+            if(pxleap_shmreader_next(x->attached, frame)){
+                int64_t arrived = pxleap_now_ns();
+                //the frame was published (arrived - published) ns ago on the same clock, at its leap time
+                int64_t age = (arrived - frame->published) / 1000;
+                pxleap_core_processframe(x, frame, arrived, frame->timestamp - (int64_t)(systimer_gettime() * 1000.) + age);
+            }
+            else pxleap_wake_wait(&x->wake, PXLEAP_SHM_POLL_US);
+        }
+        else pxleap_wake_wait(&x->wake, -1);
+    }
+    systhread_exit(0);
+    return NULL;
+}
+
+//start the worker thread for a replay or another process's frames, or take frames from the hub when connected.
+//everything the last frames left behind carries on, so a setting can stop the worker and pick up where it was
+static void pxleap_core_resume(t_pxleap_core *x)
+{
+    pxleap_core_pause(x);
+    if (x->replay || x->attached) {
+        atomic_store_explicit(&x->systhread_cancel, 0, memory_order_relaxed);
+        systhread_create((method) pxleap_core_tick, x, 0, 0, 0, &x->systhread);
+    }
+    else if (x->isrunning && x->hub) pxleap_hub_subscribe(x->hub, &x->subscriber);
+}
+
+//start frames from a new source, which has its own clock and frame ids, so nothing from the last one carries on
+static void pxleap_core_systhread_start(t_pxleap_core *x)
+{
+    pxleap_core_pause(x);
+    pxleap_history_clear(&x->history);
+    pxleap_queue_clear(&x->queue);
+    pxleap_zones_reset(&x->zones);
+    pxleap_poses_reset(&x->poses);
+    if(x->hooks->restart) x->hooks->restart(x);
+    pxleap_core_resume(x);
+}
+
+//stop the worker and the hub's frames quietly, for a setting that swaps what the worker uses and resumes it
+static void pxleap_core_pause(t_pxleap_core *x)
+{
+    unsigned int ret;
+
+    if (x->systhread) {
+        atomic_store_explicit(&x->systhread_cancel, 1, memory_order_release);    // tell the thread to stop
+        pxleap_wake_signal(&x->wake);                                           // and cut short whatever it's waiting on
+        systhread_join(x->systhread, &ret);                                     // wait for the thread to stop
+        x->systhread = NULL;
+    }
+    //once this returns the hub thread is done with the triple buffer, the recorder and the log
+    if (x->hub) pxleap_hub_unsubscribe(x->hub, &x->subscriber);
+}
+
+//stop: the worker and the hub's frames both stop until the next connect, replay or attach
+void pxleap_core_stop(t_pxleap_core *x)
+{
+    if (x->systhread) post("stopping leap service");
+    pxleap_core_pause(x);
+}
+
+//whether frames are being delivered, so a setting that stops the worker knows to start it again
+static bool pxleap_core_running(t_pxleap_core *x)
+{
+    return x->systhread != NULL || x->subscriber.subscribed;
+}
+
+// Joins the shared connection to Leap and starts receiving its frames
+void pxleap_core_connect(t_pxleap_core *x)
+{
+    post("trying to connect");
+    if(x->isrunning && pxleap_core_running(x)){
+        post("already connected!");
+        return;
+    }
+    if(!x->hub) x->hub = pxleap_hub_acquire((int)x->interactive);
+    if(x->hub){
+        x->isrunning = true;
+        pxleap_core_systhread_start(x);
+        post("Leap Connected");
+    }
+    else post("Leap connection not opened");
+}
+
+//where record and log write a file: over one already in the search path, or else a new one next to
+//the patcher, unless the name is a full path
+static void pxleap_core_writepath(t_symbol *s, char *fullpath)
+{
+    char filename[MAX_PATH_CHARS];
+    short path;
+    t_fourcc type;
+    strncpy_zero(filename, s->s_name, MAX_PATH_CHARS);
+    if(!locatefile_extended(filename, &path, &type, NULL, 0) && !path_toabsolutesystempath(path, filename, fullpath)) return;
+    strncpy_zero(filename, s->s_name, MAX_PATH_CHARS);
+    if(filename[0] != '/' && filename[0] != '\\' && !strchr(filename, ':')
+        && !path_toabsolutesystempath(path_getdefault(), filename, fullpath)) return;
+    strncpy_zero(fullpath, s->s_name, MAX_PATH_CHARS);
+}
+
+//record <file> writes every frame to disk, record with no file closes the recording
+void pxleap_core_record(t_pxleap_core *x, t_symbol *s)
+{
+    t_pxleap_recorder *recorder = NULL;
+    bool restart = pxleap_core_running(x);
+    if(s && s != ps_empty){
+        char fullpath[MAX_PATH_CHARS];
+        pxleap_core_writepath(s, fullpath);
+        recorder = pxleap_recorder_open(fullpath);
+        if(!recorder){
+            object_error((t_object *)x, "could not create recording %s", s->s_name);
+            return;
+        }
+    }
+    //the worker writes into the recorder's queue, so swap it with the worker stopped
+    pxleap_core_pause(x);
+    if(x->recorder){
+        uint64_t dropped = atomic_load(&x->recorder->dropped);
+        uint64_t count = pxleap_recorder_count(x->recorder);
+        //closing waits for the recorder's thread to write out what is still queued
+        uint64_t bytes = pxleap_recorder_close(x->recorder);
+        if(bytes) post("recorded %llu frames in %.1f MB, %llu dropped", (unsigned long long)count, (double)bytes / 1048576., (unsigned long long)dropped);
+        else object_error((t_object *)x, "the recording stopped early, a write to it failed");
+    }
+    x->recorder = recorder;
+    if(restart) pxleap_core_resume(x);
+}
+
+//log <file> keeps a compressed session log of every frame, log with no file closes it
+void pxleap_core_log(t_pxleap_core *x, t_symbol *s)
+{
+    t_pxleap_log *log = NULL;
+    bool restart = pxleap_core_running(x);
+    if(s && s != ps_empty){
+        char fullpath[MAX_PATH_CHARS];
+        pxleap_core_writepath(s, fullpath);
+        log = pxleap_log_open(fullpath);
+        if(!log){
+            object_error((t_object *)x, "could not create log %s", s->s_name);
+            return;
+        }
+    }
+    //the worker writes into the log's queue, so swap it with the worker stopped
+    pxleap_core_pause(x);
+    if(x->log){
+        uint64_t dropped = atomic_load(&x->log->dropped);
+        uint64_t count = pxleap_log_count(x->log);
+        //closing waits for the log's thread to write out what is still queued
+        uint64_t bytes = pxleap_log_close(x->log);
+        if(bytes) post("logged %llu frames in %.1f KB, %llu dropped", (unsigned long long)count, (double)bytes / 1024., (unsigned long long)dropped);
+        else object_error((t_object *)x, "the log stopped early, a write to it failed");
+    }
+    x->log = log;
+    if(restart) pxleap_core_resume(x);
+}
+
+//seek <ms> moves a replay to that many milliseconds after its first frame
+void pxleap_core_seek(t_pxleap_core *x, double ms)
+{
+    if(!x->replay){
+        object_error((t_object *)x, "seek needs a replay");
+        return;
+    }
+    pxleap_core_pause(x);
+    if(!pxleap_replay_seek(x->replay, (int64_t)(ms * 1000.)))
+        object_error((t_object *)x, "seek %.0f is past the end of the replay", ms);
+    pxleap_core_systhread_start(x);
+}
+
+//replay <file> plays a recording in place of the device, replay with no file goes back to the device
+void pxleap_core_replay(t_pxleap_core *x, t_symbol *s)
+{
+    t_pxleap_replay *replay = NULL;
+    if(s && s != ps_empty){
+        char filename[MAX_PATH_CHARS];
+        char fullpath[MAX_PATH_CHARS];
+        short path;
+        t_fourcc type;
+        strncpy_zero(filename, s->s_name, MAX_PATH_CHARS);
+        if(!locatefile_extended(filename, &path, &type, NULL, 0) && !path_toabsolutesystempath(path, filename, fullpath))
+            replay = pxleap_replay_open(fullpath);
+        else replay = pxleap_replay_open(s->s_name);
+        if(!replay){
+            object_error((t_object *)x, "could not open recording %s", s->s_name);
+            return;
+        }
+    }
+    pxleap_core_pause(x);
+    pxleap_replay_close(x->replay);
+    x->replay = replay;
+    if(x->replay || x->attached || x->isrunning) pxleap_core_systhread_start(x);
+}
+
+//share <name> copies every frame into a shared memory segment other processes can attach to, share on its own stops
+void pxleap_core_share(t_pxleap_core *x, t_symbol *s)
+{
+    t_pxleap_shm *share = NULL;
+    bool restart = pxleap_core_running(x);
+    if(s && s != ps_empty){
+        share = pxleap_shm_create(s->s_name);
+        if(!share){
+            object_error((t_object *)x, "could not share frames as %s", s->s_name);
+            return;
+        }
+    }
+    //the worker writes into the segment, so swap it with the worker stopped
+    pxleap_core_pause(x);
+    pxleap_shm_close(x->share);
+    x->share = share;
+    if(restart) pxleap_core_resume(x);
+}
+
+//attach <name> takes frames from a segment another object shares, attach on its own goes back to the device.
+//the segment doesn't have to exist yet, and a new one under the same name is picked up
+void pxleap_core_attach(t_pxleap_core *x, t_symbol *s)
+{
+    t_pxleap_shmreader *attached = NULL;
+    if(s && s != ps_empty){
+        attached = pxleap_shmreader_open(s->s_name);
+        if(!attached){
+            object_error((t_object *)x, "%s is not a name frames can be shared under", s->s_name);
+            return;
+        }
+    }
+    pxleap_core_pause(x);
+    if(x->attached && x->attached->missed)
+        object_warn((t_object *)x, "%llu shared frames were overwritten before they could be read", (unsigned long long)x->attached->missed);
+    pxleap_shmreader_close(x->attached);
+    x->attached = attached;
+    if(x->replay || x->attached || x->isrunning) pxleap_core_systhread_start(x);
+}
+
+//lay the OSC messages out for the current fields and features, only while the worker is stopped
+static void pxleap_core_compileosc(t_pxleap_core *x)
+{
+    if(x->osc && !pxleap_osc_compile(x->osc, &x->plan, (uint32_t)atomic_load(&x->features.groups), x->oscprefix->s_name))
+        object_error((t_object *)x, "the selected fields don't fit in one OSC bundle, only /frame is sent");
+}
+
+//fields, features and the prefix all change the OSC layout
+static void pxleap_core_updateosc(t_pxleap_core *x)
+{
+    bool restart = pxleap_core_running(x);
+    if(!x->osc) return;
+    pxleap_core_pause(x);
+    pxleap_core_compileosc(x);
+    if(restart) pxleap_core_resume(x);
+}
+
+//osc <host> <port> sends every frame from the worker thread as an OSC bundle, osc on its own stops
+void pxleap_core_osc(t_pxleap_core *x, t_symbol *s, long argc, t_atom *argv)
+{
+    t_pxleap_osc *osc = NULL;
+    bool restart = pxleap_core_running(x);
+    if(argc){
+        t_symbol *host = atom_getsym(argv);
+        long port = argc > 1 ? atom_getlong(argv + 1) : 0;
+        if(host == ps_empty || port <= 0 || port > 65535){
+            object_error((t_object *)x, "osc needs a host and a port");
+            return;
+        }
+        osc = pxleap_osc_open(host->s_name, (int)port);
+        if(!osc){
+            object_error((t_object *)x, "could not send to %s port %ld", host->s_name, port);
+            return;
+        }
+        pxleap_osc_setrate(osc, x->oscrate);
+    }
+    //the worker sends through the socket while it runs, so swap it with the worker stopped
+    pxleap_core_pause(x);
+    pxleap_osc_close(x->osc);
+    x->osc = osc;
+    pxleap_core_compileosc(x);
+    if(restart) pxleap_core_resume(x);
+}
+
+static t_max_err pxleap_core_setoscrate(t_pxleap_core *x, void *attr, long argc, t_atom *argv)
+{
+    double rate = argc ? atom_getfloat(argv) : 0.;
+    x->oscrate = rate < 0. ? 0. : rate;
+    if(x->osc) pxleap_osc_setrate(x->osc, x->oscrate);
+    return MAX_ERR_NONE;
+}
+
+static t_max_err pxleap_core_setoscprefix(t_pxleap_core *x, void *attr, long argc, t_atom *argv)
+{
+    t_symbol *prefix = argc ? atom_getsym(argv) : gensym("/leap");
+    if(prefix->s_name[0] != '/' || strlen(prefix->s_name) > PXLEAP_OSC_PREFIX_MAX){
+        object_error((t_object *)x, "oscprefix must start with / and be at most %d characters", PXLEAP_OSC_PREFIX_MAX);
+        return MAX_ERR_GENERIC;
+    }
+    x->oscprefix = prefix;
+    pxleap_core_updateosc(x);
+    return MAX_ERR_NONE;
+}
+
+//the ring is only resized while nothing is pushing into it, so its memory never changes under the worker
+static void pxleap_core_setdepth_now(t_pxleap_core *x, long depth)
+{
+    bool restart = pxleap_core_running(x);
+    if(depth == x->depth) return;
+    pxleap_core_pause(x);
+    if(!pxleap_history_resize(&x->history, (uint32_t)depth)){
+        object_error((t_object *)x, "could not keep a history of %ld frames", depth);
+        depth = 0;
+    }
+    x->depth = depth;
+    if(restart) pxleap_core_resume(x);
+}
+
+//and the queries read it from the scheduler thread, so it's resized there too
+static t_max_err pxleap_core_setdepth(t_pxleap_core *x, void *attr, long argc, t_atom *argv)
+{
+    long depth = argc ? atom_getlong(argv) : 0;
+    t_atom a;
+    depth = depth < 0 ? 0 : (depth > PXLEAP_HISTORY_MAX ? PXLEAP_HISTORY_MAX : depth);
+    atom_setlong(&a, depth);
+    if(!pxleap_core_toscheduler(x, ps_depth, 1, &a)) pxleap_core_setdepth_now(x, depth);
+    return MAX_ERR_NONE;
+}
+
+//@drain: every frame queued since the last bang, oldest first, then how many a full queue dropped
+static void pxleap_core_drain(t_pxleap_core *x)
+{
+    const t_pxleap_frame *frame;
+    uint64_t overflow;
+    while((frame = pxleap_queue_peek(&x->queue))){
+        int64_t start = pxleap_now_ns();
+        pxleap_predictor_push(&x->predictor, frame);
+        x->hooks->output(x, frame);
+        pxleap_core_countoutput(x, frame, start, true);
+        x->lastframeid = frame->tracking_frame_id;
+        //the worker can only reuse the slot once the frame has gone out
+        pxleap_queue_pop(&x->queue);
+    }
+    overflow = atomic_load_explicit(&x->queue.overflow, memory_order_relaxed);
+    if(overflow != x->overflowseen){
+        t_atom a;
+        atom_setlong(&a, (t_atom_long)(overflow - x->overflowseen));
+        outlet_anything(x->outlet, ps_overflow, 1, &a);
+        x->overflowseen = overflow;
+    }
+}
+
+//the queue only holds memory while draining. the worker pushes into it and bang pops it from the
+//scheduler thread, so it only changes there, with the worker paused
+static void pxleap_core_setdrain_now(t_pxleap_core *x, long drain)
+{
+    bool restart = pxleap_core_running(x);
+    if(drain == x->drain) return;
+    pxleap_core_pause(x);
+    if(!pxleap_queue_enable(&x->queue, (int)drain)){
+        object_error((t_object *)x, "not enough memory to queue frames for @drain");
+        drain = 0;
+    }
+    x->drain = drain;
+    if(restart) pxleap_core_resume(x);
+}
+
+static t_max_err pxleap_core_setdrain(t_pxleap_core *x, void *attr, long argc, t_atom *argv)
+{
+    long drain = argc ? atom_getlong(argv) != 0 : 0;
+    t_atom a;
+    atom_setlong(&a, drain);
+    if(!pxleap_core_toscheduler(x, ps_drain, 1, &a)) pxleap_core_setdrain_now(x, drain);
+    return MAX_ERR_NONE;
+}
+
+//zone add <name> <shape> ..., zone remove <name> or zone clear. the worker picks up the change with its next frame
+void pxleap_core_zone(t_pxleap_core *x, t_symbol *s, long argc, t_atom *argv)
+{
+    pxleap_zones_message(&x->zones, (t_object *)x, argc, argv);
+}
+
+static t_max_err pxleap_core_setdwell(t_pxleap_core *x, void *attr, long argc, t_atom *argv)
+{
+    pxleap_zones_setdwell(&x->zones, argc ? atom_getfloat(argv) : 0.);
+    return MAX_ERR_NONE;
+}
+
+static void pxleap_core_pose_now(t_pxleap_core *x, long argc, t_atom *argv)
+{
+    pxleap_poses_message(&x->poses, (t_object *)x, (x->isrunning || x->replay || x->attached) ? &x->frames : NULL, argc, argv);
+}
+
+//pose add <label> [left|right] records the hands of the latest frame, then pose remove <label>, clear,
+//write <file> or read <file>. the worker picks up the new library with its next frame. add reads the
+//latest frame, so every edit is made from the scheduler thread to keep the library with one writer
+void pxleap_core_pose(t_pxleap_core *x, t_symbol *s, long argc, t_atom *argv)
+{
+    if(!pxleap_core_toscheduler(x, ps_pose, argc, argv)) pxleap_core_pose_now(x, argc, argv);
+}
+
+static t_max_err pxleap_core_setposethreshold(t_pxleap_core *x, void *attr, long argc, t_atom *argv)
+{
+    pxleap_poses_setthreshold(&x->poses, argc ? atom_getfloat(argv) : 0.);
+    return MAX_ERR_NONE;
+}
+
+static t_max_err pxleap_core_setposehold(t_pxleap_core *x, void *attr, long argc, t_atom *argv)
+{
+    pxleap_poses_sethold(&x->poses, argc ? atom_getlong(argv) : 1);
+    return MAX_ERR_NONE;
+}
+
+//the worker paces replays by the speed, so wake it to pick up the new one
+static t_max_err pxleap_core_setspeed(t_pxleap_core *x, void *attr, long argc, t_atom *argv)
+{
+    double speed = argc ? atom_getfloat(argv) : 1.;
+    x->speed = speed < 0. ? 0. : speed;
+    pxleap_wake_signal(&x->wake);
+    return MAX_ERR_NONE;
+}
+
+//wakes a worker sleeping at the end of a replay
+static t_max_err pxleap_core_setloop(t_pxleap_core *x, void *attr, long argc, t_atom *argv)
+{
+    x->loop = argc ? (atom_getlong(argv) != 0) : 0;
+    pxleap_wake_signal(&x->wake);
+    return MAX_ERR_NONE;
+}
+
+//the thread sets its own QoS when it starts, so restart a running one. the hub thread keeps
+//the setting of the object that created it.
+static t_max_err pxleap_core_setinteractive(t_pxleap_core *x, void *attr, long argc, t_atom *argv)
+{
+    long interactive = argc ? (atom_getlong(argv) != 0) : 0;
+    if(interactive == x->interactive) return MAX_ERR_NONE;
+    x->interactive = interactive;
+    if(x->systhread) pxleap_core_resume(x);
+    return MAX_ERR_NONE;
+}
+
+static t_max_err pxleap_core_setdevice(t_pxleap_core *x, void *attr, long argc, t_atom *argv)
+{
+    long device = argc ? atom_getlong(argv) : 0;
+    x->device = device < 0 ? 0 : device;
+    pxleap_hub_setdevice(x->hub, &x->subscriber, (uint32_t)x->device);
+    return MAX_ERR_NONE;
+}
+
+static t_max_err pxleap_core_setmode(t_pxleap_core *x, void *attr, long argc, t_atom *argv)
+{
+    t_symbol *mode = argc ? atom_getsym(argv) : ps_bang;
+    if(mode != ps_bang && mode != ps_push){
+        object_error((t_object *)x, "mode must be bang or push");
+        return MAX_ERR_GENERIC;
+    }
+    x->mode = mode;
+    atomic_store(&x->push, mode == ps_push);
+    return MAX_ERR_NONE;
+}
+
+static t_max_err pxleap_core_setfilter(t_pxleap_core *x, void *attr, long argc, t_atom *argv)
+{
+    t_symbol *type = argc ? atom_getsym(argv) : ps_none;
+    if(type == ps_none) pxleap_filter_settype(&x->filter, PXLEAP_FILTER_NONE);
+    else if(type == ps_euro) pxleap_filter_settype(&x->filter, PXLEAP_FILTER_EURO);
+    else if(type == ps_kalman) pxleap_filter_settype(&x->filter, PXLEAP_FILTER_KALMAN);
+    else {
+        object_error((t_object *)x, "filter must be none, euro or kalman");
+        return MAX_ERR_GENERIC;
+    }
+    x->filtertype = type;
+    return MAX_ERR_NONE;
+}
+
+//cutoff <mincutoff> <beta> <dcutoff>, missing values are left as they are
+static t_max_err pxleap_core_setcutoff(t_pxleap_core *x, void *attr, long argc, t_atom *argv)
+{
+    for(long i = 0; i < argc && i < 3; i++){
+        float v = (float)atom_getfloat(argv + i);
+        x->cutoff[i] = v < 0.f ? 0.f : v;
+    }
+    pxleap_filter_seteuro(&x->filter, x->cutoff[0], x->cutoff[1], x->cutoff[2]);
+    return MAX_ERR_NONE;
+}
+
+//kalman <noise> <accel>, missing values are left as they are
+static t_max_err pxleap_core_setkalman(t_pxleap_core *x, void *attr, long argc, t_atom *argv)
+{
+    for(long i = 0; i < argc && i < 2; i++){
+        float v = (float)atom_getfloat(argv + i);
+        x->kalman[i] = v < 0.001f ? 0.001f : v;
+    }
+    pxleap_filter_setkalman(&x->filter, x->kalman[0], x->kalman[1]);
+    return MAX_ERR_NONE;
+}
+
+//compile the plan and let the object start its output over, with the worker stopped since it
+//reads the plan for the object as it prepares each frame. bang reads what the object rebuilds,
+//so this runs on the scheduler thread
+static void pxleap_core_relayout_now(t_pxleap_core *x, uint32_t fields)
+{
+    bool restart = pxleap_core_running(x);
+    pxleap_core_pause(x);
+    pxleap_plan_compile(&x->plan, fields);
+    x->hooks->relayout(x);
+    pxleap_core_compileosc(x);
+    if(restart) pxleap_core_resume(x);
+}
+
+//hand the enabled feature groups to the worker thread
+static void pxleap_core_updatefeatures(t_pxleap_core *x)
+{
+    int groups = 0;
+    int previous = atomic_load(&x->features.groups);
+    if(x->velocity) groups |= PXLEAP_FEATURE_VELOCITY;
+    if(x->grip) groups |= PXLEAP_FEATURE_GRIP;
+    if(x->curl) groups |= PXLEAP_FEATURE_CURL;
+    pxleap_features_setgroups(&x->features, groups);
+    //a group that was switched off would leave stale values behind in what the worker prepared
+    if(x->hooks->relayout && (previous & ~groups)){
+        if(!pxleap_core_toscheduler(x, ps_relayout, 0, NULL)) pxleap_core_relayout_now(x, x->plan.fields);
+    }
+    else pxleap_core_updateosc(x);
+}
+
+static t_max_err pxleap_core_setvelocity(t_pxleap_core *x, void *attr, long argc, t_atom *argv)
+{
+    x->velocity = argc ? (atom_getlong(argv) != 0) : 0;
+    pxleap_core_updatefeatures(x);
+    return MAX_ERR_NONE;
+}
+
+static t_max_err pxleap_core_setgrip(t_pxleap_core *x, void *attr, long argc, t_atom *argv)
+{
+    x->grip = argc ? (atom_getlong(argv) != 0) : 0;
+    pxleap_core_updatefeatures(x);
+    return MAX_ERR_NONE;
+}
+
+static t_max_err pxleap_core_setcurl(t_pxleap_core *x, void *attr, long argc, t_atom *argv)
+{
+    x->curl = argc ? (atom_getlong(argv) != 0) : 0;
+    pxleap_core_updatefeatures(x);
+    return MAX_ERR_NONE;
+}
+
+//compile the selection once here, so frames only visit the fields that were asked for. output
+//reads the plan on the scheduler thread, so it's compiled there
+static void pxleap_core_setfields_now(t_pxleap_core *x, uint32_t fields)
+{
+    if(fields == x->plan.fields) return;
+    //fields that were dropped would leave stale values behind in what the worker prepared
+    if(x->hooks->relayout) pxleap_core_relayout_now(x, fields);
+    else {
+        pxleap_plan_compile(&x->plan, fields);
+        pxleap_core_updateosc(x);
+    }
+}
+
+static t_max_err pxleap_core_setfields(t_pxleap_core *x, void *attr, long argc, t_atom *argv)
+{
+    t_symbol *unknown;
+    uint32_t fields = pxleap_fields_parse(argc, argv, &unknown);
+    if(unknown){
+        object_error((t_object *)x, "unknown field %s, choose from palm orientation normal direction arm tips joints all", unknown->s_name);
+        return MAX_ERR_GENERIC;
+    }
+    x->fieldcount = argc < PXLEAP_FIELD_MAXNAMES ? argc : PXLEAP_FIELD_MAXNAMES;
+    for(long i = 0; i < x->fieldcount; i++) x->fields[i] = atom_getsym(argv + i);
+    t_atom a;
+    atom_setlong(&a, fields);
+    if(!pxleap_core_toscheduler(x, ps_fields, 1, &a)) pxleap_core_setfields_now(x, fields);
+    return MAX_ERR_NONE;
+}
+
+//the pose at now + ahead ms, predicted from the last two frames the Max thread has seen
+static const t_pxleap_frame *pxleap_core_predictat(t_pxleap_core *x, double ahead)
+{
+    int64_t usertime = (int64_t)((systimer_gettime() + ahead) * 1000.);
+    return pxleap_predictor_at(&x->predictor, usertime + atomic_load_explicit(&x->clockoffset, memory_order_relaxed));
+}
+
+//output the pose predicted for ms milliseconds from now
+static void pxleap_core_predict_now(t_pxleap_core *x, double ms)
+{
+    if(x->isrunning || x->replay || x->attached){
+        const t_pxleap_frame *frame = pxleap_triplebuf_read(&x->frames);
+        if (frame){
+            pxleap_predictor_push(&x->predictor, frame);
+            x->hooks->output(x, pxleap_core_predictat(x, ms));
+            x->lastframeid = frame->tracking_frame_id;
+        }
+    }
+}
+
+void pxleap_core_predict(t_pxleap_core *x, double ms)
+{
+    t_atom a;
+    atom_setfloat(&a, ms);
+    if(!pxleap_core_toscheduler(x, ps_predict, 1, &a)) pxleap_core_predict_now(x, ms);
+}
+
+//output frames first to end - 1 of the history, oldest first, skipping any the worker overwrote meanwhile
+static void pxleap_core_outputhistory(t_pxleap_core *x, uint64_t first, uint64_t end)
+{
+    if(!x->depth){
+        object_error((t_object *)x, "set @depth to keep a history");
+        return;
+    }
+    for(uint64_t n = first; n < end; n++){
+        if(pxleap_history_get(&x->history, n, &x->historyframe)) x->hooks->output(x, &x->historyframe);
+    }
+}
+
+//history <n>: the last n frames
+static void pxleap_core_history_now(t_pxleap_core *x, long n)
+{
+    uint64_t first, end;
+    pxleap_history_range(&x->history, &first, &end);
+    if(n < 0) n = 0;
+    if((uint64_t)n < end - first) first = end - n;
+    pxleap_core_outputhistory(x, first, end);
+}
+
+void pxleap_core_history(t_pxleap_core *x, long n)
+{
+    t_atom a;
+    atom_setlong(&a, n);
+    if(!pxleap_core_toscheduler(x, ps_history, 1, &a)) pxleap_core_history_now(x, n);
+}
+
+//since <ms>: every frame from the last ms milliseconds, counted back from the newest frame
+static void pxleap_core_since_now(t_pxleap_core *x, double ms)
+{
+    uint64_t first, end;
+    pxleap_history_range(&x->history, &first, &end);
+    if(end > first && pxleap_history_get(&x->history, end - 1, &x->historyframe))
+        first = pxleap_history_findtime(&x->history, x->historyframe.timestamp - (int64_t)(ms * 1000.));
+    pxleap_core_outputhistory(x, first, end);
+}
+
+void pxleap_core_since(t_pxleap_core *x, double ms)
+{
+    t_atom a;
+    atom_setfloat(&a, ms);
+    if(!pxleap_core_toscheduler(x, ps_since, 1, &a)) pxleap_core_since_now(x, ms);
+}
+
+//frame <id>: one frame by its tracking frame id, as long as it's still held
+static void pxleap_core_frame_now(t_pxleap_core *x, long id)
+{
+    uint64_t first, end, n;
+    pxleap_history_range(&x->history, &first, &end);
+    n = pxleap_history_findid(&x->history, id);
+    if(n < end && pxleap_history_get(&x->history, n, &x->historyframe) && x->historyframe.tracking_frame_id == id)
+        x->hooks->output(x, &x->historyframe);
+    else if(x->depth) object_error((t_object *)x, "frame %ld is not in the history", id);
+    else object_error((t_object *)x, "set @depth to keep a history");
+}
+
+void pxleap_core_frame(t_pxleap_core *x, long id)
+{
+    t_atom a;
+    atom_setlong(&a, id);
+    if(!pxleap_core_toscheduler(x, ps_frame, 1, &a)) pxleap_core_frame_now(x, id);
+}
+
+//read from the most recent frame of data received from Leap
+static void pxleap_core_bang_now(t_pxleap_core *x)
+{
+    int64_t start = pxleap_now_ns();
+    if(x->isrunning || x->replay || x->attached){
+        if(x->drain){
+            pxleap_core_drain(x);
+            return;
+        }
+        //only the scheduler thread reads, so the front slot is its own until its next read and no lock is needed
+        const t_pxleap_frame *frame = pxleap_triplebuf_read(&x->frames);
+        if (frame){
+            int64_t frameID = frame->tracking_frame_id;
+            bool fresh = frameID != x->lastframeid;
+            bool output = x->interp || fresh;
+            pxleap_predictor_push(&x->predictor, frame);
+            //an interpolated pose moves on between frames, so it goes out on every bang
+            if(x->interp) x->hooks->output(x, pxleap_core_predictat(x, x->lookahead));
+            //the worker already wrote the newest frame's output, so it only has to be shown
+            else if(fresh && x->hooks->outputlatest) output = x->hooks->outputlatest(x);
+            else if(fresh) x->hooks->output(x, frame);
+            if(output) pxleap_core_countoutput(x, frame, start, fresh);
+            x->lastframeid = frameID;
+        }
+    }
+}
+
+//drain pops the queue on the same thread, so it keeps the one reader too
+void pxleap_core_bang(t_pxleap_core *x)
+{
+    if(!pxleap_core_toscheduler(x, ps_bang, 0, NULL)) pxleap_core_bang_now(x);
+}
@@ -0,0 +1,142 @@
+//
+// pxleap_core
+//
+// Everything px.ultraleap and px.dict.ultraleap have in common: where frames come from, what the
+// worker does with each one before the Max thread sees it, and the messages and attributes that
+// change either. t_pxleap_core goes first in each object's struct, the way t_pxobject does in an
+// MSP object, so the shared methods take the object itself. The object only adds its own output.
+//
+// author: Andrew Benson
+// contact: pixlpa@gmail.com
+//
+
+#ifndef PXLEAP_CORE_H
+#define PXLEAP_CORE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "ext.h"
+#include "ext_obex.h"
+#include "ext_systhread.h"
+#include "pxleap_frame.h"
+#include "pxleap_record.h"
+#include "pxleap_filter.h"
+#include "pxleap_features.h"
+#include "pxleap_thread.h"
+#include "pxleap_hub.h"
+#include "pxleap_fields.h"
+#include "pxleap_history.h"
+#include "pxleap_osc.h"
+#include "pxleap_shm.h"
+#include "pxleap_stats.h"
+#include "pxleap_queue.h"
+#include "pxleap_log.h"
+#include "pxleap_zones.h"
+#include "pxleap_poses.h"
+
+typedef struct _pxleap_core t_pxleap_core;
+
+// what the object does with frames, all but output can be NULL
+typedef struct _pxleap_core_hooks
+{
+    // Max thread: one frame in the object's format
+    void (*output)(t_pxleap_core *x, const t_pxleap_frame *frame);
+    // Max thread: bang's output of the newest frame, when prepare already wrote it. returns
+    // false when there was nothing new to show
+    bool (*outputlatest)(t_pxleap_core *x);
+    // worker thread: writes the object's output of a frame ahead of publishing it. drained
+    // frames are output by the Max thread instead, so it isn't called while @drain is on
+    void (*prepare)(t_pxleap_core *x, const t_pxleap_frame *frame);
+    // worker stopped: a new source is about to start, whatever prepare wrote is stale
+    void (*restart)(t_pxleap_core *x);
+    // worker stopped: @fields or the features changed what prepare writes. leave it NULL when
+    // the worker doesn't read the plan, and the worker is only stopped for the OSC layout
+    void (*relayout)(t_pxleap_core *x);
+} t_pxleap_core_hooks;
+
+struct _pxleap_core
+{
+    t_object ob;
+    const t_pxleap_core_hooks *hooks;
+    void *outlet;                                           // stats, overflow, zone and pose messages go out here
+    bool isrunning;
+    t_int64 lastframeid;
+    t_pxleap_hub *hub;                                      // shared Leap connection, held from connect until free
+    t_pxleap_hub_subscriber subscriber;                     // receives the hub's frames while connected and not replaying
+    long device;                                            // tracker to follow, 0 for the first one attached
+    t_pxleap_history history;                               // the last @depth frames, filled by the worker thread
+    long depth;
+    t_pxleap_frame historyframe;                            // where history queries copy each frame to before output
+    t_pxleap_osc *osc;                                      // frames also go out as OSC bundles while set, sent by the worker
+    t_pxleap_shm *share;                                    // and into shared memory for other processes while set
+    t_pxleap_shmreader *attached;                           // frames come from another process's shared memory instead of the device
+    double oscrate;                                         // bundles per second at most, 0 for every frame
+    t_symbol *oscprefix;                                    // start of every OSC address
+    t_pxleap_stats stats;                                   // frame and output counters, reported by the stats message
+    t_pxleap_queue queue;                                   // every frame since the last drain, filled by the worker while @drain is on
+    long drain;                                             // bang outputs every queued frame instead of the newest one
+    uint64_t overflowseen;                                  // queue overflow already reported
+    t_pxleap_triplebuf frames;                              // lock-free handoff of frames from the worker thread
+    t_pxleap_recorder *recorder;                            // every frame is written here while recording
+    t_pxleap_log *log;                                      // and compressed into this session log while logging
+    t_pxleap_zones zones;                                   // trigger zones, tested against every frame by the worker
+    void *zoneqelem;                                        // outputs the zone events it queued from the Max thread
+    t_pxleap_poses poses;                                   // pose templates, every hand classified against them by the worker
+    void *poseqelem;                                        // outputs the pose changes it queued from the Max thread
+    t_pxleap_replay *replay;                                // frames come from here instead of the device while replaying
+    double speed;                                           // replay speed, 0 plays as fast as possible
+    long loop;                                              // rewind when the replay reaches the end
+    t_systhread systhread;                                  // worker thread for replays and attached segments
+    atomic_int systhread_cancel;
+    t_pxleap_wake wake;                                     // signaled to cut short the worker thread's waits
+    long interactive;                                       // worker thread asks for interactive QoS
+    void *pushclock;                                        // outputs from the scheduler thread in push mode
+    t_symbol *mode;                                         // bang or push
+    atomic_int push;                                        // read by the worker thread, mirrors mode
+    _Atomic int64_t clockoffset;                            // leap clock minus Max system time in microseconds, kept current by the worker
+    t_pxleap_predictor predictor;                           // last two frames the Max thread has seen
+    long interp;                                            // bang outputs the pose predicted for now + lookahead
+    double lookahead;                                       // ms
+    t_pxleap_filter filter;                                 // joint smoothing, applied by the worker thread
+    t_symbol *filtertype;                                   // none, euro or kalman
+    float cutoff[3];                                        // euro: mincutoff (Hz), beta, dcutoff (Hz)
+    float kalman[2];                                        // kalman: measurement noise (mm), acceleration (mm/s^2)
+    t_pxleap_features_state features;                       // derived values, computed by the worker thread
+    long velocity;                                          // feature groups, see pxleap_features.h
+    long grip;
+    long curl;
+    t_symbol *fields[PXLEAP_FIELD_MAXNAMES];                // @fields as set
+    long fieldcount;
+    t_pxleap_plan plan;                                     // compiled from @fields, the object decides the defaults
+};
+
+// looks up the symbols of the shared messages, once from each class's main
+void pxleap_core_setup(void);
+// adds the shared methods and attributes to a class whose struct starts with a t_pxleap_core
+void pxleap_core_classinit(t_class *c);
+// from the object's new, before attr_args_process. outlet is where stats, overflow, zone and pose messages go
+void pxleap_core_init(t_pxleap_core *x, void *outlet, const t_pxleap_core_hooks *hooks);
+// stops the worker and lets go of everything the core holds
+void pxleap_core_free(t_pxleap_core *x);
+
+// the shared messages, registered by pxleap_core_classinit
+void pxleap_core_bang(t_pxleap_core *x);
+void pxleap_core_connect(t_pxleap_core *x);
+void pxleap_core_stop(t_pxleap_core *x);
+void pxleap_core_record(t_pxleap_core *x, t_symbol *s);
+void pxleap_core_replay(t_pxleap_core *x, t_symbol *s);
+void pxleap_core_log(t_pxleap_core *x, t_symbol *s);
+void pxleap_core_share(t_pxleap_core *x, t_symbol *s);
+void pxleap_core_attach(t_pxleap_core *x, t_symbol *s);
+void pxleap_core_seek(t_pxleap_core *x, double ms);
+void pxleap_core_zone(t_pxleap_core *x, t_symbol *s, long argc, t_atom *argv);
+void pxleap_core_pose(t_pxleap_core *x, t_symbol *s, long argc, t_atom *argv);
+void pxleap_core_predict(t_pxleap_core *x, double ms);
+void pxleap_core_history(t_pxleap_core *x, long n);
+void pxleap_core_since(t_pxleap_core *x, double ms);
+void pxleap_core_frame(t_pxleap_core *x, long id);
+void pxleap_core_osc(t_pxleap_core *x, t_symbol *s, long argc, t_atom *argv);
+void pxleap_core_stats(t_pxleap_core *x);
+
+#endif
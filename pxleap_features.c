@@ -0,0 +1,101 @@
+//
+// pxleap_features
+//
+// Per-hand values derived on the worker thread, so patches don't have to work them out
+// from the raw joints: palm and fingertip velocities, pinch and grab, and finger curl
+//
+// author: Andrew Benson
+// contact: pixlpa@gmail.com
+//
+
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include "pxleap_features.h"
+
+#define PXLEAP_DEGREES 57.29577951308232f
+
+void pxleap_features_init(t_pxleap_features_state *s)
+{
+    memset(s, 0, sizeof(*s));
+    atomic_init(&s->groups, 0);
+    for (int h = 0; h < PXLEAP_MAX_HANDS; h++) s->id[h] = -1;
+}
+
+void pxleap_features_setgroups(t_pxleap_features_state *s, int groups)
+{
+    atomic_store_explicit(&s->groups, groups, memory_order_relaxed);
+}
+
+static void pxleap_features_velocity(float *dst, const float *now, const float *before, float rate)
+{
+    for (int i = 0; i < 3; i++) dst[i] = (now[i] - before[i]) * rate;
+}
+
+// angle between two bones, 0 when either has no length (the thumb has no metacarpal)
+static float pxleap_features_bend(const LEAP_BONE *a, const LEAP_BONE *b)
+{
+    float u[3], v[3], uu = 0.f, vv = 0.f, uv = 0.f, c;
+    for (int i = 0; i < 3; i++) {
+        u[i] = a->next_joint.v[i] - a->prev_joint.v[i];
+        v[i] = b->next_joint.v[i] - b->prev_joint.v[i];
+        uu += u[i] * u[i];
+        vv += v[i] * v[i];
+        uv += u[i] * v[i];
+    }
+    if (uu < 1e-6f || vv < 1e-6f) return 0.f;
+    c = uv / sqrtf(uu * vv);
+    if (c > 1.f) c = 1.f;
+    if (c < -1.f) c = -1.f;
+    return acosf(c) * PXLEAP_DEGREES;
+}
+
+void pxleap_features_apply(t_pxleap_features_state *s, t_pxleap_frame *frame)
+{
+    int groups = atomic_load_explicit(&s->groups, memory_order_relaxed);
+    bool present[PXLEAP_MAX_HANDS] = { false, false };
+    frame->featuregroups = (uint32_t)groups;
+    if (!groups) {
+        for (int h = 0; h < PXLEAP_MAX_HANDS; h++) s->id[h] = -1;
+        return;
+    }
+    for (uint32_t h = 0; h < frame->nHands; h++) {
+        const LEAP_HAND *hand = &frame->hands[h];
+        t_pxleap_features *f = &frame->features[h];
+        int slot = (hand->type == eLeapHandType_Left) ? 0 : 1;
+        present[slot] = true;
+        if (groups & PXLEAP_FEATURE_VELOCITY) {
+            float dt = (float)(frame->timestamp - s->timestamp[slot]) * 1e-6f;
+            if (s->id[slot] == (int32_t)hand->id && dt > 0.f) {
+                float rate = 1.f / dt;
+                pxleap_features_velocity(f->palm_velocity, hand->palm.position.v, s->palm[slot], rate);
+                for (int d = 0; d < 5; d++)
+                    pxleap_features_velocity(f->tip_velocity[d], hand->digits[d].bones[3].next_joint.v, s->tips[slot][d], rate);
+            }
+            else {
+                memset(f->palm_velocity, 0, sizeof(f->palm_velocity));
+                memset(f->tip_velocity, 0, sizeof(f->tip_velocity));
+            }
+            s->id[slot] = (int32_t)hand->id;
+            s->timestamp[slot] = frame->timestamp;
+            memcpy(s->palm[slot], hand->palm.position.v, sizeof(s->palm[slot]));
+            for (int d = 0; d < 5; d++) memcpy(s->tips[slot][d], hand->digits[d].bones[3].next_joint.v, sizeof(s->tips[slot][d]));
+        }
+        if (groups & PXLEAP_FEATURE_GRIP) {
+            f->pinch_distance = hand->pinch_distance;
+            f->pinch_strength = hand->pinch_strength;
+            f->grab_strength = hand->grab_strength;
+            f->grab_angle = hand->grab_angle;
+        }
+        if (groups & PXLEAP_FEATURE_CURL) {
+            for (int d = 0; d < 5; d++) {
+                const LEAP_BONE *bones = hand->digits[d].bones;
+                f->curl[d] = pxleap_features_bend(&bones[0], &bones[1]) + pxleap_features_bend(&bones[1], &bones[2])
+                           + pxleap_features_bend(&bones[2], &bones[3]);
+            }
+        }
+    }
+    for (int h = 0; h < PXLEAP_MAX_HANDS; h++) {
+        if (!present[h] || !(groups & PXLEAP_FEATURE_VELOCITY)) s->id[h] = -1;
+    }
+}
@@ -0,0 +1,41 @@
+//
+// pxleap_features
+//
+// Per-hand values derived on the worker thread, so patches don't have to work them out
+// from the raw joints: palm and fingertip velocities, pinch and grab, and finger curl
+//
+// author: Andrew Benson
+// contact: pixlpa@gmail.com
+//
+
+#ifndef PXLEAP_FEATURES_H
+#define PXLEAP_FEATURES_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include "pxleap_frame.h"
+
+// feature groups, each one is switched on by its own attribute
+#define PXLEAP_FEATURE_VELOCITY 0x1         // palm_velocity, tip_velocity
+#define PXLEAP_FEATURE_GRIP 0x2             // pinch_distance, pinch_strength, grab_strength, grab_angle
+#define PXLEAP_FEATURE_CURL 0x4             // curl
+
+typedef struct _pxleap_features_state
+{
+    atomic_int groups;                      // written from the Max thread, read by the worker once per frame
+
+    // owned by the worker, the previous frame of each hand slot (0 left, 1 right) for velocities
+    int32_t id[PXLEAP_MAX_HANDS];           // -1 when the slot is empty
+    int64_t timestamp[PXLEAP_MAX_HANDS];
+    float palm[PXLEAP_MAX_HANDS][3];
+    float tips[PXLEAP_MAX_HANDS][5][3];
+} t_pxleap_features_state;
+
+void pxleap_features_init(t_pxleap_features_state *s);
+// safe to call from any thread while the worker is running
+void pxleap_features_setgroups(t_pxleap_features_state *s, int groups);
+// worker side: fills frame->features for the enabled groups and sets frame->featuregroups.
+// velocities are 0 for the first frame of a hand.
+void pxleap_features_apply(t_pxleap_features_state *s, t_pxleap_frame *frame);
+
+#endif
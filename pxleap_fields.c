@@ -0,0 +1,78 @@
+//
+// pxleap_fields
+//
+// Which parts of a hand the objects output, chosen with @fields. The selection is compiled
+// once into a plan, so output only walks the steps that were asked for.
+//
+// author: Andrew Benson
+// contact: pixlpa@gmail.com
+//
+
+#include <string.h>
+#include "pxleap_fields.h"
+
+static const struct
+{
+    const char *name;
+    uint32_t field;
+} pxleap_field_names[] = {
+    { "palm", PXLEAP_FIELD_PALM },
+    { "orientation", PXLEAP_FIELD_ORIENTATION },
+    { "normal", PXLEAP_FIELD_NORMAL },
+    { "direction", PXLEAP_FIELD_DIRECTION },
+    { "arm", PXLEAP_FIELD_ARM },
+    { "tips", PXLEAP_FIELD_TIPS },
+    { "joints", PXLEAP_FIELD_JOINTS },
+    { "all", PXLEAP_FIELD_ALL },
+};
+
+uint32_t pxleap_fields_parse(long argc, t_atom *argv, t_symbol **unknown)
+{
+    uint32_t fields = 0;
+    *unknown = NULL;
+    for (long i = 0; i < argc; i++) {
+        t_symbol *s = atom_getsym(argv + i);
+        size_t n;
+        for (n = 0; n < sizeof(pxleap_field_names) / sizeof(pxleap_field_names[0]); n++) {
+            if (!strcmp(s->s_name, pxleap_field_names[n].name)) break;
+        }
+        if (n == sizeof(pxleap_field_names) / sizeof(pxleap_field_names[0])) {
+            *unknown = s;
+            return fields;
+        }
+        fields |= pxleap_field_names[n].field;
+    }
+    return fields;
+}
+
+static void pxleap_plan_add(t_pxleap_plan *plan, uint32_t field, const char *name, size_t offset, long count)
+{
+    t_pxleap_plan_step *step;
+    if (!(plan->fields & field)) return;
+    step = &plan->steps[plan->nsteps++];
+    step->field = field;
+    step->name = gensym(name);
+    step->offset = offset;
+    step->count = count;
+}
+
+void pxleap_plan_compile(t_pxleap_plan *plan, uint32_t fields)
+{
+    memset(plan, 0, sizeof(*plan));
+    plan->fields = fields;
+    pxleap_plan_add(plan, PXLEAP_FIELD_PALM, "position", offsetof(LEAP_HAND, palm.position), 3);
+    pxleap_plan_add(plan, PXLEAP_FIELD_ORIENTATION, "orientation", offsetof(LEAP_HAND, palm.orientation), 4);
+    pxleap_plan_add(plan, PXLEAP_FIELD_NORMAL, "normal", offsetof(LEAP_HAND, palm.normal), 3);
+    pxleap_plan_add(plan, PXLEAP_FIELD_DIRECTION, "direction", offsetof(LEAP_HAND, palm.direction), 3);
+    pxleap_plan_add(plan, PXLEAP_FIELD_ARM, "elbow", offsetof(LEAP_HAND, arm.prev_joint), 3);
+    pxleap_plan_add(plan, PXLEAP_FIELD_ARM, "wrist", offsetof(LEAP_HAND, arm.next_joint), 3);
+    // joints already covers the tips
+    if (fields & PXLEAP_FIELD_JOINTS) {
+        plan->firstjoint = 0;
+        plan->njoints = 4;
+    }
+    else if (fields & PXLEAP_FIELD_TIPS) {
+        plan->firstjoint = 3;
+        plan->njoints = 1;
+    }
+}
@@ -0,0 +1,59 @@
+//
+// pxleap_fields
+//
+// Which parts of a hand the objects output, chosen with @fields. The selection is compiled
+// once into a plan, so output only walks the steps that were asked for.
+//
+// author: Andrew Benson
+// contact: pixlpa@gmail.com
+//
+
+#ifndef PXLEAP_FIELDS_H
+#define PXLEAP_FIELDS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "ext.h"
+#include "LeapC.h"
+
+#define PXLEAP_FIELD_PALM 0x1               // palm position
+#define PXLEAP_FIELD_ORIENTATION 0x2        // palm orientation quaternion
+#define PXLEAP_FIELD_NORMAL 0x4             // palm normal
+#define PXLEAP_FIELD_DIRECTION 0x8          // palm direction, towards the fingers
+#define PXLEAP_FIELD_ARM 0x10               // elbow and wrist
+#define PXLEAP_FIELD_TIPS 0x20              // fingertips
+#define PXLEAP_FIELD_JOINTS 0x40            // the end of every finger bone, tips included
+#define PXLEAP_FIELD_ALL 0x7f
+
+// the most @fields names a selection can hold, one per field plus "all"
+#define PXLEAP_FIELD_MAXNAMES 8
+
+// one hand-level value: count floats read from offset bytes into a LEAP_HAND
+typedef struct _pxleap_plan_step
+{
+    uint32_t field;                         // the PXLEAP_FIELD_* it comes from
+    t_symbol *name;                         // message selector or dictionary key
+    size_t offset;
+    long count;
+} t_pxleap_plan_step;
+
+typedef struct _pxleap_plan
+{
+    uint32_t fields;
+    long nsteps;
+    t_pxleap_plan_step steps[6];            // palm, orientation, normal, direction, elbow, wrist in that order
+    long firstjoint;                        // finger joints from firstjoint to 3, none when njoints is 0
+    long njoints;
+} t_pxleap_plan;
+
+// the field mask for a list of names. returns the first name it doesn't know in *unknown, or NULL.
+uint32_t pxleap_fields_parse(long argc, t_atom *argv, t_symbol **unknown);
+// Max thread only, uses gensym
+void pxleap_plan_compile(t_pxleap_plan *plan, uint32_t fields);
+
+static inline const float *pxleap_plan_read(const t_pxleap_plan_step *step, const LEAP_HAND *hand)
+{
+    return (const float *)((const char *)hand + step->offset);
+}
+
+#endif
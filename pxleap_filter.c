@@ -0,0 +1,137 @@
+//
+// pxleap_filter
+//
+// Joint smoothing run by the worker thread on every frame before it is published:
+// a One-Euro filter or a constant-velocity Kalman filter over every joint coordinate
+//
+// author: Andrew Benson
+// contact: pixlpa@gmail.com
+//
+
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include "pxleap_filter.h"
+
+#define PXLEAP_TWO_PI 6.28318530717958647692f
+
+// kalman velocity uncertainty of a hand that was just found, (mm/s)^2
+#define PXLEAP_KALMAN_INITIAL_VELOCITY 1e6f
+
+void pxleap_filter_init(t_pxleap_filter *f)
+{
+    memset(f, 0, sizeof(*f));
+    atomic_init(&f->type, PXLEAP_FILTER_NONE);
+    atomic_init(&f->mincutoff, 1.f);
+    atomic_init(&f->beta, 0.01f);
+    atomic_init(&f->dcutoff, 1.f);
+    atomic_init(&f->noise, 2.f);
+    atomic_init(&f->accel, 1000.f);
+    for (int h = 0; h < PXLEAP_MAX_HANDS; h++) f->hands[h].id = -1;
+}
+
+void pxleap_filter_settype(t_pxleap_filter *f, int type)
+{
+    atomic_store_explicit(&f->type, type, memory_order_relaxed);
+}
+
+void pxleap_filter_seteuro(t_pxleap_filter *f, float mincutoff, float beta, float dcutoff)
+{
+    atomic_store_explicit(&f->mincutoff, mincutoff, memory_order_relaxed);
+    atomic_store_explicit(&f->beta, beta, memory_order_relaxed);
+    atomic_store_explicit(&f->dcutoff, dcutoff, memory_order_relaxed);
+}
+
+void pxleap_filter_setkalman(t_pxleap_filter *f, float noise, float accel)
+{
+    atomic_store_explicit(&f->noise, noise, memory_order_relaxed);
+    atomic_store_explicit(&f->accel, accel, memory_order_relaxed);
+}
+
+// the first frame of a hand passes through untouched and seeds the state
+static void pxleap_filter_start(t_pxleap_filter_hand *s, int32_t id, int64_t timestamp, const float *raw, float noise)
+{
+    s->id = id;
+    s->timestamp = timestamp;
+    memcpy(s->value, raw, sizeof(s->value));
+    memset(s->deriv, 0, sizeof(s->deriv));
+    s->p00 = noise * noise;
+    s->p01 = 0.f;
+    s->p11 = PXLEAP_KALMAN_INITIAL_VELOCITY;
+}
+
+static void pxleap_filter_euro(t_pxleap_filter_hand *s, const float *restrict raw, float dt, float mincutoff, float beta, float dcutoff)
+{
+    float *restrict value = s->value;
+    float *restrict deriv = s->deriv;
+    const float te = PXLEAP_TWO_PI * dt;
+    const float ad = te * dcutoff / (te * dcutoff + 1.f);
+    const float rate = 1.f / dt;
+    for (int i = 0; i < PXLEAP_FILTER_WIDTH; i++) {
+        float dx = (raw[i] - value[i]) * rate;
+        float edx = deriv[i] + ad * (dx - deriv[i]);
+        float tc = te * (mincutoff + beta * fabsf(edx));
+        value[i] += tc / (tc + 1.f) * (raw[i] - value[i]);
+        deriv[i] = edx;
+    }
+}
+
+static void pxleap_filter_kalman(t_pxleap_filter_hand *s, const float *restrict raw, float dt, float noise, float accel)
+{
+    float *restrict value = s->value;
+    float *restrict deriv = s->deriv;
+    const float q = accel * accel;
+    float p00, p01, p11, k0, k1;
+    // predict, white noise acceleration
+    p00 = s->p00 + dt * (2.f * s->p01 + dt * s->p11) + q * dt * dt * dt / 3.f;
+    p01 = s->p01 + dt * s->p11 + q * dt * dt / 2.f;
+    p11 = s->p11 + q * dt;
+    // the gain only depends on the covariance, so it's worked out once for the whole hand
+    k0 = p00 / (p00 + noise * noise);
+    k1 = p01 / (p00 + noise * noise);
+    for (int i = 0; i < PXLEAP_FILTER_WIDTH; i++) {
+        float predicted = value[i] + deriv[i] * dt;
+        float err = raw[i] - predicted;
+        value[i] = predicted + k0 * err;
+        deriv[i] += k1 * err;
+    }
+    s->p11 = p11 - k1 * p01;
+    s->p01 = (1.f - k0) * p01;
+    s->p00 = (1.f - k0) * p00;
+}
+
+void pxleap_filter_apply(t_pxleap_filter *f, t_pxleap_frame *frame)
+{
+    int type = atomic_load_explicit(&f->type, memory_order_relaxed);
+    bool present[PXLEAP_MAX_HANDS] = { false, false };
+    float noise;
+    if (type != f->active) {
+        for (int h = 0; h < PXLEAP_MAX_HANDS; h++) f->hands[h].id = -1;
+        f->active = type;
+    }
+    if (type == PXLEAP_FILTER_NONE) return;
+    noise = atomic_load_explicit(&f->noise, memory_order_relaxed);
+    for (uint32_t h = 0; h < frame->nHands; h++) {
+        LEAP_HAND *hand = &frame->hands[h];
+        int slot = (hand->type == eLeapHandType_Left) ? 0 : 1;
+        t_pxleap_filter_hand *s = &f->hands[slot];
+        float dt = (float)(frame->timestamp - s->timestamp) * 1e-6f;
+        present[slot] = true;
+        pxleap_hand_joints(hand, f->raw);
+        // a new hand, or time went backwards because a replay looped
+        if (s->id != (int32_t)hand->id || dt <= 0.f) {
+            pxleap_filter_start(s, (int32_t)hand->id, frame->timestamp, f->raw, noise);
+            continue;
+        }
+        if (type == PXLEAP_FILTER_EURO)
+            pxleap_filter_euro(s, f->raw, dt, atomic_load_explicit(&f->mincutoff, memory_order_relaxed),
+                               atomic_load_explicit(&f->beta, memory_order_relaxed),
+                               atomic_load_explicit(&f->dcutoff, memory_order_relaxed));
+        else pxleap_filter_kalman(s, f->raw, dt, noise, atomic_load_explicit(&f->accel, memory_order_relaxed));
+        s->timestamp = frame->timestamp;
+        pxleap_hand_setjoints(hand, s->value);
+    }
+    for (int h = 0; h < PXLEAP_MAX_HANDS; h++) {
+        if (!present[h]) f->hands[h].id = -1;
+    }
+}
@@ -0,0 +1,63 @@
+//
+// pxleap_filter
+//
+// Joint smoothing run by the worker thread on every frame before it is published:
+// a One-Euro filter or a constant-velocity Kalman filter over every joint coordinate
+//
+// author: Andrew Benson
+// contact: pixlpa@gmail.com
+//
+
+#ifndef PXLEAP_FILTER_H
+#define PXLEAP_FILTER_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include "pxleap_frame.h"
+
+enum {
+    PXLEAP_FILTER_NONE = 0,
+    PXLEAP_FILTER_EURO,
+    PXLEAP_FILTER_KALMAN
+};
+
+// coordinates filtered per hand
+#define PXLEAP_FILTER_WIDTH (PXLEAP_JOINT_COUNT * 3)
+
+// state for one hand slot. every coordinate is filtered on its own, so the state is a set of
+// flat float arrays and one pass over them is a plain loop the compiler can vectorize
+typedef struct _pxleap_filter_hand
+{
+    int32_t id;                             // hand being tracked in this slot, -1 when empty
+    int64_t timestamp;                      // of the last filtered frame
+    float value[PXLEAP_FILTER_WIDTH];       // filtered position
+    float deriv[PXLEAP_FILTER_WIDTH];       // euro: smoothed speed, kalman: estimated velocity
+    float p00, p01, p11;                    // kalman covariance, the same for every coordinate of the hand
+} t_pxleap_filter_hand;
+
+typedef struct _pxleap_filter
+{
+    // written from the Max thread, read by the worker once per frame
+    atomic_int type;
+    _Atomic float mincutoff;                // euro: cutoff at rest, Hz
+    _Atomic float beta;                     // euro: cutoff increase per mm/s of speed
+    _Atomic float dcutoff;                  // euro: cutoff of the speed estimate, Hz
+    _Atomic float noise;                    // kalman: measurement noise, mm
+    _Atomic float accel;                    // kalman: expected acceleration, mm/s^2
+
+    // owned by the worker
+    int active;                             // type the state below was built for
+    t_pxleap_filter_hand hands[PXLEAP_MAX_HANDS];   // slot 0 is the left hand, 1 the right
+    float raw[PXLEAP_FILTER_WIDTH];
+} t_pxleap_filter;
+
+void pxleap_filter_init(t_pxleap_filter *f);
+// safe to call from any thread while the worker is filtering
+void pxleap_filter_settype(t_pxleap_filter *f, int type);
+void pxleap_filter_seteuro(t_pxleap_filter *f, float mincutoff, float beta, float dcutoff);
+void pxleap_filter_setkalman(t_pxleap_filter *f, float noise, float accel);
+// worker side: smooths the joints of every hand in the frame in place. hands start fresh
+// when their id changes, and the filters reset when the type changes.
+void pxleap_filter_apply(t_pxleap_filter *f, t_pxleap_frame *frame);
+
+#endif
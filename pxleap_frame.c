@@ -0,0 +1,189 @@
+//
+// pxleap_frame
+//
+// Fixed-size tracking frame storage shared by the px.ultraleap objects,
+// and the triple buffer used to hand frames from the worker thread to the Max thread
+//
+// author: Andrew Benson
+// contact: pixlpa@gmail.com
+//
+
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include "pxleap_frame.h"
+
+void pxleap_frame_copy(t_pxleap_frame *dst, const LEAP_TRACKING_EVENT *src)
+{
+    uint32_t nhands = src->nHands;
+    if (nhands > PXLEAP_MAX_HANDS) nhands = PXLEAP_MAX_HANDS;
+    dst->frame_id = src->info.frame_id;
+    dst->timestamp = src->info.timestamp;
+    dst->tracking_frame_id = src->tracking_frame_id;
+    dst->framerate = src->framerate;
+    dst->nHands = nhands;
+    if (nhands) memcpy(dst->hands, src->pHands, nhands * sizeof(LEAP_HAND));
+    dst->featuregroups = 0;
+}
+
+void pxleap_hand_joints(const LEAP_HAND *hand, float *xyz)
+{
+    memcpy(xyz + PXLEAP_JOINT_PALM * 3, hand->palm.position.v, 3 * sizeof(float));
+    memcpy(xyz + PXLEAP_JOINT_WRIST * 3, hand->arm.next_joint.v, 3 * sizeof(float));
+    memcpy(xyz + PXLEAP_JOINT_ELBOW * 3, hand->arm.prev_joint.v, 3 * sizeof(float));
+    for (int f = 0; f < 5; f++) {
+        float *joint = xyz + PXLEAP_JOINT_FINGER(f) * 3;
+        memcpy(joint, hand->digits[f].bones[0].prev_joint.v, 3 * sizeof(float));
+        for (int b = 0; b < 4; b++) memcpy(joint + (b + 1) * 3, hand->digits[f].bones[b].next_joint.v, 3 * sizeof(float));
+    }
+}
+
+void pxleap_hand_setjoints(LEAP_HAND *hand, const float *xyz)
+{
+    memcpy(hand->palm.position.v, xyz + PXLEAP_JOINT_PALM * 3, 3 * sizeof(float));
+    memcpy(hand->arm.next_joint.v, xyz + PXLEAP_JOINT_WRIST * 3, 3 * sizeof(float));
+    memcpy(hand->arm.prev_joint.v, xyz + PXLEAP_JOINT_ELBOW * 3, 3 * sizeof(float));
+    for (int f = 0; f < 5; f++) {
+        const float *joint = xyz + PXLEAP_JOINT_FINGER(f) * 3;
+        for (int b = 0; b < 4; b++) {
+            memcpy(hand->digits[f].bones[b].prev_joint.v, joint + b * 3, 3 * sizeof(float));
+            memcpy(hand->digits[f].bones[b].next_joint.v, joint + (b + 1) * 3, 3 * sizeof(float));
+        }
+    }
+}
+
+static void pxleap_lerp3(float *dst, const float *a, const float *b, float t)
+{
+    for (int i = 0; i < 3; i++) dst[i] = a[i] + (b[i] - a[i]) * t;
+}
+
+// normalized lerp, close enough to slerp for the small steps between frames
+static void pxleap_nlerp4(float *dst, const float *a, const float *b, float t)
+{
+    float dot = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+    float sign = dot < 0.f ? -1.f : 1.f;
+    float len = 0.f;
+    for (int i = 0; i < 4; i++) {
+        dst[i] = a[i] + (sign * b[i] - a[i]) * t;
+        len += dst[i] * dst[i];
+    }
+    if (len > 0.f) {
+        len = 1.f / sqrtf(len);
+        for (int i = 0; i < 4; i++) dst[i] *= len;
+    }
+}
+
+static void pxleap_bone_lerp(LEAP_BONE *dst, const LEAP_BONE *a, const LEAP_BONE *b, float t)
+{
+    pxleap_lerp3(dst->prev_joint.v, a->prev_joint.v, b->prev_joint.v, t);
+    pxleap_lerp3(dst->next_joint.v, a->next_joint.v, b->next_joint.v, t);
+    pxleap_nlerp4(dst->rotation.v, a->rotation.v, b->rotation.v, t);
+}
+
+static float pxleap_clamp01(float v)
+{
+    return v < 0.f ? 0.f : (v > 1.f ? 1.f : v);
+}
+
+void pxleap_hand_lerp(LEAP_HAND *dst, const LEAP_HAND *a, const LEAP_HAND *b, float t)
+{
+    *dst = *b;
+    dst->pinch_distance = a->pinch_distance + (b->pinch_distance - a->pinch_distance) * t;
+    dst->grab_angle = a->grab_angle + (b->grab_angle - a->grab_angle) * t;
+    dst->pinch_strength = pxleap_clamp01(a->pinch_strength + (b->pinch_strength - a->pinch_strength) * t);
+    dst->grab_strength = pxleap_clamp01(a->grab_strength + (b->grab_strength - a->grab_strength) * t);
+    pxleap_lerp3(dst->palm.position.v, a->palm.position.v, b->palm.position.v, t);
+    pxleap_lerp3(dst->palm.stabilized_position.v, a->palm.stabilized_position.v, b->palm.stabilized_position.v, t);
+    pxleap_lerp3(dst->palm.normal.v, a->palm.normal.v, b->palm.normal.v, t);
+    pxleap_lerp3(dst->palm.direction.v, a->palm.direction.v, b->palm.direction.v, t);
+    pxleap_nlerp4(dst->palm.orientation.v, a->palm.orientation.v, b->palm.orientation.v, t);
+    for (int f = 0; f < 5; f++) {
+        for (int j = 0; j < 4; j++) pxleap_bone_lerp(&dst->digits[f].bones[j], &a->digits[f].bones[j], &b->digits[f].bones[j], t);
+    }
+    pxleap_bone_lerp(&dst->arm, &a->arm, &b->arm, t);
+}
+
+void pxleap_frame_lerp(t_pxleap_frame *dst, const t_pxleap_frame *a, const t_pxleap_frame *b, int64_t timestamp)
+{
+    int64_t span = b->timestamp - a->timestamp;
+    float t = 1.f;
+    if (timestamp > b->timestamp + PXLEAP_MAX_EXTRAPOLATION_US) timestamp = b->timestamp + PXLEAP_MAX_EXTRAPOLATION_US;
+    if (timestamp < a->timestamp) timestamp = a->timestamp;
+    if (span > 0) t = (float)((double)(timestamp - a->timestamp) / (double)span);
+    dst->frame_id = b->frame_id;
+    dst->timestamp = timestamp;
+    dst->tracking_frame_id = b->tracking_frame_id;
+    dst->framerate = b->framerate;
+    dst->nHands = b->nHands;
+    dst->featuregroups = b->featuregroups;
+    if (b->featuregroups) memcpy(dst->features, b->features, sizeof(dst->features));
+    for (uint32_t h = 0; h < b->nHands; h++) {
+        const LEAP_HAND *match = NULL;
+        for (uint32_t k = 0; k < a->nHands; k++) {
+            if (a->hands[k].id == b->hands[h].id) match = &a->hands[k];
+        }
+        if (match) pxleap_hand_lerp(&dst->hands[h], match, &b->hands[h], t);
+        else dst->hands[h] = b->hands[h];
+    }
+}
+
+void pxleap_predictor_push(t_pxleap_predictor *p, const t_pxleap_frame *frame)
+{
+    if (p->count && p->frames[1].tracking_frame_id == frame->tracking_frame_id) return;
+    p->frames[0] = p->frames[1];
+    p->frames[1] = *frame;
+    if (p->count < 2) p->count++;
+}
+
+const t_pxleap_frame *pxleap_predictor_at(t_pxleap_predictor *p, int64_t timestamp)
+{
+    if (!p->count) return NULL;
+    if (p->count < 2) return &p->frames[1];
+    pxleap_frame_lerp(&p->predicted, &p->frames[0], &p->frames[1], timestamp);
+    return &p->predicted;
+}
+
+int64_t pxleap_now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+int64_t pxleap_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void pxleap_triplebuf_init(t_pxleap_triplebuf *tb)
+{
+    memset(tb->slots, 0, sizeof(tb->slots));
+    tb->back = 0;
+    atomic_store_explicit(&tb->middle, 1, memory_order_relaxed);
+    tb->front = 2;
+    tb->hasframe = 0;
+}
+
+t_pxleap_frame *pxleap_triplebuf_back(t_pxleap_triplebuf *tb)
+{
+    return &tb->slots[tb->back];
+}
+
+void pxleap_triplebuf_publish(t_pxleap_triplebuf *tb)
+{
+    // release makes the slot contents visible before the index, acquire hands us back a slot the reader is done with
+    uint32_t prev = atomic_exchange_explicit(&tb->middle, tb->back | PXLEAP_TRIPLEBUF_FRESH, memory_order_acq_rel);
+    tb->back = prev & PXLEAP_TRIPLEBUF_INDEX;
+}
+
+const t_pxleap_frame *pxleap_triplebuf_read(t_pxleap_triplebuf *tb)
+{
+    if (atomic_load_explicit(&tb->middle, memory_order_relaxed) & PXLEAP_TRIPLEBUF_FRESH) {
+        uint32_t prev = atomic_exchange_explicit(&tb->middle, tb->front, memory_order_acq_rel);
+        tb->front = prev & PXLEAP_TRIPLEBUF_INDEX;
+        tb->hasframe = 1;
+    }
+    return tb->hasframe ? &tb->slots[tb->front] : NULL;
+}
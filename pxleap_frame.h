@@ -0,0 +1,116 @@
+//
+// pxleap_frame
+//
+// Fixed-size tracking frame storage shared by the px.ultraleap objects,
+// and the triple buffer used to hand frames from the worker thread to the Max thread
+//
+// author: Andrew Benson
+// contact: pixlpa@gmail.com
+//
+
+#ifndef PXLEAP_FRAME_H
+#define PXLEAP_FRAME_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include "LeapC.h"
+
+// LeapC never reports more than two hands per device
+#define PXLEAP_MAX_HANDS 2
+
+// per-hand values the worker thread derives from the frame, see pxleap_features.h
+typedef struct _pxleap_features
+{
+    float palm_velocity[3];                 // mm/s
+    float tip_velocity[5][3];               // mm/s, thumb to pinky
+    float pinch_distance;                   // mm between thumb and index tips
+    float pinch_strength;                   // 0-1
+    float grab_strength;                    // 0-1
+    float grab_angle;                       // radians, 0 for a flat hand to pi for a fist
+    float curl[5];                          // degrees each finger bends from base to tip
+} t_pxleap_features;
+
+// a deep copy of a LEAP_TRACKING_EVENT, hands are stored inline instead of behind pHands
+typedef struct _pxleap_frame
+{
+    int64_t frame_id;                       // info.frame_id
+    int64_t timestamp;                      // info.timestamp, leap clock in microseconds
+    int64_t tracking_frame_id;
+    float framerate;
+    uint32_t nHands;
+    LEAP_HAND hands[PXLEAP_MAX_HANDS];
+    uint32_t featuregroups;                 // PXLEAP_FEATURE_* groups filled in below, 0 until the worker computes them
+    t_pxleap_features features[PXLEAP_MAX_HANDS];   // one per entry in hands
+    int64_t published;                      // pxleap_now_ns() when the worker handed the frame to the Max thread
+} t_pxleap_frame;
+
+// copies the event and the hand array it points to, extra hands are dropped
+void pxleap_frame_copy(t_pxleap_frame *dst, const LEAP_TRACKING_EVENT *src);
+
+// joint layout shared by the whole-skeleton outputs: palm, wrist, elbow, then for each finger
+// from thumb to pinky the base of the metacarpal followed by the end of each of its four bones
+#define PXLEAP_JOINT_PALM 0
+#define PXLEAP_JOINT_WRIST 1
+#define PXLEAP_JOINT_ELBOW 2
+#define PXLEAP_JOINT_FINGER(f) (3 + (f) * 5)
+#define PXLEAP_JOINT_COUNT 28
+
+// writes PXLEAP_JOINT_COUNT xyz triples
+void pxleap_hand_joints(const LEAP_HAND *hand, float *xyz);
+// the reverse, moves the joints of the hand to PXLEAP_JOINT_COUNT xyz triples.
+// each bone starts where the previous one ends, directions and orientations are left alone.
+void pxleap_hand_setjoints(LEAP_HAND *hand, const float *xyz);
+
+// blends every joint, direction and orientation of two hands, t = 0 gives a and t = 1 gives b.
+// ids, flags and widths come from b.
+void pxleap_hand_lerp(LEAP_HAND *dst, const LEAP_HAND *a, const LEAP_HAND *b, float t);
+
+// linear prediction further than this past the newest frame is clamped
+#define PXLEAP_MAX_EXTRAPOLATION_US 100000
+
+// the pose at a leap clock time, interpolated between frames a and b (a older) or extrapolated from them.
+// hands are matched by id, hands only in b are copied as they are. features come from b.
+void pxleap_frame_lerp(t_pxleap_frame *dst, const t_pxleap_frame *a, const t_pxleap_frame *b, int64_t timestamp);
+
+// keeps the two most recent distinct frames seen by one thread and predicts poses from them
+typedef struct _pxleap_predictor
+{
+    t_pxleap_frame frames[2];               // [1] is the newest
+    uint32_t count;
+    t_pxleap_frame predicted;
+} t_pxleap_predictor;
+
+// repeats of the newest frame are ignored
+void pxleap_predictor_push(t_pxleap_predictor *p, const t_pxleap_frame *frame);
+// NULL until a frame has been pushed, the newest frame until there are two
+const t_pxleap_frame *pxleap_predictor_at(t_pxleap_predictor *p, int64_t timestamp);
+
+// monotonic wall clock in microseconds
+int64_t pxleap_now_us(void);
+// and in nanoseconds, for timing single frames and bangs
+int64_t pxleap_now_ns(void);
+
+// single writer / single reader triple buffer
+// the writer fills the back slot and swaps it with the middle one, the reader swaps the
+// middle slot with its front slot when a new frame is waiting. neither side ever waits on the other.
+typedef struct _pxleap_triplebuf
+{
+    t_pxleap_frame slots[3];
+    _Atomic uint32_t middle;                // slot index of the latest published frame | PXLEAP_TRIPLEBUF_FRESH
+    uint32_t back;                          // owned by the writer
+    uint32_t front;                         // owned by the reader
+    uint32_t hasframe;                      // reader has swapped in at least one frame
+} t_pxleap_triplebuf;
+
+#define PXLEAP_TRIPLEBUF_FRESH 0x4u
+#define PXLEAP_TRIPLEBUF_INDEX 0x3u
+
+void pxleap_triplebuf_init(t_pxleap_triplebuf *tb);
+// writer side: the slot to fill, then publish it
+t_pxleap_frame *pxleap_triplebuf_back(t_pxleap_triplebuf *tb);
+void pxleap_triplebuf_publish(t_pxleap_triplebuf *tb);
+// reader side: the most recent complete frame, or NULL before the first publish.
+// the returned frame stays valid and unchanged until the next call.
+const t_pxleap_frame *pxleap_triplebuf_read(t_pxleap_triplebuf *tb);
+
+#endif
@@ -0,0 +1,116 @@
+//
+// pxleap_history
+//
+// A fixed number of the most recent frames, kept by the worker thread so the Max thread
+// can look back over them without copying frames into the patch
+//
+// author: Andrew Benson
+// contact: pixlpa@gmail.com
+//
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include "pxleap_history.h"
+
+#define PXLEAP_HISTORY_WRITING UINT64_MAX
+
+void pxleap_history_init(t_pxleap_history *h)
+{
+    h->frames = NULL;
+    h->stamps = NULL;
+    h->capacity = 0;
+    atomic_init(&h->count, 0);
+}
+
+void pxleap_history_free(t_pxleap_history *h)
+{
+    free(h->frames);
+    free((void *)h->stamps);
+    pxleap_history_init(h);
+}
+
+int pxleap_history_resize(t_pxleap_history *h, uint32_t capacity)
+{
+    pxleap_history_free(h);
+    if (!capacity) return 1;
+    if (capacity > PXLEAP_HISTORY_MAX) capacity = PXLEAP_HISTORY_MAX;
+    h->frames = (t_pxleap_frame *)malloc(capacity * sizeof(t_pxleap_frame));
+    h->stamps = (_Atomic uint64_t *)malloc(capacity * sizeof(*h->stamps));
+    if (!h->frames || !h->stamps) {
+        pxleap_history_free(h);
+        return 0;
+    }
+    for (uint32_t i = 0; i < capacity; i++) atomic_init(&h->stamps[i], PXLEAP_HISTORY_WRITING);
+    h->capacity = capacity;
+    return 1;
+}
+
+void pxleap_history_push(t_pxleap_history *h, const t_pxleap_frame *frame)
+{
+    uint64_t n;
+    uint32_t slot;
+    if (!h->capacity) return;
+    n = atomic_load_explicit(&h->count, memory_order_relaxed);
+    slot = (uint32_t)(n % h->capacity);
+    // readers that catch the slot mid-copy see the marker and give up on it
+    atomic_store_explicit(&h->stamps[slot], PXLEAP_HISTORY_WRITING, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    h->frames[slot] = *frame;
+    atomic_store_explicit(&h->stamps[slot], n, memory_order_release);
+    atomic_store_explicit(&h->count, n + 1, memory_order_release);
+}
+
+void pxleap_history_clear(t_pxleap_history *h)
+{
+    for (uint32_t i = 0; i < h->capacity; i++)
+        atomic_store_explicit(&h->stamps[i], PXLEAP_HISTORY_WRITING, memory_order_release);
+}
+
+void pxleap_history_range(t_pxleap_history *h, uint64_t *first, uint64_t *end)
+{
+    *end = atomic_load_explicit(&h->count, memory_order_acquire);
+    *first = *end > h->capacity ? *end - h->capacity : 0;
+}
+
+// copies size bytes at offset in frame n, checking the slot still holds it afterwards
+static int pxleap_history_read(t_pxleap_history *h, uint64_t n, size_t offset, size_t size, void *dst)
+{
+    uint32_t slot;
+    if (!h->capacity) return 0;
+    slot = (uint32_t)(n % h->capacity);
+    if (atomic_load_explicit(&h->stamps[slot], memory_order_acquire) != n) return 0;
+    memcpy(dst, (const char *)&h->frames[slot] + offset, size);
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&h->stamps[slot], memory_order_relaxed) == n;
+}
+
+int pxleap_history_get(t_pxleap_history *h, uint64_t n, t_pxleap_frame *dst)
+{
+    return pxleap_history_read(h, n, 0, sizeof(t_pxleap_frame), dst);
+}
+
+// frames are pushed in time order, so both keys only ever grow along the ring
+static uint64_t pxleap_history_find(t_pxleap_history *h, size_t offset, int64_t key)
+{
+    uint64_t lo, hi;
+    pxleap_history_range(h, &lo, &hi);
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        int64_t v;
+        // a frame overwritten under us is older than anything still held
+        if (!pxleap_history_read(h, mid, offset, sizeof(v), &v) || v < key) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+uint64_t pxleap_history_findtime(t_pxleap_history *h, int64_t timestamp)
+{
+    return pxleap_history_find(h, offsetof(t_pxleap_frame, timestamp), timestamp);
+}
+
+uint64_t pxleap_history_findid(t_pxleap_history *h, int64_t id)
+{
+    return pxleap_history_find(h, offsetof(t_pxleap_frame, tracking_frame_id), id);
+}
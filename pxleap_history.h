@@ -0,0 +1,51 @@
+//
+// pxleap_history
+//
+// A fixed number of the most recent frames, kept by the worker thread so the Max thread
+// can look back over them without copying frames into the patch
+//
+// author: Andrew Benson
+// contact: pixlpa@gmail.com
+//
+
+#ifndef PXLEAP_HISTORY_H
+#define PXLEAP_HISTORY_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include "pxleap_frame.h"
+
+// about 10 seconds at 120 Hz
+#define PXLEAP_HISTORY_MAX 1200
+
+// frames are numbered in the order they were pushed, starting from 0. frame n lives in slot
+// n % capacity until frame n + capacity overwrites it.
+typedef struct _pxleap_history
+{
+    t_pxleap_frame *frames;
+    _Atomic uint64_t *stamps;               // per slot: number of the frame it holds, or UINT64_MAX while it's being written
+    uint32_t capacity;
+    _Atomic uint64_t count;                 // frames pushed so far
+} t_pxleap_history;
+
+void pxleap_history_init(t_pxleap_history *h);
+// sets the depth and forgets every frame. only call while nothing is pushing, 0 frees the ring.
+// returns 0 if the memory can't be had, leaving the history empty.
+int pxleap_history_resize(t_pxleap_history *h, uint32_t capacity);
+void pxleap_history_free(t_pxleap_history *h);
+
+// worker side
+void pxleap_history_push(t_pxleap_history *h, const t_pxleap_frame *frame);
+// drops every frame held, for when timestamps start over (a replay looping, or a new source).
+// frame numbers keep counting, the dropped ones just can't be read anymore.
+void pxleap_history_clear(t_pxleap_history *h);
+
+// reader side, safe while the worker pushes. the oldest frame still held and one past the newest.
+void pxleap_history_range(t_pxleap_history *h, uint64_t *first, uint64_t *end);
+// copies frame n into dst. returns 0 if it was overwritten before or during the copy.
+int pxleap_history_get(t_pxleap_history *h, uint64_t n, t_pxleap_frame *dst);
+// the first frame held with a timestamp (or tracking frame id) at or past the given one, end if there is none
+uint64_t pxleap_history_findtime(t_pxleap_history *h, int64_t timestamp);
+uint64_t pxleap_history_findid(t_pxleap_history *h, int64_t id);
+
+#endif
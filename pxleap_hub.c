@@ -0,0 +1,245 @@
+//
+// pxleap_hub
+//
+// One Leap connection and polling thread shared by every px.ultraleap object in Max.
+// The first connect creates it, objects subscribe to the frames of one device, and the last
+// object to let go of it closes the connection.
+//
+// author: Andrew Benson
+// contact: pixlpa@gmail.com
+//
+
+#include <string.h>
+#include <sched.h>
+#include "pxleap_hub.h"
+
+// px.ultraleap and px.dict.ultraleap are separate externals with their own copy of this file,
+// so the hub is found through a symbol rather than a static to be shared between them
+#define PXLEAP_HUB_SYMBOL "__pxleap_hub"
+
+static int pxleap_hub_slot(t_pxleap_hub *hub, uint32_t id)
+{
+    for (int i = 0; i < PXLEAP_HUB_MAX_DEVICES; i++) {
+        if (id && hub->device_ids[i] == id) return i;
+    }
+    return -1;
+}
+
+static int pxleap_hub_firstslot(t_pxleap_hub *hub)
+{
+    for (int i = 0; i < PXLEAP_HUB_MAX_DEVICES; i++) {
+        if (hub->device_ids[i]) return i;
+    }
+    return -1;
+}
+
+// new trackers take the first free slot, so the others keep their numbers
+static void pxleap_hub_adddevice(t_pxleap_hub *hub, LEAP_DEVICE_REF ref)
+{
+    LEAP_DEVICE device;
+    int slot;
+    if (pxleap_hub_slot(hub, ref.id) >= 0) return;
+    if (LeapOpenDevice(ref, &device) != eLeapRS_Success) return;
+    systhread_mutex_lock(hub->mutex);
+    for (slot = 0; slot < PXLEAP_HUB_MAX_DEVICES && hub->device_ids[slot]; slot++);
+    if (slot < PXLEAP_HUB_MAX_DEVICES) {
+        hub->device_ids[slot] = ref.id;
+        hub->devices[slot] = device;
+    }
+    systhread_mutex_unlock(hub->mutex);
+    if (slot < PXLEAP_HUB_MAX_DEVICES) LeapSubscribeEvents(hub->connection, device);
+    else LeapCloseDevice(device);
+}
+
+static void pxleap_hub_removedevice(t_pxleap_hub *hub, uint32_t id)
+{
+    LEAP_DEVICE device;
+    int slot;
+    systhread_mutex_lock(hub->mutex);
+    slot = pxleap_hub_slot(hub, id);
+    if (slot < 0) {
+        systhread_mutex_unlock(hub->mutex);
+        return;
+    }
+    device = hub->devices[slot];
+    hub->device_ids[slot] = 0;
+    hub->devices[slot] = NULL;
+    systhread_mutex_unlock(hub->mutex);
+    LeapUnsubscribeEvents(hub->connection, device);
+    LeapCloseDevice(device);
+}
+
+static void pxleap_hub_deliver(t_pxleap_hub *hub, uint32_t device_id, int64_t clockoffset)
+{
+    // the subscribers of this frame are chained through themselves, so picking them out never
+    // allocates and every one of them gets it
+    t_pxleap_hub_subscriber *targets = NULL;
+    t_pxleap_hub_subscriber **last = &targets;
+    systhread_mutex_lock(hub->mutex);
+    int slot = pxleap_hub_slot(hub, device_id);
+    int first = pxleap_hub_firstslot(hub);
+    for (t_pxleap_hub_subscriber *s = hub->subscribers; s; s = s->next) {
+        int want = s->device ? (int)s->device - 1 : first;
+        // frames from a device the hub hasn't been told about go to whoever wants the first one
+        if (slot == want || (slot < 0 && s->device <= 1)) {
+            // marked while still listed, so an unsubscribe after this knows to wait for it
+            atomic_store_explicit(&s->busy, 1, memory_order_relaxed);
+            *last = s;
+            last = &s->nexttarget;
+        }
+    }
+    *last = NULL;
+    systhread_mutex_unlock(hub->mutex);
+    // a slow subscriber no longer holds up subscribing, unsubscribing or device changes
+    for (t_pxleap_hub_subscriber *s = targets, *next; s; s = next) {
+        // read before busy is cleared, the subscriber can be freed straight after
+        next = s->nexttarget;
+        s->callback(s->owner, &hub->frame, clockoffset);
+        atomic_store_explicit(&s->busy, 0, memory_order_release);
+    }
+}
+
+static void *pxleap_hub_tick(t_pxleap_hub *hub)
+{
+    if (hub->interactive) pxleap_thread_setinteractive();
+    while (!atomic_load_explicit(&hub->cancel, memory_order_acquire)) {
+        LEAP_CONNECTION_MESSAGE msg;
+        eLeapRS result = LeapPollConnection(hub->connection, PXLEAP_POLL_TIMEOUT_MS, &msg);
+        if (result == eLeapRS_Success) {
+            switch (msg.type) {
+                case eLeapEventType_Tracking: {
+                    // keep the rebaser in step with the Max clock, subscribers get the offset with the frame
+                    int64_t usertime = (int64_t)(systimer_gettime() * 1000.);
+                    int64_t leaptime = usertime;
+                    LeapUpdateRebase(hub->rebaser, usertime, LeapGetNow());
+                    LeapRebaseClock(hub->rebaser, usertime, &leaptime);
+                    // one deep copy, every subscriber reads the same frame
+                    pxleap_frame_copy(&hub->frame, msg.tracking_event);
+                    pxleap_hub_deliver(hub, msg.device_id, leaptime - usertime);
+                    break;
+                }
+                case eLeapEventType_Device:
+                    pxleap_hub_adddevice(hub, msg.device_event->device);
+                    break;
+                case eLeapEventType_DeviceLost:
+                    pxleap_hub_removedevice(hub, msg.device_event->device.id);
+                    break;
+                default:
+                    break;
+            }
+        }
+        // errors other than a timeout come back straight away, so back off instead of spinning on them
+        else if (result != eLeapRS_Timeout) {
+            atomic_fetch_add_explicit(&hub->pollfailures, 1, memory_order_relaxed);
+            pxleap_wake_wait(&hub->wake, PXLEAP_RETRY_US);
+        }
+    }
+    systhread_exit(0);
+    return NULL;
+}
+
+t_pxleap_hub *pxleap_hub_acquire(int interactive)
+{
+    t_symbol *sym = gensym(PXLEAP_HUB_SYMBOL);
+    t_pxleap_hub *hub = (t_pxleap_hub *)sym->s_thing;
+    LEAP_CONNECTION_CONFIG config;
+
+    if (hub) {
+        if (hub->version != PXLEAP_HUB_VERSION) {
+            object_error(NULL, "px.ultraleap objects from different versions can't share a Leap connection");
+            return NULL;
+        }
+        hub->refcount++;
+        return hub;
+    }
+
+    hub = (t_pxleap_hub *)sysmem_newptrclear(sizeof(t_pxleap_hub));
+    if (!hub) return NULL;
+    memset(&config, 0, sizeof(config));
+    config.size = sizeof(config);
+    config.flags = eLeapConnectionConfig_MultiDeviceAware;
+    if (LeapCreateConnection(&config, &hub->connection) != eLeapRS_Success) {
+        sysmem_freeptr(hub);
+        return NULL;
+    }
+    if (LeapOpenConnection(hub->connection) != eLeapRS_Success) {
+        LeapDestroyConnection(hub->connection);
+        sysmem_freeptr(hub);
+        return NULL;
+    }
+    hub->version = PXLEAP_HUB_VERSION;
+    hub->refcount = 1;
+    hub->interactive = interactive;
+    LeapCreateClockRebaser(&hub->rebaser);
+    pxleap_wake_init(&hub->wake);
+    systhread_mutex_new(&hub->mutex, 0);
+    atomic_init(&hub->cancel, 0);
+    atomic_init(&hub->pollfailures, 0);
+    systhread_create((method)pxleap_hub_tick, hub, 0, 0, 0, &hub->thread);
+    sym->s_thing = (t_object *)hub;
+    return hub;
+}
+
+void pxleap_hub_release(t_pxleap_hub *hub)
+{
+    unsigned int ret;
+    if (!hub || --hub->refcount > 0) return;
+    gensym(PXLEAP_HUB_SYMBOL)->s_thing = NULL;
+    atomic_store_explicit(&hub->cancel, 1, memory_order_release);
+    pxleap_wake_signal(&hub->wake);
+    systhread_join(hub->thread, &ret);
+    for (int i = 0; i < PXLEAP_HUB_MAX_DEVICES; i++) {
+        if (!hub->device_ids[i]) continue;
+        LeapUnsubscribeEvents(hub->connection, hub->devices[i]);
+        LeapCloseDevice(hub->devices[i]);
+    }
+    LeapCloseConnection(hub->connection);
+    LeapDestroyConnection(hub->connection);
+    LeapDestroyClockRebaser(hub->rebaser);
+    systhread_mutex_free(hub->mutex);
+    pxleap_wake_free(&hub->wake);
+    sysmem_freeptr(hub);
+}
+
+void pxleap_hub_subscribe(t_pxleap_hub *hub, t_pxleap_hub_subscriber *s)
+{
+    systhread_mutex_lock(hub->mutex);
+    if (!s->subscribed) {
+        s->next = hub->subscribers;
+        hub->subscribers = s;
+        s->subscribed = 1;
+    }
+    systhread_mutex_unlock(hub->mutex);
+}
+
+void pxleap_hub_unsubscribe(t_pxleap_hub *hub, t_pxleap_hub_subscriber *s)
+{
+    systhread_mutex_lock(hub->mutex);
+    for (t_pxleap_hub_subscriber **p = &hub->subscribers; *p; p = &(*p)->next) {
+        if (*p == s) {
+            *p = s->next;
+            break;
+        }
+    }
+    s->next = NULL;
+    s->subscribed = 0;
+    systhread_mutex_unlock(hub->mutex);
+    // off the list, so no new frame can be on its way. one picked out before is finished here.
+    while (atomic_load_explicit(&s->busy, memory_order_acquire)) sched_yield();
+}
+
+void pxleap_hub_setdevice(t_pxleap_hub *hub, t_pxleap_hub_subscriber *s, uint32_t device)
+{
+    if (!hub) {
+        s->device = device;
+        return;
+    }
+    systhread_mutex_lock(hub->mutex);
+    s->device = device;
+    systhread_mutex_unlock(hub->mutex);
+}
+
+uint64_t pxleap_hub_pollfailures(t_pxleap_hub *hub)
+{
+    return hub ? atomic_load_explicit(&hub->pollfailures, memory_order_relaxed) : 0;
+}
@@ -0,0 +1,81 @@
+//
+// pxleap_hub
+//
+// One Leap connection and polling thread shared by every px.ultraleap object in Max.
+// The first connect creates it, objects subscribe to the frames of one device, and the last
+// object to let go of it closes the connection.
+//
+// author: Andrew Benson
+// contact: pixlpa@gmail.com
+//
+
+#ifndef PXLEAP_HUB_H
+#define PXLEAP_HUB_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include "ext.h"
+#include "ext_systhread.h"
+#include "LeapC.h"
+#include "pxleap_frame.h"
+#include "pxleap_thread.h"
+
+// bumped whenever t_pxleap_hub changes, each external carries its own copy of this code
+#define PXLEAP_HUB_VERSION 4
+
+#define PXLEAP_HUB_MAX_DEVICES 8
+
+// called on the hub thread for every tracking frame of the subscribed device. the frame is
+// only valid for the duration of the call. clockoffset is the leap clock minus Max system time in microseconds.
+typedef void (*t_pxleap_hub_callback)(void *owner, const t_pxleap_frame *frame, int64_t clockoffset);
+
+typedef struct _pxleap_hub_subscriber
+{
+    void *owner;
+    t_pxleap_hub_callback callback;
+    uint32_t device;                        // 0 for the first tracker attached, n for the nth
+    int subscribed;
+    atomic_int busy;                        // set under the hub's mutex while a frame is on its way to the callback
+    struct _pxleap_hub_subscriber *next;
+    struct _pxleap_hub_subscriber *nexttarget;  // next subscriber of the frame being delivered, only used by the hub thread
+} t_pxleap_hub_subscriber;
+
+typedef struct _pxleap_hub
+{
+    uint32_t version;                       // PXLEAP_HUB_VERSION of the external that created it
+    long refcount;                          // objects holding the hub, only changed on the Max thread
+    LEAP_CONNECTION connection;
+    LEAP_CLOCK_REBASER rebaser;
+    t_systhread thread;
+    atomic_int cancel;
+    _Atomic uint64_t pollfailures;          // polls that returned an error rather than a message or a timeout
+    t_pxleap_wake wake;
+    int interactive;                        // the thread asks for interactive QoS
+
+    // guards the subscriber list and the device table. the hub thread only holds it to pick out
+    // the subscribers of a frame, the callbacks run after it's released.
+    t_systhread_mutex mutex;
+    t_pxleap_hub_subscriber *subscribers;
+    uint32_t device_ids[PXLEAP_HUB_MAX_DEVICES];    // LeapC device id per slot in attach order, 0 when free
+    LEAP_DEVICE devices[PXLEAP_HUB_MAX_DEVICES];
+
+    // owned by the hub thread
+    t_pxleap_frame frame;
+} t_pxleap_hub;
+
+// the shared hub, connected and polling, creating it if this is the first user. NULL if LeapC
+// refused the connection. interactive only applies when the hub is created.
+t_pxleap_hub *pxleap_hub_acquire(int interactive);
+// drops one reference, the last one stops the thread and closes the connection
+void pxleap_hub_release(t_pxleap_hub *hub);
+
+// frames start arriving on the hub thread once subscribed. unsubscribe only returns when
+// the callback is no longer running, so the owner can be freed straight after.
+void pxleap_hub_subscribe(t_pxleap_hub *hub, t_pxleap_hub_subscriber *s);
+void pxleap_hub_unsubscribe(t_pxleap_hub *hub, t_pxleap_hub_subscriber *s);
+// moves a subscriber to another device, safe whether or not it's subscribed
+void pxleap_hub_setdevice(t_pxleap_hub *hub, t_pxleap_hub_subscriber *s, uint32_t device);
+// failed polls since the connection opened, 0 for a NULL hub
+uint64_t pxleap_hub_pollfailures(t_pxleap_hub *hub);
+
+#endif
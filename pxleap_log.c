@@ -0,0 +1,476 @@
+//
+// pxleap_log
+//
+// Compact session logs for leaving logging on through a whole show. The worker thread only
+// quantizes each frame into a bounded queue, and a writer thread of the log's own predicts every
+// value from the frames before it and writes the small differences out in indexed chunks, so a
+// log can be replayed from any point without reading what comes before it.
+//
+// author: Andrew Benson
+// contact: pixlpa@gmail.com
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "pxleap_log.h"
+
+// the most one encoded frame can take: 10 byte varints throughout
+#define PXLEAP_LOG_FRAME_MAX (10 * (5 + PXLEAP_MAX_HANDS * (2 + PXLEAP_LOG_VALUES)))
+
+static int32_t pxleap_log_fixed(float v, double scale)
+{
+    double q = (double)v * scale;
+    if (!(q > -2147483647.)) return q != q ? 0 : -2147483647; // NaN as 0
+    if (q > 2147483647.) return 2147483647;
+    return (int32_t)lrint(q);
+}
+
+static void pxleap_log_quantize(t_pxleap_log_hand *dst, const LEAP_HAND *hand)
+{
+    float joints[PXLEAP_LOG_JOINTS];
+    int32_t *v = dst->values;
+    dst->id = hand->id;
+    dst->type = hand->type == eLeapHandType_Left ? 0 : 1;
+    pxleap_hand_joints(hand, joints);
+    for (int i = 0; i < PXLEAP_LOG_JOINTS; i++) v[i] = pxleap_log_fixed(joints[i], 10.);
+    for (int i = 0; i < 4; i++) v[PXLEAP_LOG_ORIENTATION + i] = pxleap_log_fixed(hand->palm.orientation.v[i], 1e4);
+    for (int i = 0; i < 3; i++) {
+        v[PXLEAP_LOG_NORMAL + i] = pxleap_log_fixed(hand->palm.normal.v[i], 1e4);
+        v[PXLEAP_LOG_DIRECTION + i] = pxleap_log_fixed(hand->palm.direction.v[i], 1e4);
+    }
+    v[PXLEAP_LOG_SCALARS] = pxleap_log_fixed(hand->confidence, 1e4);
+    v[PXLEAP_LOG_SCALARS + 1] = pxleap_log_fixed(hand->pinch_strength, 1e4);
+    v[PXLEAP_LOG_SCALARS + 2] = pxleap_log_fixed(hand->grab_strength, 1e4);
+    v[PXLEAP_LOG_SCALARS + 3] = pxleap_log_fixed(hand->grab_angle, 1e4);
+    v[PXLEAP_LOG_LENGTHS] = pxleap_log_fixed(hand->pinch_distance, 10.);
+    v[PXLEAP_LOG_LENGTHS + 1] = pxleap_log_fixed(hand->palm.width, 10.);
+}
+
+static void pxleap_log_restore(LEAP_HAND *hand, uint32_t id, uint32_t type, const int32_t *v)
+{
+    float joints[PXLEAP_LOG_JOINTS];
+    memset(hand, 0, sizeof(*hand));
+    hand->id = id;
+    hand->type = type ? eLeapHandType_Right : eLeapHandType_Left;
+    for (int i = 0; i < PXLEAP_LOG_JOINTS; i++) joints[i] = (float)v[i] * 0.1f;
+    pxleap_hand_setjoints(hand, joints);
+    hand->palm.stabilized_position = hand->palm.position;
+    for (int i = 0; i < 4; i++) hand->palm.orientation.v[i] = (float)v[PXLEAP_LOG_ORIENTATION + i] * 1e-4f;
+    for (int i = 0; i < 3; i++) {
+        hand->palm.normal.v[i] = (float)v[PXLEAP_LOG_NORMAL + i] * 1e-4f;
+        hand->palm.direction.v[i] = (float)v[PXLEAP_LOG_DIRECTION + i] * 1e-4f;
+    }
+    hand->confidence = (float)v[PXLEAP_LOG_SCALARS] * 1e-4f;
+    hand->pinch_strength = (float)v[PXLEAP_LOG_SCALARS + 1] * 1e-4f;
+    hand->grab_strength = (float)v[PXLEAP_LOG_SCALARS + 2] * 1e-4f;
+    hand->grab_angle = (float)v[PXLEAP_LOG_SCALARS + 3] * 1e-4f;
+    hand->pinch_distance = (float)v[PXLEAP_LOG_LENGTHS] * 0.1f;
+    hand->palm.width = (float)v[PXLEAP_LOG_LENGTHS + 1] * 0.1f;
+    for (int f = 0; f < 5; f++) hand->digits[f].finger_id = f;
+}
+
+// small differences in either direction become small unsigned numbers, then take a byte per 7 bits
+static unsigned char *pxleap_log_putvarint(unsigned char *p, int64_t v)
+{
+    uint64_t u = ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+    while (u >= 0x80) {
+        *p++ = (unsigned char)(u | 0x80);
+        u >>= 7;
+    }
+    *p++ = (unsigned char)u;
+    return p;
+}
+
+static int pxleap_log_getvarint(const unsigned char *map, size_t *pos, size_t end, int64_t *v)
+{
+    uint64_t u = 0;
+    for (int shift = 0; shift < 64 && *pos < end; shift += 7) {
+        unsigned char b = map[(*pos)++];
+        u |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            *v = (int64_t)(u >> 1) ^ -(int64_t)(u & 1);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// a hand continues along its last step, or stays put after one frame, or starts from 0
+static int64_t pxleap_log_predict(const t_pxleap_log_state *s, uint32_t type, int i)
+{
+    if (s->seen[type] >= 2) return 2 * (int64_t)s->prev[type][i] - (int64_t)s->prev2[type][i];
+    return s->seen[type] ? s->prev[type][i] : 0;
+}
+
+// both sides keep the state in step, the writer after encoding a hand and the reader after decoding it
+static void pxleap_log_advance(t_pxleap_log_state *s, uint32_t type, uint32_t id, const int32_t *values)
+{
+    if (s->seen[type] && s->id[type] != id) s->seen[type] = 0;
+    s->id[type] = id;
+    memcpy(s->prev2[type], s->prev[type], sizeof(s->prev2[type]));
+    memcpy(s->prev[type], values, sizeof(s->prev[type]));
+    if (s->seen[type] < 2) s->seen[type]++;
+}
+
+// a hand type missing from a frame starts over when it comes back
+static void pxleap_log_absent(t_pxleap_log_state *s, const uint32_t *present)
+{
+    for (uint32_t t = 0; t < PXLEAP_MAX_HANDS; t++) if (!present[t]) s->seen[t] = 0;
+}
+
+static unsigned char *pxleap_log_encode(t_pxleap_log_state *s, const t_pxleap_log_entry *e, unsigned char *p)
+{
+    uint32_t present[PXLEAP_MAX_HANDS] = { 0, 0 };
+    p = pxleap_log_putvarint(p, e->timestamp - s->timestamp);
+    p = pxleap_log_putvarint(p, e->frame_id - s->frame_id);
+    p = pxleap_log_putvarint(p, e->tracking_frame_id - s->tracking_frame_id);
+    p = pxleap_log_putvarint(p, (int64_t)e->framerate - s->framerate);
+    p = pxleap_log_putvarint(p, e->nHands);
+    s->timestamp = e->timestamp;
+    s->frame_id = e->frame_id;
+    s->tracking_frame_id = e->tracking_frame_id;
+    s->framerate = e->framerate;
+    for (uint32_t h = 0; h < e->nHands; h++) {
+        const t_pxleap_log_hand *hand = &e->hands[h];
+        uint32_t t = hand->type;
+        p = pxleap_log_putvarint(p, t);
+        p = pxleap_log_putvarint(p, (int64_t)hand->id - s->id[t]);
+        if (s->id[t] != hand->id) s->seen[t] = 0;
+        for (int i = 0; i < PXLEAP_LOG_VALUES; i++) p = pxleap_log_putvarint(p, hand->values[i] - pxleap_log_predict(s, t, i));
+        pxleap_log_advance(s, t, hand->id, hand->values);
+        present[t] = 1;
+    }
+    pxleap_log_absent(s, present);
+    return p;
+}
+
+// writer thread: the open chunk goes to disk with its index entry
+static void pxleap_log_flush(t_pxleap_log *l)
+{
+    t_pxleap_log_chunk *c = &l->chunk;
+    if (!c->frames) return;
+    if (!atomic_load_explicit(&l->failed, memory_order_relaxed)) {
+        if (l->nindex == l->indexsize) {
+            uint64_t size = l->indexsize ? l->indexsize * 2 : 1024;
+            t_pxleap_log_index *index = (t_pxleap_log_index *)realloc(l->index, (size_t)size * sizeof(*index));
+            if (index) {
+                l->index = index;
+                l->indexsize = size;
+            }
+        }
+        // a chunk the index has no room for is still written, readers of a closed log just skip it
+        if (l->nindex < l->indexsize) {
+            l->index[l->nindex].first_timestamp = c->first_timestamp;
+            l->index[l->nindex].offset = l->offset;
+            l->nindex++;
+        }
+        if (fwrite(c, sizeof(*c), 1, l->file) != 1 || fwrite(l->buffer, c->bytes, 1, l->file) != 1 || fflush(l->file))
+            atomic_store_explicit(&l->failed, 1, memory_order_relaxed);
+        l->offset += sizeof(*c) + c->bytes;
+        atomic_store_explicit(&l->bytes, l->offset, memory_order_relaxed);
+    }
+    c->frames = 0;
+    c->bytes = 0;
+}
+
+static void pxleap_log_add(t_pxleap_log *l, const t_pxleap_log_entry *e)
+{
+    t_pxleap_log_chunk *c = &l->chunk;
+    if (c->frames && (e->timestamp - c->first_timestamp >= PXLEAP_LOG_CHUNK_US || e->timestamp < c->last_timestamp
+                      || c->bytes + PXLEAP_LOG_FRAME_MAX > PXLEAP_LOG_CHUNK_BYTES))
+        pxleap_log_flush(l);
+    if (!c->frames) {
+        memset(&l->state, 0, sizeof(l->state));
+        c->first_timestamp = e->timestamp;
+        l->opened = pxleap_now_us();
+    }
+    c->bytes = (uint32_t)(pxleap_log_encode(&l->state, e, l->buffer + c->bytes) - l->buffer);
+    c->last_timestamp = e->timestamp;
+    c->frames++;
+}
+
+static void *pxleap_log_tick(void *arg)
+{
+    t_pxleap_log *l = (t_pxleap_log *)arg;
+    for (;;) {
+        // frames queued before the cancel are still written
+        int cancel = atomic_load_explicit(&l->cancel, memory_order_acquire);
+        uint64_t tail = atomic_load_explicit(&l->tail, memory_order_relaxed);
+        uint64_t head = atomic_load_explicit(&l->head, memory_order_acquire);
+        for (; tail < head; tail++) {
+            pxleap_log_add(l, &l->queue[tail % PXLEAP_LOG_QUEUE_FRAMES]);
+            atomic_store_explicit(&l->tail, tail + 1, memory_order_release);
+        }
+        if (cancel) break;
+        // frames stopped coming, don't leave the last of them in memory
+        if (l->chunk.frames && pxleap_now_us() - l->opened >= PXLEAP_LOG_CHUNK_US) pxleap_log_flush(l);
+        pxleap_wake_wait(&l->wake, PXLEAP_LOG_INTERVAL_US);
+    }
+    pxleap_log_flush(l);
+    return NULL;
+}
+
+t_pxleap_log *pxleap_log_open(const char *path)
+{
+    t_pxleap_log_header header;
+    t_pxleap_log *l;
+    FILE *file = fopen(path, "wb");
+    if (!file) return NULL;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, PXLEAP_LOG_MAGIC, sizeof(header.magic));
+    header.version = PXLEAP_LOG_VERSION;
+    header.values = PXLEAP_LOG_VALUES;
+    l = (t_pxleap_log *)calloc(1, sizeof(t_pxleap_log));
+    if (l) {
+        l->queue = (t_pxleap_log_entry *)malloc(PXLEAP_LOG_QUEUE_FRAMES * sizeof(t_pxleap_log_entry));
+        l->buffer = (unsigned char *)malloc(PXLEAP_LOG_CHUNK_BYTES);
+    }
+    if (!l || !l->queue || !l->buffer || fwrite(&header, sizeof(header), 1, file) != 1 || fflush(file)) {
+        if (l) {
+            free(l->queue);
+            free(l->buffer);
+            free(l);
+        }
+        fclose(file);
+        return NULL;
+    }
+    l->file = file;
+    l->offset = sizeof(header);
+    memcpy(l->chunk.magic, PXLEAP_LOG_CHUNK_MAGIC, sizeof(l->chunk.magic));
+    atomic_init(&l->cancel, 0);
+    atomic_init(&l->head, 0);
+    atomic_init(&l->tail, 0);
+    atomic_init(&l->dropped, 0);
+    atomic_init(&l->bytes, l->offset);
+    atomic_init(&l->failed, 0);
+    pxleap_wake_init(&l->wake);
+    if (pthread_create(&l->thread, NULL, pxleap_log_tick, l)) {
+        pxleap_wake_free(&l->wake);
+        fclose(file);
+        free(l->queue);
+        free(l->buffer);
+        free(l);
+        return NULL;
+    }
+    return l;
+}
+
+int pxleap_log_write(t_pxleap_log *l, const t_pxleap_frame *frame)
+{
+    uint64_t head = atomic_load_explicit(&l->head, memory_order_relaxed);
+    t_pxleap_log_entry *e;
+    if (head - atomic_load_explicit(&l->tail, memory_order_acquire) >= PXLEAP_LOG_QUEUE_FRAMES) {
+        atomic_fetch_add_explicit(&l->dropped, 1, memory_order_relaxed);
+        return 0;
+    }
+    e = &l->queue[head % PXLEAP_LOG_QUEUE_FRAMES];
+    e->frame_id = frame->frame_id;
+    e->timestamp = frame->timestamp;
+    e->tracking_frame_id = frame->tracking_frame_id;
+    e->framerate = pxleap_log_fixed(frame->framerate, 100.);
+    e->nHands = frame->nHands;
+    for (uint32_t h = 0; h < frame->nHands; h++) pxleap_log_quantize(&e->hands[h], &frame->hands[h]);
+    // the writer only reads the entry once it sees the new head, and never waits for it
+    atomic_store_explicit(&l->head, head + 1, memory_order_release);
+    return 1;
+}
+
+uint64_t pxleap_log_count(t_pxleap_log *l)
+{
+    return atomic_load_explicit(&l->head, memory_order_relaxed);
+}
+
+uint64_t pxleap_log_close(t_pxleap_log *l)
+{
+    t_pxleap_log_trailer trailer;
+    uint64_t bytes;
+    if (!l) return 0;
+    atomic_store_explicit(&l->cancel, 1, memory_order_release);
+    pxleap_wake_signal(&l->wake);
+    pthread_join(l->thread, NULL);
+    if (!atomic_load_explicit(&l->failed, memory_order_relaxed)) {
+        memset(&trailer, 0, sizeof(trailer));
+        memcpy(trailer.magic, PXLEAP_LOG_INDEX_MAGIC, sizeof(trailer.magic));
+        trailer.offset = l->offset;
+        trailer.count = l->nindex;
+        if ((l->nindex && fwrite(l->index, sizeof(t_pxleap_log_index), (size_t)l->nindex, l->file) != l->nindex)
+            || fwrite(&trailer, sizeof(trailer), 1, l->file) != 1)
+            atomic_store_explicit(&l->failed, 1, memory_order_relaxed);
+        else atomic_store_explicit(&l->bytes, l->offset + l->nindex * sizeof(t_pxleap_log_index) + sizeof(trailer), memory_order_relaxed);
+    }
+    if (fclose(l->file)) atomic_store_explicit(&l->failed, 1, memory_order_relaxed);
+    bytes = atomic_load_explicit(&l->failed, memory_order_relaxed) ? 0 : atomic_load_explicit(&l->bytes, memory_order_relaxed);
+    pxleap_wake_free(&l->wake);
+    free(l->queue);
+    free(l->buffer);
+    free(l->index);
+    free(l);
+    return bytes;
+}
+
+// the chunk at offset, if the whole of it is in the file
+static int pxleap_logreader_chunkat(const t_pxleap_logreader *r, uint64_t offset, t_pxleap_log_chunk *c)
+{
+    if (offset > r->size || r->size - offset < sizeof(*c)) return 0;
+    memcpy(c, r->map + offset, sizeof(*c));
+    return !memcmp(c->magic, PXLEAP_LOG_CHUNK_MAGIC, sizeof(c->magic)) && r->size - offset - sizeof(*c) >= c->bytes;
+}
+
+// a closed log carries its index at the end, a log cut short by a crash has its chunks walked instead
+static int pxleap_logreader_index(t_pxleap_logreader *r)
+{
+    t_pxleap_log_trailer trailer;
+    t_pxleap_log_chunk c;
+    uint64_t offset = sizeof(t_pxleap_log_header), size = 0;
+    if (r->size >= sizeof(t_pxleap_log_header) + sizeof(trailer)) {
+        memcpy(&trailer, r->map + r->size - sizeof(trailer), sizeof(trailer));
+        if (!memcmp(trailer.magic, PXLEAP_LOG_INDEX_MAGIC, sizeof(trailer.magic)) && trailer.offset <= r->size - sizeof(trailer)
+            && trailer.count <= r->size / sizeof(t_pxleap_log_index)
+            && trailer.count * sizeof(t_pxleap_log_index) == r->size - sizeof(trailer) - trailer.offset) {
+            r->nindex = trailer.count;
+            r->index = (t_pxleap_log_index *)malloc((size_t)(trailer.count ? trailer.count : 1) * sizeof(t_pxleap_log_index));
+            if (!r->index) return 0;
+            memcpy(r->index, r->map + trailer.offset, (size_t)trailer.count * sizeof(t_pxleap_log_index));
+            return 1;
+        }
+    }
+    r->nindex = 0;
+    while (pxleap_logreader_chunkat(r, offset, &c)) {
+        if (r->nindex == size) {
+            t_pxleap_log_index *index;
+            size = size ? size * 2 : 1024;
+            index = (t_pxleap_log_index *)realloc(r->index, (size_t)size * sizeof(*index));
+            if (!index) return 0;
+            r->index = index;
+        }
+        r->index[r->nindex].first_timestamp = c.first_timestamp;
+        r->index[r->nindex].offset = offset;
+        r->nindex++;
+        offset += sizeof(c) + c.bytes;
+    }
+    return 1;
+}
+
+t_pxleap_logreader *pxleap_logreader_open(const unsigned char *map, size_t size)
+{
+    t_pxleap_log_header header;
+    t_pxleap_logreader *r;
+    if (size < sizeof(header)) return NULL;
+    memcpy(&header, map, sizeof(header));
+    if (memcmp(header.magic, PXLEAP_LOG_MAGIC, sizeof(header.magic)) || header.version != PXLEAP_LOG_VERSION
+        || header.values != PXLEAP_LOG_VALUES)
+        return NULL;
+    r = (t_pxleap_logreader *)calloc(1, sizeof(t_pxleap_logreader));
+    if (!r) return NULL;
+    r->map = map;
+    r->size = size;
+    if (!pxleap_logreader_index(r)) {
+        pxleap_logreader_close(r);
+        return NULL;
+    }
+    pxleap_logreader_seek(r, INT64_MIN);
+    return r;
+}
+
+void pxleap_logreader_close(t_pxleap_logreader *r)
+{
+    if (!r) return;
+    free(r->index);
+    free(r);
+}
+
+static int pxleap_logreader_load(t_pxleap_logreader *r, uint64_t chunk)
+{
+    t_pxleap_log_chunk c;
+    r->chunk = chunk;
+    r->left = 0;
+    if (chunk >= r->nindex || !pxleap_logreader_chunkat(r, r->index[chunk].offset, &c)) return 0;
+    r->pos = (size_t)r->index[chunk].offset + sizeof(c);
+    r->end = r->pos + c.bytes;
+    r->left = c.frames;
+    memset(&r->state, 0, sizeof(r->state));
+    return 1;
+}
+
+static int pxleap_logreader_decode(t_pxleap_logreader *r, t_pxleap_frame *dst)
+{
+    t_pxleap_log_state *s = &r->state;
+    uint32_t present[PXLEAP_MAX_HANDS] = { 0, 0 };
+    int32_t values[PXLEAP_LOG_VALUES];
+    int64_t v[5];
+    for (int i = 0; i < 5; i++) if (!pxleap_log_getvarint(r->map, &r->pos, r->end, &v[i])) return 0;
+    if (v[4] < 0 || v[4] > PXLEAP_MAX_HANDS) return 0;
+    s->timestamp += v[0];
+    s->frame_id += v[1];
+    s->tracking_frame_id += v[2];
+    s->framerate += (int32_t)v[3];
+    dst->timestamp = s->timestamp;
+    dst->frame_id = s->frame_id;
+    dst->tracking_frame_id = s->tracking_frame_id;
+    dst->framerate = (float)s->framerate * 0.01f;
+    dst->nHands = (uint32_t)v[4];
+    dst->featuregroups = 0;
+    dst->published = 0;
+    for (uint32_t h = 0; h < dst->nHands; h++) {
+        int64_t type, id;
+        uint32_t t;
+        if (!pxleap_log_getvarint(r->map, &r->pos, r->end, &type) || type < 0 || type >= PXLEAP_MAX_HANDS
+            || !pxleap_log_getvarint(r->map, &r->pos, r->end, &id))
+            return 0;
+        t = (uint32_t)type;
+        id += s->id[t];
+        if (s->id[t] != (uint32_t)id) s->seen[t] = 0;
+        for (int i = 0; i < PXLEAP_LOG_VALUES; i++) {
+            int64_t d;
+            if (!pxleap_log_getvarint(r->map, &r->pos, r->end, &d)) return 0;
+            values[i] = (int32_t)(pxleap_log_predict(s, t, i) + d);
+        }
+        pxleap_log_advance(s, t, (uint32_t)id, values);
+        pxleap_log_restore(&dst->hands[h], (uint32_t)id, t, values);
+        present[t] = 1;
+    }
+    pxleap_log_absent(s, present);
+    return 1;
+}
+
+int pxleap_logreader_next(t_pxleap_logreader *r, t_pxleap_frame *dst)
+{
+    if (r->haspending) {
+        *dst = r->pending;
+        r->haspending = 0;
+        return 1;
+    }
+    for (;;) {
+        while (!r->left) if (!pxleap_logreader_load(r, r->chunk + 1)) return 0;
+        r->left--;
+        if (pxleap_logreader_decode(r, dst)) return 1;
+        // a damaged chunk is skipped as a whole, the next one doesn't depend on it
+        r->left = 0;
+    }
+}
+
+int pxleap_logreader_seek(t_pxleap_logreader *r, int64_t timestamp)
+{
+    uint64_t lo = 0, hi = r->nindex;
+    r->haspending = 0;
+    // the last chunk starting at or before timestamp
+    while (hi - lo > 1) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (r->index[mid].first_timestamp <= timestamp) lo = mid;
+        else hi = mid;
+    }
+    if (!pxleap_logreader_load(r, lo)) return 0;
+    while (pxleap_logreader_next(r, &r->pending)) {
+        if (r->pending.timestamp >= timestamp) {
+            r->haspending = 1;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int64_t pxleap_logreader_start(t_pxleap_logreader *r)
+{
+    return r->nindex ? r->index[0].first_timestamp : 0;
+}
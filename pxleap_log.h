@@ -0,0 +1,169 @@
+//
+// pxleap_log
+//
+// Compact session logs for leaving logging on through a whole show. The worker thread only
+// quantizes each frame into a bounded queue, and a writer thread of the log's own predicts every
+// value from the frames before it and writes the small differences out in indexed chunks, so a
+// log can be replayed from any point without reading what comes before it.
+//
+// author: Andrew Benson
+// contact: pixlpa@gmail.com
+//
+
+#ifndef PXLEAP_LOG_H
+#define PXLEAP_LOG_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "pxleap_frame.h"
+#include "pxleap_thread.h"
+
+// file layout: one t_pxleap_log_header, then t_pxleap_log_chunk headers each followed by their
+// encoded frames, then the index (one t_pxleap_log_index per chunk) and a t_pxleap_log_trailer
+// pointing at it. a log that was never closed has no index, and readers rebuild it from the
+// chunk headers instead. everything is native endian.
+#define PXLEAP_LOG_MAGIC "PXLEAPL1"
+#define PXLEAP_LOG_INDEX_MAGIC "PXLEAPIX"
+#define PXLEAP_LOG_CHUNK_MAGIC "PXLC"
+#define PXLEAP_LOG_VERSION 1
+
+// values kept per hand, each one fixed point
+#define PXLEAP_LOG_JOINTS (PXLEAP_JOINT_COUNT * 3)    // 0.1 mm
+#define PXLEAP_LOG_ORIENTATION PXLEAP_LOG_JOINTS       // quaternion, then normal and direction, 1/10000
+#define PXLEAP_LOG_NORMAL (PXLEAP_LOG_ORIENTATION + 4)
+#define PXLEAP_LOG_DIRECTION (PXLEAP_LOG_NORMAL + 3)
+#define PXLEAP_LOG_SCALARS (PXLEAP_LOG_DIRECTION + 3) // confidence, pinch and grab strength, grab angle, 1/10000
+#define PXLEAP_LOG_LENGTHS (PXLEAP_LOG_SCALARS + 4)   // pinch distance and palm width, 0.1 mm
+#define PXLEAP_LOG_VALUES (PXLEAP_LOG_LENGTHS + 2)
+
+// frames the worker can get ahead of the writer, about 8 seconds at 120 Hz
+#define PXLEAP_LOG_QUEUE_FRAMES 1024
+// a chunk is closed once it spans this much time, which is also the most a crash can lose
+#define PXLEAP_LOG_CHUNK_US 1000000
+// how often the writer wakes to empty the queue
+#define PXLEAP_LOG_INTERVAL_US 50000
+#define PXLEAP_LOG_CHUNK_BYTES (256 * 1024)
+
+typedef struct _pxleap_log_header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t values;                        // PXLEAP_LOG_VALUES of the writer
+    uint64_t reserved;
+} t_pxleap_log_header;
+
+typedef struct _pxleap_log_chunk
+{
+    char magic[4];
+    uint32_t bytes;                         // encoded frames following this header
+    uint32_t frames;
+    uint32_t reserved;
+    int64_t first_timestamp;
+    int64_t last_timestamp;
+} t_pxleap_log_chunk;
+
+typedef struct _pxleap_log_index
+{
+    int64_t first_timestamp;
+    uint64_t offset;                        // of the chunk header from the start of the file
+} t_pxleap_log_index;
+
+typedef struct _pxleap_log_trailer
+{
+    char magic[8];
+    uint64_t offset;                        // of the first index entry
+    uint64_t count;
+} t_pxleap_log_trailer;
+
+// a hand as the worker hands it over, already quantized
+typedef struct _pxleap_log_hand
+{
+    uint32_t id;
+    uint32_t type;                          // 0 left, 1 right
+    int32_t values[PXLEAP_LOG_VALUES];
+} t_pxleap_log_hand;
+
+typedef struct _pxleap_log_entry
+{
+    int64_t frame_id;
+    int64_t timestamp;
+    int64_t tracking_frame_id;
+    int32_t framerate;                      // 1/100 Hz
+    uint32_t nHands;
+    t_pxleap_log_hand hands[PXLEAP_MAX_HANDS];
+} t_pxleap_log_entry;
+
+// what each side predicts a hand's values from, reset at every chunk so chunks stand alone
+typedef struct _pxleap_log_state
+{
+    int64_t frame_id;
+    int64_t timestamp;
+    int64_t tracking_frame_id;
+    int32_t framerate;
+    uint32_t id[PXLEAP_MAX_HANDS];          // per hand type
+    uint32_t seen[PXLEAP_MAX_HANDS];        // frames of that hand in a row, up to 2
+    int32_t prev[PXLEAP_MAX_HANDS][PXLEAP_LOG_VALUES];
+    int32_t prev2[PXLEAP_MAX_HANDS][PXLEAP_LOG_VALUES];
+} t_pxleap_log_state;
+
+typedef struct _pxleap_log
+{
+    FILE *file;
+    pthread_t thread;
+    t_pxleap_wake wake;
+    atomic_int cancel;
+    t_pxleap_log_entry *queue;              // PXLEAP_LOG_QUEUE_FRAMES entries
+    _Atomic uint64_t head;                  // frames queued, only written by the worker
+    _Atomic uint64_t tail;                  // frames encoded, only written by the writer
+    _Atomic uint64_t dropped;               // frames the worker found no room for
+    _Atomic uint64_t bytes;                 // written to the file so far
+    _Atomic int failed;                     // the file refused a write, nothing more is written
+
+    // owned by the writer thread
+    t_pxleap_log_state state;
+    t_pxleap_log_chunk chunk;               // the open chunk, empty while frames is 0
+    int64_t opened;                         // pxleap_now_us() when it took its first frame
+    unsigned char *buffer;                  // its encoded frames
+    t_pxleap_log_index *index;
+    uint64_t nindex, indexsize;
+    uint64_t offset;                        // file position of the next chunk
+} t_pxleap_log;
+
+// creates the file and starts the writer thread, NULL if either fails
+t_pxleap_log *pxleap_log_open(const char *path);
+// worker side: quantizes the frame into the queue, or counts it as dropped and returns 0 when full
+int pxleap_log_write(t_pxleap_log *l, const t_pxleap_frame *frame);
+// frames written (or still queued) so far
+uint64_t pxleap_log_count(t_pxleap_log *l);
+// lets the writer finish the queue, then writes the index and closes the file. only call once
+// the worker has stopped writing. returns the size of the file, or 0 if a write to it failed.
+uint64_t pxleap_log_close(t_pxleap_log *l);
+
+typedef struct _pxleap_logreader
+{
+    const unsigned char *map;               // the whole file, owned by whoever opened the reader
+    size_t size;
+    t_pxleap_log_index *index;
+    uint64_t nindex;
+    uint64_t chunk;                         // chunk being decoded
+    size_t pos;                             // next encoded byte in the file
+    size_t end;                             // end of that chunk's encoded frames
+    uint32_t left;                          // frames still to decode in that chunk
+    t_pxleap_log_state state;
+    t_pxleap_frame pending;                 // the frame a seek stopped at, handed out by the next read
+    int haspending;
+} t_pxleap_logreader;
+
+// returns NULL if map isn't a log this version can read
+t_pxleap_logreader *pxleap_logreader_open(const unsigned char *map, size_t size);
+void pxleap_logreader_close(t_pxleap_logreader *r);
+// the first frame read next is the first one at or after timestamp. returns 0 if there is none.
+int pxleap_logreader_seek(t_pxleap_logreader *r, int64_t timestamp);
+// decodes the next frame into dst, returns 0 at the end of the log
+int pxleap_logreader_next(t_pxleap_logreader *r, t_pxleap_frame *dst);
+// timestamp of the first frame, 0 for an empty log
+int64_t pxleap_logreader_start(t_pxleap_logreader *r);
+
+#endif
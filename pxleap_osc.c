@@ -0,0 +1,220 @@
+//
+// pxleap_osc
+//
+// Sends every frame as an OSC bundle over UDP straight from the worker thread, so forwarding
+// hand data to another machine or engine never touches the Max scheduler. The messages for
+// each hand are laid out once when the fields change, and a frame only fills in the floats.
+//
+// author: Andrew Benson
+// contact: pixlpa@gmail.com
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include "pxleap_features.h"
+#include "pxleap_osc.h"
+
+static const char *pxleap_osc_hands[PXLEAP_MAX_HANDS] = { "left", "right" };
+static const char *pxleap_osc_fingers[5] = { "thumb", "index", "middle", "ring", "pinky" };
+
+// OSC strings are null terminated and padded to 4 bytes
+static size_t pxleap_osc_pad(size_t length)
+{
+    return (length + 4) & ~(size_t)3;
+}
+
+static void pxleap_osc_put32(unsigned char *p, uint32_t v)
+{
+    p[0] = (unsigned char)(v >> 24);
+    p[1] = (unsigned char)(v >> 16);
+    p[2] = (unsigned char)(v >> 8);
+    p[3] = (unsigned char)v;
+}
+
+// the address and type tags of a message with count float (or int) arguments, returns their size
+static size_t pxleap_osc_header(unsigned char *p, const char *address, long count, char type)
+{
+    size_t alen = strlen(address);
+    size_t size = pxleap_osc_pad(alen) + pxleap_osc_pad((size_t)count + 1);
+    memset(p, 0, size);
+    memcpy(p, address, alen);
+    p += pxleap_osc_pad(alen);
+    p[0] = ',';
+    for (long i = 0; i < count; i++) p[1 + i] = (unsigned char)type;
+    return size;
+}
+
+// appends a bundle element holding one message, returns where its arguments start or 0 if it doesn't fit
+static size_t pxleap_osc_message(t_pxleap_osc_template *t, const char *address, long count)
+{
+    size_t alen = strlen(address);
+    size_t body = pxleap_osc_pad(alen) + pxleap_osc_pad((size_t)count + 1) + 4 * (size_t)count;
+    size_t start = t->size;
+    if (start + 4 + body > PXLEAP_OSC_TEMPLATE_MAX) return 0;
+    pxleap_osc_put32(t->bytes + start, (uint32_t)body);
+    memset(t->bytes + start + 4, 0, body);
+    t->size = start + 4 + body;
+    return start + 4 + pxleap_osc_header(t->bytes + start + 4, address, count, 'f');
+}
+
+static int pxleap_osc_run(t_pxleap_osc_template *t, uint32_t features, size_t offset, long count, size_t pos)
+{
+    t_pxleap_osc_run *run;
+    if (!pos || t->nruns == PXLEAP_OSC_RUNS_MAX) return 0;
+    run = &t->runs[t->nruns++];
+    run->features = features;
+    run->offset = (uint32_t)offset;
+    run->count = (uint32_t)count;
+    run->pos = (uint32_t)pos;
+    return 1;
+}
+
+static int pxleap_osc_compilehand(t_pxleap_osc_template *t, const t_pxleap_plan *plan, uint32_t featuregroups, const char *prefix, const char *hand)
+{
+    char address[256];
+    size_t pos;
+    int ok = 1;
+    t->size = 0;
+    t->nruns = 0;
+    for (long i = 0; i < plan->nsteps; i++) {
+        snprintf(address, sizeof(address), "%s/%s/%s", prefix, hand, plan->steps[i].name->s_name);
+        pos = pxleap_osc_message(t, address, plan->steps[i].count);
+        ok &= pxleap_osc_run(t, 0, plan->steps[i].offset, plan->steps[i].count, pos);
+    }
+    for (long f = 0; f < 5 && plan->njoints; f++) {
+        snprintf(address, sizeof(address), "%s/%s/%s/%s", prefix, hand, pxleap_osc_fingers[f], plan->njoints == 1 ? "tip" : "joints");
+        pos = pxleap_osc_message(t, address, plan->njoints * 3);
+        for (long j = 0; j < plan->njoints; j++) {
+            size_t offset = offsetof(LEAP_HAND, digits) + (size_t)f * sizeof(LEAP_DIGIT) + offsetof(LEAP_DIGIT, bones)
+                          + (size_t)(plan->firstjoint + j) * sizeof(LEAP_BONE) + offsetof(LEAP_BONE, next_joint);
+            ok &= pxleap_osc_run(t, 0, offset, 3, pos ? pos + (size_t)j * 12 : 0);
+        }
+    }
+    // same layout as px.ultraleap's feature messages
+    if (featuregroups & PXLEAP_FEATURE_VELOCITY) {
+        snprintf(address, sizeof(address), "%s/%s/velocity", prefix, hand);
+        pos = pxleap_osc_message(t, address, 18);
+        ok &= pxleap_osc_run(t, 1, offsetof(t_pxleap_features, palm_velocity), 18, pos);
+    }
+    if (featuregroups & PXLEAP_FEATURE_GRIP) {
+        snprintf(address, sizeof(address), "%s/%s/grip", prefix, hand);
+        pos = pxleap_osc_message(t, address, 4);
+        ok &= pxleap_osc_run(t, 1, offsetof(t_pxleap_features, pinch_distance), 4, pos);
+    }
+    if (featuregroups & PXLEAP_FEATURE_CURL) {
+        snprintf(address, sizeof(address), "%s/%s/curl", prefix, hand);
+        pos = pxleap_osc_message(t, address, 5);
+        ok &= pxleap_osc_run(t, 1, offsetof(t_pxleap_features, curl), 5, pos);
+    }
+    if (!ok) {
+        t->size = 0;
+        t->nruns = 0;
+    }
+    return ok;
+}
+
+int pxleap_osc_compile(t_pxleap_osc *o, const t_pxleap_plan *plan, uint32_t featuregroups, const char *prefix)
+{
+    char address[PXLEAP_OSC_PREFIX_MAX + 8];
+    int ok = 1;
+    snprintf(address, sizeof(address), "%.*s/frame", PXLEAP_OSC_PREFIX_MAX, prefix);
+    o->frameheadersize = pxleap_osc_header(o->frameheader, address, 2, 'i');
+    for (int h = 0; h < PXLEAP_MAX_HANDS; h++) ok &= pxleap_osc_compilehand(&o->hands[h], plan, featuregroups, prefix, pxleap_osc_hands[h]);
+    return ok;
+}
+
+t_pxleap_osc *pxleap_osc_open(const char *host, int port)
+{
+    struct addrinfo hints, *res = NULL;
+    char service[16];
+    t_pxleap_osc *o;
+    int sock;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    snprintf(service, sizeof(service), "%d", port);
+    if (getaddrinfo(host, service, &hints, &res) || !res) return NULL;
+    sock = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    if (sock < 0) {
+        freeaddrinfo(res);
+        return NULL;
+    }
+    // a full socket buffer drops the bundle rather than stalling the worker
+    fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+    o = (t_pxleap_osc *)calloc(1, sizeof(t_pxleap_osc));
+    if (!o) {
+        close(sock);
+        freeaddrinfo(res);
+        return NULL;
+    }
+    o->sock = sock;
+    memcpy(&o->addr, res->ai_addr, res->ai_addrlen);
+    o->addrlen = (socklen_t)res->ai_addrlen;
+    freeaddrinfo(res);
+    atomic_init(&o->interval, 0);
+    atomic_init(&o->sent, 0);
+    atomic_init(&o->skipped, 0);
+    atomic_init(&o->failed, 0);
+    return o;
+}
+
+void pxleap_osc_close(t_pxleap_osc *o)
+{
+    if (!o) return;
+    close(o->sock);
+    free(o);
+}
+
+void pxleap_osc_setrate(t_pxleap_osc *o, double hz)
+{
+    atomic_store_explicit(&o->interval, hz > 0. ? (int64_t)(1e6 / hz) : 0, memory_order_relaxed);
+}
+
+void pxleap_osc_send(t_pxleap_osc *o, const t_pxleap_frame *frame)
+{
+    unsigned char *p = o->packet;
+    size_t size;
+    int64_t now = pxleap_now_us();
+    int64_t interval = atomic_load_explicit(&o->interval, memory_order_relaxed);
+    if (interval && now < o->next) {
+        atomic_fetch_add_explicit(&o->skipped, 1, memory_order_relaxed);
+        return;
+    }
+    // keep to the schedule while frames arrive late by less than an interval, so the rate holds
+    o->next = now - o->next < interval ? o->next + interval : now + interval;
+
+    // bundle header with the immediate time tag, then the frame message
+    memcpy(p, "#bundle", 8);
+    pxleap_osc_put32(p + 8, 0);
+    pxleap_osc_put32(p + 12, 1);
+    pxleap_osc_put32(p + 16, (uint32_t)(o->frameheadersize + 8));
+    memcpy(p + 20, o->frameheader, o->frameheadersize);
+    size = 20 + o->frameheadersize;
+    pxleap_osc_put32(p + size, (uint32_t)frame->tracking_frame_id);
+    pxleap_osc_put32(p + size + 4, frame->nHands);
+    size += 8;
+
+    for (uint32_t h = 0; h < frame->nHands; h++) {
+        const t_pxleap_osc_template *t = &o->hands[frame->hands[h].type == eLeapHandType_Left ? 0 : 1];
+        memcpy(p + size, t->bytes, t->size);
+        for (long r = 0; r < t->nruns; r++) {
+            const t_pxleap_osc_run *run = &t->runs[r];
+            const unsigned char *src = run->features ? (const unsigned char *)&frame->features[h] : (const unsigned char *)&frame->hands[h];
+            for (uint32_t c = 0; c < run->count; c++) {
+                uint32_t bits;
+                memcpy(&bits, src + run->offset + c * 4, 4);
+                pxleap_osc_put32(p + size + run->pos + c * 4, bits);
+            }
+        }
+        size += t->size;
+    }
+    if (sendto(o->sock, p, size, 0, (const struct sockaddr *)&o->addr, o->addrlen) == (ssize_t)size)
+        atomic_fetch_add_explicit(&o->sent, 1, memory_order_relaxed);
+    else atomic_fetch_add_explicit(&o->failed, 1, memory_order_relaxed);
+}
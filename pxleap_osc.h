@@ -0,0 +1,72 @@
+//
+// pxleap_osc
+//
+// Sends every frame as an OSC bundle over UDP straight from the worker thread, so forwarding
+// hand data to another machine or engine never touches the Max scheduler. The messages for
+// each hand are laid out once when the fields change, and a frame only fills in the floats.
+//
+// author: Andrew Benson
+// contact: pixlpa@gmail.com
+//
+
+#ifndef PXLEAP_OSC_H
+#define PXLEAP_OSC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <sys/socket.h>
+#include "pxleap_frame.h"
+#include "pxleap_fields.h"
+
+#define PXLEAP_OSC_PREFIX_MAX 64
+#define PXLEAP_OSC_TEMPLATE_MAX 4096        // bytes of messages for one hand
+#define PXLEAP_OSC_RUNS_MAX 64
+#define PXLEAP_OSC_PACKET_MAX (2 * PXLEAP_OSC_TEMPLATE_MAX + 256)
+
+// floats copied from a hand into a message, count floats from offset bytes into the LEAP_HAND
+// (or into the hand's t_pxleap_features) to pos bytes into the template
+typedef struct _pxleap_osc_run
+{
+    uint32_t features;
+    uint32_t offset;
+    uint32_t count;
+    uint32_t pos;
+} t_pxleap_osc_run;
+
+typedef struct _pxleap_osc_template
+{
+    unsigned char bytes[PXLEAP_OSC_TEMPLATE_MAX];   // bundle elements with every float zeroed
+    size_t size;
+    t_pxleap_osc_run runs[PXLEAP_OSC_RUNS_MAX];
+    long nruns;
+} t_pxleap_osc_template;
+
+typedef struct _pxleap_osc
+{
+    int sock;
+    struct sockaddr_storage addr;
+    socklen_t addrlen;
+    unsigned char frameheader[96];          // the frame message up to its arguments
+    size_t frameheadersize;
+    t_pxleap_osc_template hands[PXLEAP_MAX_HANDS];  // left and right
+    unsigned char packet[PXLEAP_OSC_PACKET_MAX];    // owned by the worker
+    _Atomic int64_t interval;               // microseconds between bundles, 0 sends every frame
+    int64_t next;                           // worker: pxleap_now_us() when the next bundle may go out
+    _Atomic uint64_t sent;
+    _Atomic uint64_t skipped;               // frames dropped by the rate limit
+    _Atomic uint64_t failed;                // sends the socket refused
+} t_pxleap_osc;
+
+// resolves host and opens a UDP socket to it, NULL on failure. Max thread only.
+t_pxleap_osc *pxleap_osc_open(const char *host, int port);
+void pxleap_osc_close(t_pxleap_osc *o);
+// lays out the messages for the fields in plan and the feature groups under prefix. only call
+// while the worker isn't sending. returns 0 if they don't fit in a bundle, which sends nothing.
+int pxleap_osc_compile(t_pxleap_osc *o, const t_pxleap_plan *plan, uint32_t featuregroups, const char *prefix);
+// bundles per second at most, 0 for every frame. safe from any thread.
+void pxleap_osc_setrate(t_pxleap_osc *o, double hz);
+// worker side: sends frame as one bundle unless the rate limit holds it back
+void pxleap_osc_send(t_pxleap_osc *o, const t_pxleap_frame *frame);
+
+#endif
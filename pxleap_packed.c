@@ -0,0 +1,101 @@
+//
+// pxleap_packed
+//
+// The whole frame as one list, for @output packed and px.ultraleap.unpack.
+// see pxleap_packed.h
+//
+// author: Andrew Benson
+// contact: pixlpa@gmail.com
+//
+
+#include <string.h>
+#include "pxleap_packed.h"
+#include "pxleap_features.h"
+
+const char *pxleap_packed_parts[PXLEAP_PACKED_PARTS] = {
+    "present", "id", "palm", "orientation", "normal", "direction", "elbow", "wrist",
+    "thumb", "index", "middle", "ring", "pinky", "velocity", "grip", "curl",
+};
+
+static void pxleap_packed_part(t_pxleap_packed_layout *l, int part, int on, long count)
+{
+    l->offset[part] = l->stride;
+    l->count[part] = on ? count : 0;
+    l->stride += l->count[part];
+}
+
+void pxleap_packed_layout(t_pxleap_packed_layout *l, uint32_t fields, uint32_t groups)
+{
+    // joints already covers the tips, as in the plan
+    long joints = (fields & PXLEAP_FIELD_JOINTS) ? 4 : (fields & PXLEAP_FIELD_TIPS) ? 1 : 0;
+    memset(l, 0, sizeof(*l));
+    l->fields = fields;
+    l->groups = groups;
+    pxleap_packed_part(l, PXLEAP_PACKED_PRESENT, 1, 1);
+    pxleap_packed_part(l, PXLEAP_PACKED_ID, 1, 1);
+    pxleap_packed_part(l, PXLEAP_PACKED_PALM, fields & PXLEAP_FIELD_PALM, 3);
+    pxleap_packed_part(l, PXLEAP_PACKED_ORIENTATION, fields & PXLEAP_FIELD_ORIENTATION, 4);
+    pxleap_packed_part(l, PXLEAP_PACKED_NORMAL, fields & PXLEAP_FIELD_NORMAL, 3);
+    pxleap_packed_part(l, PXLEAP_PACKED_DIRECTION, fields & PXLEAP_FIELD_DIRECTION, 3);
+    pxleap_packed_part(l, PXLEAP_PACKED_ELBOW, fields & PXLEAP_FIELD_ARM, 3);
+    pxleap_packed_part(l, PXLEAP_PACKED_WRIST, fields & PXLEAP_FIELD_ARM, 3);
+    for (int f = 0; f < 5; f++) pxleap_packed_part(l, PXLEAP_PACKED_THUMB + f, joints > 0, joints * 3);
+    pxleap_packed_part(l, PXLEAP_PACKED_VELOCITY, groups & PXLEAP_FEATURE_VELOCITY, 18);
+    pxleap_packed_part(l, PXLEAP_PACKED_GRIP, groups & PXLEAP_FEATURE_GRIP, 4);
+    pxleap_packed_part(l, PXLEAP_PACKED_CURL, groups & PXLEAP_FEATURE_CURL, 5);
+}
+
+static t_atom *pxleap_packed_floats(t_atom *dst, const float *v, long n)
+{
+    for (long i = 0; i < n; i++) atom_setfloat(dst++, v[i]);
+    return dst;
+}
+
+long pxleap_packed_write(t_atom *dst, const t_pxleap_packed_layout *l, const t_pxleap_plan *plan, const t_pxleap_frame *frame)
+{
+    const LEAP_HAND *hands[PXLEAP_MAX_HANDS] = { NULL, NULL };
+    const t_pxleap_features *features[PXLEAP_MAX_HANDS] = { NULL, NULL };
+
+    atom_setlong(dst + PXLEAP_PACKED_FRAME, (t_atom_long)frame->frame_id);
+    atom_setlong(dst + PXLEAP_PACKED_TIMESTAMP, (t_atom_long)frame->timestamp);
+    atom_setlong(dst + PXLEAP_PACKED_HANDS, (t_atom_long)frame->nHands);
+    atom_setlong(dst + PXLEAP_PACKED_FIELDS, (t_atom_long)l->fields);
+    atom_setlong(dst + PXLEAP_PACKED_GROUPS, (t_atom_long)l->groups);
+    atom_setlong(dst + PXLEAP_PACKED_STRIDE, (t_atom_long)l->stride);
+    for (uint32_t h = 0; h < frame->nHands; h++) {
+        int t = frame->hands[h].type == eLeapHandType_Left ? 0 : 1;
+        hands[t] = &frame->hands[h];
+        features[t] = &frame->features[h];
+    }
+    for (int t = 0; t < PXLEAP_MAX_HANDS; t++) {
+        t_atom *block = dst + PXLEAP_PACKED_HEADER + t * l->stride, *a = block + 2;
+        const LEAP_HAND *hand = hands[t];
+        const t_pxleap_features *f = features[t];
+        if (!hand) {
+            // the same length either way, so nothing downstream has to check before indexing
+            atom_setlong(block, 0);
+            atom_setlong(block + 1, 0);
+            for (long i = 2; i < l->stride; i++) atom_setfloat(block + i, 0.);
+            continue;
+        }
+        atom_setlong(block, 1);
+        atom_setlong(block + 1, (t_atom_long)hand->id);
+        // the plan's steps are in the layout's order, palm to wrist
+        for (long i = 0; i < plan->nsteps; i++) a = pxleap_packed_floats(a, pxleap_plan_read(&plan->steps[i], hand), plan->steps[i].count);
+        for (int d = 0; d < 5 && plan->njoints; d++) {
+            for (long j = 0; j < plan->njoints; j++) a = pxleap_packed_floats(a, hand->digits[d].bones[plan->firstjoint + j].next_joint.v, 3);
+        }
+        if (l->groups & PXLEAP_FEATURE_VELOCITY) {
+            a = pxleap_packed_floats(a, f->palm_velocity, 3);
+            a = pxleap_packed_floats(a, &f->tip_velocity[0][0], 15);
+        }
+        if (l->groups & PXLEAP_FEATURE_GRIP) {
+            atom_setfloat(a++, f->pinch_distance);
+            atom_setfloat(a++, f->pinch_strength);
+            atom_setfloat(a++, f->grab_strength);
+            atom_setfloat(a++, f->grab_angle);
+        }
+        if (l->groups & PXLEAP_FEATURE_CURL) a = pxleap_packed_floats(a, f->curl, 5);
+    }
+    return PXLEAP_PACKED_HEADER + PXLEAP_MAX_HANDS * l->stride;
+}
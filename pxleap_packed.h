@@ -0,0 +1,66 @@
+//
+// pxleap_packed
+//
+// The whole frame as one list, for @output packed and px.ultraleap.unpack. A short header is
+// followed by a block of the same length for each hand, left then right, whether or not it's
+// tracked, so every value sits at an index worked out once from @fields and the features that
+// are on. The header carries both, and unpacking reads straight from the list.
+//
+// author: Andrew Benson
+// contact: pixlpa@gmail.com
+//
+
+#ifndef PXLEAP_PACKED_H
+#define PXLEAP_PACKED_H
+
+#include <stdint.h>
+#include "ext.h"
+#include "pxleap_frame.h"
+#include "pxleap_fields.h"
+
+// header atoms
+#define PXLEAP_PACKED_FRAME 0               // frame id
+#define PXLEAP_PACKED_TIMESTAMP 1           // leap clock in microseconds
+#define PXLEAP_PACKED_HANDS 2               // hands tracked
+#define PXLEAP_PACKED_FIELDS 3              // PXLEAP_FIELD_* the blocks were laid out for
+#define PXLEAP_PACKED_GROUPS 4              // PXLEAP_FEATURE_* the same
+#define PXLEAP_PACKED_STRIDE 5              // atoms per hand block
+#define PXLEAP_PACKED_HEADER 6
+
+// parts of a hand block, in the order they're laid out. present and id are always there.
+#define PXLEAP_PACKED_PRESENT 0             // 1 if the hand is tracked, every other value is 0 if not
+#define PXLEAP_PACKED_ID 1
+#define PXLEAP_PACKED_PALM 2
+#define PXLEAP_PACKED_ORIENTATION 3
+#define PXLEAP_PACKED_NORMAL 4
+#define PXLEAP_PACKED_DIRECTION 5
+#define PXLEAP_PACKED_ELBOW 6
+#define PXLEAP_PACKED_WRIST 7
+#define PXLEAP_PACKED_THUMB 8               // the tip, or all four bone ends with joints. thumb to pinky.
+#define PXLEAP_PACKED_VELOCITY 13           // palm then thumb to pinky tips
+#define PXLEAP_PACKED_GRIP 14               // pinch distance, pinch, grab, grab angle
+#define PXLEAP_PACKED_CURL 15               // thumb to pinky
+#define PXLEAP_PACKED_PARTS 16
+
+// a block with every field and feature
+#define PXLEAP_PACKED_STRIDE_MAX (2 + 3 + 4 + 3 + 3 + 3 + 3 + 5 * 12 + 18 + 4 + 5)
+#define PXLEAP_PACKED_MAX (PXLEAP_PACKED_HEADER + PXLEAP_MAX_HANDS * PXLEAP_PACKED_STRIDE_MAX)
+
+typedef struct _pxleap_packed_layout
+{
+    uint32_t fields;
+    uint32_t groups;
+    long stride;
+    long offset[PXLEAP_PACKED_PARTS];       // from the start of a hand block
+    long count[PXLEAP_PACKED_PARTS];        // 0 for parts that aren't in the list
+} t_pxleap_packed_layout;
+
+// names of the parts, as px.ultraleap.unpack takes them
+extern const char *pxleap_packed_parts[PXLEAP_PACKED_PARTS];
+
+void pxleap_packed_layout(t_pxleap_packed_layout *l, uint32_t fields, uint32_t groups);
+// fills dst with the frame laid out by l, which has to match the plan's fields and the frame's
+// feature groups. returns the atoms written, PXLEAP_PACKED_HEADER + PXLEAP_MAX_HANDS * stride.
+long pxleap_packed_write(t_atom *dst, const t_pxleap_packed_layout *l, const t_pxleap_plan *plan, const t_pxleap_frame *frame);
+
+#endif
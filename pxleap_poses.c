@@ -0,0 +1,577 @@
+//
+// pxleap_poses
+//
+// Hand shapes recognised on the worker thread against a library of named templates, in place
+// of if trees in the patch. A template is the end of every finger bone in the palm's own frame,
+// scaled by palm width, so it matches wherever the hand is, however it's turned and whichever
+// hand makes it. Only changes of label reach the patch.
+//
+// author: Andrew Benson
+// contact: pixlpa@gmail.com
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include "pxleap_poses.h"
+
+// sqrt of PXLEAP_POSES_MAX, the most clusters a library is split into
+#define PXLEAP_POSES_CLUSTERS_MAX 64
+
+// four floats at a time with the compiler's vector extensions, which become NEON on arm64 and
+// SSE on x86 without separate code for each. aligned(4) allows loads from any float.
+typedef float t_pxleap_v4 __attribute__((vector_size(16), aligned(4)));
+
+static t_symbol *ps_pose;
+static t_symbol *ps_none;
+static t_symbol *ps_handtypes[2];
+static t_symbol *ps_add;
+static t_symbol *ps_remove;
+static t_symbol *ps_clear;
+static t_symbol *ps_write;
+static t_symbol *ps_read;
+static t_symbol *ps_empty;
+
+void pxleap_poses_setup(void)
+{
+    ps_pose = gensym("pose");
+    ps_none = gensym("none");
+    ps_handtypes[0] = gensym("left");
+    ps_handtypes[1] = gensym("right");
+    ps_add = gensym("add");
+    ps_remove = gensym("remove");
+    ps_clear = gensym("clear");
+    ps_write = gensym("write");
+    ps_read = gensym("read");
+    ps_empty = gensym("");
+}
+
+void pxleap_poses_init(t_pxleap_poses *p)
+{
+    memset(p, 0, sizeof(*p));
+    p->back = 0;
+    atomic_init(&p->middle, 1);
+    p->front = 2;
+    atomic_init(&p->threshold, 0.25f);
+    atomic_init(&p->hold, 3);
+    p->posethreshold = 0.25;
+    p->posehold = 3;
+    atomic_init(&p->head, 0);
+    atomic_init(&p->tail, 0);
+    atomic_init(&p->dropped, 0);
+    atomic_init(&p->compared, 0);
+    atomic_init(&p->truncated, 0);
+}
+
+static void pxleap_poselib_free(t_pxleap_poselib *lib)
+{
+    if (!lib) return;
+    free(lib->vectors);
+    free(lib->centers);
+    free(lib->labels);
+    free(lib->radius);
+    free(lib->first);
+    free(lib);
+}
+
+void pxleap_poses_free(t_pxleap_poses *p)
+{
+    for (int i = 0; i < 3; i++) {
+        pxleap_poselib_free(p->libs[i]);
+        p->libs[i] = NULL;
+    }
+    free(p->vectors);
+    free(p->labels);
+    p->vectors = NULL;
+    p->labels = NULL;
+    p->count = p->size = 0;
+}
+
+// squared distance between two templates
+static float pxleap_poses_distance(const float *a, const float *b)
+{
+    const t_pxleap_v4 *va = (const t_pxleap_v4 *)a, *vb = (const t_pxleap_v4 *)b;
+    t_pxleap_v4 s0 = { 0.f, 0.f, 0.f, 0.f }, s1 = s0, s2 = s0, s3 = s0;
+    // four sums in flight, so the adds don't wait on each other
+    for (int i = 0; i < PXLEAP_POSES_DIMS / 4; i += 4) {
+        t_pxleap_v4 d0 = va[i] - vb[i], d1 = va[i + 1] - vb[i + 1], d2 = va[i + 2] - vb[i + 2], d3 = va[i + 3] - vb[i + 3];
+        s0 += d0 * d0;
+        s1 += d1 * d1;
+        s2 += d2 * d2;
+        s3 += d3 * d3;
+    }
+    s0 += s1 + s2 + s3;
+    return s0[0] + s0[1] + s0[2] + s0[3];
+}
+
+void pxleap_poses_vector(const LEAP_HAND *hand, float *v)
+{
+    const float *o = hand->palm.position.v, *d = hand->palm.direction.v, *n = hand->palm.normal.v;
+    float up[3] = { -n[0], -n[1], -n[2] };  // the normal points out of the palm, so this is the back of the hand
+    float side[3] = { up[1] * d[2] - up[2] * d[1], up[2] * d[0] - up[0] * d[2], up[0] * d[1] - up[1] * d[0] };
+    float scale = 1.f / (hand->palm.width > 1.f ? hand->palm.width : 80.f);
+    float mirror = hand->type == eLeapHandType_Left ? -scale : scale;
+    long i = 0;
+    for (int f = 0; f < 5; f++) {
+        for (int b = 0; b < 4; b++) {
+            const float *j = hand->digits[f].bones[b].next_joint.v;
+            float r[3] = { j[0] - o[0], j[1] - o[1], j[2] - o[2] };
+            v[i++] = (r[0] * side[0] + r[1] * side[1] + r[2] * side[2]) * mirror;
+            v[i++] = (r[0] * up[0] + r[1] * up[1] + r[2] * up[2]) * scale;
+            v[i++] = (r[0] * d[0] + r[1] * d[1] + r[2] * d[2]) * scale;
+        }
+    }
+    while (i < PXLEAP_POSES_DIMS) v[i++] = 0.f;
+}
+
+static void *pxleap_poses_alignedalloc(size_t bytes)
+{
+    void *ptr = NULL;
+    if (posix_memalign(&ptr, 64, bytes ? bytes : 64)) return NULL;
+    return ptr;
+}
+
+// a copy of the library for the worker, split into about sqrt(count) clusters once it's big
+// enough: farthest-first centers, each template in the cluster of its nearest one
+static t_pxleap_poselib *pxleap_poses_compile(const t_pxleap_poses *p)
+{
+    uint32_t n = p->count, k = 0;
+    uint32_t centers[PXLEAP_POSES_CLUSTERS_MAX], fill[PXLEAP_POSES_CLUSTERS_MAX + 1];
+    uint32_t *cluster = NULL;
+    float *nearest = NULL;
+    t_pxleap_poselib *lib;
+
+    if (!n) return NULL;
+    lib = (t_pxleap_poselib *)calloc(1, sizeof(t_pxleap_poselib));
+    if (!lib) return NULL;
+    lib->count = n;
+    lib->vectors = (float (*)[PXLEAP_POSES_DIMS])pxleap_poses_alignedalloc(n * sizeof(*lib->vectors));
+    lib->labels = (t_symbol **)malloc(n * sizeof(t_symbol *));
+    if (!lib->vectors || !lib->labels) {
+        pxleap_poselib_free(lib);
+        return NULL;
+    }
+    if (n < PXLEAP_POSES_INDEX_MIN) {
+        memcpy(lib->vectors, p->vectors, n * sizeof(*lib->vectors));
+        memcpy(lib->labels, p->labels, n * sizeof(t_symbol *));
+        return lib;
+    }
+
+    k = (uint32_t)ceil(sqrt((double)n));
+    if (k > PXLEAP_POSES_CLUSTERS_MAX) k = PXLEAP_POSES_CLUSTERS_MAX;
+    cluster = (uint32_t *)malloc(n * sizeof(uint32_t));
+    nearest = (float *)malloc(n * sizeof(float));
+    lib->centers = (float (*)[PXLEAP_POSES_DIMS])pxleap_poses_alignedalloc(k * sizeof(*lib->centers));
+    lib->radius = (float *)calloc(k, sizeof(float));
+    lib->first = (uint32_t *)calloc(k + 1, sizeof(uint32_t));
+    if (!cluster || !nearest || !lib->centers || !lib->radius || !lib->first) {
+        free(cluster);
+        free(nearest);
+        pxleap_poselib_free(lib);
+        return NULL;
+    }
+    centers[0] = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        nearest[i] = pxleap_poses_distance(p->vectors[i], p->vectors[0]);
+        cluster[i] = 0;
+    }
+    for (uint32_t c = 1; c < k; c++) {
+        uint32_t far = 0;
+        for (uint32_t i = 1; i < n; i++) {
+            if (nearest[i] > nearest[far]) far = i;
+        }
+        // every template already sits on a center
+        if (nearest[far] <= 0.f) {
+            k = c;
+            break;
+        }
+        centers[c] = far;
+        for (uint32_t i = 0; i < n; i++) {
+            float d = pxleap_poses_distance(p->vectors[i], p->vectors[far]);
+            if (d < nearest[i]) {
+                nearest[i] = d;
+                cluster[i] = c;
+            }
+        }
+    }
+    lib->nclusters = k;
+
+    // templates grouped by cluster, so each one is scanned straight through
+    memset(fill, 0, sizeof(fill));
+    for (uint32_t i = 0; i < n; i++) fill[cluster[i] + 1]++;
+    for (uint32_t c = 0; c < k; c++) fill[c + 1] += fill[c];
+    memcpy(lib->first, fill, (k + 1) * sizeof(uint32_t));
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t c = cluster[i], at = fill[c]++;
+        float r = sqrtf(nearest[i]);
+        memcpy(lib->vectors[at], p->vectors[i], sizeof(*lib->vectors));
+        lib->labels[at] = p->labels[i];
+        if (r > lib->radius[c]) lib->radius[c] = r;
+    }
+    for (uint32_t c = 0; c < k; c++) memcpy(lib->centers[c], p->vectors[centers[c]], sizeof(*lib->centers));
+    free(cluster);
+    free(nearest);
+    return lib;
+}
+
+// hands a newly compiled library to the worker, and frees the one that came back from it
+static int pxleap_poses_publish(t_pxleap_poses *p)
+{
+    t_pxleap_poselib *lib = pxleap_poses_compile(p);
+    uint32_t prev;
+    if (p->count && !lib) return 0;
+    pxleap_poselib_free(p->libs[p->back]);
+    p->libs[p->back] = lib;
+    prev = atomic_exchange_explicit(&p->middle, p->back | PXLEAP_TRIPLEBUF_FRESH, memory_order_acq_rel);
+    p->back = prev & PXLEAP_TRIPLEBUF_INDEX;
+    return 1;
+}
+
+static int pxleap_poses_reserve(t_pxleap_poses *p, uint32_t count)
+{
+    float (*vectors)[PXLEAP_POSES_DIMS];
+    t_symbol **labels;
+    uint32_t size = p->size ? p->size : 64;
+    if (count <= p->size) return 1;
+    while (size < count) size *= 2;
+    vectors = (float (*)[PXLEAP_POSES_DIMS])realloc(p->vectors, size * sizeof(*vectors));
+    if (!vectors) return 0;
+    p->vectors = vectors;
+    labels = (t_symbol **)realloc(p->labels, size * sizeof(t_symbol *));
+    if (!labels) return 0;
+    p->labels = labels;
+    p->size = size;
+    return 1;
+}
+
+int pxleap_poses_add(t_pxleap_poses *p, t_symbol *label, const LEAP_HAND *hand)
+{
+    if (p->count >= PXLEAP_POSES_MAX || !pxleap_poses_reserve(p, p->count + 1)) return 0;
+    pxleap_poses_vector(hand, p->vectors[p->count]);
+    p->labels[p->count] = label;
+    p->count++;
+    if (pxleap_poses_publish(p)) return 1;
+    p->count--;
+    return 0;
+}
+
+uint32_t pxleap_poses_remove(t_pxleap_poses *p, t_symbol *label)
+{
+    uint32_t kept = 0, removed;
+    for (uint32_t i = 0; i < p->count; i++) {
+        if (p->labels[i] == label) continue;
+        if (kept != i) {
+            memcpy(p->vectors[kept], p->vectors[i], sizeof(*p->vectors));
+            p->labels[kept] = p->labels[i];
+        }
+        kept++;
+    }
+    removed = p->count - kept;
+    p->count = kept;
+    if (removed) pxleap_poses_publish(p);
+    return removed;
+}
+
+void pxleap_poses_clear(t_pxleap_poses *p)
+{
+    p->count = 0;
+    pxleap_poses_publish(p);
+}
+
+int pxleap_poses_write(t_pxleap_poses *p, const char *path)
+{
+    t_pxleap_poses_header header;
+    t_pxleap_poses_record record;
+    FILE *file = fopen(path, "wb");
+    int ok;
+    if (!file) return 0;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, PXLEAP_POSES_MAGIC, 8);
+    header.version = PXLEAP_POSES_VERSION;
+    header.points = PXLEAP_POSES_POINTS;
+    header.count = p->count;
+    ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    for (uint32_t i = 0; ok && i < p->count; i++) {
+        memset(&record, 0, sizeof(record));
+        strncpy(record.label, p->labels[i]->s_name, PXLEAP_POSES_LABEL - 1);
+        memcpy(record.v, p->vectors[i], sizeof(record.v));
+        ok = fwrite(&record, sizeof(record), 1, file) == 1;
+    }
+    if (fclose(file)) ok = 0;
+    return ok;
+}
+
+long pxleap_poses_read(t_pxleap_poses *p, const char *path)
+{
+    t_pxleap_poses_header header;
+    t_pxleap_poses_record record;
+    FILE *file = fopen(path, "rb");
+    uint32_t count = 0;
+    if (!file) return -1;
+    if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, PXLEAP_POSES_MAGIC, 8)
+        || header.version != PXLEAP_POSES_VERSION || header.points != PXLEAP_POSES_POINTS || header.count > PXLEAP_POSES_MAX
+        || !pxleap_poses_reserve(p, header.count)) {
+        fclose(file);
+        return -1;
+    }
+    // the library only changes once the whole file has been read
+    for (; count < header.count; count++) {
+        if (fread(&record, sizeof(record), 1, file) != 1) break;
+    }
+    if (count < header.count) {
+        fclose(file);
+        return -1;
+    }
+    fseek(file, (long)sizeof(header), SEEK_SET);
+    for (uint32_t i = 0; i < count; i++) {
+        if (fread(&record, sizeof(record), 1, file) != 1) break;
+        record.label[PXLEAP_POSES_LABEL - 1] = 0;
+        memcpy(p->vectors[i], record.v, sizeof(record.v));
+        memset(p->vectors[i] + PXLEAP_POSES_POINTS * 3, 0, (PXLEAP_POSES_DIMS - PXLEAP_POSES_POINTS * 3) * sizeof(float));
+        p->labels[i] = gensym(record.label);
+    }
+    fclose(file);
+    p->count = count;
+    pxleap_poses_publish(p);
+    return (long)count;
+}
+
+void pxleap_poses_setthreshold(t_pxleap_poses *p, double threshold)
+{
+    p->posethreshold = threshold > 0. ? threshold : 0.;
+    atomic_store_explicit(&p->threshold, (float)p->posethreshold, memory_order_relaxed);
+}
+
+void pxleap_poses_sethold(t_pxleap_poses *p, long frames)
+{
+    p->posehold = frames > 1 ? frames : 1;
+    atomic_store_explicit(&p->hold, (int)p->posehold, memory_order_relaxed);
+}
+
+int pxleap_poses_pop(t_pxleap_poses *p, t_pxleap_pose_event *e)
+{
+    uint64_t tail = atomic_load_explicit(&p->tail, memory_order_relaxed);
+    if (tail == atomic_load_explicit(&p->head, memory_order_acquire)) return 0;
+    *e = p->events[tail % PXLEAP_POSES_EVENTS];
+    atomic_store_explicit(&p->tail, tail + 1, memory_order_release);
+    return 1;
+}
+
+void pxleap_poses_message(t_pxleap_poses *p, t_object *owner, t_pxleap_triplebuf *frames, long argc, t_atom *argv)
+{
+    t_symbol *command = argc ? atom_getsym(argv) : ps_empty;
+    t_symbol *arg = argc > 1 ? atom_getsym(argv + 1) : ps_empty;
+    if (command == ps_add && arg != ps_empty) {
+        t_symbol *only = argc > 2 ? atom_getsym(argv + 2) : NULL;
+        const t_pxleap_frame *frame;
+        long added = 0;
+        if (only && only != ps_handtypes[0] && only != ps_handtypes[1]) {
+            object_error(owner, "pose add takes left or right, not %s", only->s_name);
+            return;
+        }
+        frame = frames ? pxleap_triplebuf_read(frames) : NULL;
+        for (uint32_t h = 0; frame && h < frame->nHands; h++) {
+            const LEAP_HAND *hand = &frame->hands[h];
+            if (only && only != ps_handtypes[hand->type == eLeapHandType_Left ? 0 : 1]) continue;
+            if (!pxleap_poses_add(p, arg, hand)) {
+                object_error(owner, "pose library is full");
+                break;
+            }
+            added++;
+        }
+        if (added) post("pose %s: %ld templates in the library", arg->s_name, (long)p->count);
+        else object_error(owner, "no hand to record pose %s from", arg->s_name);
+    }
+    else if (command == ps_remove && arg != ps_empty) {
+        if (!pxleap_poses_remove(p, arg))
+            object_error(owner, "no pose named %s", arg->s_name);
+    }
+    else if (command == ps_clear) pxleap_poses_clear(p);
+    else if (command == ps_write && arg != ps_empty) {
+        char filename[MAX_PATH_CHARS];
+        char fullpath[MAX_PATH_CHARS];
+        short path;
+        t_fourcc type;
+        // over a file in the search path, or else a new one next to the patcher unless it's a full path
+        strncpy_zero(filename, arg->s_name, MAX_PATH_CHARS);
+        if (locatefile_extended(filename, &path, &type, NULL, 0) || path_toabsolutesystempath(path, filename, fullpath)) {
+            strncpy_zero(filename, arg->s_name, MAX_PATH_CHARS);
+            if (filename[0] == '/' || filename[0] == '\\' || strchr(filename, ':')
+                || path_toabsolutesystempath(path_getdefault(), filename, fullpath))
+                strncpy_zero(fullpath, arg->s_name, MAX_PATH_CHARS);
+        }
+        if (!pxleap_poses_write(p, fullpath))
+            object_error(owner, "could not write poses to %s", arg->s_name);
+    }
+    else if (command == ps_read && arg != ps_empty) {
+        char filename[MAX_PATH_CHARS];
+        char fullpath[MAX_PATH_CHARS];
+        short path;
+        t_fourcc type;
+        long count;
+        // a file in the search path, or else the path as given
+        strncpy_zero(filename, arg->s_name, MAX_PATH_CHARS);
+        if (!locatefile_extended(filename, &path, &type, NULL, 0) && !path_toabsolutesystempath(path, filename, fullpath))
+            count = pxleap_poses_read(p, fullpath);
+        else count = pxleap_poses_read(p, arg->s_name);
+        if (count < 0) object_error(owner, "could not read poses from %s", arg->s_name);
+        else post("read %ld pose templates from %s", count, arg->s_name);
+    }
+    else object_error(owner, "pose needs add <label> [left|right], remove <label>, clear, write <file> or read <file>");
+}
+
+void pxleap_poses_output(t_pxleap_poses *p, t_object *owner, void *outlet)
+{
+    t_pxleap_pose_event e;
+    t_atom a[3];
+    uint64_t dropped;
+    while (pxleap_poses_pop(p, &e)) {
+        atom_setsym(a, ps_handtypes[e.hand]);
+        atom_setsym(a + 1, e.label ? e.label : ps_none);
+        atom_setfloat(a + 2, e.confidence);
+        outlet_anything(outlet, ps_pose, 3, a);
+    }
+    dropped = atomic_load_explicit(&p->dropped, memory_order_relaxed);
+    if (dropped != p->droppedseen) {
+        object_warn(owner, "%llu pose changes dropped before they could go out", (unsigned long long)(dropped - p->droppedseen));
+        p->droppedseen = dropped;
+    }
+}
+
+// keeps the nearest template and the nearest with any other label
+static void pxleap_poses_scan(const t_pxleap_poselib *lib, const float *v, uint32_t first, uint32_t end, t_pxleap_pose_match *m)
+{
+    for (uint32_t i = first; i < end; i++) {
+        float d = pxleap_poses_distance(v, lib->vectors[i]);
+        t_symbol *label = lib->labels[i];
+        if (d < m->distance) {
+            // the old best has another label, and is nearer than any other label was
+            if (label != m->label) m->other = m->distance;
+            m->label = label;
+            m->distance = d;
+        }
+        else if (d < m->other && label != m->label) m->other = d;
+    }
+    m->compared += end - first;
+}
+
+void pxleap_poses_classify(const t_pxleap_poselib *lib, const float *v, uint32_t budget, t_pxleap_pose_match *m)
+{
+    float lower[PXLEAP_POSES_CLUSTERS_MAX];
+    uint32_t order[PXLEAP_POSES_CLUSTERS_MAX];
+    m->label = NULL;
+    m->distance = m->other = FLT_MAX;
+    m->compared = 0;
+    m->truncated = 0;
+    if (!lib) return;
+    if (!lib->nclusters) {
+        uint32_t end = lib->count < budget ? lib->count : budget;
+        pxleap_poses_scan(lib, v, 0, end, m);
+        m->truncated = end < lib->count;
+        return;
+    }
+    // nothing in a cluster is nearer than the distance to its center less its radius
+    for (uint32_t c = 0; c < lib->nclusters; c++) {
+        uint32_t j = c;
+        lower[c] = sqrtf(pxleap_poses_distance(v, lib->centers[c])) - lib->radius[c];
+        while (j > 0 && lower[order[j - 1]] > lower[c]) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = c;
+    }
+    m->compared = lib->nclusters;
+    for (uint32_t o = 0; o < lib->nclusters; o++) {
+        uint32_t c = order[o], first = lib->first[c], end = lib->first[c + 1];
+        // the runner-up bounds the search too, so the confidence is exact as well
+        if (lower[c] > 0.f && lower[c] * lower[c] >= m->other) break;
+        if (m->compared + (end - first) > budget) {
+            end = first + (budget > m->compared ? budget - m->compared : 0);
+            m->truncated = 1;
+        }
+        pxleap_poses_scan(lib, v, first, end, m);
+        if (m->truncated) break;
+    }
+}
+
+static int pxleap_poses_push(t_pxleap_poses *p, t_symbol *label, int hand, float confidence)
+{
+    uint64_t head = atomic_load_explicit(&p->head, memory_order_relaxed);
+    t_pxleap_pose_event *e;
+    if (head - atomic_load_explicit(&p->tail, memory_order_acquire) >= PXLEAP_POSES_EVENTS) {
+        atomic_fetch_add_explicit(&p->dropped, 1, memory_order_relaxed);
+        return 0;
+    }
+    e = &p->events[head % PXLEAP_POSES_EVENTS];
+    e->label = label;
+    e->hand = (uint8_t)hand;
+    e->confidence = confidence;
+    atomic_store_explicit(&p->head, head + 1, memory_order_release);
+    return 1;
+}
+
+int pxleap_poses_apply(t_pxleap_poses *p, const t_pxleap_frame *frame)
+{
+    const t_pxleap_poselib *lib;
+    float threshold = atomic_load_explicit(&p->threshold, memory_order_relaxed);
+    float limit = threshold * threshold * PXLEAP_POSES_POINTS;
+    int hold = atomic_load_explicit(&p->hold, memory_order_relaxed);
+    int queued = 0;
+
+    if (atomic_load_explicit(&p->middle, memory_order_relaxed) & PXLEAP_TRIPLEBUF_FRESH) {
+        uint32_t prev = atomic_exchange_explicit(&p->middle, p->front, memory_order_acq_rel);
+        p->front = prev & PXLEAP_TRIPLEBUF_INDEX;
+    }
+    lib = p->libs[p->front];
+    // nothing to classify and nothing to take back
+    if (!lib && !p->current[0] && !p->current[1] && !p->candidate[0] && !p->candidate[1]) return 0;
+
+    for (int t = 0; t < 2; t++) {
+        const LEAP_HAND *hand = NULL;
+        t_symbol *label = NULL;
+        float confidence = 0.f;
+        for (uint32_t h = 0; h < frame->nHands && !hand; h++) {
+            if ((frame->hands[h].type == eLeapHandType_Left ? 0 : 1) == t) hand = &frame->hands[h];
+        }
+        if (hand && lib) {
+            float v[PXLEAP_POSES_DIMS];
+            t_pxleap_pose_match m;
+            pxleap_poses_vector(hand, v);
+            pxleap_poses_classify(lib, v, PXLEAP_POSES_BUDGET, &m);
+            atomic_fetch_add_explicit(&p->compared, m.compared, memory_order_relaxed);
+            if (m.truncated) atomic_fetch_add_explicit(&p->truncated, 1, memory_order_relaxed);
+            if (m.label && m.distance <= limit) {
+                // 1 on a template, 0 halfway to the threshold or to the nearest other label
+                float nearest = sqrtf(m.distance), other = sqrtf(m.other < limit ? m.other : limit);
+                label = m.label;
+                confidence = other > 0.f ? 1.f - nearest / other : 1.f;
+            }
+        }
+        // a new label has to win hold frames in a row, so a hand passing through a pose doesn't flicker
+        if (label == p->current[t]) {
+            p->candidate[t] = label;
+            p->held[t] = 0;
+            continue;
+        }
+        if (label != p->candidate[t]) {
+            p->candidate[t] = label;
+            p->held[t] = 0;
+        }
+        if (++p->held[t] < hold) continue;
+        p->current[t] = label;
+        p->held[t] = 0;
+        queued += pxleap_poses_push(p, label, t, confidence);
+    }
+    return queued;
+}
+
+void pxleap_poses_reset(t_pxleap_poses *p)
+{
+    for (int t = 0; t < 2; t++) {
+        p->current[t] = p->candidate[t] = NULL;
+        p->held[t] = 0;
+    }
+    atomic_store_explicit(&p->tail, atomic_load_explicit(&p->head, memory_order_relaxed), memory_order_relaxed);
+}
@@ -0,0 +1,154 @@
+//
+// pxleap_poses
+//
+// Hand shapes recognised on the worker thread against a library of named templates, in place
+// of if trees in the patch. A template is the end of every finger bone in the palm's own frame,
+// scaled by palm width, so it matches wherever the hand is, however it's turned and whichever
+// hand makes it. Only changes of label reach the patch.
+//
+// author: Andrew Benson
+// contact: pixlpa@gmail.com
+//
+
+#ifndef PXLEAP_POSES_H
+#define PXLEAP_POSES_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include "ext.h"
+#include "pxleap_frame.h"
+
+#define PXLEAP_POSES_POINTS 20              // the end of each bone, thumb to pinky
+#define PXLEAP_POSES_DIMS 64                // 60 coordinates, padded for the distance kernel
+#define PXLEAP_POSES_MAX 4096
+#define PXLEAP_POSES_LABEL 32               // label characters in a library file, null included
+// libraries at least this big are clustered, so a frame only visits the clusters near it
+#define PXLEAP_POSES_INDEX_MIN 256
+// the most templates one hand is compared against per frame, cluster centers included
+#define PXLEAP_POSES_BUDGET 1024
+#define PXLEAP_POSES_EVENTS 64
+
+// file layout: one t_pxleap_poses_header, then count t_pxleap_poses_record. native endian.
+#define PXLEAP_POSES_MAGIC "PXLEAPP1"
+#define PXLEAP_POSES_VERSION 1
+
+typedef struct _pxleap_poses_header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t points;                        // PXLEAP_POSES_POINTS of the writer
+    uint32_t count;
+    uint32_t reserved;
+} t_pxleap_poses_header;
+
+typedef struct _pxleap_poses_record
+{
+    char label[PXLEAP_POSES_LABEL];
+    float v[PXLEAP_POSES_POINTS * 3];
+} t_pxleap_poses_record;
+
+// what the worker classifies against, compiled by the Max thread and never changed after
+typedef struct _pxleap_poselib
+{
+    uint32_t count;
+    uint32_t nclusters;                     // 0 compares every template
+    float (*vectors)[PXLEAP_POSES_DIMS];    // grouped by cluster
+    t_symbol **labels;
+    float (*centers)[PXLEAP_POSES_DIMS];
+    float *radius;                          // from each center to its farthest template
+    uint32_t *first;                        // first template of each cluster, nclusters + 1 of them
+} t_pxleap_poselib;
+
+// nearest template to a hand, and the nearest one with another label
+typedef struct _pxleap_pose_match
+{
+    t_symbol *label;                        // NULL for an empty library
+    float distance;                         // squared, summed over the coordinates
+    float other;                            // the same for the runner-up label, FLT_MAX if there is none
+    uint32_t compared;
+    int truncated;                          // the budget ran out before every candidate was seen
+} t_pxleap_pose_match;
+
+typedef struct _pxleap_pose_event
+{
+    t_symbol *label;                        // NULL for none
+    uint8_t hand;                           // 0 left, 1 right
+    float confidence;
+} t_pxleap_pose_event;
+
+typedef struct _pxleap_poses
+{
+    // Max thread: the templates as recorded or read
+    float (*vectors)[PXLEAP_POSES_DIMS];
+    t_symbol **labels;
+    uint32_t count, size;
+
+    // compiled libraries handed to the worker like frames, as pointers. the Max thread frees
+    // whatever comes back to it in the back slot.
+    t_pxleap_poselib *libs[3];
+    _Atomic uint32_t middle;                // slot index | PXLEAP_TRIPLEBUF_FRESH
+    uint32_t back;                          // owned by the Max thread
+    uint32_t front;                         // owned by the worker
+
+    _Atomic float threshold;                // RMS distance per point in palm widths, farther is no pose
+    atomic_int hold;                        // frames a new label has to win before it's reported
+
+    // Max thread: @posethreshold and @posehold as set, and dropped changes already reported
+    double posethreshold;
+    long posehold;
+    uint64_t droppedseen;
+
+    // owned by the worker, per hand type
+    t_symbol *current[2];
+    t_symbol *candidate[2];
+    int held[2];
+
+    t_pxleap_pose_event events[PXLEAP_POSES_EVENTS];
+    _Atomic uint64_t head;                  // only written by the worker
+    _Atomic uint64_t tail;                  // only written by the Max thread
+    _Atomic uint64_t dropped;
+    _Atomic uint64_t compared;              // templates compared, for the bench
+    _Atomic uint64_t truncated;             // hands the budget ran out on
+} t_pxleap_poses;
+
+// looks up the symbols of the pose messages, once from each class's main
+void pxleap_poses_setup(void);
+void pxleap_poses_init(t_pxleap_poses *p);
+// only once the worker has stopped classifying
+void pxleap_poses_free(t_pxleap_poses *p);
+
+// the template for a hand: every bone end relative to the palm, in its own frame, in palm widths.
+// left hands are mirrored so a template matches either hand.
+void pxleap_poses_vector(const LEAP_HAND *hand, float *v);
+
+// Max thread: these change the library and hand the worker a new one
+// returns 0 if the library is full or out of memory
+int pxleap_poses_add(t_pxleap_poses *p, t_symbol *label, const LEAP_HAND *hand);
+// returns how many templates had that label
+uint32_t pxleap_poses_remove(t_pxleap_poses *p, t_symbol *label);
+void pxleap_poses_clear(t_pxleap_poses *p);
+// returns 0 if the file can't be written
+int pxleap_poses_write(t_pxleap_poses *p, const char *path);
+// replaces the library with the file's, returns the templates read or -1 if it isn't a library
+long pxleap_poses_read(t_pxleap_poses *p, const char *path);
+// Max thread: the worker picks these up with its next frame
+void pxleap_poses_setthreshold(t_pxleap_poses *p, double threshold);
+void pxleap_poses_sethold(t_pxleap_poses *p, long frames);
+// Max thread: the next change of label, 0 when there are none left
+int pxleap_poses_pop(t_pxleap_poses *p, t_pxleap_pose_event *e);
+// Max thread: the pose message of either object, pose add <label> [left|right] records the hands
+// of the newest frame in frames (NULL while there's no source), then pose remove <label>, clear,
+// write <file> or read <file>. errors are reported against owner.
+void pxleap_poses_message(t_pxleap_poses *p, t_object *owner, t_pxleap_triplebuf *frames, long argc, t_atom *argv);
+// Max thread: every queued change out of outlet as pose <left|right> <label|none> <confidence>,
+// then a warning if any were dropped
+void pxleap_poses_output(t_pxleap_poses *p, t_object *owner, void *outlet);
+
+// nearest templates to v, comparing at most budget of them
+void pxleap_poses_classify(const t_pxleap_poselib *lib, const float *v, uint32_t budget, t_pxleap_pose_match *m);
+// worker side: classifies each hand of the frame and queues the labels that changed, returns how many
+int pxleap_poses_apply(t_pxleap_poses *p, const t_pxleap_frame *frame);
+// every hand back to no pose without events, only while the worker isn't running
+void pxleap_poses_reset(t_pxleap_poses *p);
+
+#endif
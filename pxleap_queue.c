@@ -0,0 +1,72 @@
+//
+// pxleap_queue
+//
+// Single producer / single consumer queue of frames for @drain, so every frame the worker
+// thread receives reaches the Max thread in order instead of only the newest one. A full
+// queue drops the incoming frame and counts it rather than waiting on the Max thread.
+//
+// author: Andrew Benson
+// contact: pixlpa@gmail.com
+//
+
+#include <stdlib.h>
+#include "pxleap_queue.h"
+
+void pxleap_queue_init(t_pxleap_queue *q)
+{
+    q->frames = NULL;
+    atomic_init(&q->head, 0);
+    atomic_init(&q->tail, 0);
+    atomic_init(&q->overflow, 0);
+}
+
+void pxleap_queue_free(t_pxleap_queue *q)
+{
+    free(q->frames);
+    q->frames = NULL;
+    pxleap_queue_clear(q);
+}
+
+int pxleap_queue_enable(t_pxleap_queue *q, int on)
+{
+    pxleap_queue_clear(q);
+    if (!on) {
+        pxleap_queue_free(q);
+        return 1;
+    }
+    if (!q->frames) q->frames = (t_pxleap_frame *)malloc(PXLEAP_QUEUE_FRAMES * sizeof(t_pxleap_frame));
+    return q->frames != NULL;
+}
+
+void pxleap_queue_clear(t_pxleap_queue *q)
+{
+    atomic_store_explicit(&q->tail, atomic_load_explicit(&q->head, memory_order_relaxed), memory_order_relaxed);
+}
+
+int pxleap_queue_push(t_pxleap_queue *q, const t_pxleap_frame *frame)
+{
+    uint64_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    if (!q->frames) return 0;
+    if (head - atomic_load_explicit(&q->tail, memory_order_acquire) >= PXLEAP_QUEUE_FRAMES) {
+        atomic_fetch_add_explicit(&q->overflow, 1, memory_order_relaxed);
+        return 0;
+    }
+    q->frames[head % PXLEAP_QUEUE_FRAMES] = *frame;
+    // the consumer only reads the slot once it sees the new head
+    atomic_store_explicit(&q->head, head + 1, memory_order_release);
+    return 1;
+}
+
+const t_pxleap_frame *pxleap_queue_peek(t_pxleap_queue *q)
+{
+    uint64_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    if (!q->frames || tail == atomic_load_explicit(&q->head, memory_order_acquire)) return NULL;
+    return &q->frames[tail % PXLEAP_QUEUE_FRAMES];
+}
+
+void pxleap_queue_pop(t_pxleap_queue *q)
+{
+    uint64_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    // hands the slot back to the producer once the consumer is done reading it
+    atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+}
@@ -0,0 +1,45 @@
+//
+// pxleap_queue
+//
+// Single producer / single consumer queue of frames for @drain, so every frame the worker
+// thread receives reaches the Max thread in order instead of only the newest one. A full
+// queue drops the incoming frame and counts it rather than waiting on the Max thread.
+//
+// author: Andrew Benson
+// contact: pixlpa@gmail.com
+//
+
+#ifndef PXLEAP_QUEUE_H
+#define PXLEAP_QUEUE_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include "pxleap_frame.h"
+
+// about 2 seconds at 120 Hz between drains
+#define PXLEAP_QUEUE_FRAMES 256
+
+typedef struct _pxleap_queue
+{
+    t_pxleap_frame *frames;                 // PXLEAP_QUEUE_FRAMES slots, NULL while drain is off
+    _Atomic uint64_t head;                  // frames pushed, only written by the producer
+    _Atomic uint64_t tail;                  // frames popped, only written by the consumer
+    _Atomic uint64_t overflow;              // frames dropped because the queue was full
+} t_pxleap_queue;
+
+void pxleap_queue_init(t_pxleap_queue *q);
+// allocates the slots (or frees them when on is 0) and empties the queue. only call while
+// nothing is pushing. returns 0 if the memory can't be had.
+int pxleap_queue_enable(t_pxleap_queue *q, int on);
+void pxleap_queue_free(t_pxleap_queue *q);
+// empties the queue, only while nothing is pushing
+void pxleap_queue_clear(t_pxleap_queue *q);
+
+// producer side: copies frame in, or counts it as overflow and returns 0 when full
+int pxleap_queue_push(t_pxleap_queue *q, const t_pxleap_frame *frame);
+
+// consumer side: the oldest frame, NULL when empty. it stays put until pxleap_queue_pop.
+const t_pxleap_frame *pxleap_queue_peek(t_pxleap_queue *q);
+void pxleap_queue_pop(t_pxleap_queue *q);
+
+#endif
@@ -0,0 +1,237 @@
+//
+// pxleap_record
+//
+// Recording of tracking frames to disk and memory-mapped replay of those recordings,
+// so the objects can run without a device attached
+//
+// author: Andrew Benson
+// contact: pixlpa@gmail.com
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "pxleap_record.h"
+
+// writer thread: everything queued goes out, then the file is flushed so a crash loses little
+static void pxleap_recorder_flush(t_pxleap_recorder *r)
+{
+    uint64_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    uint64_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+    uint64_t bytes = atomic_load_explicit(&r->bytes, memory_order_relaxed);
+    if (tail == head) return;
+    for (; tail < head; tail++) {
+        const t_pxleap_record_frame *f = &r->queue[tail % PXLEAP_RECORD_QUEUE_FRAMES];
+        if (!atomic_load_explicit(&r->failed, memory_order_relaxed)) {
+            if (fwrite(&f->entry, sizeof(f->entry), 1, r->file) != 1
+                || (f->entry.nHands && fwrite(f->hands, sizeof(LEAP_HAND), f->entry.nHands, r->file) != f->entry.nHands))
+                atomic_store_explicit(&r->failed, 1, memory_order_relaxed);
+            else bytes += sizeof(f->entry) + f->entry.nHands * sizeof(LEAP_HAND);
+        }
+        atomic_store_explicit(&r->tail, tail + 1, memory_order_release);
+    }
+    if (fflush(r->file)) atomic_store_explicit(&r->failed, 1, memory_order_relaxed);
+    atomic_store_explicit(&r->bytes, bytes, memory_order_relaxed);
+}
+
+static void *pxleap_recorder_tick(void *arg)
+{
+    t_pxleap_recorder *r = (t_pxleap_recorder *)arg;
+    for (;;) {
+        // frames queued before the cancel are still written
+        int cancel = atomic_load_explicit(&r->cancel, memory_order_acquire);
+        pxleap_recorder_flush(r);
+        if (cancel) break;
+        pxleap_wake_wait(&r->wake, PXLEAP_RECORD_INTERVAL_US);
+    }
+    return NULL;
+}
+
+t_pxleap_recorder *pxleap_recorder_open(const char *path)
+{
+    t_pxleap_record_header header;
+    t_pxleap_recorder *r;
+    FILE *file = fopen(path, "wb");
+    if (!file) return NULL;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, PXLEAP_RECORD_MAGIC, sizeof(header.magic));
+    header.version = PXLEAP_RECORD_VERSION;
+    header.handsize = (uint32_t)sizeof(LEAP_HAND);
+    r = (t_pxleap_recorder *)calloc(1, sizeof(t_pxleap_recorder));
+    if (r) r->queue = (t_pxleap_record_frame *)malloc(PXLEAP_RECORD_QUEUE_FRAMES * sizeof(t_pxleap_record_frame));
+    if (!r || !r->queue || fwrite(&header, sizeof(header), 1, file) != 1 || fflush(file)) {
+        if (r) free(r->queue);
+        free(r);
+        fclose(file);
+        return NULL;
+    }
+    r->file = file;
+    atomic_init(&r->cancel, 0);
+    atomic_init(&r->head, 0);
+    atomic_init(&r->tail, 0);
+    atomic_init(&r->dropped, 0);
+    atomic_init(&r->bytes, sizeof(header));
+    atomic_init(&r->failed, 0);
+    pxleap_wake_init(&r->wake);
+    if (pthread_create(&r->thread, NULL, pxleap_recorder_tick, r)) {
+        pxleap_wake_free(&r->wake);
+        fclose(file);
+        free(r->queue);
+        free(r);
+        return NULL;
+    }
+    return r;
+}
+
+int pxleap_recorder_write(t_pxleap_recorder *r, const t_pxleap_frame *frame)
+{
+    uint64_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    t_pxleap_record_frame *f;
+    if (atomic_load_explicit(&r->failed, memory_order_relaxed)) return 0;
+    if (head - atomic_load_explicit(&r->tail, memory_order_acquire) >= PXLEAP_RECORD_QUEUE_FRAMES) {
+        atomic_fetch_add_explicit(&r->dropped, 1, memory_order_relaxed);
+        return 0;
+    }
+    f = &r->queue[head % PXLEAP_RECORD_QUEUE_FRAMES];
+    f->entry.frame_id = frame->frame_id;
+    f->entry.timestamp = frame->timestamp;
+    f->entry.tracking_frame_id = frame->tracking_frame_id;
+    f->entry.framerate = frame->framerate;
+    f->entry.nHands = frame->nHands;
+    if (frame->nHands) memcpy(f->hands, frame->hands, frame->nHands * sizeof(LEAP_HAND));
+    // the writer only reads the entry once it sees the new head, and never waits for it
+    atomic_store_explicit(&r->head, head + 1, memory_order_release);
+    return 1;
+}
+
+uint64_t pxleap_recorder_count(t_pxleap_recorder *r)
+{
+    return atomic_load_explicit(&r->head, memory_order_relaxed);
+}
+
+uint64_t pxleap_recorder_close(t_pxleap_recorder *r)
+{
+    uint64_t bytes;
+    if (!r) return 0;
+    atomic_store_explicit(&r->cancel, 1, memory_order_release);
+    pxleap_wake_signal(&r->wake);
+    pthread_join(r->thread, NULL);
+    if (fclose(r->file)) atomic_store_explicit(&r->failed, 1, memory_order_relaxed);
+    bytes = atomic_load_explicit(&r->failed, memory_order_relaxed) ? 0 : atomic_load_explicit(&r->bytes, memory_order_relaxed);
+    pxleap_wake_free(&r->wake);
+    free(r->queue);
+    free(r);
+    return bytes;
+}
+
+t_pxleap_replay *pxleap_replay_open(const char *path)
+{
+    struct stat st;
+    t_pxleap_record_header header;
+    t_pxleap_replay *r;
+    void *map;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(header)) {
+        close(fd);
+        return NULL;
+    }
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // the mapping keeps the file alive
+    if (map == MAP_FAILED) return NULL;
+    memcpy(&header, map, sizeof(header));
+    r = (t_pxleap_replay *)calloc(1, sizeof(t_pxleap_replay));
+    if (!r) {
+        munmap(map, (size_t)st.st_size);
+        return NULL;
+    }
+    if (!memcmp(header.magic, PXLEAP_LOG_MAGIC, sizeof(header.magic)))
+        r->log = pxleap_logreader_open((const unsigned char *)map, (size_t)st.st_size);
+    if (!r->log && (memcmp(header.magic, PXLEAP_RECORD_MAGIC, sizeof(header.magic)) != 0
+        || header.version != PXLEAP_RECORD_VERSION
+        || header.handsize != sizeof(LEAP_HAND))) {
+        munmap(map, (size_t)st.st_size);
+        free(r);
+        return NULL;
+    }
+    madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+    r->map = (const unsigned char *)map;
+    r->size = (size_t)st.st_size;
+    pxleap_replay_rewind(r);
+    return r;
+}
+
+void pxleap_replay_close(t_pxleap_replay *r)
+{
+    if (!r) return;
+    pxleap_logreader_close(r->log);
+    munmap((void *)r->map, r->size);
+    free(r);
+}
+
+void pxleap_replay_rewind(t_pxleap_replay *r)
+{
+    r->offset = sizeof(t_pxleap_record_header);
+    r->count = 0;
+    if (r->log) pxleap_logreader_seek(r->log, INT64_MIN);
+}
+
+int pxleap_replay_next(t_pxleap_replay *r, t_pxleap_frame *dst)
+{
+    t_pxleap_record_entry entry;
+    uint32_t nhands;
+    size_t handbytes;
+    if (r->log) {
+        if (!pxleap_logreader_next(r->log, dst)) return 0;
+        r->count++;
+        return 1;
+    }
+    if (r->offset + sizeof(entry) > r->size) return 0;
+    memcpy(&entry, r->map + r->offset, sizeof(entry));
+    handbytes = (size_t)entry.nHands * sizeof(LEAP_HAND);
+    if (r->offset + sizeof(entry) + handbytes > r->size) return 0; // truncated recording
+    nhands = entry.nHands > PXLEAP_MAX_HANDS ? PXLEAP_MAX_HANDS : entry.nHands;
+    dst->frame_id = entry.frame_id;
+    dst->timestamp = entry.timestamp;
+    dst->tracking_frame_id = entry.tracking_frame_id;
+    dst->framerate = entry.framerate;
+    dst->nHands = nhands;
+    dst->featuregroups = 0;
+    if (nhands) memcpy(dst->hands, r->map + r->offset + sizeof(entry), nhands * sizeof(LEAP_HAND));
+    r->offset += sizeof(entry) + handbytes;
+    r->count++;
+    return 1;
+}
+
+int pxleap_replay_seek(t_pxleap_replay *r, int64_t offset)
+{
+    t_pxleap_record_entry entry;
+    int64_t first = 0;
+    pxleap_replay_rewind(r);
+    if (r->log) return pxleap_logreader_seek(r->log, pxleap_logreader_start(r->log) + offset);
+    // only the entry headers are read on the way
+    while (r->offset + sizeof(entry) <= r->size) {
+        memcpy(&entry, r->map + r->offset, sizeof(entry));
+        if (r->offset == sizeof(t_pxleap_record_header)) first = entry.timestamp;
+        if (entry.timestamp - first >= offset) return 1;
+        r->offset += sizeof(entry) + (size_t)entry.nHands * sizeof(LEAP_HAND);
+    }
+    return 0;
+}
+
+int64_t pxleap_replay_delay(t_pxleap_replay *r, int64_t timestamp, double speed)
+{
+    int64_t now = pxleap_now_us();
+    if (speed <= 0.) return 0;
+    // the first frame, or a speed change, restarts the timing base at this frame
+    if (r->count <= 1 || speed != r->speed) {
+        r->first_timestamp = timestamp;
+        r->start_us = now;
+        r->speed = speed;
+        return 0;
+    }
+    return r->start_us + (int64_t)((double)(timestamp - r->first_timestamp) / speed) - now;
+}
@@ -0,0 +1,110 @@
+//
+// pxleap_record
+//
+// Recording of tracking frames to disk and memory-mapped replay of those recordings (and of
+// session logs, see pxleap_log.h), so the objects can run without a device attached. As with
+// logs, the worker only copies each frame into a bounded queue and a writer thread of the
+// recorder's own does the writing.
+//
+// author: Andrew Benson
+// contact: pixlpa@gmail.com
+//
+
+#ifndef PXLEAP_RECORD_H
+#define PXLEAP_RECORD_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "pxleap_frame.h"
+#include "pxleap_log.h"
+#include "pxleap_thread.h"
+
+// file layout: one t_pxleap_record_header, then for every frame a t_pxleap_record_entry
+// followed by nHands raw LEAP_HAND structs. everything is native endian.
+#define PXLEAP_RECORD_MAGIC "PXLEAPR1"
+#define PXLEAP_RECORD_VERSION 1
+
+// frames the worker can get ahead of the writer, about 8 seconds at 120 Hz
+#define PXLEAP_RECORD_QUEUE_FRAMES 1024
+// how often the writer wakes to empty the queue
+#define PXLEAP_RECORD_INTERVAL_US 50000
+
+typedef struct _pxleap_record_header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t handsize;                      // sizeof(LEAP_HAND) of the writer, replay refuses a mismatch
+    uint64_t reserved;
+} t_pxleap_record_header;
+
+typedef struct _pxleap_record_entry
+{
+    int64_t frame_id;
+    int64_t timestamp;
+    int64_t tracking_frame_id;
+    float framerate;
+    uint32_t nHands;
+} t_pxleap_record_entry;
+
+// a frame as the worker hands it over, written out as the entry then its nHands hands
+typedef struct _pxleap_record_frame
+{
+    t_pxleap_record_entry entry;
+    LEAP_HAND hands[PXLEAP_MAX_HANDS];
+} t_pxleap_record_frame;
+
+typedef struct _pxleap_recorder
+{
+    FILE *file;
+    pthread_t thread;
+    t_pxleap_wake wake;
+    atomic_int cancel;
+    t_pxleap_record_frame *queue;           // PXLEAP_RECORD_QUEUE_FRAMES entries
+    _Atomic uint64_t head;                  // frames queued, only written by the worker
+    _Atomic uint64_t tail;                  // frames written, only written by the writer
+    _Atomic uint64_t dropped;               // frames the worker found no room for
+    _Atomic uint64_t bytes;                 // written to the file so far
+    _Atomic int failed;                     // the file refused a write, nothing more is written
+} t_pxleap_recorder;
+
+// creates the file and starts the writer thread, NULL if either fails
+t_pxleap_recorder *pxleap_recorder_open(const char *path);
+// worker side: copies the frame into the queue, or returns 0 when it's full (counted as dropped)
+// or a write has already failed
+int pxleap_recorder_write(t_pxleap_recorder *r, const t_pxleap_frame *frame);
+// frames written (or still queued) so far
+uint64_t pxleap_recorder_count(t_pxleap_recorder *r);
+// lets the writer finish the queue, then closes the file. only call once the worker has stopped
+// writing. returns the size of the file, or 0 if a write to it or closing it failed.
+uint64_t pxleap_recorder_close(t_pxleap_recorder *r);
+
+typedef struct _pxleap_replay
+{
+    const unsigned char *map;               // the whole file, mapped read-only
+    size_t size;
+    size_t offset;                          // read position of the next entry
+    uint64_t count;                         // frames read since the last rewind
+    int64_t first_timestamp;                // recording time of the first frame after a rewind
+    int64_t start_us;                       // wall clock time that frame was played
+    double speed;                           // speed the timing base was taken at
+    t_pxleap_logreader *log;                // decodes the file instead when it's a session log
+} t_pxleap_replay;
+
+// returns NULL if the file can't be mapped or isn't a recording or a log
+t_pxleap_replay *pxleap_replay_open(const char *path);
+void pxleap_replay_close(t_pxleap_replay *r);
+void pxleap_replay_rewind(t_pxleap_replay *r);
+// copies the next recorded frame into dst, returns 0 at the end of the file
+int pxleap_replay_next(t_pxleap_replay *r, t_pxleap_frame *dst);
+// moves to the first frame at least offset microseconds after the first frame of the file and
+// restarts the timing from there. logs jump straight to the right chunk, recordings are walked
+// from the start. returns 0 past the end.
+int pxleap_replay_seek(t_pxleap_replay *r, int64_t offset);
+// microseconds until a frame recorded at timestamp is due at the given speed,
+// speed 1 keeps the original timing and 0 means as fast as possible
+int64_t pxleap_replay_delay(t_pxleap_replay *r, int64_t timestamp, double speed);
+
+#endif
@@ -0,0 +1,243 @@
+//
+// pxleap_shm
+//
+// Frames shared with other processes through a named POSIX shared memory segment.
+// see pxleap_shm.h
+//
+// author: Andrew Benson
+// contact: pixlpa@gmail.com
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "pxleap_shm.h"
+
+#define PXLEAP_SHM_SIZE (sizeof(t_pxleap_shm_header) + PXLEAP_SHM_SLOTS * sizeof(t_pxleap_shm_slot))
+
+// only read while there are no frames, so the time isn't taken per frame
+static int64_t pxleap_shm_now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// shm_open wants a single leading slash
+static int pxleap_shm_name(const char *name, char *dst)
+{
+    size_t length;
+    if (!name || !*name) return 0;
+    if (*name == '/') name++;
+    length = strlen(name);
+    if (!length || length + 2 > PXLEAP_SHM_NAME_MAX || strchr(name, '/')) return 0;
+    dst[0] = '/';
+    memcpy(dst + 1, name, length + 1);
+    return 1;
+}
+
+static t_pxleap_shm_slot *pxleap_shm_slot(const unsigned char *map, uint64_t n)
+{
+    return (t_pxleap_shm_slot *)(map + sizeof(t_pxleap_shm_header) + (n % PXLEAP_SHM_SLOTS) * sizeof(t_pxleap_shm_slot));
+}
+
+t_pxleap_shm *pxleap_shm_create(const char *name)
+{
+    t_pxleap_shm *s = (t_pxleap_shm *)calloc(1, sizeof(t_pxleap_shm));
+    t_pxleap_shm_header *header;
+    struct stat st;
+    int fd;
+    if (!s) return NULL;
+    if (!pxleap_shm_name(name, s->name)) {
+        free(s);
+        return NULL;
+    }
+    // always a new segment, so readers still mapping an old one see it closed and move over
+    shm_unlink(s->name);
+    fd = shm_open(s->name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        free(s);
+        return NULL;
+    }
+    s->size = PXLEAP_SHM_SIZE;
+    if (ftruncate(fd, (off_t)s->size) || fstat(fd, &st)
+        || (s->map = (unsigned char *)mmap(NULL, s->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+        close(fd);
+        shm_unlink(s->name);
+        free(s);
+        return NULL;
+    }
+    close(fd);
+    s->dev = st.st_dev;
+    s->ino = st.st_ino;
+    header = (t_pxleap_shm_header *)s->map;
+    header->version = PXLEAP_SHM_VERSION;
+    header->framesize = sizeof(t_pxleap_frame);
+    header->slots = PXLEAP_SHM_SLOTS;
+    header->slotsize = sizeof(t_pxleap_shm_slot);
+    atomic_store_explicit(&header->closed, 0, memory_order_relaxed);
+    atomic_store_explicit(&header->head, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    memcpy(header->magic, PXLEAP_SHM_MAGIC, 8);
+    return s;
+}
+
+void pxleap_shm_publish(t_pxleap_shm *s, const t_pxleap_frame *frame)
+{
+    t_pxleap_shm_header *header = (t_pxleap_shm_header *)s->map;
+    t_pxleap_shm_slot *slot = pxleap_shm_slot(s->map, s->count);
+    // odd while the frame is half written, so a reader copying it at the same time throws it away
+    atomic_store_explicit(&slot->seq, 2 * s->count + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    memcpy(&slot->frame, frame, sizeof(t_pxleap_frame));
+    atomic_store_explicit(&slot->seq, 2 * s->count + 2, memory_order_release);
+    s->count++;
+    atomic_store_explicit(&header->head, s->count, memory_order_release);
+}
+
+void pxleap_shm_close(t_pxleap_shm *s)
+{
+    struct stat st;
+    int fd;
+    if (!s) return;
+    atomic_store_explicit(&((t_pxleap_shm_header *)s->map)->closed, 1, memory_order_release);
+    munmap(s->map, s->size);
+    // another writer may have taken the name since, and that segment stays
+    fd = shm_open(s->name, O_RDONLY, 0);
+    if (fd >= 0) {
+        if (!fstat(fd, &st) && st.st_dev == s->dev && st.st_ino == s->ino) shm_unlink(s->name);
+        close(fd);
+    }
+    free(s);
+}
+
+t_pxleap_shmreader *pxleap_shmreader_open(const char *name)
+{
+    t_pxleap_shmreader *r = (t_pxleap_shmreader *)calloc(1, sizeof(t_pxleap_shmreader));
+    if (!r) return NULL;
+    if (!pxleap_shm_name(name, r->name)) {
+        free(r);
+        return NULL;
+    }
+    return r;
+}
+
+void pxleap_shmreader_close(t_pxleap_shmreader *r)
+{
+    if (!r) return;
+    if (r->map) munmap((void *)r->map, r->size);
+    free(r);
+}
+
+int pxleap_shmreader_attached(const t_pxleap_shmreader *r)
+{
+    return r->map && !atomic_load_explicit(&((const t_pxleap_shm_header *)r->map)->closed, memory_order_acquire);
+}
+
+// maps whatever segment has the name now, unless it's the one already mapped
+static int pxleap_shmreader_map(t_pxleap_shmreader *r)
+{
+    const t_pxleap_shm_header *header;
+    const unsigned char *map;
+    struct stat st;
+    int fd = shm_open(r->name, O_RDONLY, 0);
+    r->checked = pxleap_shm_now_us();
+    if (fd < 0) return 0;
+    if (fstat(fd, &st) || (r->map && st.st_dev == r->dev && st.st_ino == r->ino) || (size_t)st.st_size < PXLEAP_SHM_SIZE) {
+        close(fd);
+        return 0;
+    }
+    map = (const unsigned char *)mmap(NULL, PXLEAP_SHM_SIZE, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return 0;
+    header = (const t_pxleap_shm_header *)map;
+    if (memcmp(header->magic, PXLEAP_SHM_MAGIC, 8)) {
+        munmap((void *)map, PXLEAP_SHM_SIZE);
+        return 0;
+    }
+    atomic_thread_fence(memory_order_acquire);
+    if (header->version != PXLEAP_SHM_VERSION || header->framesize != sizeof(t_pxleap_frame) || header->slots != PXLEAP_SHM_SLOTS
+        || header->slotsize != sizeof(t_pxleap_shm_slot)) {
+        munmap((void *)map, PXLEAP_SHM_SIZE);
+        return 0;
+    }
+    if (r->map) munmap((void *)r->map, r->size);
+    r->map = map;
+    r->size = PXLEAP_SHM_SIZE;
+    r->dev = st.st_dev;
+    r->ino = st.st_ino;
+    // a new writer counts from 0, start at its newest frame
+    r->next = atomic_load_explicit(&header->head, memory_order_acquire);
+    if (r->next) r->next--;
+    return 1;
+}
+
+// nothing new: look the name up again if the writer closed, or went quiet for a while
+static void pxleap_shmreader_idle(t_pxleap_shmreader *r)
+{
+    int64_t now = pxleap_shm_now_us();
+    if (!r->idle) r->idle = now;
+    if (now - r->checked < PXLEAP_SHM_RECHECK_US) return;
+    if (!pxleap_shmreader_attached(r) || now - r->idle >= PXLEAP_SHM_RECHECK_US) pxleap_shmreader_map(r);
+}
+
+// copies frame n, 0 if the writer has already started on a newer frame in its slot
+static int pxleap_shmreader_copy(const t_pxleap_shmreader *r, uint64_t n, t_pxleap_frame *dst)
+{
+    const t_pxleap_shm_slot *slot = pxleap_shm_slot(r->map, n);
+    uint64_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+    if (seq != 2 * n + 2) return 0;
+    memcpy(dst, &slot->frame, sizeof(t_pxleap_frame));
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&slot->seq, memory_order_relaxed) == seq;
+}
+
+int pxleap_shmreader_next(t_pxleap_shmreader *r, t_pxleap_frame *dst)
+{
+    uint64_t head;
+    if (!r->map) {
+        pxleap_shmreader_idle(r);
+        if (!r->map) return 0;
+    }
+    head = atomic_load_explicit(&((const t_pxleap_shm_header *)r->map)->head, memory_order_acquire);
+    if (head - r->next > PXLEAP_SHM_SLOTS) {
+        r->missed += head - PXLEAP_SHM_SLOTS - r->next;
+        r->next = head - PXLEAP_SHM_SLOTS;
+    }
+    for (; r->next < head; r->next++) {
+        if (pxleap_shmreader_copy(r, r->next, dst)) {
+            r->next++;
+            r->idle = 0;
+            return 1;
+        }
+        // overwritten while it was being copied
+        r->missed++;
+    }
+    pxleap_shmreader_idle(r);
+    return 0;
+}
+
+int pxleap_shmreader_latest(t_pxleap_shmreader *r, t_pxleap_frame *dst)
+{
+    const t_pxleap_shm_header *header;
+    uint64_t head;
+    if (!r->map) {
+        pxleap_shmreader_idle(r);
+        if (!r->map) return 0;
+    }
+    header = (const t_pxleap_shm_header *)r->map;
+    // only fails if the writer lapped the whole ring during one copy
+    while ((head = atomic_load_explicit(&header->head, memory_order_acquire)) > r->next) {
+        if (pxleap_shmreader_copy(r, head - 1, dst)) {
+            r->next = head;
+            r->idle = 0;
+            return 1;
+        }
+    }
+    pxleap_shmreader_idle(r);
+    return 0;
+}
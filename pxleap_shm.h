@@ -0,0 +1,101 @@
+//
+// pxleap_shm
+//
+// Frames shared with other processes on the same machine through a named POSIX shared memory
+// segment, so a second Max instance or an audio process can follow the hands without opening
+// its own tracker connection. The writer copies each frame into a ring of slots, each guarded by
+// a sequence number, and readers copy frames out and check the sequence afterwards. Neither side
+// makes a system call per frame, and a reader never holds the writer up.
+//
+// The reader half only needs this header, pxleap_frame.h, pxleap_shm.c and LeapC.h, so it can be built into
+// programs that aren't Max externals.
+//
+// author: Andrew Benson
+// contact: pixlpa@gmail.com
+//
+
+#ifndef PXLEAP_SHM_H
+#define PXLEAP_SHM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <sys/types.h>
+#include "pxleap_frame.h"
+
+// segment layout: one t_pxleap_shm_header, then PXLEAP_SHM_SLOTS t_pxleap_shm_slot. frames are
+// stored as t_pxleap_frame, so the writer and its readers have to be built from the same headers,
+// which framesize checks.
+#define PXLEAP_SHM_MAGIC "PXLEAPM1"
+#define PXLEAP_SHM_VERSION 1
+// frames a reader can fall behind before it misses any, about half a second at 120 Hz
+#define PXLEAP_SHM_SLOTS 64
+// with a leading /, which is added when it's missing. macOS allows 31 characters.
+#define PXLEAP_SHM_NAME_MAX 64
+// how long a reader waits without frames before it checks whether a new writer took the name
+#define PXLEAP_SHM_RECHECK_US 1000000
+// how often a worker thread with nothing to read looks again, as nothing can wake it across processes
+#define PXLEAP_SHM_POLL_US 1000
+
+typedef struct _pxleap_shm_header
+{
+    char magic[8];                          // written last, so a reader never sees a half made header
+    uint32_t version;
+    uint32_t framesize;                     // sizeof(t_pxleap_frame) of the writer
+    uint32_t slots;
+    uint32_t slotsize;
+    _Atomic uint32_t closed;                // the writer has gone, readers should look for a new one
+    uint32_t reserved;
+    _Atomic uint64_t head;                  // frames published so far
+    uint64_t pad[3];                        // slots start on a new cache line
+} t_pxleap_shm_header;
+
+typedef struct _pxleap_shm_slot
+{
+    _Atomic uint64_t seq;                   // 2n + 1 while frame n is being written, 2n + 2 once it's whole
+    uint64_t pad[7];
+    t_pxleap_frame frame;
+} t_pxleap_shm_slot;
+
+typedef struct _pxleap_shm
+{
+    char name[PXLEAP_SHM_NAME_MAX];
+    unsigned char *map;
+    size_t size;
+    dev_t dev;                              // of the segment, so closing doesn't unlink a newer writer's
+    ino_t ino;
+    uint64_t count;                         // frames published, only touched by the worker
+} t_pxleap_shm;
+
+// creates the segment, replacing any left under that name. NULL if it can't be created.
+t_pxleap_shm *pxleap_shm_create(const char *name);
+// worker side: copies the frame into the next slot
+void pxleap_shm_publish(t_pxleap_shm *s, const t_pxleap_frame *frame);
+// marks the segment closed for its readers and removes the name, only once the worker has stopped publishing
+void pxleap_shm_close(t_pxleap_shm *s);
+
+typedef struct _pxleap_shmreader
+{
+    char name[PXLEAP_SHM_NAME_MAX];
+    const unsigned char *map;               // NULL until a writer has created the segment
+    size_t size;
+    dev_t dev;
+    ino_t ino;
+    uint64_t next;                          // frame number read next
+    uint64_t missed;                        // frames overwritten before pxleap_shmreader_next got to them
+    int64_t idle;                           // when frames stopped coming, 0 while they do
+    int64_t checked;                        // when the name was last looked up
+} t_pxleap_shmreader;
+
+// a reader for the segment of that name, which doesn't have to exist yet. NULL for a bad name.
+t_pxleap_shmreader *pxleap_shmreader_open(const char *name);
+void pxleap_shmreader_close(t_pxleap_shmreader *r);
+// copies the oldest frame not yet read into dst, returns 0 when there is none. a reader that
+// falls more than PXLEAP_SHM_SLOTS behind skips ahead and counts the frames in missed.
+int pxleap_shmreader_next(t_pxleap_shmreader *r, t_pxleap_frame *dst);
+// copies the newest frame into dst and skips everything before it, returns 0 unless it's new
+int pxleap_shmreader_latest(t_pxleap_shmreader *r, t_pxleap_frame *dst);
+// whether the reader is mapped to a segment whose writer is still there
+int pxleap_shmreader_attached(const t_pxleap_shmreader *r);
+
+#endif
@@ -0,0 +1,165 @@
+//
+// pxleap_signal
+//
+// Joint positions for px.ultraleap~. The worker thread keeps the last few frames of the selected
+// joints along with their timestamps, and the audio thread interpolates between them sample by
+// sample, so the signals glide from frame to frame instead of stepping at the tracking rate.
+//
+// author: Andrew Benson
+// contact: pixlpa@gmail.com
+//
+
+#include <string.h>
+#include <math.h>
+#include "pxleap_signal.h"
+
+static const struct
+{
+    const char *name;
+    uint8_t joint;
+} pxleap_signal_joints[] = {
+    { "palm", PXLEAP_JOINT_PALM },
+    { "wrist", PXLEAP_JOINT_WRIST },
+    { "elbow", PXLEAP_JOINT_ELBOW },
+    { "thumb", PXLEAP_JOINT_FINGER(0) + 4 },
+    { "index", PXLEAP_JOINT_FINGER(1) + 4 },
+    { "middle", PXLEAP_JOINT_FINGER(2) + 4 },
+    { "ring", PXLEAP_JOINT_FINGER(3) + 4 },
+    { "pinky", PXLEAP_JOINT_FINGER(4) + 4 },
+};
+
+void pxleap_signal_init(t_pxleap_signal *s)
+{
+    memset(s, 0, sizeof(*s));
+    s->back = 0;
+    atomic_init(&s->middle, 1);
+    s->front = 2;
+}
+
+int pxleap_signal_addjoint(t_pxleap_signal *s, const char *hand, const char *joint)
+{
+    uint8_t h;
+    if (!strcmp(hand, "left")) h = 0;
+    else if (!strcmp(hand, "right")) h = 1;
+    else return 0;
+    if (s->njoints == PXLEAP_SIGNAL_MAX_JOINTS) return 0;
+    for (size_t i = 0; i < sizeof(pxleap_signal_joints) / sizeof(pxleap_signal_joints[0]); i++) {
+        if (strcmp(joint, pxleap_signal_joints[i].name)) continue;
+        s->hand[s->njoints] = h;
+        s->joint[s->njoints] = pxleap_signal_joints[i].joint;
+        s->njoints++;
+        return 1;
+    }
+    return 0;
+}
+
+void pxleap_signal_push(t_pxleap_signal *s, const t_pxleap_frame *frame)
+{
+    t_pxleap_signal_window *w = &s->window;
+    float joints[PXLEAP_MAX_HANDS][PXLEAP_JOINT_COUNT * 3];
+    int present[PXLEAP_MAX_HANDS] = { 0, 0 };
+    uint32_t channels = s->njoints * 3;
+    float *dst;
+    uint32_t prev;
+
+    for (uint32_t h = 0; h < frame->nHands; h++) {
+        int type = frame->hands[h].type == eLeapHandType_Left ? 0 : 1;
+        pxleap_hand_joints(&frame->hands[h], joints[type]);
+        present[type] = 1;
+    }
+    // drop the oldest frame once the window is full
+    if (w->count == PXLEAP_SIGNAL_FRAMES) {
+        memmove(w->timestamps, w->timestamps + 1, (PXLEAP_SIGNAL_FRAMES - 1) * sizeof(w->timestamps[0]));
+        memmove(w->values, w->values + 1, (PXLEAP_SIGNAL_FRAMES - 1) * sizeof(w->values[0]));
+        w->count--;
+    }
+    dst = w->values[w->count];
+    for (uint32_t j = 0; j < s->njoints; j++) {
+        if (present[s->hand[j]]) memcpy(dst + j * 3, joints[s->hand[j]] + s->joint[j] * 3, 3 * sizeof(float));
+        else if (w->count) memcpy(dst + j * 3, w->values[w->count - 1] + j * 3, 3 * sizeof(float));
+        else memset(dst + j * 3, 0, 3 * sizeof(float));
+    }
+    w->timestamps[w->count++] = frame->timestamp;
+
+    // copy only what's in use into the back slot, then swap it in
+    s->slots[s->back].count = w->count;
+    memcpy(s->slots[s->back].timestamps, w->timestamps, sizeof(w->timestamps));
+    for (uint32_t f = 0; f < w->count; f++) memcpy(s->slots[s->back].values[f], w->values[f], channels * sizeof(float));
+    prev = atomic_exchange_explicit(&s->middle, s->back | PXLEAP_TRIPLEBUF_FRESH, memory_order_acq_rel);
+    s->back = prev & PXLEAP_TRIPLEBUF_INDEX;
+}
+
+static const t_pxleap_signal_window *pxleap_signal_read(t_pxleap_signal *s)
+{
+    if (atomic_load_explicit(&s->middle, memory_order_relaxed) & PXLEAP_TRIPLEBUF_FRESH) {
+        uint32_t prev = atomic_exchange_explicit(&s->middle, s->front, memory_order_acq_rel);
+        s->front = prev & PXLEAP_TRIPLEBUF_INDEX;
+        s->hasframe = 1;
+    }
+    return s->hasframe ? &s->slots[s->front] : NULL;
+}
+
+// n samples of every channel on a straight line from a at time ta to b at time tb, starting at t
+static void pxleap_signal_ramp(double **outs, long offset, long n, uint32_t channels, const float *a, const float *b, double ta, double tb, double t, double step)
+{
+    double span = tb - ta;
+    for (uint32_t c = 0; c < channels; c++) {
+        double *out = outs[c] + offset;
+        double slope = span > 0. ? ((double)b[c] - (double)a[c]) / span : 0.;
+        double v = (double)a[c] + slope * (t - ta);
+        double inc = slope * step;
+        // no dependency between samples, so this vectorizes
+        for (long i = 0; i < n; i++) out[i] = v + inc * (double)i;
+    }
+}
+
+void pxleap_signal_render(t_pxleap_signal *s, double now, double step, double **outs, long n)
+{
+    const t_pxleap_signal_window *w = pxleap_signal_read(s);
+    uint32_t channels = s->njoints * 3;
+    double t;
+    long i = 0;
+
+    if (!w || !w->count) {
+        for (uint32_t c = 0; c < channels; c++) memset(outs[c], 0, (size_t)n * sizeof(double));
+        return;
+    }
+    if (!s->clockset || fabs(now - s->clock) > PXLEAP_SIGNAL_RESYNC_US) {
+        s->clock = now;
+        s->clockset = 1;
+    }
+    else {
+        // vectors are computed in bursts, so only lean towards the target a little per vector, and
+        // spread that over the vector by running the clock slightly fast or slow instead of jumping
+        double limit = (double)n * step * PXLEAP_SIGNAL_SLEW;
+        double adjust = (now - s->clock) * 0.01;
+        adjust = adjust > limit ? limit : (adjust < -limit ? -limit : adjust);
+        step += adjust / (double)n;
+    }
+
+    t = s->clock;
+    while (i < n) {
+        long run = n - i;
+        uint32_t k = 0;
+        // the first frame newer than t, the signal sits on the line from the one before it
+        while (k < w->count && (double)w->timestamps[k] <= t) k++;
+        if (k == w->count || k == 0) {
+            // past the newest frame or before the oldest, hold it
+            const float *v = w->values[k ? k - 1 : 0];
+            if (k == 0) {
+                long until = (long)ceil(((double)w->timestamps[0] - t) / step);
+                if (until < run) run = until < 1 ? 1 : until;
+            }
+            pxleap_signal_ramp(outs, i, run, channels, v, v, 0., 0., 0., step);
+        }
+        else {
+            double ta = (double)w->timestamps[k - 1], tb = (double)w->timestamps[k];
+            long until = (long)ceil((tb - t) / step);
+            if (until < run) run = until < 1 ? 1 : until;
+            pxleap_signal_ramp(outs, i, run, channels, w->values[k - 1], w->values[k], ta, tb, t, step);
+        }
+        i += run;
+        t += (double)run * step;
+    }
+    s->clock = t;
+}
@@ -0,0 +1,72 @@
+//
+// pxleap_signal
+//
+// Joint positions for px.ultraleap~. The worker thread keeps the last few frames of the selected
+// joints along with their timestamps, and the audio thread interpolates between them sample by
+// sample, so the signals glide from frame to frame instead of stepping at the tracking rate.
+//
+// author: Andrew Benson
+// contact: pixlpa@gmail.com
+//
+
+#ifndef PXLEAP_SIGNAL_H
+#define PXLEAP_SIGNAL_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include "pxleap_frame.h"
+
+#define PXLEAP_SIGNAL_MAX_JOINTS 16
+#define PXLEAP_SIGNAL_MAX_CHANNELS (PXLEAP_SIGNAL_MAX_JOINTS * 3)
+// frames held for interpolation, about 60 ms at 120 Hz so a clock running late still lands between frames
+#define PXLEAP_SIGNAL_FRAMES 8
+// the audio clock jumps to the tracker's time instead of gliding towards it when it's this far off
+#define PXLEAP_SIGNAL_RESYNC_US 50000
+// and otherwise runs at most this much fast or slow to catch up
+#define PXLEAP_SIGNAL_SLEW 0.02
+
+// the most recent frames of the selected joints, oldest first
+typedef struct _pxleap_signal_window
+{
+    uint32_t count;
+    int64_t timestamps[PXLEAP_SIGNAL_FRAMES];   // leap clock in microseconds
+    float values[PXLEAP_SIGNAL_FRAMES][PXLEAP_SIGNAL_MAX_CHANNELS];
+} t_pxleap_signal_window;
+
+typedef struct _pxleap_signal
+{
+    // set up on the Max thread before any frames arrive
+    uint32_t njoints;
+    uint8_t hand[PXLEAP_SIGNAL_MAX_JOINTS];     // 0 for left, 1 for right
+    uint8_t joint[PXLEAP_SIGNAL_MAX_JOINTS];    // PXLEAP_JOINT_* cell
+
+    // worker side
+    t_pxleap_signal_window window;
+
+    // worker to audio thread, the same scheme as t_pxleap_triplebuf
+    t_pxleap_signal_window slots[3];
+    _Atomic uint32_t middle;
+    uint32_t back;
+    uint32_t front;
+    uint32_t hasframe;
+
+    // audio thread
+    double clock;                               // leap clock time of the next sample, in microseconds
+    int clockset;
+} t_pxleap_signal;
+
+void pxleap_signal_init(t_pxleap_signal *s);
+// selects one more joint by hand (left or right) and name (palm wrist elbow thumb index middle
+// ring pinky, the fingers meaning their tips). returns 0 for an unknown name or when full.
+int pxleap_signal_addjoint(t_pxleap_signal *s, const char *hand, const char *joint);
+
+// worker side: adds a frame. a hand that isn't tracked holds its last position.
+void pxleap_signal_push(t_pxleap_signal *s, const t_pxleap_frame *frame);
+
+// audio thread: writes n samples to each of the njoints * 3 outputs (x y z per joint). now is the
+// leap clock time the vector should start at and step the microseconds per sample. the clock
+// glides towards now from vector to vector, so jitter in when the vectors are computed doesn't
+// reach the signals.
+void pxleap_signal_render(t_pxleap_signal *s, double now, double step, double **outs, long n);
+
+#endif
@@ -0,0 +1,176 @@
+//
+// pxleap_stats
+//
+// Cheap counters kept on every frame and every output, so a stuttering rig can be traced to
+// the tracker, the worker thread or the patch. Each side only adds to its own counters and
+// the Max thread sums them up into a report when asked.
+//
+// author: Andrew Benson
+// contact: pixlpa@gmail.com
+//
+
+#include <string.h>
+#include "pxleap_frame.h"
+#include "pxleap_stats.h"
+
+static t_symbol *ps_stats;
+static t_symbol *ps_framerate;
+static t_symbol *ps_frames;
+static t_symbol *ps_pollfailures;
+static t_symbol *ps_worker;
+static t_symbol *ps_handoff;
+static t_symbol *ps_age;
+static t_symbol *ps_outputcost;
+static t_symbol *ps_histogram;
+
+static void pxleap_stats_startwindow(t_pxleap_stats *s, uint64_t pollfailures)
+{
+    s->outputs = 0;
+    s->skipped = 0;
+    memset(&s->handoff, 0, sizeof(s->handoff));
+    memset(&s->age, 0, sizeof(s->age));
+    memset(&s->cost, 0, sizeof(s->cost));
+    memset(s->histogram, 0, sizeof(s->histogram));
+    s->windowstart = pxleap_now_ns();
+    s->frames0 = atomic_load_explicit(&s->frames, memory_order_relaxed);
+    s->worktotal0 = atomic_load_explicit(&s->worktotal, memory_order_relaxed);
+    s->pollfailures0 = pollfailures;
+}
+
+void pxleap_stats_setup(void)
+{
+    ps_stats = gensym("stats");
+    ps_framerate = gensym("framerate");
+    ps_frames = gensym("frames");
+    ps_pollfailures = gensym("pollfailures");
+    ps_worker = gensym("worker");
+    ps_handoff = gensym("handoff");
+    ps_age = gensym("age");
+    ps_outputcost = gensym("output");
+    ps_histogram = gensym("histogram");
+}
+
+void pxleap_stats_init(t_pxleap_stats *s, void *owner, method tick)
+{
+    atomic_init(&s->frames, 0);
+    atomic_init(&s->worktotal, 0);
+    atomic_init(&s->workmax, 0);
+    pxleap_stats_startwindow(s, 0);
+    s->clock = clock_new(owner, tick);
+    s->interval = 0.;
+}
+
+void pxleap_stats_free(t_pxleap_stats *s)
+{
+    object_free(s->clock);
+    s->clock = NULL;
+}
+
+static void pxleap_stats_add(t_pxleap_stats_timing *t, int64_t ns)
+{
+    uint64_t v = ns > 0 ? (uint64_t)ns : 0;
+    t->count++;
+    t->total += v;
+    if (v > t->max) t->max = v;
+}
+
+void pxleap_stats_output(t_pxleap_stats *s, int64_t skipped, int64_t handoff, int64_t age, int64_t cost)
+{
+    int bucket = 0;
+    s->outputs++;
+    if (skipped > 0) s->skipped += (uint64_t)skipped;
+    if (handoff >= 0) pxleap_stats_add(&s->handoff, handoff);
+    pxleap_stats_add(&s->age, age);
+    pxleap_stats_add(&s->cost, cost);
+    for (int64_t us = cost / 1000; us && bucket < PXLEAP_STATS_BUCKETS - 1; us >>= 1) bucket++;
+    s->histogram[bucket]++;
+}
+
+// mean and max in the given unit
+static void pxleap_stats_summary(const t_pxleap_stats_timing *t, double unit, double *dst)
+{
+    dst[0] = t->count ? (double)t->total / (double)t->count / unit : 0.;
+    dst[1] = (double)t->max / unit;
+}
+
+void pxleap_stats_report(t_pxleap_stats *s, uint64_t pollfailures, t_pxleap_stats_report *r)
+{
+    uint64_t frames = atomic_load_explicit(&s->frames, memory_order_relaxed);
+    uint64_t worktotal = atomic_load_explicit(&s->worktotal, memory_order_relaxed);
+    t_pxleap_stats_timing work;
+
+    r->seconds = (double)(pxleap_now_ns() - s->windowstart) / 1e9;
+    r->frames = frames - s->frames0;
+    r->framerate = r->seconds > 0. ? (double)r->frames / r->seconds : 0.;
+    r->outputs = s->outputs;
+    r->skipped = s->skipped;
+    r->pollfailures = pollfailures - s->pollfailures0;
+    work.count = r->frames;
+    work.total = worktotal - s->worktotal0;
+    work.max = atomic_exchange_explicit(&s->workmax, 0, memory_order_relaxed);
+    pxleap_stats_summary(&work, 1e3, r->work);
+    pxleap_stats_summary(&s->handoff, 1e6, r->handoff);
+    pxleap_stats_summary(&s->age, 1e6, r->age);
+    pxleap_stats_summary(&s->cost, 1e3, r->cost);
+    memcpy(r->histogram, s->histogram, sizeof(r->histogram));
+    pxleap_stats_startwindow(s, pollfailures);
+}
+
+void pxleap_stats_count(t_pxleap_stats *s, const t_pxleap_frame *frame, int64_t lastframeid, int64_t clockoffset, int64_t start, bool fresh)
+{
+    int64_t now = pxleap_now_ns();
+    int64_t leapnow = (int64_t)(systimer_gettime() * 1000.) + clockoffset;
+    // tracking frames skipped since the last output, how long the frame waited for the Max
+    // thread, how old it is and what the output cost
+    int64_t skipped = fresh && lastframeid ? frame->tracking_frame_id - lastframeid - 1 : 0;
+    pxleap_stats_output(s, skipped, fresh ? start - frame->published : -1, (leapnow - frame->timestamp) * 1000, now - start);
+}
+
+void pxleap_stats_send(t_pxleap_stats *s, uint64_t pollfailures, void *outlet)
+{
+    t_pxleap_stats_report r;
+    t_atom a[PXLEAP_STATS_BUCKETS + 1];
+    pxleap_stats_report(s, pollfailures, &r);
+    atom_setsym(a, ps_framerate);
+    atom_setfloat(a + 1, r.framerate);
+    outlet_anything(outlet, ps_stats, 2, a);
+    atom_setsym(a, ps_frames);
+    atom_setlong(a + 1, (t_atom_long)r.frames);
+    atom_setlong(a + 2, (t_atom_long)r.outputs);
+    atom_setlong(a + 3, (t_atom_long)r.skipped);
+    outlet_anything(outlet, ps_stats, 4, a);
+    atom_setsym(a, ps_pollfailures);
+    atom_setlong(a + 1, (t_atom_long)r.pollfailures);
+    outlet_anything(outlet, ps_stats, 2, a);
+    atom_setsym(a, ps_worker);
+    atom_setfloat(a + 1, r.work[0]);
+    atom_setfloat(a + 2, r.work[1]);
+    outlet_anything(outlet, ps_stats, 3, a);
+    atom_setsym(a, ps_handoff);
+    atom_setfloat(a + 1, r.handoff[0]);
+    atom_setfloat(a + 2, r.handoff[1]);
+    outlet_anything(outlet, ps_stats, 3, a);
+    atom_setsym(a, ps_age);
+    atom_setfloat(a + 1, r.age[0]);
+    atom_setfloat(a + 2, r.age[1]);
+    outlet_anything(outlet, ps_stats, 3, a);
+    atom_setsym(a, ps_outputcost);
+    atom_setfloat(a + 1, r.cost[0]);
+    atom_setfloat(a + 2, r.cost[1]);
+    outlet_anything(outlet, ps_stats, 3, a);
+    atom_setsym(a, ps_histogram);
+    for (int i = 0; i < PXLEAP_STATS_BUCKETS; i++) atom_setlong(a + 1 + i, (t_atom_long)r.histogram[i]);
+    outlet_anything(outlet, ps_stats, PXLEAP_STATS_BUCKETS + 1, a);
+}
+
+void pxleap_stats_setinterval(t_pxleap_stats *s, double interval)
+{
+    s->interval = interval < 0. ? 0. : interval;
+    if (s->interval > 0.) clock_fdelay(s->clock, s->interval);
+    else clock_unset(s->clock);
+}
+
+void pxleap_stats_schedule(t_pxleap_stats *s)
+{
+    if (s->interval > 0.) clock_fdelay(s->clock, s->interval);
+}
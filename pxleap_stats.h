@@ -0,0 +1,108 @@
+//
+// pxleap_stats
+//
+// Cheap counters kept on every frame and every output, so a stuttering rig can be traced to
+// the tracker, the worker thread or the patch. Each side only adds to its own counters and
+// the Max thread sums them up into a report when asked.
+//
+// author: Andrew Benson
+// contact: pixlpa@gmail.com
+//
+
+#ifndef PXLEAP_STATS_H
+#define PXLEAP_STATS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "ext.h"
+#include "pxleap_frame.h"
+
+// output cost histogram: under 1 us, 1-2 us, 2-4 us and so on, the last bucket is 1 ms and over
+#define PXLEAP_STATS_BUCKETS 12
+
+// a duration summed over a window, in nanoseconds
+typedef struct _pxleap_stats_timing
+{
+    uint64_t count;
+    uint64_t total;
+    uint64_t max;
+} t_pxleap_stats_timing;
+
+typedef struct _pxleap_stats
+{
+    // worker side, written by whichever thread delivers frames to the object
+    _Atomic uint64_t frames;
+    _Atomic uint64_t worktotal;             // ns from a frame arriving to it being published
+    _Atomic uint64_t workmax;               // reset by each report
+
+    // Max thread side, for the current window
+    uint64_t outputs;
+    uint64_t skipped;                       // tracking frames that were never output
+    t_pxleap_stats_timing handoff;          // from publish to the Max thread picking the frame up
+    t_pxleap_stats_timing age;              // from the tracker's timestamp to output
+    t_pxleap_stats_timing cost;             // output time per bang
+    uint64_t histogram[PXLEAP_STATS_BUCKETS];
+
+    // where the current window started
+    int64_t windowstart;
+    uint64_t frames0;
+    uint64_t worktotal0;
+    uint64_t pollfailures0;
+
+    // Max thread: the clock behind @statsinterval
+    void *clock;
+    double interval;                        // ms, 0 for no regular reports
+} t_pxleap_stats;
+
+// one window, means and maxima are 0 when nothing was counted
+typedef struct _pxleap_stats_report
+{
+    double seconds;
+    double framerate;                       // frames received per second
+    uint64_t frames;
+    uint64_t outputs;
+    uint64_t skipped;
+    uint64_t pollfailures;
+    double work[2];                         // mean and max, us
+    double handoff[2];                      // ms
+    double age[2];                          // ms
+    double cost[2];                         // us
+    uint64_t histogram[PXLEAP_STATS_BUCKETS];
+} t_pxleap_stats_report;
+
+// looks up the symbols of the stats messages, once from each class's main
+void pxleap_stats_setup(void);
+// tick is called on owner every interval once one is set, and should send a report then reschedule
+void pxleap_stats_init(t_pxleap_stats *s, void *owner, method tick);
+void pxleap_stats_free(t_pxleap_stats *s);
+
+// worker side: a frame that arrived and was published at these pxleap_now_ns() times.
+// only one thread delivers frames at a time, so plain loads and stores do instead of locked adds.
+static inline void pxleap_stats_frame(t_pxleap_stats *s, int64_t arrived, int64_t published)
+{
+    uint64_t work = published > arrived ? (uint64_t)(published - arrived) : 0;
+    uint64_t max = atomic_load_explicit(&s->workmax, memory_order_relaxed);
+    atomic_store_explicit(&s->frames, atomic_load_explicit(&s->frames, memory_order_relaxed) + 1, memory_order_relaxed);
+    atomic_store_explicit(&s->worktotal, atomic_load_explicit(&s->worktotal, memory_order_relaxed) + work, memory_order_relaxed);
+    // the report zeroes the maximum, so don't write back over that with an older one
+    while (work > max && !atomic_compare_exchange_weak_explicit(&s->workmax, &max, work, memory_order_relaxed, memory_order_relaxed));
+}
+
+// Max thread: one output, all in ns. handoff is negative when the frame was already output before.
+void pxleap_stats_output(t_pxleap_stats *s, int64_t skipped, int64_t handoff, int64_t age, int64_t cost);
+// Max thread: everything since the previous report (or init), then starts a new window.
+// pollfailures is the running total from the connection, if there is one.
+void pxleap_stats_report(t_pxleap_stats *s, uint64_t pollfailures, t_pxleap_stats_report *r);
+
+// Max thread: one output of frame that started at start (pxleap_now_ns()), against the tracking
+// frame output before it. clockoffset is the leap clock minus Max system time in microseconds.
+void pxleap_stats_count(t_pxleap_stats *s, const t_pxleap_frame *frame, int64_t lastframeid, int64_t clockoffset, int64_t start, bool fresh);
+// Max thread: takes a report and sends it out of outlet, one stats <measure> <values> message per measure
+void pxleap_stats_send(t_pxleap_stats *s, uint64_t pollfailures, void *outlet);
+// Max thread: sets the report interval in ms, 0 or less turns regular reports off
+void pxleap_stats_setinterval(t_pxleap_stats *s, double interval);
+// Max thread: from the tick, schedules the next report if there's an interval
+void pxleap_stats_schedule(t_pxleap_stats *s);
+
+#endif
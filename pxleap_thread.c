@@ -0,0 +1,87 @@
+//
+// pxleap_thread
+//
+// What the worker threads block on: a wake-up the Max thread can signal to cut any wait short,
+// so the workers sleep while idle and still stop or pick up new work straight away
+//
+// author: Andrew Benson
+// contact: pixlpa@gmail.com
+//
+
+#include <time.h>
+#include <errno.h>
+#ifdef __APPLE__
+#include <pthread/qos.h>
+#endif
+#include "pxleap_thread.h"
+
+void pxleap_wake_init(t_pxleap_wake *w)
+{
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+#ifndef __APPLE__
+    // timed waits measure against the monotonic clock, so wall clock changes can't stretch them
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+#endif
+    pthread_mutex_init(&w->mutex, NULL);
+    pthread_cond_init(&w->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    w->pending = 0;
+}
+
+void pxleap_wake_free(t_pxleap_wake *w)
+{
+    pthread_cond_destroy(&w->cond);
+    pthread_mutex_destroy(&w->mutex);
+}
+
+void pxleap_wake_signal(t_pxleap_wake *w)
+{
+    pthread_mutex_lock(&w->mutex);
+    w->pending++;
+    pthread_cond_signal(&w->cond);
+    pthread_mutex_unlock(&w->mutex);
+}
+
+int pxleap_wake_wait(t_pxleap_wake *w, int64_t timeout)
+{
+    int err = 0, signaled;
+    struct timespec ts;
+    if (timeout >= 0) {
+#ifdef __APPLE__
+        ts.tv_sec = (time_t)(timeout / 1000000);
+        ts.tv_nsec = (long)(timeout % 1000000) * 1000;
+#else
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        ts.tv_sec += (time_t)(timeout / 1000000);
+        ts.tv_nsec += (long)(timeout % 1000000) * 1000;
+        if (ts.tv_nsec >= 1000000000) {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000;
+        }
+#endif
+    }
+    pthread_mutex_lock(&w->mutex);
+    while (!w->pending && err != ETIMEDOUT) {
+        if (timeout < 0) err = pthread_cond_wait(&w->cond, &w->mutex);
+#ifdef __APPLE__
+        else err = pthread_cond_timedwait_relative_np(&w->cond, &w->mutex, &ts);
+#else
+        else err = pthread_cond_timedwait(&w->cond, &w->mutex, &ts);
+#endif
+    }
+    signaled = w->pending != 0;
+    w->pending = 0;
+    pthread_mutex_unlock(&w->mutex);
+    return signaled;
+}
+
+int pxleap_thread_setinteractive(void)
+{
+#ifdef __APPLE__
+    return pthread_set_qos_class_self_np(QOS_CLASS_USER_INTERACTIVE, 0) == 0;
+#else
+    // raising a thread's priority elsewhere needs privileges Max doesn't run with
+    return 0;
+#endif
+}
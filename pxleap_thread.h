@@ -0,0 +1,42 @@
+//
+// pxleap_thread
+//
+// What the worker threads block on: a wake-up the Max thread can signal to cut any wait short,
+// so the workers sleep while idle and still stop or pick up new work straight away
+//
+// author: Andrew Benson
+// contact: pixlpa@gmail.com
+//
+
+#ifndef PXLEAP_THREAD_H
+#define PXLEAP_THREAD_H
+
+#include <stdint.h>
+#include <pthread.h>
+
+// how long LeapPollConnection may block, which bounds how late a stop request is seen while
+// connected but without frames coming in. tracking frames usually cut it short.
+#define PXLEAP_POLL_TIMEOUT_MS 10
+
+// how long to wait before polling again after LeapC reports an error instead of a timeout
+#define PXLEAP_RETRY_US 250000
+
+typedef struct _pxleap_wake
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    uint32_t pending;                       // signals not yet consumed by a wait
+} t_pxleap_wake;
+
+void pxleap_wake_init(t_pxleap_wake *w);
+void pxleap_wake_free(t_pxleap_wake *w);
+// wakes the waiting thread, or makes its next wait return at once
+void pxleap_wake_signal(t_pxleap_wake *w);
+// blocks for up to timeout microseconds, or until signaled when timeout is negative.
+// returns 1 if it was signaled, 0 on timeout.
+int pxleap_wake_wait(t_pxleap_wake *w, int64_t timeout);
+
+// puts the calling thread in the interactive QoS class on macOS. returns 0 if that isn't available.
+int pxleap_thread_setinteractive(void);
+
+#endif
@@ -0,0 +1,415 @@
+//
+// pxleap_zones
+//
+// Trigger zones tested against the palm and fingertips on the worker thread. Boxes, spheres
+// and planes are defined by message, and only entering, leaving or dwelling in one reaches the
+// patch, so nothing goes out while the hands stay put. Finite zones are binned into a coarse
+// grid, so each joint only tests the zones around it.
+//
+// author: Andrew Benson
+// contact: pixlpa@gmail.com
+//
+
+#include <string.h>
+#include <math.h>
+#include "pxleap_zones.h"
+
+const char *pxleap_zones_probes[PXLEAP_ZONES_PROBES] = { "palm", "thumb", "index", "middle", "ring", "pinky" };
+
+static t_symbol *ps_zone;
+static t_symbol *ps_events[3];
+static t_symbol *ps_probes[PXLEAP_ZONES_PROBES];
+static t_symbol *ps_handtypes[2];
+static t_symbol *ps_add;
+static t_symbol *ps_remove;
+static t_symbol *ps_clear;
+static t_symbol *ps_empty;
+
+void pxleap_zones_setup(void)
+{
+    ps_zone = gensym("zone");
+    ps_events[PXLEAP_ZONE_ENTER] = gensym("enter");
+    ps_events[PXLEAP_ZONE_EXIT] = gensym("exit");
+    ps_events[PXLEAP_ZONE_DWELL] = gensym("dwell");
+    for (int p = 0; p < PXLEAP_ZONES_PROBES; p++) ps_probes[p] = gensym(pxleap_zones_probes[p]);
+    ps_handtypes[0] = gensym("left");
+    ps_handtypes[1] = gensym("right");
+    ps_add = gensym("add");
+    ps_remove = gensym("remove");
+    ps_clear = gensym("clear");
+    ps_empty = gensym("");
+}
+
+void pxleap_zones_init(t_pxleap_zones *z)
+{
+    memset(z, 0, sizeof(*z));
+    z->back = 0;
+    atomic_init(&z->middle, 1);
+    z->front = 2;
+    atomic_init(&z->head, 0);
+    atomic_init(&z->tail, 0);
+    atomic_init(&z->dropped, 0);
+}
+
+static int pxleap_zones_cell(const t_pxleap_zoneset *s, int axis, float v)
+{
+    int c = (int)((v - s->lo[axis]) / s->cell[axis]);
+    return c < 0 ? 0 : c >= PXLEAP_ZONES_GRID ? PXLEAP_ZONES_GRID - 1 : c;
+}
+
+// the finite zones whose bounds share a cell with p
+static uint64_t pxleap_zones_lookup(const t_pxleap_zoneset *s, const float *p)
+{
+    int c[3];
+    if (!s->hasgrid) return 0;
+    for (int k = 0; k < 3; k++) {
+        if (p[k] < s->lo[k] || p[k] > s->hi[k]) return 0;
+        c[k] = pxleap_zones_cell(s, k, p[k]);
+    }
+    return s->cells[(c[0] * PXLEAP_ZONES_GRID + c[1]) * PXLEAP_ZONES_GRID + c[2]];
+}
+
+// bins every finite zone into the cells its bounds overlap
+static void pxleap_zones_index(t_pxleap_zoneset *s)
+{
+    uint64_t bounded = 0;
+    s->unbounded = 0;
+    memset(s->probemask, 0, sizeof(s->probemask));
+    memset(s->cells, 0, sizeof(s->cells));
+    for (int i = 0; i < PXLEAP_ZONES_MAX; i++) {
+        const t_pxleap_zone *zone = &s->zones[i];
+        uint64_t bit = (uint64_t)1 << i;
+        if (!(s->active & bit)) continue;
+        for (int p = 0; p < PXLEAP_ZONES_PROBES; p++) {
+            if (zone->probes & (1u << p)) s->probemask[p] |= bit;
+        }
+        if (zone->shape == PXLEAP_ZONE_PLANE) {
+            s->unbounded |= bit;
+            continue;
+        }
+        for (int k = 0; k < 3; k++) {
+            if (!bounded || zone->lo[k] < s->lo[k]) s->lo[k] = zone->lo[k];
+            if (!bounded || zone->hi[k] > s->hi[k]) s->hi[k] = zone->hi[k];
+        }
+        bounded |= bit;
+    }
+    s->hasgrid = bounded != 0;
+    if (!bounded) return;
+    // zones that are all flat along an axis share one layer of cells
+    for (int k = 0; k < 3; k++) {
+        s->cell[k] = (s->hi[k] - s->lo[k]) / PXLEAP_ZONES_GRID;
+        if (s->cell[k] <= 0.f) s->cell[k] = 1.f;
+    }
+    for (int i = 0; i < PXLEAP_ZONES_MAX; i++) {
+        const t_pxleap_zone *zone = &s->zones[i];
+        int c0[3], c1[3];
+        if (!(bounded & ((uint64_t)1 << i))) continue;
+        for (int k = 0; k < 3; k++) {
+            c0[k] = pxleap_zones_cell(s, k, zone->lo[k]);
+            c1[k] = pxleap_zones_cell(s, k, zone->hi[k]);
+        }
+        for (int x = c0[0]; x <= c1[0]; x++) {
+            for (int y = c0[1]; y <= c1[1]; y++) {
+                for (int c = c0[2]; c <= c1[2]; c++)
+                    s->cells[(x * PXLEAP_ZONES_GRID + y) * PXLEAP_ZONES_GRID + c] |= (uint64_t)1 << i;
+            }
+        }
+    }
+}
+
+// hands the edited zones to the worker, which picks them up at its next frame
+static void pxleap_zones_publish(t_pxleap_zones *z)
+{
+    uint32_t prev;
+    pxleap_zones_index(&z->edit);
+    z->sets[z->back] = z->edit;
+    prev = atomic_exchange_explicit(&z->middle, z->back | PXLEAP_TRIPLEBUF_FRESH, memory_order_acq_rel);
+    z->back = prev & PXLEAP_TRIPLEBUF_INDEX;
+}
+
+static long pxleap_zones_find(t_pxleap_zones *z, t_symbol *name)
+{
+    for (long i = 0; i < PXLEAP_ZONES_MAX; i++) {
+        if ((z->edit.active & ((uint64_t)1 << i)) && z->names[i] == name) return i;
+    }
+    return -1;
+}
+
+static uint32_t pxleap_zones_probe(t_symbol *s)
+{
+    if (!strcmp(s->s_name, "tips")) return PXLEAP_ZONES_ALLPROBES & ~1u;
+    for (int p = 0; p < PXLEAP_ZONES_PROBES; p++) {
+        if (!strcmp(s->s_name, pxleap_zones_probes[p])) return 1u << p;
+    }
+    return 0;
+}
+
+const char *pxleap_zones_add(t_pxleap_zones *z, long argc, t_atom *argv)
+{
+    t_pxleap_zone zone;
+    t_symbol *name, *shape;
+    float v[6];
+    long nvalues, slot;
+
+    if (argc < 2 || atom_gettype(argv) != A_SYM || atom_gettype(argv + 1) != A_SYM) return "zone add needs a name and a shape";
+    name = atom_getsym(argv);
+    shape = atom_getsym(argv + 1);
+    memset(&zone, 0, sizeof(zone));
+    if (!strcmp(shape->s_name, "box")) zone.shape = PXLEAP_ZONE_BOX;
+    else if (!strcmp(shape->s_name, "sphere")) zone.shape = PXLEAP_ZONE_SPHERE;
+    else if (!strcmp(shape->s_name, "plane")) zone.shape = PXLEAP_ZONE_PLANE;
+    else return "zone shapes are box, sphere and plane";
+    nvalues = zone.shape == PXLEAP_ZONE_SPHERE ? 4 : 6;
+    if (argc < 2 + nvalues) return "box needs two corners, sphere a center and radius, plane a point and normal";
+    for (long i = 0; i < nvalues; i++) {
+        if (atom_gettype(argv + 2 + i) != A_FLOAT && atom_gettype(argv + 2 + i) != A_LONG)
+            return "box needs two corners, sphere a center and radius, plane a point and normal";
+        v[i] = (float)atom_getfloat(argv + 2 + i);
+    }
+    for (long i = 2 + nvalues; i < argc; i++) {
+        uint32_t probe = atom_gettype(argv + i) == A_SYM ? pxleap_zones_probe(atom_getsym(argv + i)) : 0;
+        if (!probe) return "zone joints are palm, thumb, index, middle, ring, pinky and tips";
+        zone.probes |= probe;
+    }
+    if (!zone.probes) zone.probes = PXLEAP_ZONES_ALLPROBES;
+
+    if (zone.shape == PXLEAP_ZONE_BOX) {
+        // either pair of opposite corners will do
+        for (int k = 0; k < 3; k++) {
+            zone.a[k] = zone.lo[k] = v[k] < v[k + 3] ? v[k] : v[k + 3];
+            zone.b[k] = zone.hi[k] = v[k] < v[k + 3] ? v[k + 3] : v[k];
+        }
+    }
+    else if (zone.shape == PXLEAP_ZONE_SPHERE) {
+        if (v[3] <= 0.f) return "a sphere needs a radius above 0";
+        zone.b[0] = v[3];
+        for (int k = 0; k < 3; k++) {
+            zone.a[k] = v[k];
+            zone.lo[k] = v[k] - v[3];
+            zone.hi[k] = v[k] + v[3];
+        }
+    }
+    else {
+        float length = sqrtf(v[3] * v[3] + v[4] * v[4] + v[5] * v[5]);
+        if (length <= 0.f) return "a plane needs a normal";
+        for (int k = 0; k < 3; k++) {
+            zone.a[k] = v[k];
+            zone.b[k] = v[k + 3] / length;
+        }
+    }
+
+    slot = pxleap_zones_find(z, name);
+    for (long i = 0; slot < 0 && i < PXLEAP_ZONES_MAX; i++) {
+        if (!(z->edit.active & ((uint64_t)1 << i))) slot = i;
+    }
+    if (slot < 0) return "no room for another zone, remove one first";
+    // a new generation tells the worker the zone starts over, even in the same slot
+    if (!++z->nextgeneration) ++z->nextgeneration;
+    zone.generation = z->nextgeneration;
+    z->edit.zones[slot] = zone;
+    z->edit.active |= (uint64_t)1 << slot;
+    z->names[slot] = name;
+    pxleap_zones_publish(z);
+    return NULL;
+}
+
+int pxleap_zones_remove(t_pxleap_zones *z, t_symbol *name)
+{
+    long slot = pxleap_zones_find(z, name);
+    if (slot < 0) return 0;
+    z->edit.active &= ~((uint64_t)1 << slot);
+    z->names[slot] = NULL;
+    pxleap_zones_publish(z);
+    return 1;
+}
+
+void pxleap_zones_clear(t_pxleap_zones *z)
+{
+    z->edit.active = 0;
+    memset(z->names, 0, sizeof(z->names));
+    pxleap_zones_publish(z);
+}
+
+void pxleap_zones_setdwell(t_pxleap_zones *z, double ms)
+{
+    z->dwell = ms > 0. ? ms : 0.;
+    z->edit.dwell = (int64_t)(z->dwell * 1000.);
+    pxleap_zones_publish(z);
+}
+
+int pxleap_zones_pop(t_pxleap_zones *z, t_pxleap_zone_event *e, t_symbol **name)
+{
+    for (;;) {
+        uint64_t tail = atomic_load_explicit(&z->tail, memory_order_relaxed);
+        if (tail == atomic_load_explicit(&z->head, memory_order_acquire)) return 0;
+        *e = z->events[tail % PXLEAP_ZONES_EVENTS];
+        atomic_store_explicit(&z->tail, tail + 1, memory_order_release);
+        // events from before a zone was replaced or removed no longer have a name to go out under
+        if ((z->edit.active & ((uint64_t)1 << e->zone)) && z->edit.zones[e->zone].generation == e->generation) {
+            *name = z->names[e->zone];
+            return 1;
+        }
+    }
+}
+
+void pxleap_zones_message(t_pxleap_zones *z, t_object *owner, long argc, t_atom *argv)
+{
+    t_symbol *command = argc ? atom_getsym(argv) : ps_empty;
+    if (command == ps_add) {
+        const char *error = pxleap_zones_add(z, argc - 1, argv + 1);
+        if (error) object_error(owner, "%s", error);
+    }
+    else if (command == ps_remove && argc > 1) {
+        if (!pxleap_zones_remove(z, atom_getsym(argv + 1)))
+            object_error(owner, "no zone named %s", atom_getsym(argv + 1)->s_name);
+    }
+    else if (command == ps_clear) pxleap_zones_clear(z);
+    else object_error(owner, "zone needs add <name> <shape>, remove <name> or clear");
+}
+
+void pxleap_zones_output(t_pxleap_zones *z, t_object *owner, void *outlet)
+{
+    t_pxleap_zone_event e;
+    t_symbol *name;
+    t_atom a[5];
+    uint64_t dropped;
+    while (pxleap_zones_pop(z, &e, &name)) {
+        atom_setsym(a, name);
+        atom_setsym(a + 1, ps_events[e.type]);
+        atom_setsym(a + 2, ps_handtypes[e.hand]);
+        atom_setsym(a + 3, ps_probes[e.probe]);
+        atom_setfloat(a + 4, (double)e.duration / 1000.);
+        outlet_anything(outlet, ps_zone, e.type == PXLEAP_ZONE_ENTER ? 4 : 5, a);
+    }
+    dropped = atomic_load_explicit(&z->dropped, memory_order_relaxed);
+    if (dropped != z->droppedseen) {
+        object_warn(owner, "%llu zone events dropped before they could go out", (unsigned long long)(dropped - z->droppedseen));
+        z->droppedseen = dropped;
+    }
+}
+
+static int pxleap_zones_push(t_pxleap_zones *z, int type, int zone, int hand, int probe, int64_t duration)
+{
+    uint64_t head = atomic_load_explicit(&z->head, memory_order_relaxed);
+    t_pxleap_zone_event *e;
+    if (head - atomic_load_explicit(&z->tail, memory_order_acquire) >= PXLEAP_ZONES_EVENTS) {
+        atomic_fetch_add_explicit(&z->dropped, 1, memory_order_relaxed);
+        return 0;
+    }
+    e = &z->events[head % PXLEAP_ZONES_EVENTS];
+    e->type = (uint8_t)type;
+    e->zone = (uint8_t)zone;
+    e->hand = (uint8_t)hand;
+    e->probe = (uint8_t)probe;
+    e->generation = z->generation[zone];
+    e->duration = duration;
+    atomic_store_explicit(&z->head, head + 1, memory_order_release);
+    return 1;
+}
+
+// zones that were removed or replaced start over, without events for them
+static void pxleap_zones_sync(t_pxleap_zones *z, const t_pxleap_zoneset *s)
+{
+    uint64_t stale = 0;
+    for (int i = 0; i < PXLEAP_ZONES_MAX; i++) {
+        uint32_t generation = (s->active & ((uint64_t)1 << i)) ? s->zones[i].generation : 0;
+        if (generation != z->generation[i]) {
+            stale |= (uint64_t)1 << i;
+            z->generation[i] = generation;
+        }
+    }
+    for (int t = 0; t < 2; t++) {
+        for (int p = 0; p < PXLEAP_ZONES_PROBES; p++) {
+            z->inside[t][p] &= ~stale;
+            z->dwelt[t][p] &= ~stale;
+        }
+    }
+}
+
+static int pxleap_zone_contains(const t_pxleap_zone *zone, const float *p)
+{
+    float d[3];
+    switch (zone->shape) {
+    case PXLEAP_ZONE_BOX:
+        return p[0] >= zone->a[0] && p[0] <= zone->b[0] && p[1] >= zone->a[1] && p[1] <= zone->b[1]
+            && p[2] >= zone->a[2] && p[2] <= zone->b[2];
+    case PXLEAP_ZONE_SPHERE:
+        for (int k = 0; k < 3; k++) d[k] = p[k] - zone->a[k];
+        return d[0] * d[0] + d[1] * d[1] + d[2] * d[2] <= zone->b[0] * zone->b[0];
+    default:
+        for (int k = 0; k < 3; k++) d[k] = p[k] - zone->a[k];
+        return d[0] * zone->b[0] + d[1] * zone->b[1] + d[2] * zone->b[2] >= 0.f;
+    }
+}
+
+int pxleap_zones_apply(t_pxleap_zones *z, const t_pxleap_frame *frame)
+{
+    const t_pxleap_zoneset *s;
+    uint64_t now[2][PXLEAP_ZONES_PROBES];
+    int queued = 0;
+
+    if (atomic_load_explicit(&z->middle, memory_order_relaxed) & PXLEAP_TRIPLEBUF_FRESH) {
+        uint32_t prev = atomic_exchange_explicit(&z->middle, z->front, memory_order_acq_rel);
+        z->front = prev & PXLEAP_TRIPLEBUF_INDEX;
+        pxleap_zones_sync(z, &z->sets[z->front]);
+    }
+    s = &z->sets[z->front];
+    // with no zones nothing can be inside one either, sync saw to that
+    if (!s->active) return 0;
+
+    memset(now, 0, sizeof(now));
+    for (uint32_t h = 0; h < frame->nHands; h++) {
+        const LEAP_HAND *hand = &frame->hands[h];
+        int type = hand->type == eLeapHandType_Left ? 0 : 1;
+        for (int p = 0; p < PXLEAP_ZONES_PROBES; p++) {
+            const float *pos = p ? hand->digits[p - 1].bones[3].next_joint.v : hand->palm.position.v;
+            uint64_t candidates;
+            if (!s->probemask[p]) continue;
+            candidates = (pxleap_zones_lookup(s, pos) | s->unbounded) & s->probemask[p];
+            while (candidates) {
+                int i = __builtin_ctzll(candidates);
+                candidates &= candidates - 1;
+                if (pxleap_zone_contains(&s->zones[i], pos)) now[type][p] |= (uint64_t)1 << i;
+            }
+        }
+    }
+
+    // a hand that left the frame leaves every zone it was in
+    for (int t = 0; t < 2; t++) {
+        for (int p = 0; p < PXLEAP_ZONES_PROBES; p++) {
+            uint64_t entered = now[t][p] & ~z->inside[t][p];
+            uint64_t exited = z->inside[t][p] & ~now[t][p];
+            uint64_t waiting;
+            while (exited) {
+                int i = __builtin_ctzll(exited);
+                exited &= exited - 1;
+                queued += pxleap_zones_push(z, PXLEAP_ZONE_EXIT, i, t, p, frame->timestamp - z->entered[t][p][i]);
+            }
+            while (entered) {
+                int i = __builtin_ctzll(entered);
+                entered &= entered - 1;
+                z->entered[t][p][i] = frame->timestamp;
+                queued += pxleap_zones_push(z, PXLEAP_ZONE_ENTER, i, t, p, 0);
+            }
+            z->inside[t][p] = now[t][p];
+            z->dwelt[t][p] &= now[t][p];
+            waiting = s->dwell ? now[t][p] & ~z->dwelt[t][p] : 0;
+            while (waiting) {
+                int i = __builtin_ctzll(waiting);
+                int64_t duration = frame->timestamp - z->entered[t][p][i];
+                waiting &= waiting - 1;
+                if (duration < s->dwell) continue;
+                z->dwelt[t][p] |= (uint64_t)1 << i;
+                queued += pxleap_zones_push(z, PXLEAP_ZONE_DWELL, i, t, p, duration);
+            }
+        }
+    }
+    return queued;
+}
+
+void pxleap_zones_reset(t_pxleap_zones *z)
+{
+    memset(z->inside, 0, sizeof(z->inside));
+    memset(z->dwelt, 0, sizeof(z->dwelt));
+    atomic_store_explicit(&z->tail, atomic_load_explicit(&z->head, memory_order_relaxed), memory_order_relaxed);
+}
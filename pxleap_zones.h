@@ -0,0 +1,131 @@
+//
+// pxleap_zones
+//
+// Trigger zones tested against the palm and fingertips on the worker thread. Boxes, spheres
+// and planes are defined by message, and only entering, leaving or dwelling in one reaches the
+// patch, so nothing goes out while the hands stay put. Finite zones are binned into a coarse
+// grid, so each joint only tests the zones around it.
+//
+// author: Andrew Benson
+// contact: pixlpa@gmail.com
+//
+
+#ifndef PXLEAP_ZONES_H
+#define PXLEAP_ZONES_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include "ext.h"
+#include "pxleap_frame.h"
+
+// one bit per zone in every mask below
+#define PXLEAP_ZONES_MAX 64
+// the palm, then the thumb to pinky tips
+#define PXLEAP_ZONES_PROBES 6
+#define PXLEAP_ZONES_ALLPROBES 0x3fu
+// cells per axis, over the bounds of every finite zone
+#define PXLEAP_ZONES_GRID 8
+// events the worker can get ahead of the Max thread
+#define PXLEAP_ZONES_EVENTS 256
+
+#define PXLEAP_ZONE_BOX 0
+#define PXLEAP_ZONE_SPHERE 1
+#define PXLEAP_ZONE_PLANE 2                 // the side the normal points to
+
+#define PXLEAP_ZONE_ENTER 0
+#define PXLEAP_ZONE_EXIT 1
+#define PXLEAP_ZONE_DWELL 2
+
+typedef struct _pxleap_zone
+{
+    int shape;
+    float a[3];                             // box min, sphere center or a point on the plane
+    float b[3];                             // box max, sphere radius in b[0] or the plane's unit normal
+    float lo[3], hi[3];                     // bounds of a box or sphere
+    uint32_t probes;                        // which joints it tests, one bit per probe
+    uint32_t generation;                    // changes whenever the zone is replaced
+} t_pxleap_zone;
+
+// everything the worker tests against, compiled by the Max thread on every change
+typedef struct _pxleap_zoneset
+{
+    t_pxleap_zone zones[PXLEAP_ZONES_MAX];
+    uint64_t active;
+    uint64_t unbounded;                     // active planes, tested wherever a joint is
+    uint64_t probemask[PXLEAP_ZONES_PROBES];  // zones each probe is tested against
+    int64_t dwell;                          // microseconds inside before a dwell event, 0 for none
+    int hasgrid;
+    float lo[3], hi[3], cell[3];
+    uint64_t cells[PXLEAP_ZONES_GRID * PXLEAP_ZONES_GRID * PXLEAP_ZONES_GRID];
+} t_pxleap_zoneset;
+
+typedef struct _pxleap_zone_event
+{
+    uint8_t type;                           // PXLEAP_ZONE_ENTER, EXIT or DWELL
+    uint8_t zone;
+    uint8_t hand;                           // 0 left, 1 right
+    uint8_t probe;
+    uint32_t generation;                    // of the zone, so events for one since replaced are dropped
+    int64_t duration;                       // microseconds inside, for exit and dwell
+} t_pxleap_zone_event;
+
+typedef struct _pxleap_zones
+{
+    // Max thread: the zones as defined, and the name of each
+    t_pxleap_zoneset edit;
+    t_symbol *names[PXLEAP_ZONES_MAX];
+    uint32_t nextgeneration;
+    double dwell;                           // @dwell as set, in ms
+    uint64_t droppedseen;                   // dropped events already reported
+
+    // handed to the worker like frames, but written by the Max thread
+    t_pxleap_zoneset sets[3];
+    _Atomic uint32_t middle;                // slot index | PXLEAP_TRIPLEBUF_FRESH
+    uint32_t back;                          // owned by the Max thread
+    uint32_t front;                         // owned by the worker
+
+    // owned by the worker
+    uint32_t generation[PXLEAP_ZONES_MAX];  // of each zone its state below belongs to
+    uint64_t inside[2][PXLEAP_ZONES_PROBES];
+    uint64_t dwelt[2][PXLEAP_ZONES_PROBES]; // dwell already sent since entering
+    int64_t entered[2][PXLEAP_ZONES_PROBES][PXLEAP_ZONES_MAX];
+
+    // events from the worker to the Max thread
+    t_pxleap_zone_event events[PXLEAP_ZONES_EVENTS];
+    _Atomic uint64_t head;                  // only written by the worker
+    _Atomic uint64_t tail;                  // only written by the Max thread
+    _Atomic uint64_t dropped;               // events the worker found no room for
+} t_pxleap_zones;
+
+// joint names of the probes, "palm" then "thumb" to "pinky"
+extern const char *pxleap_zones_probes[PXLEAP_ZONES_PROBES];
+
+// looks up the symbols of the zone messages, once from each class's main
+void pxleap_zones_setup(void);
+void pxleap_zones_init(t_pxleap_zones *z);
+
+// Max thread: zone add <name> box <x1 y1 z1> <x2 y2 z2>, sphere <x y z> <radius> or
+// plane <x y z> <nx ny nz>, then the joints to test (default all of them). a zone that's
+// already defined is replaced. returns NULL or what was wrong with the arguments.
+const char *pxleap_zones_add(t_pxleap_zones *z, long argc, t_atom *argv);
+// returns 0 if there is no zone by that name
+int pxleap_zones_remove(t_pxleap_zones *z, t_symbol *name);
+void pxleap_zones_clear(t_pxleap_zones *z);
+// milliseconds inside before a dwell event, 0 for none
+void pxleap_zones_setdwell(t_pxleap_zones *z, double ms);
+// Max thread: the next event and the name of its zone, 0 when there are none left
+int pxleap_zones_pop(t_pxleap_zones *z, t_pxleap_zone_event *e, t_symbol **name);
+// Max thread: the zone message of either object, zone add <name> <shape> ..., zone remove <name>
+// or zone clear. errors are reported against owner.
+void pxleap_zones_message(t_pxleap_zones *z, t_object *owner, long argc, t_atom *argv);
+// Max thread: every queued event out of outlet as zone <name> <enter|exit|dwell> <left|right>
+// <joint>, with the ms spent inside for exit and dwell, then a warning if any were dropped
+void pxleap_zones_output(t_pxleap_zones *z, t_object *owner, void *outlet);
+
+// worker side: tests the frame's palms and tips, queues what changed and returns how many
+// events it queued
+int pxleap_zones_apply(t_pxleap_zones *z, const t_pxleap_frame *frame);
+// forgets which joints are inside what, only while the worker isn't running
+void pxleap_zones_reset(t_pxleap_zones *z);
+
+#endif